@@ -0,0 +1,294 @@
+#ifndef H_ARCH_TRAITS_H
+#define H_ARCH_TRAITS_H
+
+#include <cstdint>
+
+#include "config.hpp"
+#include "registers.hpp"
+#include "breakpoint.hpp"
+#include "syscall_mngr.hpp"
+#include "displaced_step.hpp"
+#include "hw_breakpoint.hpp"
+
+/**
+ * @brief Everything the tracing core needs to know about an architecture
+ *
+ * The architecture dependent code is written as templates over the traits,
+ * so register access and syscall decoding are resolved at compile time
+ * instead of going through a runtime switch and a cast of the register
+ * object. The register classes are final, calls through
+ * ArchTraits::Register are not virtual.
+ *
+ * Each traits provides :
+ * - Register : register class of the architecture
+ * - Injector : breakpoint injector of the architecture
+ * - Stepper : out of line execution of the breakpoint instructions
+ * - DebugRegisters : access to the hardware breakpoint registers
+ * - syscall_id_reg : register holding the syscall number at a syscall stop
+ * - syscall_nr_reg : register the syscall number is passed in
+ * - syscall_ret_reg : register holding the return value of the syscall
+ * - syscallArgReg(idx) : register of the idx-th syscall argument
+ * - canonicalize(call_id) : platform syscall number to SysCallId
+ * - has_single_step : the kernel supports PTRACE_SINGLESTEP, without it the
+ *   step over is emulated with a breakpoint on the next instruction
+ * - breakpointAddr(pc) : address of the breakpoint from the PC at the trap
+ * - resumeOverHwBreakpoint(regs, type) : let the Tracee resume past the
+ *   hardware breakpoint which stopped it, false if the slot has to be
+ *   disarmed while the instruction is stepped over
+ *
+ * src : https://chromium.googlesource.com/chromiumos/docs/+/HEAD/constants/syscalls.md
+ *
+ *     arch     syscall NR  return  arg0  arg1  arg2  arg3  arg4  arg5
+ *     arm      r7          r0      r0    r1    r2    r3    r4    r5
+ *     arm64    x8          x0      x0    x1    x2    x3    x4    x5
+ *     x86      eax         eax     ebx   ecx   edx   esi   edi   ebp
+ *     x86_64   rax         rax     rdi   rsi   rdx   r10   r8    r9
+ *
+ * @ingroup platform_support
+ */
+template <CPU_ARCH arch>
+struct ArchTraits;
+
+template <>
+struct ArchTraits<CPU_ARCH::AMD64> {
+    typedef AMD64Register Register;
+    typedef X86BreakpointInjector Injector;
+    typedef AMD64DisplacedStepper Stepper;
+    typedef X86DebugRegisters DebugRegisters;
+
+    static constexpr CPU_ARCH cpu_arch = CPU_ARCH::AMD64;
+    static constexpr bool has_single_step = true;
+    static constexpr uint8_t syscall_id_reg = AMD64Register::ORIG_RAX;
+    static constexpr uint8_t syscall_nr_reg = AMD64Register::RAX;
+    static constexpr uint8_t syscall_ret_reg = AMD64Register::RAX;
+
+    static uint8_t syscallArgReg(int idx) {
+        static const uint8_t arg_regs[] = {
+            AMD64Register::RDI, AMD64Register::RSI, AMD64Register::RDX,
+            AMD64Register::R10, AMD64Register::R8, AMD64Register::R9
+        };
+        return arg_regs[idx];
+    }
+
+    static SysCallId canonicalize(int16_t call_id) {
+        return amd64_canonicalize_syscall(static_cast<AMD64_SYSCALL>(call_id));
+    }
+
+    /// @brief PC is past the 1 byte int3
+    static uintptr_t breakpointAddr(uintptr_t pc) { return pc - 1; }
+
+    /// @brief instruction breakpoints are faults, RF skips them once,
+    /// watchpoints trap after the access
+    static bool resumeOverHwBreakpoint(Register& regs, HwBreakpointType type) {
+        if (type == HwBreakpointType::EXECUTE)
+            regs.setRegIdx(Register::EFLAGS, regs.getRegIdx(Register::EFLAGS) | X86_EFLAGS_RF);
+        return true;
+    }
+};
+
+template <>
+struct ArchTraits<CPU_ARCH::X86> {
+    typedef X86Register Register;
+    typedef X86BreakpointInjector Injector;
+    typedef DisplacedStepper Stepper;
+    typedef X86DebugRegisters DebugRegisters;
+
+    static constexpr CPU_ARCH cpu_arch = CPU_ARCH::X86;
+    static constexpr bool has_single_step = true;
+    static constexpr uint8_t syscall_id_reg = X86Register::ORIG_EAX;
+    static constexpr uint8_t syscall_nr_reg = X86Register::EAX;
+    static constexpr uint8_t syscall_ret_reg = X86Register::EAX;
+
+    static uint8_t syscallArgReg(int idx) {
+        static const uint8_t arg_regs[] = {
+            X86Register::EBX, X86Register::ECX, X86Register::EDX,
+            X86Register::ESI, X86Register::EDI, X86Register::EBP
+        };
+        return arg_regs[idx];
+    }
+
+    static SysCallId canonicalize(int16_t call_id) {
+        return i386_canonicalize_syscall(call_id);
+    }
+
+    static uintptr_t breakpointAddr(uintptr_t pc) { return pc - 1; }
+
+    /// @brief instruction breakpoints are faults, RF skips them once,
+    /// watchpoints trap after the access
+    static bool resumeOverHwBreakpoint(Register& regs, HwBreakpointType type) {
+        if (type == HwBreakpointType::EXECUTE)
+            regs.setRegIdx(Register::EFLAGS, regs.getRegIdx(Register::EFLAGS) | X86_EFLAGS_RF);
+        return true;
+    }
+};
+
+template <>
+struct ArchTraits<CPU_ARCH::ARM32> {
+    typedef ARM32Register Register;
+    typedef ARMBreakpointInjector Injector;
+    typedef ARM32DisplacedStepper Stepper;
+    typedef HwDebugRegisters DebugRegisters;
+
+    static constexpr CPU_ARCH cpu_arch = CPU_ARCH::ARM32;
+    static constexpr bool has_single_step = false;
+    static constexpr uint8_t syscall_id_reg = ARM32Register::R7;
+    static constexpr uint8_t syscall_nr_reg = ARM32Register::R7;
+    static constexpr uint8_t syscall_ret_reg = ARM32Register::R0;
+
+    static uint8_t syscallArgReg(int idx) {
+        static const uint8_t arg_regs[] = {
+            ARM32Register::R0, ARM32Register::R1, ARM32Register::R2,
+            ARM32Register::R3, ARM32Register::R4, ARM32Register::R5
+        };
+        return arg_regs[idx];
+    }
+
+    static SysCallId canonicalize(int16_t call_id) {
+        return arm32_canonicalize_syscall(call_id);
+    }
+
+    /// @brief the undefined instruction trap doesn't advance the PC
+    static uintptr_t breakpointAddr(uintptr_t pc) { return pc; }
+
+    /// @brief no debug register support
+    static bool resumeOverHwBreakpoint(Register& regs, HwBreakpointType type) { return false; }
+};
+
+template <>
+struct ArchTraits<CPU_ARCH::ARM64> {
+    typedef ARM64Register Register;
+    typedef ARM64BreakpointInjector Injector;
+    typedef DisplacedStepper Stepper;
+    typedef ARM64DebugRegisters DebugRegisters;
+
+    static constexpr CPU_ARCH cpu_arch = CPU_ARCH::ARM64;
+    static constexpr bool has_single_step = true;
+    static constexpr uint8_t syscall_id_reg = ARM64Register::X8;
+    static constexpr uint8_t syscall_nr_reg = ARM64Register::X8;
+    static constexpr uint8_t syscall_ret_reg = ARM64Register::X0;
+
+    static uint8_t syscallArgReg(int idx) {
+        static const uint8_t arg_regs[] = {
+            ARM64Register::X0, ARM64Register::X1, ARM64Register::X2,
+            ARM64Register::X3, ARM64Register::X4, ARM64Register::X5
+        };
+        return arg_regs[idx];
+    }
+
+    static SysCallId canonicalize(int16_t call_id) {
+        return arm64_canonicalize_syscall(static_cast<ARM64_SYSCALL>(call_id));
+    }
+
+    /// @brief brk doesn't advance the PC
+    static uintptr_t breakpointAddr(uintptr_t pc) { return pc; }
+
+    /// @brief breakpoints and watchpoints are reported before the
+    /// instruction completes
+    static bool resumeOverHwBreakpoint(Register& regs, HwBreakpointType type) { return false; }
+};
+
+/// @brief Traits of the architecture selected in config.hpp
+typedef ArchTraits<TARGET_CPU_ARCH> TargetArch;
+
+/// @brief Register object of the Tracee as the register class of the architecture
+template <typename Arch>
+typename Arch::Register& archRegisters(Registers& regs) {
+    return static_cast<typename Arch::Register&>(regs);
+}
+
+#if defined(SUPPORT_ARCH_AMD64)
+#define ARCH_CASE_AMD64(...) \
+    case CPU_ARCH::AMD64: { typedef ArchTraits<CPU_ARCH::AMD64> Arch; __VA_ARGS__; } break;
+#else
+#define ARCH_CASE_AMD64(...)
+#endif
+
+#if defined(SUPPORT_ARCH_X86)
+#define ARCH_CASE_X86(...) \
+    case CPU_ARCH::X86: { typedef ArchTraits<CPU_ARCH::X86> Arch; __VA_ARGS__; } break;
+#else
+#define ARCH_CASE_X86(...)
+#endif
+
+#if defined(SUPPORT_ARCH_ARM)
+#define ARCH_CASE_ARM32(...) \
+    case CPU_ARCH::ARM32: { typedef ArchTraits<CPU_ARCH::ARM32> Arch; __VA_ARGS__; } break;
+#else
+#define ARCH_CASE_ARM32(...)
+#endif
+
+#if defined(SUPPORT_ARCH_ARM64)
+#define ARCH_CASE_ARM64(...) \
+    case CPU_ARCH::ARM64: { typedef ArchTraits<CPU_ARCH::ARM64> Arch; __VA_ARGS__; } break;
+#else
+#define ARCH_CASE_ARM64(...)
+#endif
+
+/**
+ * @brief Case labels of every architecture enabled in config.hpp, the
+ * statement is compiled once per architecture with `Arch` naming its
+ * traits. Only the enabled architectures are instantiated.
+ *
+ *     switch (traceeProg.m_target_desc.m_cpu_arch) {
+ *     ARCH_DISPATCH(readRetValue<Arch>(traceeProg))
+ *     default:
+ *         m_log->error("Invalid Archictecture");
+ *     }
+ */
+#define ARCH_DISPATCH(...) \
+    ARCH_CASE_AMD64(__VA_ARGS__) \
+    ARCH_CASE_X86(__VA_ARGS__) \
+    ARCH_CASE_ARM32(__VA_ARGS__) \
+    ARCH_CASE_ARM64(__VA_ARGS__)
+
+/**
+ * @brief Register access of the code which isn't templated on the traits,
+ * dispatched on the architecture of the Tracee, never cast the registers
+ * to those of another architecture
+ */
+inline uintptr_t archProgramCounter(CPU_ARCH cpu_arch, Registers& regs) {
+    switch (cpu_arch) {
+    ARCH_DISPATCH(return archRegisters<Arch>(regs).getProgramCounter())
+    default:
+        break;
+    }
+    return 0;
+}
+
+inline void archSetProgramCounter(CPU_ARCH cpu_arch, Registers& regs, uintptr_t pc) {
+    switch (cpu_arch) {
+    ARCH_DISPATCH(archRegisters<Arch>(regs).setProgramCounter(pc))
+    default:
+        break;
+    }
+}
+
+/// @brief address of the breakpoint which trapped, see ArchTraits::breakpointAddr
+inline uintptr_t archBreakpointAddr(CPU_ARCH cpu_arch, Registers& regs) {
+    switch (cpu_arch) {
+    ARCH_DISPATCH(return Arch::breakpointAddr(archRegisters<Arch>(regs).getProgramCounter()))
+    default:
+        break;
+    }
+    return 0;
+}
+
+inline bool archHasSingleStep(CPU_ARCH cpu_arch) {
+    switch (cpu_arch) {
+    ARCH_DISPATCH(return Arch::has_single_step)
+    default:
+        break;
+    }
+    return false;
+}
+
+inline bool archResumeOverHwBreakpoint(CPU_ARCH cpu_arch, Registers& regs, HwBreakpointType type) {
+    switch (cpu_arch) {
+    ARCH_DISPATCH(return Arch::resumeOverHwBreakpoint(archRegisters<Arch>(regs), type))
+    default:
+        break;
+    }
+    return false;
+}
+
+#endif
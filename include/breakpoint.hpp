@@ -38,7 +38,7 @@ public:
      *                  and the data of the original instruction will be copied
      * into the address object
      */
-    virtual void inject(DebugOpts& debug_opts, std::unique_ptr<Addr>& targetAddress) {};
+    virtual void inject(DebugOpts& debug_opts, Addr& targetAddress) {};
 
     /**
      * @brief Restore the original instruction in the Tracee process
@@ -46,7 +46,28 @@ public:
      * @param debug_opts 
      * @param targetAddress 
      */
-    virtual void restore(DebugOpts& debug_opts, std::unique_ptr<Addr>& targetAddress) {};
+    virtual void restore(DebugOpts& debug_opts, Addr& targetAddress) {};
+
+    /**
+     * @brief Insert a breakpoint into a local copy of the Tracee memory, the
+     * caller writes the copy back, see BreakpointMngr::writeBreakpoints
+     * 
+     * @param debug_opts Tracee whose memory was copied
+     * @param code copy of the memory at targetAddress, holds at least the
+     * size of targetAddress bytes
+     * @param targetAddress the original instruction is copied into it
+     */
+    virtual void injectInBuffer(DebugOpts& debug_opts, uint8_t* code, Addr& targetAddress) {};
+
+    /**
+     * @brief Restore the original instruction in a local copy of the Tracee
+     * memory
+     * 
+     * @param debug_opts 
+     * @param code copy of the memory at targetAddress
+     * @param targetAddress 
+     */
+    virtual void restoreInBuffer(DebugOpts& debug_opts, uint8_t* code, Addr& targetAddress) {};
 };
 
 // its 1 but I need to fix it
@@ -57,16 +78,20 @@ class X86BreakpointInjector : public BreakpointInjector {
 public:
     X86BreakpointInjector() : BreakpointInjector(INTEL_BREAKPOINT_INST_SIZE) {};
 
-    void inject(DebugOpts& debug_opts, std::unique_ptr<Addr>& targetAddress);
-    void restore(DebugOpts& debug_opts, std::unique_ptr<Addr>& targetAddress);
+    void inject(DebugOpts& debug_opts, Addr& targetAddress);
+    void restore(DebugOpts& debug_opts, Addr& targetAddress);
+    void injectInBuffer(DebugOpts& debug_opts, uint8_t* code, Addr& targetAddress);
+    void restoreInBuffer(DebugOpts& debug_opts, uint8_t* code, Addr& targetAddress);
 };
 
 struct ARMBreakpointInjector : public BreakpointInjector {
 
     ARMBreakpointInjector(): BreakpointInjector(4) {}
 
-    void inject(DebugOpts& debug_opts, std::unique_ptr<Addr>& targetAddress);
-    void restore(DebugOpts& debug_opts, std::unique_ptr<Addr>& targetAddress);
+    void inject(DebugOpts& debug_opts, Addr& targetAddress);
+    void restore(DebugOpts& debug_opts, Addr& targetAddress);
+    void injectInBuffer(DebugOpts& debug_opts, uint8_t* code, Addr& targetAddress);
+    void restoreInBuffer(DebugOpts& debug_opts, uint8_t* code, Addr& targetAddress);
 };
 
 
@@ -74,8 +99,10 @@ struct ARM64BreakpointInjector : public BreakpointInjector {
 
     ARM64BreakpointInjector(): BreakpointInjector(4) {}
 
-    void inject(DebugOpts& debug_opts, std::unique_ptr<Addr>& targetAddress);
-    void restore(DebugOpts& debug_opts, std::unique_ptr<Addr>& targetAddress);
+    void inject(DebugOpts& debug_opts, Addr& targetAddress);
+    void restore(DebugOpts& debug_opts, Addr& targetAddress);
+    void injectInBuffer(DebugOpts& debug_opts, uint8_t* code, Addr& targetAddress);
+    void restoreInBuffer(DebugOpts& debug_opts, uint8_t* code, Addr& targetAddress);
 };
 
 
@@ -150,7 +177,7 @@ public:
     
     /// @brief breakpoint instruction data is stored to the memory
     /// later restored when brk pnt is hit
-    std::unique_ptr<Addr> m_backupData = nullptr;
+    Addr m_backupData;
     
     // DebugOpts& m_debug_opts = nullptr;
     
@@ -209,12 +236,12 @@ public:
     }
 
     void reset() {
-        m_log->trace("Breakpoint at {:x} going out scope!", m_addr);
+        SPDLOG_LOGGER_TRACE(m_log, "Breakpoint at {:x} going out scope!", m_addr);
         m_addr = 0;
         m_offset = 0;
         m_hit_count = 0;
         m_enabled = false;
-        m_backupData.reset();
+        m_backupData = Addr();
     }
 
     Breakpoint& setInjector(BreakpointInjector* brk_pnt_injector);
@@ -234,7 +261,7 @@ public:
     virtual void setAddress(uintptr_t brkpnt_addr);
 
     void printDebug() {
-        m_log->debug("[0x{:x}] [{}] count {} ", m_addr, m_label.c_str(), m_hit_count);
+        SPDLOG_LOGGER_DEBUG(m_log, "[0x{:x}] [{}] count {} ", m_addr, m_label.c_str(), m_hit_count);
     }
 
     uint32_t getHitCount() { return m_hit_count; }
@@ -276,6 +303,23 @@ public:
      * @return int 
      */
     virtual int disable(TraceeProgram &traceeProg);
+
+    /**
+     * @brief Enable the breakpoint in a local copy of the Tracee memory,
+     * used to place the breakpoints of a page with a single write
+     * 
+     * @param traceeProg tracee whose memory was copied
+     * @param code copy of the memory at @ref m_addr
+     */
+    virtual void enableInBuffer(TraceeProgram &traceeProg, uint8_t* code);
+
+    /**
+     * @brief Disable the breakpoint in a local copy of the Tracee memory
+     * 
+     * @param traceeProg tracee whose memory was copied
+     * @param code copy of the memory at @ref m_addr
+     */
+    virtual void disableInBuffer(TraceeProgram &traceeProg, uint8_t* code);
 };
 
 /** @} End of Group */
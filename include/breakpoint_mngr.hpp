@@ -2,10 +2,20 @@
 #define H_BREAKPOINT_MANAGER_H
 
 #include <map>
+#include <set>
 #include <list>
+#include <mutex>
+#include <atomic>
+#include <vector>
 
 #include "breakpoint.hpp"
+#include "displaced_step.hpp"
+#include "flat_addr_map.hpp"
+#include "hw_breakpoint.hpp"
 
+/// @brief breakpoints are read and written to the Tracee memory in
+/// clusters which don't cross this boundary
+#define BRKPNT_BATCH_PAGE_SIZE 4096
 
 class TargetDescription;
 class TraceeProgram;
@@ -44,6 +54,12 @@ class ArmDisassembler;
  *  1. Each breakpoint will have information that to list of all process
  *     breakpoint is placed
  *  
+ * The manager can be shared by the Debuggers of a ShardedDebugger, every
+ * operation holds m_lock so the breakpoint handlers are never run
+ * concurrently. Threads of a process in different shards can step over
+ * the same breakpoint at the same time, m_step_overs counts them so the
+ * breakpoint is only put back by the last one.
+ * 
  * Use cases to handle
  * -------------------
  * 
@@ -69,7 +85,7 @@ public:
      * @brief Breakpoints which are alive in the tracee Process
      * 
      */
-    std::map<uintptr_t, Breakpoint*> m_active_brkpnt;
+    FlatAddrMap<Breakpoint*> m_active_brkpnt;
     
     /**
      * @brief Branch information Cache
@@ -78,21 +94,53 @@ public:
      * Single-Stepping feature for the Debugger
      * 
      */
-    std::map<uintptr_t, std::unique_ptr<BranchData>> m_branch_info_cache;
+    FlatAddrMap<std::unique_ptr<BranchData>> m_branch_info_cache;
 
     TargetDescription& m_target_desc;
 
-    /**
-     * @brief this is brk point is saved to restore the breakpoint once it has
-     * executed, if there is no breakpoint has hit then this value should be
-     * null this stores the key as thread on which the breakpoint was hit and
-     * value is the breakpoint which was hit.
-     */
-    std::map<pid_t, Breakpoint*> m_suspendedBrkPnt;
-
     ArmDisassembler* m_arm_disasm;
+
+    /// @brief executes the breakpoint instructions out of line, nullptr
+    /// until enableDisplacedStepping is called
+    DisplacedStepper* m_displaced_stepper = nullptr;
+
+    /// @brief scratch pad of each process, by thread group id
+    std::map<pid_t, ScratchPad> m_scratch_pads;
+
+    /// @brief debug registers of the architecture, see HwBreakpoint
+    HwDebugRegisters* m_debug_regs;
+
+    /// @brief hardware breakpoints by debug register slot, nullptr for a
+    /// free slot
+    std::vector<HwBreakpoint*> m_hw_brkpnt;
+
+    /// @brief hardware breakpoints waiting for a slot, see addHwBreakpoint
+    std::list<HwBreakpoint*> m_hw_pending;
+
+    /// @brief retired hardware breakpoints still armed in some threads,
+    /// read without the lock on every stop, see disarmRetiredHw
+    std::atomic<int> m_hw_retiring{0};
+
+    /// @brief free the slot of a retired hardware breakpoint once no
+    /// thread has it armed anymore
+    void releaseHwSlot(HwBreakpoint* hw_brkpnt);
+
+    /// @brief threads stepping over a breakpoint removed from the memory,
+    /// by breakpoint address, see restoreSuspendedBreakpoint
+    std::map<uintptr_t, int> m_step_overs;
+
+    /// @brief single shot breakpoints which were hit but are still in the
+    /// memory, by thread group id, see retireBreakpoint
+    std::map<pid_t, std::vector<Breakpoint*>> m_retired_brkpnt;
+
+    /// @brief addresses of the retired breakpoints, by thread group id,
+    /// kept after the restore for the hits reaped late, see retireBreakpoint
+    std::map<pid_t, std::set<uintptr_t>> m_retired_addrs;
     std::shared_ptr<spdlog::logger> m_log = spdlog::get("bkpt");
 
+    /// @brief recursive, breakpoint handlers can add new breakpoints
+    std::recursive_mutex m_lock;
+
     BreakpointMngr(TargetDescription& _target_desc);
 
     // add breakpoint in format module@addr1,addr2,add3
@@ -102,6 +150,18 @@ public:
     
     void addBrkPnt(Breakpoint* brkPtr);
 
+    /**
+     * @brief Register a hardware breakpoint or watchpoint
+     * 
+     * Its address is resolved and a debug register slot is allocated by the
+     * next @ref inject, the slot is the same in all the threads. It is armed
+     * in the thread injecting it and in every thread created afterwards.
+     * It is dropped if there is no free slot for it.
+     * 
+     * @param brkPtr 
+     */
+    void addHwBreakpoint(HwBreakpoint* brkPtr);
+
     /**
      * @brief Place all the pending Breakpoint in the Tracee 
      * 
@@ -109,25 +169,67 @@ public:
      */
     void inject(TraceeProgram &traceeProg);
 
+    /**
+     * @brief Call when the Tracee is stopped by a TRAP_HWBKPT, the hardware
+     * breakpoint is handled as by handleBreakpointHit
+     * 
+     * After its last hit the breakpoint is retired: it is disarmed in the
+     * Tracee, and in the other threads when they stop next or hit it (they
+     * can't be modified while running), without being handled again. Its
+     * slot is freed once no thread has it armed.
+     * 
+     * @param traceeProg Tracee which hit the breakpoint
+     * @return true if the Tracee can be resumed
+     * @return false if the Tracee has to step over the instruction first,
+     * the slot is disarmed until restoreSuspendedBreakpoint
+     */
+    bool handleHwBreakpointHit(TraceeProgram &traceeProg);
+
+    /// @brief disarm the retired hardware breakpoints in the stopped Tracee,
+    /// call on every stop, handleHwBreakpointHit does it for TRAP_HWBKPT
+    void disarmRetiredHw(TraceeProgram &traceeProg);
+
+    /// @brief the Tracee is gone, its debug registers don't hold any slot
+    void dropHwThread(TraceeProgram &traceeProg);
+
+    /**
+     * @brief Remove all the enabled breakpoints from the Tracee memory, they
+     * stay registered so their statistics can still be printed
+     * 
+     * @param traceeProg 
+     */
+    void disarm(TraceeProgram &traceeProg);
+
+    /**
+     * @brief Enable or disable breakpoints with one read and one write per
+     * page of the Tracee memory instead of one of each per breakpoint
+     * 
+     * The breakpoints are sorted by address and grouped by page, each group
+     * is read in a local copy in which the breakpoints are patched, then
+     * written back. A group whose memory can't be read entirely falls back
+     * to @ref Breakpoint::enable one breakpoint at a time.
+     * 
+     * @param traceeProg Tracee whose memory is patched
+     * @param brkpnts breakpoints with their address set, sorted in place
+     * @param enable place the breakpoints if true, else restore the
+     * original instructions
+     */
+    void writeBreakpoints(TraceeProgram &traceeProg, std::vector<Breakpoint*>& brkpnts, bool enable);
+
     Breakpoint* getBreakpointObj(uintptr_t bk_addr);
 
     /**
      * @brief Does the Tracee have suspended Breakpoint
      * 
-     * @param tracee_pid Tracee for which we what of check for suspended breakpoint
+     * @param traceeProg Tracee for which we what of check for suspended breakpoint
      * @return true Thread has suspended breakpoint
      * @return false no suspended Breakpoint
      */
-    bool hasSuspendedBrkPnt(pid_t tracee_pid) {
-        auto sus_bkpt_iter = m_suspendedBrkPnt.find(tracee_pid);
-        if (sus_bkpt_iter != m_suspendedBrkPnt.end()) {
-            return true;
-        }
-        return false;
-    }
+    bool hasSuspendedBrkPnt(TraceeProgram& traceeProg);
 
     /**
-     * @brief Place the breakpoint back in the Tracee Process
+     * @brief Place the breakpoint back in the Tracee Process, unless another
+     * thread is still stepping over it
      * 
      * @param traceeProgram Process in which the Breakpoint will be restored
      */
@@ -143,6 +245,66 @@ public:
      */
     BreakpointPtr handleBreakpointHit(TraceeProgram &traceeProg, uintptr_t brk_addr);
 
+    /**
+     * @brief Handle the hit of a breakpoint which won't be enabled again
+     * (e.g. SINGLE_SHOT) without stepping over it
+     * 
+     * The breakpoint is never placed back, so the Tracee can be resumed on
+     * the original instruction. Its restore is queued with the other retired
+     * breakpoints of the process, @ref restoreRetiredBreakpoints writes
+     * them back one page at a time. A hit of a breakpoint which was already
+     * retired in the process isn't handled again, even when it is reaped
+     * after the restore.
+     * 
+     * @param traceeProg Tracee which hit the breakpoint
+     * @param brk_addr address of the breakpoint
+     * @return true if the breakpoint was handled, the Tracee has to be
+     * resumed at brk_addr after restoreRetiredBreakpoints
+     * @return false if the breakpoint stays enabled, nothing was done
+     */
+    bool retireBreakpoint(TraceeProgram& traceeProg, uintptr_t brk_addr);
+
+    /// @brief put back the original instructions of the breakpoints retired
+    /// in the process of the Tracee
+    void restoreRetiredBreakpoints(TraceeProgram& traceeProg);
+
+    /// @brief step over the breakpoints out of line when the architecture
+    /// supports it, see displacedStepOver
+    void enableDisplacedStepping();
+
+    /**
+     * @brief Step over the breakpoint hit by the Tracee without removing
+     * it from the memory, see DisplacedStepper. The breakpoint is handled
+     * as by handleBreakpointHit.
+     *
+     * @param exit_status wait status of the Tracee when EXITED is returned
+     * @return DisplacedStepResult UNSUPPORTED if nothing was done, the
+     * breakpoint then has to go through handleBreakpointHit
+     */
+    DisplacedStepResult displacedStepOver(TraceeProgram& traceeProg, uintptr_t brk_addr, int& exit_status);
+
+    /**
+     * @brief A signal is about to be delivered to the Tracee, move it out of
+     * its scratch slot if it is running there, see DisplacedStepper::leaveSlot
+     */
+    void leaveScratchSlot(TraceeProgram& traceeProg);
+
+    /// @brief the Tracee is gone, its slot in the scratch pad can be reused.
+    /// The pad is dropped once the leader is gone and no slot is held.
+    void releaseScratchSlot(TraceeProgram& traceeProg);
+
+    /// @brief the Tracee is gone while stepping over a breakpoint, it
+    /// doesn't hold the breakpoint out of the memory anymore
+    void dropSuspendedBreakpoint(TraceeProgram& traceeProg);
+
+    /// @brief the address space of the Tracee process was replaced (execve),
+    /// its scratch pad and retired breakpoints are gone
+    void dropScratchPad(TraceeProgram& traceeProg);
+
+    /// @brief the last thread of the process @p tgid is gone, a new
+    /// process reusing the id must not see its retired breakpoints
+    void dropRetiredBreakpoints(pid_t tgid);
+
     void printStats();
 
     void setBreakpointAtAddr(TraceeProgram &traceeProg, uintptr_t brk_addr, std::string* label);
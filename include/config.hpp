@@ -1,6 +1,7 @@
 #ifndef _SYS_COFNIG_H
 #define _SYS_COFNIG_H
 
+#include <cstdint>
 
 #define SHAMAN_LOG_LEVEL_TRACE 0
 #define SHAMAN_LOG_LEVEL_DEBUG 1
@@ -16,12 +17,47 @@
 // #define SUPPORT_ARCH_X86
 // #define SUPPORT_ARCH_ARM64
 
+/**
+ * @brief CPU Architectur of the Target
+ * 
+ */
+enum CPU_ARCH : uint8_t {
+    X86 = 0x00,
+    AMD64 = 0x01,
+    ARM32 = 0x10,
+    ARM64 = 0x20
+};
+
+/**
+ * @brief Execution mode of the Target
+ * 
+ */
+enum CPU_MODE : uint8_t{
+    x86_16 = 0x00,
+    x86_32 = 0x01,
+    x86_64 = 0x02,
+    THUMB = 0x10,
+    ARM = 0x11,
+    ARM_64 = 0x12
+};
+
+/// @brief Architecture of the Tracee, the first enabled SUPPORT_ARCH_*
+#if defined(SUPPORT_ARCH_AMD64)
+#define TARGET_CPU_ARCH CPU_ARCH::AMD64
+#elif defined(SUPPORT_ARCH_ARM64)
+#define TARGET_CPU_ARCH CPU_ARCH::ARM64
+#elif defined(SUPPORT_ARCH_X86)
+#define TARGET_CPU_ARCH CPU_ARCH::X86
+#elif defined(SUPPORT_ARCH_ARM)
+#define TARGET_CPU_ARCH CPU_ARCH::ARM32
+#else
+#error "No target architecture enabled in config.hpp"
+#endif
+
 #if !defined(SPDLOG_ACTIVE_LEVEL)
 #define SPDLOG_ACTIVE_LEVEL SHAMAN_LOG_LEVEL_TRACE
 #endif
 
-// #define SUPPORT_MEM_FILE 1
-
 /**
  * @defgroup programming_interface Programming Interfaces
  * Components which can be pluged into the system which will help you to manipulate the Tracee
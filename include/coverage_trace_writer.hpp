@@ -6,6 +6,7 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <mutex>
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "mempipe.hpp"
@@ -20,6 +21,9 @@ enum CoverageRecordType: uint16_t {
 
 /**
  * @brief This class write coverage trace to file
+ * 
+ * The writer can be shared by breakpoint handlers running on different
+ * tracer threads, see ShardedDebugger.
 */
 class CoverageTraceWriter {
 
@@ -40,6 +44,9 @@ class CoverageTraceWriter {
     
     uint64_t m_cov_data_points_count = 0;
 
+    /// @brief recursive, add_module updates the base address
+    std::recursive_mutex m_lock;
+
     /// @brief shared memory where the coverage data is written to
     std::unique_ptr<ChunkWriter<DEFAULT_CHUNK_SIZE, DEFAULT_NUM_BUFFER>> m_chunk_writer 
         = std::unique_ptr<ChunkWriter<DEFAULT_CHUNK_SIZE, DEFAULT_NUM_BUFFER>>();
@@ -75,10 +82,12 @@ public:
     void write_module_info();
 
     uint16_t get_module_id(std::string module_name) {
+        std::lock_guard<std::recursive_mutex> guard(m_lock);
         return m_module_id_map[module_name];
     };
 
     void update_module_base_addr(std::string module_name, uint64_t base_addr) {
+        std::lock_guard<std::recursive_mutex> guard(m_lock);
         uint8_t module_id = m_module_id_map[module_name];
         m_module_map[module_id] = base_addr;
     }
@@ -95,6 +104,7 @@ public:
     void record_cov(pid_t tracee_pid, uint16_t module_id, uint64_t execution_addr);
 
     void close() {
+        std::lock_guard<std::recursive_mutex> guard(m_lock);
         spdlog::warn("closing coverage file");
         m_trace_file.close();
     }
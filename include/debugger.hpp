@@ -5,6 +5,7 @@
 #include <tuple>
 #include <queue>
 #include <map>
+#include <unordered_map>
 #include <unistd.h>
 
 #include "spdlog/spdlog.h"
@@ -16,6 +17,20 @@
 #include "breakpoint_mngr.hpp"
 
 #include "linux_debugger.hpp"
+#include "tracee_table.hpp"
+#include "event_poller.hpp"
+#include "trace_recorder.hpp"
+
+/// @brief Tracees stopped on single shot breakpoints are resumed once this
+/// many are waiting, even if more events are ready
+#define RETIRED_TRACEES_MAX 64
+
+/// @brief Tracees stopped on single shot breakpoints are resumed after this
+/// many other events were taken, even if more events are ready
+#define RETIRED_EVENTS_MAX 64
+
+/// @brief events of unknown pids held at most, the oldest is dropped first
+#define HELD_EVENTS_MAX 64
 
 /**
  * 
@@ -123,30 +138,6 @@ class TraceeProgram;
 class TraceeFactory;
 class SyscallInjector;
 
-/**
- * @brief CPU Architectur of the Target
- * 
- */
-enum CPU_ARCH : uint8_t {
-	X86 = 0x00,
-	AMD64 = 0x01,
-	ARM32 = 0x10,
-	ARM64 = 0x20
-};
-
-/**
- * @brief Execution mode of the Target
- * 
- */
-enum CPU_MODE : uint8_t{
-	x86_16 = 0x00,
-	x86_32 = 0x01,
-	x86_64 = 0x02,
-	THUMB = 0x10,
-	ARM = 0x11,
-	ARM_64 = 0x12
-};
-
 /**
  * @brief All the Architecture speicfic detials will be avaible in this
  * class 
@@ -199,6 +190,91 @@ enum class DebugResult {
 
 	/// @brief Error while stopping the thread
 	ErrStopThread,
+
+	/// @brief Architecture of the Target is not enabled in config.hpp
+	ErrArchitecture,
+};
+
+/**
+ * @brief Breakpoints a Tracee is stepping over, and the hits of other
+ * Tracees on the same breakpoint waiting for the step over to complete
+ *
+ * Only a handful of breakpoints are stepped over at the same time, they
+ * are kept in a vector which is searched linearly and keeps its capacity,
+ * the event loop doesn't allocate for it once warmed up.
+ */
+class SteppingBreakpoints {
+	struct Entry {
+		uintptr_t addr;
+		/// @brief a Tracee is stepping over the breakpoint
+		bool stepping;
+		DebugEventQueue waiting;
+	};
+
+	std::vector<Entry> m_entries;
+
+	Entry* find(uintptr_t addr) {
+		for (auto& entry : m_entries) {
+			if (entry.addr == addr)
+				return &entry;
+		}
+		return nullptr;
+	}
+
+	void remove(Entry* entry) {
+		if (entry != &m_entries.back())
+			*entry = std::move(m_entries.back());
+		m_entries.pop_back();
+	}
+
+public:
+	bool isStepping(uintptr_t addr) {
+		Entry* entry = find(addr);
+		return entry && entry->stepping;
+	}
+
+	/// @brief a Tracee starts stepping over the breakpoint
+	void acquire(uintptr_t addr) {
+		Entry* entry = find(addr);
+		if (entry == nullptr) {
+			m_entries.push_back(Entry());
+			entry = &m_entries.back();
+			entry->addr = addr;
+		}
+		entry->stepping = true;
+	}
+
+	/// @brief hold the hit until the breakpoint is released
+	void defer(uintptr_t addr, DebugEventPtr debug_event) {
+		Entry* entry = find(addr);
+		if (entry)
+			entry->waiting.push(std::move(debug_event));
+	}
+
+	/**
+	 * @brief The step over is done
+	 *
+	 * @return DebugEventQueue* hits waiting for the breakpoint, nullptr if
+	 * there are none. Call compact once done with the queue.
+	 */
+	DebugEventQueue* release(uintptr_t addr) {
+		Entry* entry = find(addr);
+		if (entry == nullptr)
+			return nullptr;
+		entry->stepping = false;
+		if (entry->waiting.empty()) {
+			remove(entry);
+			return nullptr;
+		}
+		return &entry->waiting;
+	}
+
+	/// @brief forget the breakpoint if nobody steps over it or waits for it
+	void compact(uintptr_t addr) {
+		Entry* entry = find(addr);
+		if (entry && !entry->stepping && entry->waiting.empty())
+			remove(entry);
+	}
 };
 
 /**
@@ -215,7 +291,63 @@ class Debugger {
 
 	/// @brief Currently Active Tracee request which is been processed
 	pid_t m_signalled_pid = 0;
-	std::map<pid_t, TraceeProgram*> m_tracees;
+	TraceeTable m_tracees;
+
+	/**
+	 * @brief Events of pids we don't know yet, e.g. the initial stop of a
+	 * new child which is reported before the fork/clone event of its
+	 * parent. They are handed over once the child is added. At most
+	 * HELD_EVENTS_MAX are kept, a pid which is never added can't pin
+	 * its event forever.
+	 */
+	std::unordered_map<pid_t, DebugEventPtr> m_held_events;
+
+	/// @brief pids of m_held_events, oldest first
+	std::vector<pid_t> m_held_order;
+
+	/// @brief park the event of a pid we don't know yet
+	void holdEvent(DebugEventPtr& debug_event);
+
+	/// @brief queue the event the child reported before it was added
+	void adoptHeldEvent(TraceeProgram* child_tracee, DebugEventQueue& pending_events);
+
+	/// @brief the Tracee has stepped over its breakpoint, arm it again and
+	/// queue the next thread waiting for it
+	void finishStepOver(TraceeProgram* tracee_prog, SteppingBreakpoints& active_breakpoint, DebugEventQueue& pending_events);
+
+	/// @brief wait for Tracee events together with other fds, see useEventPoller
+	EventPoller* m_event_poller = nullptr;
+
+	/// @brief Tracee events reaped since the last poll of m_event_poller
+	uint32_t m_reaped_since_poll = 0;
+
+	/// @brief binary log of the Tracee events, see setTraceRecorder
+	TraceRecorder* m_recorder = nullptr;
+
+	/**
+	 * @brief Reap the next Tracee event, the callbacks of the event poller
+	 * run while no Tracee has an event and at least every
+	 * EVENT_POLLER_REAP_BATCH reaped events
+	 *
+	 * @return int pid of the Tracee, -1 on error
+	 */
+	int waitTraceeEvent(int* wait_status);
+
+	/**
+	 * @brief Tracees stopped on a single shot breakpoint, they wait for the
+	 * events already reported so the breakpoints of a page are restored with
+	 * one write, see BreakpointMngr::retireBreakpoint
+	 */
+	std::vector<pid_t> m_retired_tracees;
+
+	/// @brief events taken while m_retired_tracees were waiting
+	size_t m_retired_events = 0;
+
+	/// @brief restore the retired breakpoints and resume their Tracees
+	void resumeRetiredTracees();
+
+	/// @brief the Tracee is gone or its pid was taken over by execve
+	void dropRetiredTracee(pid_t tracee_pid);
 
 public:
 	
@@ -240,6 +372,21 @@ public:
 
 	bool m_followFork = false;
 
+	/// @brief cache tracee pages within a stop, see PageCache
+	bool m_pageCache = false;
+
+	/// @brief step over the breakpoints out of line, see useDisplacedStepping
+	bool m_displacedStepping = false;
+
+	/// @brief fastest backend used to access the tracee memory
+	MemoryBackend m_memBackend = MemoryBackend::PROCESS_VM;
+
+	/// @brief options of the waitpid() call of the event loop, only the
+	/// events of the Tracees attached by the thread running the event loop
+	/// are reaped (__WNOTHREAD), the children of the other threads of the
+	/// debugger process are left alone
+	int m_wait_options = __WALL | __WNOTHREAD | WCONTINUED;
+
 	TargetDescription& m_target_desc;
 
 	Debugger& followFork() {
@@ -252,6 +399,65 @@ public:
 		return *this;
 	};
 
+	/**
+	 * @brief Cache the tracee pages read during a stop, text pages are
+	 * also kept across stops when system calls are traced
+	 */
+	Debugger& enablePageCache() {
+		m_pageCache = true;
+		return *this;
+	};
+
+	/**
+	 * @brief Select how the tracee memory is accessed, e.g. MEM_FILE to
+	 * skip process_vm_readv/writev and use /proc/<pid>/mem directly
+	 */
+	Debugger& setMemoryBackend(MemoryBackend backend) {
+		m_memBackend = backend;
+		return *this;
+	};
+
+	/**
+	 * @brief Execute the instruction under a breakpoint from a scratch
+	 * mapping in the Tracee instead of removing the breakpoint, the other
+	 * threads are never stopped. Falls back to the in place step over for
+	 * the instructions and architectures which aren't supported, see
+	 * DisplacedStepper
+	 */
+	Debugger& useDisplacedStepping() {
+		m_displacedStepping = true;
+		return *this;
+	};
+
+	/**
+	 * @brief Wait for the Tracee events with epoll, so file descriptors
+	 * and timers can be serviced by the event loop, see addFdWatch and
+	 * addTimer. SIGCHLD is blocked on the thread running the event loop,
+	 * when the application has other threads call
+	 * EventPoller::blockProcessChildSignal from main before creating them.
+	 */
+	Debugger& useEventPoller();
+
+	/**
+	 * @brief Call @p callback from the event loop when @p fd is ready,
+	 * enables the event poller
+	 *
+	 * @return int 0 on success, -1 on error
+	 */
+	int addFdWatch(int fd, uint32_t events, EventPoller::FdCallback callback);
+
+	int removeFdWatch(int fd);
+
+	/**
+	 * @brief Call @p callback from the event loop every @p interval_ms,
+	 * enables the event poller
+	 *
+	 * @return int id of the timer, -1 on error
+	 */
+	int addTimer(uint64_t interval_ms, EventPoller::TimerCallback callback, bool periodic = true);
+
+	int removeTimer(int timer_id);
+
 	Debugger(TargetDescription& _target_desc);
 
 	/**
@@ -300,6 +506,18 @@ public:
 
 	Debugger& setSyscallMngr(SyscallManager* sys_mngr) {
 		m_syscallMngr = sys_mngr;
+		m_syscallMngr->setTraceRecorder(m_recorder);
+		return *this;
+	};
+
+	/**
+	 * @brief Record the Tracee events, breakpoint hits and syscalls to
+	 * @p recorder, they are formatted off the tracer thread. The recorder
+	 * is owned by the caller and must not be shared with another Debugger.
+	 */
+	Debugger& setTraceRecorder(TraceRecorder* recorder) {
+		m_recorder = recorder;
+		m_syscallMngr->setTraceRecorder(recorder);
 		return *this;
 	};
 
@@ -308,6 +526,13 @@ public:
 		return *this;
 	};
 
+	/// @brief Share the File and Network Tracers of @p resources, owned by
+	/// the caller, with the other Debuggers using it
+	Debugger& setResourceTracers(ResourceTracers* resources) {
+		m_syscallMngr->setResourceTracers(resources);
+		return *this;
+	};
+
 	void addBreakpoint(std::vector<std::string>& _brk_pnt_str);
 
 	TraceeProgram* getTracee(pid_t tracee_pid);
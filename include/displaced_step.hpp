@@ -0,0 +1,337 @@
+#ifndef H_DISPLACED_STEP_H
+#define H_DISPLACED_STEP_H
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <unistd.h>
+#include <capstone/capstone.h>
+
+#include "spdlog/spdlog.h"
+
+class TraceeProgram;
+class DebugOpts;
+class Breakpoint;
+class ArmDisassembler;
+
+/// @brief size of the scratch mapping allocated in each Tracee process
+#define SCRATCH_PAD_SIZE 4096
+
+/// @brief outcome of @ref DisplacedStepper::stepOver
+enum class DisplacedStepResult {
+    /// @brief the instruction can't be executed out of line, nothing
+    /// was done, the breakpoint has to be stepped over in place
+    UNSUPPORTED,
+    /// @brief the breakpoint is handled, the Tracee can be resumed and
+    /// will continue after the instruction on its own
+    RESUMED,
+    /// @brief the Tracee exited or was killed while the scratch pad was
+    /// mapped, its wait status was reaped and is handed back to the caller
+    EXITED,
+};
+
+/**
+ * @brief Slot of a thread in the scratch pad
+ *
+ * The slot remembers which code it holds, a thread hitting the same
+ * breakpoint again doesn't rewrite it.
+ */
+struct ScratchSlot {
+    uintptr_t m_addr = 0;
+    pid_t m_owner = 0;
+    /// @brief id of the decoded instruction written in the slot, 0 if none
+    uint64_t m_loaded = 0;
+    /// @brief breakpoint the instruction in the slot comes from
+    uintptr_t m_brk_addr = 0;
+    /// @brief the owner was moved out of the slot back on this breakpoint,
+    /// its handler already ran, see DisplacedStepper::leaveSlot
+    uintptr_t m_rewound = 0;
+};
+
+/**
+ * @brief Executable mapping in the Tracee where the instructions under the
+ * breakpoints are executed out of line
+ *
+ * There is one pad per process, split in one slot per thread, so threads
+ * stepping over the same breakpoint don't have to wait for each other.
+ */
+class ScratchPad {
+
+    std::vector<ScratchSlot> m_slots;
+    std::unordered_map<pid_t, size_t> m_slot_of;
+
+public:
+    /// @brief start of the mapping, 0 if it couldn't be allocated
+    uintptr_t m_base = 0;
+
+    /// @brief the thread group leader has exited, the other threads may
+    /// still be running (pthread_exit)
+    bool m_leader_gone = false;
+
+    ScratchPad() {}
+
+    ScratchPad(uintptr_t base, size_t slot_size);
+
+    /// @brief slot of the thread, a free one is assigned on the first
+    /// call. nullptr if all of them are taken.
+    ScratchSlot* slotFor(pid_t tid);
+
+    /// @brief slot of the thread, nullptr if it never had one
+    ScratchSlot* findSlot(pid_t tid);
+
+    /// @brief the thread is gone, its slot can be reused
+    void release(pid_t tid);
+
+    /// @brief a thread holds a slot
+    bool inUse() { return !m_slot_of.empty(); }
+};
+
+/**
+ * @brief Step over a breakpoint without removing it (displaced stepping)
+ *
+ * The instruction under the breakpoint is copied to the slot of the thread,
+ * followed by a jump back after the breakpoint, and the thread is resumed
+ * in the slot. Instructions which depend on their address are rewritten or
+ * emulated. The breakpoint instruction never leaves the memory, the other
+ * threads keep running through it and no second stop is needed.
+ *
+ * This base class is used by the architectures without support, every
+ * breakpoint is then stepped over in place.
+ *
+ * @ingroup platform_support
+ */
+class DisplacedStepper {
+
+protected:
+    std::shared_ptr<spdlog::logger> m_log = spdlog::get("bkpt");
+
+    /**
+     * @brief Code running a syscall followed by a trap, used to allocate
+     * the scratch pad
+     *
+     * @return size_t number of bytes written to @p code, 0 if not supported
+     */
+    virtual size_t syscallTrapCode(uint8_t* code) { return 0; }
+
+    /// @brief prepare the registers to run an anonymous executable mmap of
+    /// @p len bytes from @p code_addr
+    virtual void setMmapCall(TraceeProgram& traceeProg, uintptr_t code_addr, size_t len) {}
+
+    /// @brief return value of the syscall run by the syscallTrapCode
+    virtual uintptr_t syscallResult(TraceeProgram& traceeProg) { return 0; }
+
+public:
+    virtual ~DisplacedStepper() {}
+
+    /// @brief bytes reserved for each thread in the scratch pad, 0 if
+    /// displaced stepping is not supported
+    virtual size_t slotSize() { return 0; }
+
+    /**
+     * @brief Can the instruction under @p bkpt be executed out of line for
+     * this stop, nothing is modified in the Tracee
+     */
+    virtual bool canStepOver(TraceeProgram& traceeProg, Breakpoint& bkpt) { return false; }
+
+    /**
+     * @brief Redirect the stopped thread to execute the instruction under
+     * @p bkpt from @p slot, only valid after @ref canStepOver returned true
+     * during the same stop
+     */
+    virtual DisplacedStepResult stepOver(TraceeProgram& traceeProg, Breakpoint& bkpt, ScratchSlot& slot) {
+        return DisplacedStepResult::UNSUPPORTED;
+    }
+
+    /**
+     * @brief Move a thread stopped inside its @p slot to the same state in
+     * the original code, so a signal handler never runs on top of the slot
+     * and the slot can be reused by a breakpoint hit in the handler
+     *
+     * Nothing is executed, the registers the slot code modified are put
+     * back. If the instruction didn't complete the thread is put back on
+     * the breakpoint.
+     *
+     * @return true if the thread was put back on the breakpoint
+     */
+    virtual bool leaveSlot(TraceeProgram& traceeProg, ScratchSlot& slot) { return false; }
+
+    /**
+     * @brief Map the scratch pad in the process of the stopped thread
+     *
+     * The mmap is run by the thread itself from the entry point of the
+     * program, the code there has run once at startup and is never
+     * executed again. The registers and the code are restored afterwards.
+     *
+     * @param exit_status set to the wait status if the Tracee exited or
+     * was killed meanwhile, -1 otherwise
+     * @return uintptr_t address of the mapping, 0 on error
+     */
+    uintptr_t allocateScratch(TraceeProgram& traceeProg, size_t len, int& exit_status);
+};
+
+/**
+ * @brief Displaced stepping of ARM mode instructions
+ *
+ * - B/BL are emulated with the BranchData of the instruction, nothing is
+ *   executed
+ * - instructions reading the PC get it replaced by a free register, which
+ *   is loaded with the value the PC would have had and restored after
+ * - instructions writing the PC without reading it (pop {pc}, bx lr) are
+ *   copied, they just never take the jump back
+ * - blx reg, instructions both reading and writing the PC (add pc, pc, ...)
+ *   and Thumb code are stepped over in place
+ */
+class ARM32DisplacedStepper : public DisplacedStepper {
+
+    friend class ARM32DisplacedStepTest;
+
+    /// @brief how the instruction at a breakpoint address is stepped over
+    struct Plan {
+        enum Kind {
+            UNSUPPORTED,
+            /// @brief copied unmodified
+            COPY,
+            /// @brief PC operands replaced by m_scratch_reg
+            SUBSTITUTE,
+            /// @brief B/BL, emulated
+            BRANCH,
+        } m_kind;
+        /// @brief unique, see ScratchSlot::m_loaded
+        uint64_t m_id;
+        uint32_t m_insn;
+        /// @brief SUBSTITUTE : the instruction with the PC replaced
+        uint32_t m_relocated;
+        uint8_t m_scratch_reg;
+        /// @brief BRANCH : BL, sets the LR
+        bool m_is_call;
+        uintptr_t m_target;
+    };
+
+    /// @brief decoded instructions by breakpoint address
+    std::unordered_map<uintptr_t, Plan> m_plans;
+
+    uint64_t m_next_plan_id = 1;
+
+    ArmDisassembler* m_disasm;
+
+    Plan& plan(DebugOpts& debug_opts, uintptr_t brk_addr, uint32_t insn);
+
+    /// @brief the branches are decoded with the registers and the memory
+    /// of @p debug_opts, which have to be those of an ARM32 Tracee
+    void decode(DebugOpts& debug_opts, uintptr_t brk_addr, Plan& plan);
+
+protected:
+    size_t syscallTrapCode(uint8_t* code);
+    void setMmapCall(TraceeProgram& traceeProg, uintptr_t code_addr, size_t len);
+    uintptr_t syscallResult(TraceeProgram& traceeProg);
+
+public:
+    ARM32DisplacedStepper();
+
+    ~ARM32DisplacedStepper();
+
+    size_t slotSize() { return 32; }
+
+    bool canStepOver(TraceeProgram& traceeProg, Breakpoint& bkpt);
+
+    DisplacedStepResult stepOver(TraceeProgram& traceeProg, Breakpoint& bkpt, ScratchSlot& slot);
+
+    bool leaveSlot(TraceeProgram& traceeProg, ScratchSlot& slot);
+};
+
+/// @brief longest x86 instruction
+#define X86_MAX_INSN_SIZE 15
+
+/**
+ * @brief Displaced stepping of x86-64 instructions, decoded with capstone
+ *
+ * - jmp/jcc/call rel are emulated, as are call/jmp through a register or a
+ *   %rip based pointer
+ * - instructions with a %rip based operand get it replaced by a free
+ *   register, loaded with the address of the next instruction and restored
+ *   after, the displacement doesn't change
+ * - call through other memory operands pushes the return address and runs
+ *   as a jmp from the slot
+ * - the rest is copied as is followed by a jump back, ret and jmp to an
+ *   absolute address never take it
+ * - syscalls, interrupts and privileged instructions are stepped over in
+ *   place
+ *
+ * The pad is mapped writable, the slot code saves the scratch register in
+ * the slot itself.
+ */
+class AMD64DisplacedStepper : public DisplacedStepper {
+
+    friend class AMD64DisplacedStepTest;
+
+    /// @brief how the instruction at a breakpoint address is stepped over
+    struct Plan {
+        enum Kind {
+            UNSUPPORTED,
+            /// @brief copied unmodified
+            COPY,
+            /// @brief %rip based operand replaced by m_scratch_reg
+            RIP_RELATIVE,
+            /// @brief jmp/jcc/call rel, emulated
+            BRANCH,
+            /// @brief jmp/call through a register or a %rip based pointer,
+            /// emulated
+            INDIRECT,
+            /// @brief call through memory, turned into a jmp
+            CALL_MEMORY,
+        } m_kind;
+        /// @brief unique, see ScratchSlot::m_loaded
+        uint64_t m_id;
+        uint8_t m_insn[X86_MAX_INSN_SIZE];
+        uint8_t m_size;
+        /// @brief RIP_RELATIVE and CALL_MEMORY : the rewritten instruction
+        uint8_t m_relocated[X86_MAX_INSN_SIZE];
+        /// @brief RIP_RELATIVE : hardware number of the register, 0 - 7
+        uint8_t m_scratch_reg;
+        bool m_is_call;
+        /// @brief BRANCH : condition of the jcc, always taken for jmp/call
+        uint8_t m_cond;
+        /// @brief BRANCH : destination, INDIRECT : address of the pointer,
+        /// 0 when the destination is in m_target_reg
+        uintptr_t m_target;
+        uint8_t m_target_reg;
+    };
+
+    /// @brief decoded instructions by breakpoint address
+    std::unordered_map<uintptr_t, Plan> m_plans;
+
+    uint64_t m_next_plan_id = 1;
+
+    csh m_handle = {};
+    cs_insn* m_cs_insn = nullptr;
+
+    /// @brief INDIRECT through a pointer : destination read by canStepOver
+    /// for the current stop
+    uintptr_t m_indirect_target = 0;
+
+    Plan& plan(uintptr_t brk_addr, const uint8_t* code, size_t code_size);
+
+    void decode(uintptr_t brk_addr, const uint8_t* code, size_t code_size, Plan& plan);
+
+    void pushReturnAddress(TraceeProgram& traceeProg, uintptr_t ret_addr);
+
+protected:
+    size_t syscallTrapCode(uint8_t* code);
+    void setMmapCall(TraceeProgram& traceeProg, uintptr_t code_addr, size_t len);
+    uintptr_t syscallResult(TraceeProgram& traceeProg);
+
+public:
+    AMD64DisplacedStepper();
+
+    ~AMD64DisplacedStepper();
+
+    size_t slotSize() { return 64; }
+
+    bool canStepOver(TraceeProgram& traceeProg, Breakpoint& bkpt);
+
+    DisplacedStepResult stepOver(TraceeProgram& traceeProg, Breakpoint& bkpt, ScratchSlot& slot);
+
+    bool leaveSlot(TraceeProgram& traceeProg, ScratchSlot& slot);
+};
+
+#endif
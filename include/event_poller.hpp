@@ -0,0 +1,140 @@
+#ifndef H_EVENT_POLLER_H
+#define H_EVENT_POLLER_H
+
+#include <cstdint>
+#include <map>
+#include <functional>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "spdlog/spdlog.h"
+
+/// @brief upper bound of a single epoll_wait, see EventPoller::poll
+#define EVENT_POLLER_MAX_WAIT_MS 100
+
+/// @brief Tracee events reaped before the ready descriptors and timers are
+/// served, see Debugger::waitTraceeEvent
+#define EVENT_POLLER_REAP_BATCH 16
+
+/**
+ * @brief epoll based wait for the Debugger event loop
+ *
+ * Tracee events and file descriptors of the application are waited for
+ * together, the callbacks of the ready descriptors and expired timers run
+ * on the event loop thread between two Tracee events.
+ *
+ * ptrace stops are not reported on a pidfd, it only becomes readable when
+ * the process exits. The stops are announced by the SIGCHLD sent to the
+ * tracer, which is read from a signalfd. SIGCHLD has to be blocked for
+ * it, blockChildSignal blocks it on the calling thread. The signal is
+ * process directed, another thread which doesn't block it can swallow it,
+ * the wait is bounded by EVENT_POLLER_MAX_WAIT_MS so such an event is
+ * picked up late but never lost. To avoid the delay, call
+ * blockProcessChildSignal from main before any thread is created, the
+ * threads inherit the signal mask of their creator.
+ *
+ * @ingroup platform_support
+ */
+class EventPoller {
+public:
+	/// @brief called with the descriptor and the ready epoll events
+	typedef std::function<void(int fd, uint32_t events)> FdCallback;
+
+	/// @brief called on every expiration of a timer
+	typedef std::function<void()> TimerCallback;
+
+private:
+	struct Timer {
+		TimerCallback callback;
+		bool periodic;
+	};
+
+	int m_epoll_fd = -1;
+	int m_signal_fd = -1;
+
+	std::map<int, FdCallback> m_fd_watches;
+
+	/// @brief timerfd to its timer, the timerfd is the id of the timer
+	std::map<int, Timer> m_timers;
+
+	/// @brief pidfd of the watched processes
+	std::map<pid_t, int> m_pidfds;
+	std::map<int, pid_t> m_pidfd_owner;
+
+	std::shared_ptr<spdlog::logger> m_log = spdlog::get("debugger");
+
+	int addToEpoll(int fd, uint32_t events);
+
+	void removeFromEpoll(int fd);
+
+public:
+	EventPoller();
+
+	~EventPoller();
+
+	bool valid() { return m_epoll_fd >= 0; }
+
+	/**
+	 * @brief Block SIGCHLD on the calling thread and read it from a
+	 * signalfd, call it from the thread running the event loop
+	 *
+	 * @return int 0 on success, -1 on error
+	 */
+	int blockChildSignal();
+
+	/**
+	 * @brief Block SIGCHLD for the whole process, must be called from
+	 * main before any thread is created so every thread inherits the
+	 * mask. SIGCHLD handlers of the application no longer run. The
+	 * programs spawned by the Debugger get it unblocked again.
+	 *
+	 * @return int 0 on success, -1 on error
+	 */
+	static int blockProcessChildSignal();
+
+	/**
+	 * @brief Call @p callback when @p fd is ready
+	 *
+	 * @param fd descriptor to watch, still owned by the caller
+	 * @param events epoll events, e.g. EPOLLIN
+	 * @param callback
+	 * @return int 0 on success, -1 on error
+	 */
+	int addFdWatch(int fd, uint32_t events, FdCallback callback);
+
+	/// @brief Stop watching @p fd, can be called from a callback
+	int removeFdWatch(int fd);
+
+	/**
+	 * @brief Call @p callback every @p interval_ms milliseconds
+	 *
+	 * @param interval_ms
+	 * @param callback
+	 * @param periodic false to only call it once
+	 * @return int id of the timer, -1 on error
+	 */
+	int addTimer(uint64_t interval_ms, TimerCallback callback, bool periodic = true);
+
+	/// @brief Cancel a timer, can be called from a callback
+	int removeTimer(int timer_id);
+
+	/**
+	 * @brief Wake up when the process exits, even if its SIGCHLD went to
+	 * another thread. Only thread group leaders have a pidfd.
+	 */
+	void watchProcess(pid_t pid);
+
+	void unwatchProcess(pid_t pid);
+
+	/**
+	 * @brief Wait for a Tracee event or a watched descriptor and run the
+	 * callbacks of everything which is ready
+	 *
+	 * @param timeout_ms -1 to wait up to EVENT_POLLER_MAX_WAIT_MS
+	 * @return int 1 if a Tracee may have an event to reap, 0 otherwise,
+	 * -1 on error
+	 */
+	int poll(int timeout_ms = -1);
+};
+
+#endif
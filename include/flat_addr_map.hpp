@@ -0,0 +1,129 @@
+#ifndef H_FLAT_ADDR_MAP_H
+#define H_FLAT_ADDR_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+/// @brief slots allocated by the first insertion, a power of 2
+#define FLAT_ADDR_MAP_MIN_SLOTS 64
+
+/**
+ * @brief Map keyed by address, for the lookups done on every breakpoint hit
+ *
+ * An open addressing table with linear probing, the slots hold the address
+ * and an index into a dense list of the entries. A lookup reads the slots
+ * of one cache line in the common case, then the entry. The table is kept
+ * at most half full, the probe sequences stay short.
+ *
+ * Removal shifts the following slots of the probe sequence back, there are
+ * no tombstones, and moves the last entry into the hole of the dense list,
+ * so the order of the iteration is not stable. Address 0 can't be a key.
+ */
+template <typename T>
+class FlatAddrMap {
+public:
+	typedef std::pair<uintptr_t, T> Entry;
+	typedef typename std::vector<Entry>::iterator iterator;
+
+private:
+	struct Slot {
+		uintptr_t addr = 0;
+		/// @brief index in m_dense + 1, 0 for a free slot
+		uint32_t idx = 0;
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<Entry> m_dense;
+	size_t m_mask = 0;
+
+	size_t home(uintptr_t addr) const {
+		// fibonacci hashing, instruction addresses share their low bits
+		return static_cast<size_t>((static_cast<uint64_t>(addr) * 0x9e3779b97f4a7c15ull) >> 32) & m_mask;
+	}
+
+	/// @brief slot holding the address, or the free slot it would go in
+	size_t probe(uintptr_t addr) const {
+		size_t pos = home(addr);
+		while (m_slots[pos].idx && m_slots[pos].addr != addr)
+			pos = (pos + 1) & m_mask;
+		return pos;
+	}
+
+	void grow() {
+		size_t slot_count = m_slots.empty() ? FLAT_ADDR_MAP_MIN_SLOTS : m_slots.size() * 2;
+		m_slots.assign(slot_count, Slot());
+		m_mask = slot_count - 1;
+		for (size_t idx = 0; idx < m_dense.size(); idx++) {
+			Slot& slot = m_slots[probe(m_dense[idx].first)];
+			slot.addr = m_dense[idx].first;
+			slot.idx = idx + 1;
+		}
+	}
+
+public:
+	/// @brief value of the address, nullptr if it isn't in the map
+	T* find(uintptr_t addr) {
+		if (m_dense.empty())
+			return nullptr;
+		const Slot& slot = m_slots[probe(addr)];
+		return slot.idx ? &m_dense[slot.idx - 1].second : nullptr;
+	}
+
+	/// @brief value of the address, a default constructed one is added if
+	/// it isn't in the map
+	T& operator[](uintptr_t addr) {
+		if ((m_dense.size() + 1) * 2 > m_slots.size())
+			grow();
+
+		Slot& slot = m_slots[probe(addr)];
+		if (!slot.idx) {
+			m_dense.push_back(Entry(addr, T()));
+			slot.addr = addr;
+			slot.idx = m_dense.size();
+		}
+		return m_dense[slot.idx - 1].second;
+	}
+
+	void erase(uintptr_t addr) {
+		if (m_dense.empty())
+			return;
+
+		size_t pos = probe(addr);
+		if (!m_slots[pos].idx)
+			return;
+		size_t hole = m_slots[pos].idx - 1;
+
+		// pull back the slots which can't be found past the free one, those
+		// whose home isn't between the free slot and themselves
+		for (size_t next = (pos + 1) & m_mask; m_slots[next].idx; next = (next + 1) & m_mask) {
+			size_t home_dist = (next - home(m_slots[next].addr)) & m_mask;
+			if (home_dist >= ((next - pos) & m_mask)) {
+				m_slots[pos] = m_slots[next];
+				pos = next;
+			}
+		}
+		m_slots[pos] = Slot();
+
+		if (hole != m_dense.size() - 1) {
+			m_dense[hole] = std::move(m_dense.back());
+			m_slots[probe(m_dense[hole].first)].idx = hole + 1;
+		}
+		m_dense.pop_back();
+	}
+
+	void clear() {
+		m_slots.clear();
+		m_dense.clear();
+		m_mask = 0;
+	}
+
+	size_t size() const { return m_dense.size(); }
+	bool empty() const { return m_dense.empty(); }
+
+	iterator begin() { return m_dense.begin(); }
+	iterator end() { return m_dense.end(); }
+};
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef H_HW_BREAKPOINT_H
+#define H_HW_BREAKPOINT_H
+
+#include <vector>
+#include <sys/types.h>
+
+#include "breakpoint.hpp"
+
+/// @brief what the debug register traps on
+enum class HwBreakpointType : uint8_t {
+    /// @brief instruction fetch at the address, a breakpoint
+    EXECUTE = 0,
+
+    /// @brief data write in the range, a watchpoint
+    WRITE,
+
+    /// @brief data read or write in the range, a watchpoint
+    READ_WRITE,
+};
+
+/**
+ * @brief Access to the debug registers of the Tracee threads
+ *
+ * Debug registers belong to a thread, a new thread doesn't inherit the
+ * ones of its parent, they have to be armed in every thread which should
+ * stop. The slots are numbered by the architecture, a slot may only
+ * accept some of the HwBreakpointType.
+ *
+ * This base class is used by the architectures without debug register
+ * support, it has no slot.
+ *
+ * @ingroup platform_support
+ */
+class HwDebugRegisters {
+
+protected:
+
+    std::shared_ptr<spdlog::logger> m_log = spdlog::get("bkpt");
+
+public:
+
+    virtual ~HwDebugRegisters() {}
+
+    /**
+     * @brief Number of slots, queried from the thread the first time
+     *
+     * @param tid stopped thread of the Tracee
+     * @return int slots are numbered from 0 to the returned value
+     */
+    virtual int slotCount(pid_t tid) { return 0; }
+
+    /// @brief the slot can hold a breakpoint of this type
+    virtual bool supports(int slot, HwBreakpointType type) { return false; }
+
+    /**
+     * @brief Program and enable the slot in the thread
+     *
+     * @param tid stopped thread
+     * @param slot slot accepting the type, see @ref supports
+     * @param addr address of the instruction or of the watched range
+     * @param type
+     * @param len size of the watched range, 1, 2, 4 or 8 bytes, x86 wants
+     * it aligned on its size and ARM64 within a double word, ignored for
+     * EXECUTE
+     * @return true if the slot is armed
+     */
+    virtual bool arm(pid_t tid, int slot, uintptr_t addr, HwBreakpointType type, uint8_t len) { return false; }
+
+    /// @brief disable the slot in the thread
+    virtual bool disarm(pid_t tid, int slot) { return false; }
+
+    /**
+     * @brief Slot which stopped the thread with a TRAP_HWBKPT
+     *
+     * @param tid thread in the TRAP_HWBKPT stop
+     * @return int slot, -1 if it can't be found
+     */
+    virtual int hitSlot(pid_t tid) { return -1; }
+};
+
+/// @brief DR0-DR3 hold the addresses, DR6 the status and DR7 the control
+#define X86_DEBUG_REG_SLOTS 4
+#define X86_DR_STATUS 6
+#define X86_DR_CONTROL 7
+
+/// @brief resume flag of EFLAGS, the instruction breakpoints of the next
+/// instruction don't trigger
+#define X86_EFLAGS_RF (1UL << 16)
+
+/**
+ * @brief x86 debug registers, accessed with PTRACE_PEEKUSER and
+ * PTRACE_POKEUSER in struct user
+ *
+ * The 4 address registers are shared by breakpoints and watchpoints.
+ * Instruction breakpoints are faults, the Tracee is resumed over them
+ * with the resume flag (RF) of EFLAGS. Watchpoints trap after the access.
+ */
+class X86DebugRegisters : public HwDebugRegisters {
+
+    long peek(pid_t tid, int reg_idx, bool& ok);
+    bool poke(pid_t tid, int reg_idx, unsigned long value);
+
+public:
+
+    int slotCount(pid_t tid) { return X86_DEBUG_REG_SLOTS; }
+    bool supports(int slot, HwBreakpointType type) { return slot >= 0 && slot < X86_DEBUG_REG_SLOTS; }
+    bool arm(pid_t tid, int slot, uintptr_t addr, HwBreakpointType type, uint8_t len);
+    bool disarm(pid_t tid, int slot);
+    int hitSlot(pid_t tid);
+};
+
+/// @brief the watchpoint registers come after the breakpoint ones in the
+/// slot numbering, the architecture has at most 16 of each
+#define ARM64_HW_WATCH_SLOT_BASE 16
+
+/**
+ * @brief ARM64 debug registers, NT_ARM_HW_BREAK and NT_ARM_HW_WATCH
+ * register sets
+ *
+ * Breakpoints and watchpoints have their own registers, slots below
+ * ARM64_HW_WATCH_SLOT_BASE are breakpoints. Both report the exception
+ * before the instruction completes, the slot has to be disarmed while the
+ * instruction is stepped over.
+ */
+class ARM64DebugRegisters : public HwDebugRegisters {
+
+    /// @brief number of registers of each set, -1 until queried
+    int m_brk_count = -1;
+    int m_watch_count = 0;
+
+public:
+
+    int slotCount(pid_t tid);
+    bool supports(int slot, HwBreakpointType type);
+    bool arm(pid_t tid, int slot, uintptr_t addr, HwBreakpointType type, uint8_t len);
+    bool disarm(pid_t tid, int slot);
+    int hitSlot(pid_t tid);
+};
+
+/**
+ * @addtogroup programming_interface
+ * @{
+ */
+
+/**
+ * @brief Breakpoint or watchpoint placed in the debug registers
+ *
+ * The code isn't modified, the hardware stops the threads for which the
+ * breakpoint is armed, all of them unless some are selected with
+ * @ref addThread. Only a handful of them can be used at a time, see
+ * BreakpointMngr::addHwBreakpoint.
+ *
+ * Hits are delivered to @ref handle like the software breakpoints, for a
+ * watchpoint the PC is past the instruction which did the access on x86
+ * and on it on ARM64.
+ */
+class HwBreakpoint : public Breakpoint {
+
+    /// @brief threads which stop on the breakpoint, empty for all of them
+    std::vector<pid_t> m_tids;
+
+    /// @brief threads in which the slot is currently armed, debug
+    /// registers are per thread
+    std::vector<pid_t> m_armed_tids;
+
+public:
+
+    HwBreakpointType m_hw_type;
+
+    /// @brief size of the watched range
+    uint8_t m_len;
+
+    /// @brief debug register slot, -1 until one is allocated
+    int m_slot = -1;
+
+    /// @brief set by the BreakpointMngr when it allocates the slot
+    HwDebugRegisters* m_debug_regs = nullptr;
+
+    /// @brief won't be handled anymore, the slot is released once it is
+    /// disarmed in every thread, see BreakpointMngr::handleHwBreakpointHit
+    bool m_retired = false;
+
+    /**
+     * @brief Breakpoint at an offset of the module
+     *
+     * @param modname module in which the address is
+     * @param offset offset WRT to the module base address
+     * @param hw_type
+     * @param len size of the watched range, 1, 2, 4 or 8
+     */
+    HwBreakpoint(std::string& modname, uintptr_t offset,
+        HwBreakpointType hw_type = HwBreakpointType::EXECUTE, uint8_t len = 1) :
+        Breakpoint(modname, offset), m_hw_type(hw_type), m_len(len) {}
+
+    /// @brief stop only the thread, can be called several times
+    HwBreakpoint& addThread(pid_t tid);
+
+    /// @brief the thread is one of those which stop on the breakpoint
+    bool armedFor(pid_t tid);
+
+    /// @brief the slot is armed in the thread
+    bool armedIn(pid_t tid);
+
+    /// @brief the slot is armed in at least one thread
+    bool armedAnywhere() { return !m_armed_tids.empty(); }
+
+    /// @brief the thread is gone, its debug registers with it
+    void forgetThread(pid_t tid);
+
+    /// @brief arm the slot in the thread of the Tracee
+    virtual int enable(TraceeProgram &traceeProg);
+
+    /// @brief disarm the slot in the thread of the Tracee
+    virtual int disable(TraceeProgram &traceeProg);
+};
+
+/** @} End of Group */
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <sys/wait.h>
 #include <spdlog/spdlog.h>
+#include <memory>
 #include <tuple>
 #include <utility>
 
@@ -127,6 +128,7 @@ struct TrapReason {
 		VFORK, 		// Process invoked `vfork()`
 		SYSCALL,
 		BREAKPOINT,
+		HW_BREAKPOINT, // debug register trap, TRAP_HWBKPT
 		ERROR,
 		INVALID
 	} status;
@@ -140,12 +142,33 @@ struct TrapReason {
 };
 
 
+struct DebugEvent;
+
+/**
+ * @brief Gives the DebugEvent back to the pool of the thread instead of
+ * freeing it, see DebugEvent::allocate
+ */
+struct DebugEventRecycler {
+	void operator()(DebugEvent* debug_event) const;
+};
+
+typedef std::unique_ptr<DebugEvent, DebugEventRecycler> DebugEventPtr;
+
 struct DebugEvent {
 	// pid of the process causing this event
 	pid_t m_pid = 0;
 	TraceeEvent event;
 	TrapReason reason;
 
+	/// @brief link of DebugEventQueue and of the pool
+	DebugEvent* m_next = nullptr;
+
+	/**
+	 * @brief Invalid event from the pool of the calling thread, only
+	 * allocates when the pool is empty
+	 */
+	static DebugEventPtr allocate();
+
 	DebugEvent() {
 		event.type = TraceeEvent::INVALID;
 		reason.status = TrapReason::INVALID;
@@ -168,9 +191,77 @@ struct DebugEvent {
 
 };
 
-typedef std::unique_ptr<DebugEvent> DebugEventPtr;
+/**
+ * @brief FIFO of events linked through DebugEvent::m_next, the queue owns
+ * the events it holds and pushing or popping never allocates
+ */
+class DebugEventQueue {
+	DebugEvent* m_head = nullptr;
+	DebugEvent* m_tail = nullptr;
+	size_t m_size = 0;
+
+public:
+	DebugEventQueue() {}
+
+	DebugEventQueue(DebugEventQueue&& other)
+		: m_head(other.m_head), m_tail(other.m_tail), m_size(other.m_size) {
+		other.m_head = other.m_tail = nullptr;
+		other.m_size = 0;
+	}
+
+	DebugEventQueue& operator=(DebugEventQueue&& other) {
+		clear();
+		std::swap(m_head, other.m_head);
+		std::swap(m_tail, other.m_tail);
+		std::swap(m_size, other.m_size);
+		return *this;
+	}
+
+	DebugEventQueue(const DebugEventQueue&) = delete;
+	DebugEventQueue& operator=(const DebugEventQueue&) = delete;
+
+	~DebugEventQueue() { clear(); }
+
+	bool empty() const { return m_head == nullptr; }
+	size_t size() const { return m_size; }
+
+	void push(DebugEventPtr debug_event) {
+		DebugEvent* node = debug_event.release();
+		node->m_next = nullptr;
+		if (m_tail)
+			m_tail->m_next = node;
+		else
+			m_head = node;
+		m_tail = node;
+		m_size++;
+	}
+
+	/// @brief oldest event, the queue must not be empty
+	DebugEventPtr pop() {
+		DebugEvent* node = m_head;
+		m_head = node->m_next;
+		if (m_head == nullptr)
+			m_tail = nullptr;
+		node->m_next = nullptr;
+		m_size--;
+		return DebugEventPtr(node);
+	}
+
+	void clear() {
+		while (!empty())
+			pop();
+	}
+};
+
 
+/**
+ * @brief Fill the event from a status returned by waitpid()
+ * 
+ * @return int 0 on success, -1 if the status is not understood
+ */
+int decode_wait_status(int child_status, DebugEventPtr& debug_event);
 
+/// @brief non blocking wait for an event of the pid
 int get_wait_event(pid_t pid, DebugEventPtr& debug_event);
 
 #endif
\ No newline at end of file
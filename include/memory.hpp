@@ -7,9 +7,112 @@
 #include <cstring>
 #include <stdio.h>
 #include <spdlog/spdlog.h>
-#include <fstream>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <map>
 #include "config.hpp"
 
+/// @brief buffers up to this size are stored inside the Addr object
+#define ADDR_INLINE_SIZE 8
+
+/// @brief size of the blocks carved by AddrArena
+#define ADDR_ARENA_BLOCK_SIZE (64 * 1024)
+
+/**
+ * @brief Bump allocator for buffers which only live during a Tracee stop
+ * 
+ * Allocation is a pointer increment, nothing is freed individually, the
+ * whole arena is recycled with @ref reset when the Tracee is resumed.
+ * Blocks are kept across resets so steady state doesn't touch malloc.
+ */
+class AddrArena {
+
+    std::vector<uint8_t*> m_blocks;
+
+    /// @brief allocations which don't fit in a block, freed on reset
+    std::vector<uint8_t*> m_large_allocs;
+
+    /// @brief block currently used for allocation
+    size_t m_block_idx = 0;
+
+    /// @brief offset of the free space in the current block
+    size_t m_offset = 0;
+
+public:
+
+    AddrArena() = default;
+
+    /// @brief buffers are never shared, a copy starts with an empty arena
+    AddrArena(const AddrArena&) {}
+    AddrArena& operator=(const AddrArena&) { return *this; }
+
+    ~AddrArena();
+
+    /**
+     * @brief Allocate a buffer valid until the next @ref reset
+     * 
+     * @param size size of the buffer
+     * @return uint8_t* buffer aligned to 8 bytes
+     */
+    uint8_t* allocate(size_t size);
+
+    /// @brief Release all the buffers allocated from the arena
+    void reset();
+};
+
+/**
+ * @brief Non-owning read-only view on bytes read from the Tracee
+ * 
+ * Used by the callers which only need to inspect the data, the view
+ * doesn't allocate or free anything. Views returned by
+ * RemoteMemory::readView are valid until the Tracee is resumed.
+ */
+class AddrView {
+
+    const uint8_t* m_data = nullptr;
+
+    uint64_t r_addr = 0;
+
+    size_t m_size = 0;
+
+public:
+
+    AddrView() = default;
+
+    AddrView(const uint8_t* _data, uint64_t _r_addr, size_t _size)
+        : m_data(_data), r_addr(_r_addr), m_size(_size) {}
+
+    const uint8_t* data() const { return m_data; }
+
+    uint64_t raddr() const { return r_addr; }
+
+    size_t size() const { return m_size; }
+
+    /// @brief true if nothing could be read from the Tracee
+    bool empty() const { return m_size == 0; }
+
+    /**
+     * @brief Read a value at the offset in the view, the caller has to
+     * make sure the offset + size of the value is within the view
+     */
+    template<class T>
+    T read(size_t offset = 0) const {
+        T value;
+        memcpy(&value, m_data + offset, sizeof(T));
+        return value;
+    }
+
+    uint8_t read_u8() const { return read<uint8_t>(); }
+    uint16_t read_u16() const { return read<uint16_t>(); }
+    uint32_t read_u32() const { return read<uint32_t>(); }
+    uint64_t read_u64() const { return read<uint64_t>(); }
+};
+
 /**
  * @brief Abstract for Memory Buffer in Tracee Process
  * 
@@ -18,6 +121,9 @@
  * location(i.e. pointer address), the size of the buffer and
  * the buffer data itself.
  * 
+ * Small buffers (up to @ref ADDR_INLINE_SIZE) are stored in the object
+ * itself, bigger ones are allocated on the heap or borrowed from an
+ * AddrArena, in which case the Addr must not outlive the Tracee stop.
  */
 class Addr {
 
@@ -30,6 +136,19 @@ class Addr {
     /// @brief size of the buffer
     size_t m_size = 0;
 
+    /// @brief size of the memory pointed by m_data
+    size_t m_capacity = 0;
+
+    /// @brief m_data was allocated by this object and has to be freed
+    bool m_owned = false;
+
+    /// @brief storage for the small buffers
+    uint8_t m_inline[ADDR_INLINE_SIZE];
+
+    void allocate(size_t _size);
+
+    void release();
+
 public:
 
     /// @brief Create plain object without allocating and memory
@@ -41,10 +160,29 @@ public:
     Addr(uint64_t _r_addr, size_t _size);
 
     Addr(size_t _size);
+
+    /**
+     * @brief Create buffer borrowed from the arena, valid until the arena
+     * is reset
+     * 
+     * @param arena arena which provides the memory
+     * @param _r_addr address in the Tracee memory space
+     * @param _size size of the buffer
+     */
+    Addr(AddrArena& arena, uint64_t _r_addr, size_t _size);
     
     ~Addr();
 
-    Addr(Addr &addrObj);
+    Addr(const Addr &addrObj);
+
+    Addr(Addr &&addrObj);
+
+    Addr& operator=(const Addr &addrObj);
+
+    Addr& operator=(Addr &&addrObj);
+
+    /// @brief Non-owning view on the buffer
+    AddrView view() const { return AddrView(m_data, r_addr, m_size); }
 
     uint8_t* data() { return m_data; };
 
@@ -171,9 +309,276 @@ enum class MemoryOptResult {
     ErrInsufficentBuffer,
 };
 
+/**
+ * @brief One range of a scatter-gather read, see RemoteMemory::readv
+ * 
+ */
+struct RemoteIoVec {
+    /// @brief address in tracee memory space
+    uintptr_t raddr;
+
+    /// @brief number of bytes to read
+    size_t len;
+
+    /// @brief local buffer, must hold at least len bytes
+    void* dest;
+
+    /// @brief filled by the read, number of bytes read or -1 if the
+    /// range couldn't be read at all
+    ssize_t result;
+
+    RemoteIoVec() : raddr(0), len(0), dest(nullptr), result(0) {}
+
+    RemoteIoVec(uintptr_t _raddr, size_t _len, void* _dest)
+        : raddr(_raddr), len(_len), dest(_dest), result(0) {}
+};
+
+/// @brief granularity of the RemoteMemory page cache
+#define PAGE_CACHE_BLOCK_SIZE 4096
+
+/// @brief default number of pages held by the page cache
+#define PAGE_CACHE_DEFAULT_PAGES 256
+
+/// @brief reads bigger than this go straight to the Tracee, they are
+/// mostly one-off buffer copies which would only evict useful pages
+#define PAGE_CACHE_MAX_READ (4 * PAGE_CACHE_BLOCK_SIZE)
+
+/// @brief default limit for strings read from the Tracee including the NUL
+/// terminator, same as PATH_MAX
+#define CSTRING_MAX_LEN 4096
+
+class ProcessMap;
+
+/**
+ * @brief Counters to measure the efficiency of the page cache
+ * 
+ */
+struct PageCacheStats {
+    /// @brief reads served from the cache
+    uint64_t hits = 0;
+
+    /// @brief reads which had to fetch the page from the Tracee
+    uint64_t misses = 0;
+
+    /// @brief pages dropped because of debugger writes or mapping changes
+    uint64_t invalidations = 0;
+};
+
+/**
+ * @brief Cache of Tracee pages, valid for one stop of the Tracee
+ * 
+ * Each page is tagged with the stop epoch in which it was read, the epoch
+ * is bumped every time the Tracee is resumed, so a page read during the
+ * previous stop is never returned. Read-only file-backed pages (text) are
+ * marked persistent and stay valid across epochs, they are only dropped
+ * when the debugger writes to them or when a mapping syscall touches them.
+ * 
+ * The cache is shared by all the threads of a process since they share
+ * the same address space. A thread which is running can write to any page,
+ * so the pages which are not persistent are only cached while all the
+ * threads sharing the cache are stopped.
+ */
+class PageCache {
+
+    struct CachedPage {
+        uint64_t m_epoch;
+        bool m_persistent;
+        uint8_t m_data[PAGE_CACHE_BLOCK_SIZE];
+    };
+
+    std::unordered_map<uintptr_t, CachedPage*> m_pages;
+
+    /// @brief freed pages kept for reuse
+    std::vector<CachedPage*> m_free_pages;
+
+    struct VolatileRange {
+        uintptr_t m_end;
+        /// @brief ProcessMap::lastGeneration() when the range was remapped
+        uint64_t m_stamp;
+    };
+
+    /// @brief page aligned ranges remapped after the process map was
+    /// parsed, by start address, they don't overlap. The maps parsed
+    /// before the remap can't be trusted for these pages anymore.
+    std::map<uintptr_t, VolatileRange> m_volatile_ranges;
+
+    /// @brief too many ranges were remapped to track them individually,
+    /// the maps parsed up to this generation aren't trusted at all
+    uint64_t m_volatile_overflow = 0;
+
+    uint64_t m_epoch = 1;
+
+    /// @brief threads sharing the cache which are running
+    int m_running = 0;
+
+    size_t m_max_pages;
+
+    /// @brief allow read-only text pages to outlive the stop epoch
+    bool m_persist_text;
+
+    void evict();
+
+public:
+
+    PageCacheStats m_stats;
+
+    PageCache(size_t max_pages, bool persist_text)
+        : m_max_pages(max_pages), m_persist_text(persist_text) {}
+
+    ~PageCache();
+
+    /**
+     * @brief Find a valid page in the cache
+     * 
+     * @param page_addr page aligned address in the Tracee
+     * @return const uint8_t* page data or nullptr if the page is not cached
+     */
+    const uint8_t* lookup(uintptr_t page_addr);
+
+    /**
+     * @brief Reserve a page in the cache, caller has to fill the returned buffer
+     * 
+     * @param page_addr page aligned address in the Tracee
+     * @param persistent page can be kept across stop epochs
+     * @return uint8_t* buffer of PAGE_CACHE_BLOCK_SIZE bytes
+     */
+    uint8_t* insert(uintptr_t page_addr, bool persistent);
+
+    /// @brief Remove a single page from the cache
+    void drop(uintptr_t page_addr);
+
+    /**
+     * @brief Drop all the pages overlapping the range
+     * 
+     * @param addr start of the range
+     * @param len length of the range
+     */
+    void invalidate(uintptr_t addr, size_t len);
+
+    /**
+     * @brief The range was remapped, don't let its text pages persist
+     * for the process maps parsed before
+     * 
+     * @param addr start of the range
+     * @param len length of the range
+     * @param stamp ProcessMap::lastGeneration() at the remap
+     */
+    void markVolatile(uintptr_t addr, size_t len, uint64_t stamp);
+
+    /// @brief Drop every page, used when the address space is replaced
+    void clear();
+
+    /// @brief Tracee is resumed, pages which are not persistent are stale now
+    void nextEpoch() { m_epoch++; }
+
+    /// @brief a thread sharing the cache is resumed
+    void onResume() {
+        nextEpoch();
+        m_running++;
+    }
+
+    /// @brief a thread sharing the cache has stopped or is gone
+    void onStop() {
+        if (m_running > 0)
+            m_running--;
+    }
+
+    /// @brief no thread can modify the pages which are not persistent
+    bool stable() { return m_running == 0; }
+
+    bool persistText() { return m_persist_text; }
+
+    /// @brief true if the page was remapped after the process map of
+    /// @p map_generation was parsed
+    bool isVolatile(uintptr_t page_addr, uint64_t map_generation);
+};
+
+/**
+ * @brief Mechanism used by RemoteMemory to move data in/out of the Tracee
+ * 
+ * Listed from the fastest to the slowest, RemoteMemory starts with the
+ * fastest one and falls back to the next one when the kernel refuses the
+ * operation.
+ */
+enum class MemoryBackend {
+    /// @brief process_vm_readv/process_vm_writev, whole range in one syscall
+    PROCESS_VM = 0,
+
+    /// @brief pread/pwrite on /proc/<pid>/mem, can write to read-only pages
+    MEM_FILE,
+
+    /// @brief PTRACE_PEEKDATA/PTRACE_POKEDATA, one word per syscall
+    PTRACE,
+};
+
+/**
+ * @brief Handle on /proc/<pid>/mem of one address space
+ * 
+ * The file is opened once with O_RDWR|O_CLOEXEC and accessed with
+ * pread/pwrite at the remote address. Threads of a process share the same
+ * handle, those created by CLONE as well as those found when attaching,
+ * even when they are traced by different shards, see
+ * RemoteMemory::shareAddressSpace. The kernel ties the handle to the mm it
+ * was opened on, so it has to be reopened when the address space is
+ * replaced by execve, which has killed the other threads by then.
+ * 
+ * @ingroup platform_support
+ */
+class MemFile {
+    /// @brief pid used to build the /proc path
+    pid_t m_pid;
+
+    /// @brief file descriptor, -1 until the first access
+    std::atomic<int> m_fd{-1};
+
+    /// @brief serializes opening and closing the handle
+    std::mutex m_lock;
+
+    /// @brief handle was opened without write permission
+    bool m_read_only = false;
+
+    /// @brief set when /proc/<pid>/mem can't be opened at all
+    bool m_failed = false;
+
+public:
+    MemFile(pid_t pid) : m_pid(pid) {}
+    ~MemFile() { close(); }
+
+    MemFile(const MemFile&) = delete;
+    MemFile& operator=(const MemFile&) = delete;
+
+    /**
+     * @brief Open the file if it is not open already
+     * 
+     * @return true if the handle can be used
+     */
+    bool open();
+
+    void close();
+
+    /**
+     * @brief Close the handle and open the file again on the next access,
+     * must be called after execve
+     * 
+     * @param pid pid which owns the new address space
+     */
+    void reopen(pid_t pid);
+
+    bool failed() { return m_failed; }
+
+    ssize_t read(uintptr_t _remote_addr, uint8_t* _buf, size_t _len);
+    ssize_t write(uintptr_t _remote_addr, const uint8_t* _buf, size_t _len);
+};
+
 /**
  * @brief Interface for Reading and Writing data in Tracee Memory
  * 
+ * Every transfer is first tried with the fastest backend available for
+ * this Tracee, if it fails (e.g. process_vm_writev on read-only text
+ * pages) the remaining bytes are moved with the next backend. Backends
+ * which are not supported at all (ENOSYS, EPERM) are disabled for the
+ * lifetime of the object.
+ * 
  * @ingroup platform_support
  * 
  */
@@ -182,10 +587,39 @@ class RemoteMemory {
     /// @brief Process ID of the Tracee in which read/write Operation will be done
     pid_t m_pid;
 
-#ifdef SUPPORT_MEM_FILE
-    std::fstream* m_mem_file;
-    FILE* m_mem_fd;
-#endif
+    /// @brief fastest backend which is known to work for this Tracee
+    MemoryBackend m_backend = MemoryBackend::PROCESS_VM;
+
+    /// @brief /proc/<pid>/mem of the address space, shared between threads
+    std::shared_ptr<MemFile> m_mem_file;
+
+    /// @brief optional cache of Tracee pages, shared between threads
+    std::shared_ptr<PageCache> m_page_cache;
+
+    /// @brief process map of the Tracee, used to find text pages
+    ProcessMap* m_proc_map = nullptr;
+
+    /// @brief buffers handed out during a stop, recycled on resume
+    AddrArena m_arena;
+
+    /// @brief Tracee was resumed and its stop wasn't reported yet
+    bool m_running = false;
+
+    /// @brief writes try process_vm_writev before /proc/<pid>/mem
+    bool m_process_vm_writes = false;
+
+    ssize_t readDirect(uintptr_t _remote_addr, uint8_t* _buf, size_t _len);
+    ssize_t readCached(uintptr_t _remote_addr, uint8_t* _buf, size_t _len);
+    bool isTextPage(uintptr_t page_addr);
+
+    ssize_t readProcessVm(uintptr_t _remote_addr, uint8_t* _buf, size_t _len);
+    ssize_t writeProcessVm(uintptr_t _remote_addr, const uint8_t* _buf, size_t _len);
+
+    ssize_t readMemFile(uintptr_t _remote_addr, uint8_t* _buf, size_t _len);
+    ssize_t writeMemFile(uintptr_t _remote_addr, const uint8_t* _buf, size_t _len);
+
+    ssize_t readPtrace(uintptr_t _remote_addr, uint8_t* _buf, size_t _len);
+    ssize_t writePtrace(uintptr_t _remote_addr, const uint8_t* _buf, size_t _len);
 
 public:
 
@@ -195,27 +629,203 @@ public:
 
     ~RemoteMemory();
 
+    /**
+     * @brief Fastest backend currently used for this Tracee
+     * 
+     * @return MemoryBackend 
+     */
+    MemoryBackend backend() { return m_backend; }
+
+    pid_t pid() { return m_pid; }
+
+    /**
+     * @brief Select the fastest backend which may be used for this Tracee,
+     * the slower ones are still used as fallback
+     * 
+     * @param backend 
+     */
+    void setBackend(MemoryBackend backend) { m_backend = backend; }
+
+    /**
+     * @brief Try process_vm_writev before /proc/<pid>/mem for writes
+     * 
+     * Saves the pwrite when the Tracee mostly writes to writable data,
+     * writes to read-only pages (e.g. breakpoints in text) fail with
+     * process_vm_writev first and are moved by /proc/<pid>/mem after.
+     * Only used while the backend is PROCESS_VM.
+     * 
+     * @param enable 
+     */
+    void setProcessVmWrites(bool enable) { m_process_vm_writes = enable; }
+
+    void setProcessMap(ProcessMap* proc_map) { m_proc_map = proc_map; }
+
+    /**
+     * @brief Enable the page cache for this Tracee
+     * 
+     * @param max_pages maximum number of pages held in the cache
+     * @param persist_text keep read-only text pages across stops, only
+     * safe when mapping syscalls (mmap/mprotect/munmap) are traced
+     */
+    void enablePageCache(size_t max_pages = PAGE_CACHE_DEFAULT_PAGES, bool persist_text = false);
+
+    /**
+     * @brief Use the same page cache and /proc/<pid>/mem handle as another
+     * Tracee, threads share their address space so they must share those
+     * as well
+     * 
+     * @param other RemoteMemory of a thread of the same process
+     */
+    void shareAddressSpace(RemoteMemory& other);
+
+    /// @brief Page cache statistics, nullptr if the cache is disabled
+    const PageCacheStats* pageCacheStats() {
+        return m_page_cache ? &m_page_cache->m_stats : nullptr;
+    }
+
+    /// @brief Must be called right before the Tracee is resumed
+    void onResume() {
+        if (m_page_cache && !m_running)
+            m_page_cache->onResume();
+        else if (m_page_cache)
+            m_page_cache->nextEpoch();
+        m_running = true;
+        m_arena.reset();
+    }
+
+    /// @brief Must be called when a stop, exit or kill of the Tracee is
+    /// reported, the other threads may use the page cache again once all
+    /// of them are stopped
+    void onStop() {
+        if (m_page_cache && m_running)
+            m_page_cache->onStop();
+        m_running = false;
+    }
+
+    /**
+     * @brief Mapping of the range has changed (mmap, mprotect, munmap)
+     * 
+     * @param _remote_addr start of the range
+     * @param _len length of the range
+     */
+    void onMappingChange(uintptr_t _remote_addr, size_t _len);
+
+    /// @brief Address space has been replaced (execve), drop every cached
+    /// page and reopen /proc/<pid>/mem on the new address space
+    void onAddressSpaceReset() {
+        if (m_page_cache)
+            m_page_cache->clear();
+        m_mem_file->reopen(m_pid);
+    }
+
+    /**
+     * @brief Read a range of memory from the Tracee Process
+     * 
+     * @param _remote_addr address in the Tracee memory space
+     * @param _buf local buffer, must hold at least _len bytes
+     * @param _len number of bytes to read
+     * @return ssize_t number of bytes read, -1 if nothing could be read
+     */
+    ssize_t readRemote(uintptr_t _remote_addr, void* _buf, size_t _len);
+
+    /**
+     * @brief Write a range of memory in the Tracee Process
+     * 
+     * @param _remote_addr address in the Tracee memory space
+     * @param _buf local buffer holding the data to write
+     * @param _len number of bytes to write
+     * @return ssize_t number of bytes written, -1 if nothing could be written
+     */
+    ssize_t writeRemote(uintptr_t _remote_addr, const void* _buf, size_t _len);
+
+    /**
+     * @brief Read several unrelated ranges from the Tracee Process
+     * 
+     * The ranges are read with as few syscalls as possible, if a range can't
+     * be read in the batch it is retried alone so the failure is confined to
+     * that descriptor. The outcome of each range is stored in its
+     * RemoteIoVec::result.
+     * 
+     * @param _vecs array of range descriptors
+     * @param _count number of descriptors in the array
+     * @return int number of descriptors which were read completely
+     */
+    int readv(RemoteIoVec* _vecs, size_t _count);
+
+    int readv(std::vector<RemoteIoVec>& _vecs) {
+        return readv(_vecs.data(), _vecs.size());
+    }
+
     /**
      * @brief Read data from the Tracee Process
      * 
      * @param dest 
      * @param readSize 
-     * @return int 
+     * @return int number of bytes read, -1 on error
      */
     int readRemoteAddrObj(Addr& dest, size_t readSize);
 
+    /**
+     * @brief Write data to the Tracee Process
+     * 
+     * @param data 
+     * @param writeSize 
+     * @return int number of bytes written, -1 on error
+     */
     int writeRemoteAddrObj(Addr& data, size_t writeSize);
 
     /**
      * @brief Read from the *Raw Address* in the Addr object
      * 
+     * The returned object is allocated on the heap and has to be deleted by
+     * the caller, prefer @ref readView or @ref readAddr in stop handlers.
+     * 
      * @param _remote_addr 
      * @param _buffer_size 
      * @return AddrPtr 
      */
     AddrPtr readPointerObj(uintptr_t _remote_addr, uint64_t _buffer_size);
 
-    int read_cstring(Addr *data);
+    /**
+     * @brief Read Tracee memory into the per-stop arena
+     * 
+     * @param _remote_addr address in the Tracee memory space
+     * @param _size number of bytes to read
+     * @return AddrView view on the data, valid until the Tracee is resumed,
+     * its size is the number of bytes which could be read
+     */
+    AddrView readView(uintptr_t _remote_addr, size_t _size);
+
+    /**
+     * @brief Read Tracee memory into a modifiable buffer borrowed from the
+     * per-stop arena, the buffer can be written back with @ref writeRemoteAddrObj
+     * 
+     * @param _remote_addr address in the Tracee memory space
+     * @param _size number of bytes to read
+     * @param dest set to a buffer of _size bytes, valid until the Tracee
+     * is resumed
+     * @return int number of bytes read, -1 on error
+     */
+    int readAddr(uintptr_t _remote_addr, size_t _size, Addr& dest);
+
+    /// @brief Arena recycled every time the Tracee is resumed
+    AddrArena& arena() { return m_arena; }
+
+    /**
+     * @brief Read a NUL terminated string from the Tracee Process
+     * 
+     * String is fetched one page at a time and the scan stops at the first
+     * NUL byte, so the read never touches the page following the string.
+     * 
+     * @param _remote_addr address of the string in the Tracee
+     * @param str filled with the string, without the NUL terminator
+     * @param max_len maximum number of bytes read, including the terminator,
+     * so the string is at most max_len - 1 characters long
+     * @return ssize_t length of the string, -1 if the terminator was not found
+     * within max_len bytes or the string runs into an unreadable page, in that
+     * case str holds the bytes which could be read
+     */
+    ssize_t read_cstring(uintptr_t _remote_addr, std::string& str, size_t max_len = CSTRING_MAX_LEN);
 };
 
 #endif
\ No newline at end of file
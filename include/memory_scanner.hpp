@@ -0,0 +1,225 @@
+#ifndef H_MEMORY_SCANNER_H
+#define H_MEMORY_SCANNER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include "spdlog/spdlog.h"
+
+#include "memory.hpp"
+#include "modules.hpp"
+
+/// @brief size of the chunks in which the regions are read and searched
+#define SCANNER_DEFAULT_CHUNK_SIZE (1024 * 1024)
+
+/**
+ * @brief Byte signature searched by the MemoryScanner
+ *
+ * Every byte of the pattern has a mask, only the bits set in the mask are
+ * compared, a mask of 0x00 matches any byte.
+ */
+struct ScanPattern {
+    std::vector<uint8_t> m_bytes;
+    std::vector<uint8_t> m_mask;
+
+    /// @brief offset of the byte used to find candidates, it is compared
+    /// with all of its bits, -1 if the pattern has no such byte
+    int m_anchor = -1;
+
+    /// @brief identifier handed back with every match of this pattern
+    int m_id = -1;
+
+    size_t size() const { return m_bytes.size(); }
+
+    /// @brief true if the pattern matches the data, data must hold size() bytes
+    bool match(const uint8_t* data) const {
+        for (size_t i = 0; i < m_bytes.size(); i++) {
+            if ((data[i] & m_mask[i]) != m_bytes[i])
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Parse a pattern written as hex bytes, wildcard bytes are
+     * written as "?" or "??", e.g. "48 8b 05 ?? ?? ?? ?? c3"
+     *
+     * @param pattern_str
+     * @param pattern
+     * @return true if the string could be parsed
+     */
+    static bool fromString(const std::string& pattern_str, ScanPattern& pattern);
+};
+
+/**
+ * @brief Search several patterns at once in a local buffer
+ *
+ * Candidates are found by comparing the anchor byte of every pattern with
+ * 16 bytes of the buffer per instruction (SSE2), or with memchr when SSE2
+ * is not available, only the candidates are compared with the full pattern.
+ */
+class PatternMatcher {
+    std::vector<ScanPattern> m_patterns;
+    size_t m_max_size = 0;
+
+public:
+    /**
+     * @brief Add a pattern to the set
+     *
+     * @param pattern
+     * @return int id of the pattern, -1 if the pattern is empty or has no
+     * byte without wildcard bits
+     */
+    int addPattern(ScanPattern pattern);
+
+    size_t maxPatternSize() const { return m_max_size; }
+
+    bool empty() const { return m_patterns.empty(); }
+
+    const ScanPattern& pattern(int id) const { return m_patterns[id]; }
+
+    /**
+     * @brief Search the buffer
+     *
+     * @param data buffer to search
+     * @param len number of bytes in the buffer
+     * @param max_start matches starting at or after this offset are ignored,
+     * lets the caller search an overlap without reporting it twice
+     * @param on_match called with the offset and the pattern id of every
+     * match, returning false stops the search
+     * @return false if the search was stopped by the callback
+     */
+    bool search(const uint8_t* data, size_t len, size_t max_start,
+        const std::function<bool(size_t, int)>& on_match) const;
+};
+
+/// @brief Match reported by the MemoryScanner
+struct ScanMatch {
+    /// @brief region in which the pattern was found
+    const ProcMap* region;
+
+    /// @brief address of the match in the Tracee memory space
+    uintptr_t addr;
+
+    /// @brief id returned by MemoryScanner::addPattern
+    int pattern_id;
+};
+
+/**
+ * @brief Callback receiving the matches while the scan is running, calls
+ * are serialized. Returning false stops the scan.
+ */
+using ScanCallback = std::function<bool(const ScanMatch&)>;
+
+/**
+ * @brief Search byte signatures in the memory of a Tracee
+ *
+ * The regions of the ProcessMap are filtered by permission, split in large
+ * chunks and searched by a pool of worker threads, each worker reads the
+ * Tracee memory on its own. Consecutive chunks overlap so the matches
+ * crossing a chunk boundary are found.
+ *
+ * Scanning normally happens while the Tracee is stopped. When the Tracee
+ * is running the process map is parsed again before the scan and regions
+ * which disappear in the meantime are skipped, the data read is only a
+ * best-effort snapshot in that case.
+ *
+ * PTRACE_PEEKDATA is only allowed to the thread which attached to the
+ * Tracee, with the PTRACE backend the scan runs on the calling thread
+ * alone, which must be the tracer thread.
+ *
+ * The memory is read as the Tracee sees it, the instructions patched by
+ * armed software breakpoints are reported with the trap instruction
+ * (e.g. 0xcc on x86) instead of their original bytes.
+ *
+ * @ingroup platform_support
+ */
+class MemoryScanner {
+
+    RemoteMemory& m_memory;
+    ProcessMap& m_proc_map;
+    PatternMatcher m_matcher;
+
+    /// @brief permissions a region must have to be scanned
+    uint8_t m_perms_required = ProcMap::PERMS_READ;
+
+    /// @brief regions with any of these permissions are skipped
+    uint8_t m_perms_excluded = 0;
+
+    unsigned int m_threads = 0;
+    size_t m_chunk_size = SCANNER_DEFAULT_CHUNK_SIZE;
+    bool m_tracee_running = false;
+
+    /// @brief map parsed for a scan of a running Tracee, the matches point
+    /// into it until the next scan
+    ProcessMap m_running_map;
+
+    std::shared_ptr<spdlog::logger> m_log = spdlog::get("main");
+
+    size_t scanRegions(const std::vector<ProcMap*>& regions, const ScanCallback& on_match);
+
+public:
+    MemoryScanner(RemoteMemory& memory, ProcessMap& proc_map)
+        : m_memory(memory), m_proc_map(proc_map), m_running_map(memory.pid()) {};
+
+    ~MemoryScanner() { m_running_map.clear(); }
+
+    /**
+     * @brief Add a pattern with its mask, bytes and mask must have the same size
+     *
+     * @return int id reported with the matches, -1 if the pattern is invalid
+     */
+    int addPattern(const std::vector<uint8_t>& bytes, const std::vector<uint8_t>& mask);
+
+    /// @brief Add a pattern without wildcard
+    int addPattern(const std::vector<uint8_t>& bytes);
+
+    /// @brief Add a pattern in the ScanPattern::fromString format
+    int addPattern(const std::string& pattern_str);
+
+    /**
+     * @brief Only scan regions with all the permissions of @p required and
+     * none of @p excluded, e.g. (PERMS_READ | PERMS_EXECUTE) for code
+     */
+    MemoryScanner& filterPermissions(uint8_t required, uint8_t excluded = 0) {
+        m_perms_required = required | ProcMap::PERMS_READ;
+        m_perms_excluded = excluded;
+        return *this;
+    }
+
+    /// @brief number of worker threads, 0 uses the number of CPUs,
+    /// ignored with the PTRACE backend
+    MemoryScanner& threads(unsigned int count) {
+        m_threads = count;
+        return *this;
+    }
+
+    MemoryScanner& chunkSize(size_t size) {
+        m_chunk_size = size;
+        return *this;
+    }
+
+    /**
+     * @brief Tracee is not stopped while scanning, the regions of the
+     * matches are then valid until the next scan
+     */
+    MemoryScanner& traceeRunning(bool running = true) {
+        m_tracee_running = running;
+        return *this;
+    }
+
+    /**
+     * @brief Scan the Tracee memory
+     *
+     * @param on_match called for every match
+     * @return size_t number of matches reported
+     */
+    size_t scan(const ScanCallback& on_match);
+
+    /// @brief Scan the Tracee memory and collect every match
+    std::vector<ScanMatch> scan();
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef H_MEMORY_SNAPSHOT_H
+#define H_MEMORY_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "spdlog/spdlog.h"
+
+#include "memory.hpp"
+#include "modules.hpp"
+
+/// @brief soft-dirty flag of a /proc/<pid>/pagemap entry
+#define PAGEMAP_SOFT_DIRTY (1ULL << 55)
+
+/// @brief value written to /proc/<pid>/clear_refs to reset the soft-dirty flags
+#define CLEAR_REFS_SOFT_DIRTY "4"
+
+/**
+ * @brief Page of a MemorySnapshot which was written since the snapshot
+ */
+struct DirtyPage {
+    /// @brief address of the page in the Tracee memory space
+    uintptr_t addr;
+
+    /// @brief content of the page when the snapshot was taken
+    const uint8_t* baseline;
+
+    /// @brief current content of the page
+    const uint8_t* current;
+};
+
+/**
+ * @brief Pages which changed since a snapshot was taken
+ *
+ * The current content of all the pages is read in one batch when the diff
+ * is created, iterate over it with a range based for loop.
+ */
+class MemoryDiff {
+    friend class MemorySnapshot;
+
+    std::vector<DirtyPage> m_pages;
+
+    /// @brief current content of the pages, m_pages point into it
+    std::vector<uint8_t> m_current;
+
+public:
+    typedef std::vector<DirtyPage>::const_iterator const_iterator;
+
+    const_iterator begin() const { return m_pages.begin(); }
+    const_iterator end() const { return m_pages.end(); }
+    size_t size() const { return m_pages.size(); }
+    bool empty() const { return m_pages.empty(); }
+};
+
+/**
+ * @brief Checkpoint of the writable memory of a stopped Tracee
+ *
+ * Taking the snapshot copies every private writable region and resets the
+ * soft-dirty flags of the Tracee with /proc/<pid>/clear_refs, from then on
+ * the kernel flags each page the Tracee writes to in /proc/<pid>/pagemap.
+ * Diff and restore only look at the flagged pages, so resetting the state
+ * costs a few page writes instead of a copy of the whole heap.
+ *
+ * When the kernel has no soft-dirty support (CONFIG_MEM_SOFT_DIRTY) every
+ * page of the snapshot is considered dirty and the diff falls back to a
+ * comparison of the content.
+ *
+ * Regions mapped after the snapshot, the part of a region which grew
+ * after it (e.g. brk) and the pages which couldn't be read when it was
+ * taken are not tracked.
+ *
+ * @ingroup platform_support
+ */
+class MemorySnapshot {
+
+    struct SnapshotRegion {
+        uintptr_t addr_begin;
+        uintptr_t addr_end;
+        std::string path;
+
+        /// @brief content of the region when the snapshot was taken
+        std::vector<uint8_t> data;
+    };
+
+    RemoteMemory& m_memory;
+    ProcessMap& m_proc_map;
+    std::vector<SnapshotRegion> m_regions;
+    size_t m_page_size;
+
+    /// @brief the kernel tracks the pages written since the snapshot
+    bool m_soft_dirty = false;
+
+    std::shared_ptr<spdlog::logger> m_log = spdlog::get("main");
+
+    /// @brief reset the soft-dirty flags of the Tracee
+    bool clearSoftDirty();
+
+    /**
+     * @brief Collect the pages of the snapshot regions written since the
+     * soft-dirty flags were cleared
+     *
+     * @param pages addresses of the dirty pages, ordered
+     * @param baselines baseline content of each dirty page
+     * @return int 0 on success, -1 on error
+     */
+    int dirtyPages(std::vector<uintptr_t>& pages, std::vector<const uint8_t*>& baselines);
+
+public:
+    MemorySnapshot(RemoteMemory& memory, ProcessMap& proc_map);
+
+    /**
+     * @brief Take the snapshot, the Tracee must be stopped. A previous
+     * snapshot is discarded.
+     *
+     * @return int 0 on success, -1 on error
+     */
+    int take();
+
+    /// @brief a snapshot has been taken
+    bool valid() { return !m_regions.empty(); }
+
+    /// @brief soft-dirty tracking is available for this snapshot
+    bool softDirty() { return m_soft_dirty; }
+
+    /// @brief number of bytes held by the snapshot
+    size_t size();
+
+    /**
+     * @brief Pages changed since the snapshot was taken or last restored
+     *
+     * @param compare_content drop the pages which were written with the
+     * same content they had in the snapshot
+     * @return MemoryDiff
+     */
+    MemoryDiff diff(bool compare_content = true);
+
+    /**
+     * @brief Write the snapshot content back to the pages which changed,
+     * the Tracee must be stopped. Contiguous dirty pages are written with
+     * a single write.
+     *
+     * @return int number of pages restored, -1 on error
+     */
+    int restore();
+};
+
+#endif
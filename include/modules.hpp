@@ -2,6 +2,7 @@
 #define H_PROC_MODULE
 
 #include <string>
+#include <vector>
 #include "spdlog/spdlog.h"
 
 struct dev_major_minor_t {
@@ -38,6 +39,8 @@ class ProcessMap {
 
     std::vector<ProcMap*> m_map;
     pid_t m_pid;
+    /// @brief parse() of this map, 0 if it was never parsed
+    uint64_t m_generation = 0;
     std::shared_ptr<spdlog::logger> m_log = spdlog::get("main");
 public:
     std::vector<pid_t> m_child_thread_pids;
@@ -56,8 +59,30 @@ public:
 	void parseLine(char *line);
 	void parseProcessMapFile(FILE *procmaps_file);
 	
-    /// @brief parses the process map from '/proc/<pid>/maps'
+    /// @brief parses the process map from '/proc/<pid>/maps', the
+    /// previously parsed map is discarded
     int parse();
+
+    /// @brief ordering of the parses of every ProcessMap, a map with a
+    /// higher generation was parsed later
+    uint64_t generation() { return m_generation; }
+
+    /// @brief generation of the latest parse of any ProcessMap
+    static uint64_t lastGeneration();
+
+    /**
+     * @brief Find the mapping containing the address
+     * 
+     * @param addr address in the Tracee memory space
+     * @return ProcMap* mapping or nullptr if the address is not mapped
+     */
+    ProcMap* findRegion(uintptr_t addr);
+
+    /// @brief Entries of the last parsed map, ordered by address
+    const std::vector<ProcMap*>& regions() { return m_map; }
+
+    /// @brief Release the parsed map entries
+    void clear();
 	void permStr(uint8_t perm_val, char * pem_str);
 	void print();
     void list_child_threads();
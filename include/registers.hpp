@@ -5,6 +5,8 @@
 #include <sys/uio.h>
 #include <elf.h>
 #include <capstone/capstone.h>
+#include <cstring>
+#include <vector>
 #include "spdlog/spdlog.h"
 
 
@@ -13,9 +15,350 @@ struct RegisterAliases {
   int regnum;
 };
 
+/**
+ * @brief Number of register transfers done and avoided by the register cache
+ */
+struct RegisterCacheStats {
+    /// @brief PTRACE_GETREGSET calls issued
+    uint64_t fetch_calls = 0;
+
+    /// @brief fetch requests served from the cache
+    uint64_t fetch_saved = 0;
+
+    /// @brief PTRACE_SETREGSET calls issued
+    uint64_t update_calls = 0;
+
+    /// @brief update requests skipped because nothing was modified
+    uint64_t update_saved = 0;
+};
+
+/**
+ * @brief Value of a vector register
+ * 
+ * @tparam N size of the register in bytes
+ */
+template <size_t N> struct VectorRegister {
+    uint8_t bytes[N];
+
+    /**
+     * @brief Read a lane of the register, e.g. lane<float>(3) or lane<uint64_t>(1)
+     * 
+     * @param idx lane index, lane 0 is the least significant one
+     */
+    template <typename T> T lane(size_t idx) const {
+        T value;
+        memcpy(&value, bytes + idx * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    template <typename T> void setLane(size_t idx, T value) {
+        memcpy(bytes + idx * sizeof(T), &value, sizeof(T));
+    }
+
+    static constexpr size_t size() { return N; }
+};
+
+typedef VectorRegister<16> Vec128;
+typedef VectorRegister<32> Vec256;
+typedef VectorRegister<64> Vec512;
+
+/**
+ * @brief Register set other than the general purpose one (NT_PRFPREG,
+ * NT_X86_XSTATE, ...), read with PTRACE_GETREGSET
+ * 
+ * The set is fetched on first access only, so a stop in which nobody
+ * touches it costs nothing, and written back only if it was modified.
+ */
+class RegisterSet {
+
+protected:
+    pid_t m_pid;
+    int m_nt_type;
+
+    /// @brief largest size the kernel can hand out for this set
+    size_t m_max_size;
+
+    /// @brief bytes filled by the kernel, the set can be smaller than
+    /// m_max_size (e.g. xstate depends on the CPU features)
+    size_t m_size = 0;
+    std::vector<uint8_t> m_data;
+
+    bool m_valid = false;
+    bool m_dirty = false;
+    RegisterCacheStats m_cache_stats;
+
+    std::shared_ptr<spdlog::logger> m_log = spdlog::get("main");
+
+    /// @brief data of the set, nullptr if it couldn't be fetched
+    uint8_t* data() {
+        if (!m_valid && fetch() < 0)
+            return nullptr;
+        return m_data.data();
+    }
+
+    /// @brief data of the set for modification, nullptr if it couldn't be fetched
+    uint8_t* dataForWrite() {
+        uint8_t* ptr = data();
+        if (ptr)
+            m_dirty = true;
+        return ptr;
+    }
+
+    /// @brief the fetched set holds [offset, offset + len)
+    bool contains(size_t offset, size_t len) {
+        return data() && offset + len <= m_size;
+    }
+
+public:
+    RegisterSet(pid_t tracee_pid, int nt_type, size_t max_size)
+        : m_pid(tracee_pid), m_nt_type(nt_type), m_max_size(max_size) {}
+
+    void setPid(pid_t tracee_pid) {
+        m_pid = tracee_pid;
+        invalidate();
+    }
+
+    int fetch() {
+        if (m_valid) {
+            m_cache_stats.fetch_saved++;
+            return 0;
+        }
+
+        m_data.resize(m_max_size);
+        struct iovec io;
+        io.iov_base = m_data.data();
+        io.iov_len = m_data.size();
+
+        m_cache_stats.fetch_calls++;
+        int ret = ptrace(PTRACE_GETREGSET, m_pid, (void*)(long)m_nt_type, (void*)&io);
+        if (ret < 0) {
+            m_log->error("Unable to get tracee [pid : {}] register set {:#x}, Err code: {}", m_pid, m_nt_type, ret);
+            return ret;
+        }
+
+        m_size = io.iov_len;
+        m_valid = true;
+        m_dirty = false;
+        return ret;
+    }
+
+    int update() {
+        if (!m_dirty) {
+            m_cache_stats.update_saved++;
+            return 0;
+        }
+
+        struct iovec io;
+        io.iov_base = m_data.data();
+        io.iov_len = m_size;
+
+        m_cache_stats.update_calls++;
+        int ret = ptrace(PTRACE_SETREGSET, m_pid, (void*)(long)m_nt_type, (void*)&io);
+        if (ret < 0) {
+            m_log->error("Unable to set tracee [pid : {}] register set {:#x}, Err code: {}", m_pid, m_nt_type, ret);
+        } else {
+            m_dirty = false;
+        }
+        return ret;
+    }
+
+    void invalidate() {
+        m_valid = false;
+        m_dirty = false;
+    }
+
+    /// @brief write pending modifications and drop the cache
+    void onResume() {
+        update();
+        invalidate();
+    }
+
+    /// @brief bytes filled by the kernel, fetches the set
+    size_t size() {
+        data();
+        return m_size;
+    }
+
+    const RegisterCacheStats& cacheStats() { return m_cache_stats; }
+
+    /**
+     * @brief Read a value at an offset of the set
+     * 
+     * @return false if the set couldn't be fetched or is too small
+     */
+    template <typename T> bool read(size_t offset, T& value) {
+        if (!contains(offset, sizeof(T)))
+            return false;
+        memcpy(&value, m_data.data() + offset, sizeof(T));
+        return true;
+    }
+
+    template <typename T> bool write(size_t offset, const T& value) {
+        if (!contains(offset, sizeof(T)))
+            return false;
+        memcpy(dataForWrite() + offset, &value, sizeof(T));
+        return true;
+    }
+};
+
+/// @brief FXSAVE area, NT_PRFPREG on x86-64
+#define X86_FXSAVE_SIZE 512
+#define X86_FXSAVE_MXCSR_OFFSET 24
+#define X86_FXSAVE_ST_OFFSET 32
+#define X86_FXSAVE_XMM_OFFSET 160
+
+/// @brief offsets of the XSAVE components in the standard (non compacted)
+/// format used by NT_X86_XSTATE
+#define X86_XSTATE_HEADER_OFFSET 512
+#define X86_XSTATE_YMM_HI_OFFSET 576
+#define X86_XSTATE_OPMASK_OFFSET 1088
+#define X86_XSTATE_ZMM_HI_OFFSET 1152
+#define X86_XSTATE_HI16_ZMM_OFFSET 1664
+
+/// @brief xstate_bv bits of the components we write
+#define X86_XFEATURE_SSE (1ULL << 1)
+#define X86_XFEATURE_YMM (1ULL << 2)
+#define X86_XFEATURE_OPMASK (1ULL << 5)
+#define X86_XFEATURE_ZMM_HI (1ULL << 6)
+#define X86_XFEATURE_HI16_ZMM (1ULL << 7)
+
+/// @brief big enough for every xstate component including AMX
+#define X86_XSTATE_MAX_SIZE (16 * 1024)
+
+/**
+ * @brief x87/SSE registers of an x86-64 Tracee (NT_PRFPREG)
+ */
+class X86FpRegisters : public RegisterSet {
+public:
+    X86FpRegisters(pid_t tracee_pid)
+        : RegisterSet(tracee_pid, NT_PRFPREG, X86_FXSAVE_SIZE) {}
+
+    bool getXmm(uint8_t idx, Vec128& value) {
+        return read(X86_FXSAVE_XMM_OFFSET + idx * sizeof(Vec128), value);
+    }
+
+    bool setXmm(uint8_t idx, const Vec128& value) {
+        return write(X86_FXSAVE_XMM_OFFSET + idx * sizeof(Vec128), value);
+    }
+
+    bool getMxcsr(uint32_t& value) {
+        return read(X86_FXSAVE_MXCSR_OFFSET, value);
+    }
+};
+
+/**
+ * @brief Extended processor state of an x86 Tracee (NT_X86_XSTATE), gives
+ * access to the AVX and AVX-512 registers
+ * 
+ * Accessors return false when the CPU doesn't have the component.
+ */
+class X86XStateRegisters : public RegisterSet {
+
+    /// @brief the kernel ignores components whose xstate_bv bit is clear
+    void markComponent(uint64_t feature) {
+        uint64_t xstate_bv = 0;
+        read(X86_XSTATE_HEADER_OFFSET, xstate_bv);
+        write(X86_XSTATE_HEADER_OFFSET, xstate_bv | feature);
+    }
+
+public:
+    X86XStateRegisters(pid_t tracee_pid)
+        : RegisterSet(tracee_pid, NT_X86_XSTATE, X86_XSTATE_MAX_SIZE) {}
+
+    bool getXmm(uint8_t idx, Vec128& value) {
+        return read(X86_FXSAVE_XMM_OFFSET + idx * sizeof(Vec128), value);
+    }
+
+    bool setXmm(uint8_t idx, const Vec128& value) {
+        if (!write(X86_FXSAVE_XMM_OFFSET + idx * sizeof(Vec128), value))
+            return false;
+        markComponent(X86_XFEATURE_SSE);
+        return true;
+    }
+
+    bool getYmm(uint8_t idx, Vec256& value) {
+        return getXmm(idx, reinterpret_cast<Vec128*>(value.bytes)[0]) &&
+            read(X86_XSTATE_YMM_HI_OFFSET + idx * sizeof(Vec128), reinterpret_cast<Vec128*>(value.bytes)[1]);
+    }
+
+    bool setYmm(uint8_t idx, const Vec256& value) {
+        if (!contains(X86_XSTATE_YMM_HI_OFFSET + idx * sizeof(Vec128), sizeof(Vec128)))
+            return false;
+        setXmm(idx, reinterpret_cast<const Vec128*>(value.bytes)[0]);
+        write(X86_XSTATE_YMM_HI_OFFSET + idx * sizeof(Vec128), reinterpret_cast<const Vec128*>(value.bytes)[1]);
+        markComponent(X86_XFEATURE_YMM);
+        return true;
+    }
+
+    /// @brief zmm0-zmm31, zmm16 and above don't alias any xmm/ymm register
+    bool getZmm(uint8_t idx, Vec512& value) {
+        if (idx >= 16)
+            return read(X86_XSTATE_HI16_ZMM_OFFSET + (idx - 16) * sizeof(Vec512), value);
+        return getYmm(idx, reinterpret_cast<Vec256*>(value.bytes)[0]) &&
+            read(X86_XSTATE_ZMM_HI_OFFSET + idx * sizeof(Vec256), reinterpret_cast<Vec256*>(value.bytes)[1]);
+    }
+
+    bool setZmm(uint8_t idx, const Vec512& value) {
+        if (idx >= 16) {
+            if (!write(X86_XSTATE_HI16_ZMM_OFFSET + (idx - 16) * sizeof(Vec512), value))
+                return false;
+            markComponent(X86_XFEATURE_HI16_ZMM);
+            return true;
+        }
+        if (!contains(X86_XSTATE_ZMM_HI_OFFSET + idx * sizeof(Vec256), sizeof(Vec256)))
+            return false;
+        setYmm(idx, reinterpret_cast<const Vec256*>(value.bytes)[0]);
+        write(X86_XSTATE_ZMM_HI_OFFSET + idx * sizeof(Vec256), reinterpret_cast<const Vec256*>(value.bytes)[1]);
+        markComponent(X86_XFEATURE_ZMM_HI);
+        return true;
+    }
+
+    /// @brief AVX-512 opmask registers k0-k7
+    bool getOpmask(uint8_t idx, uint64_t& value) {
+        return read(X86_XSTATE_OPMASK_OFFSET + idx * sizeof(uint64_t), value);
+    }
+};
+
+/// @brief layout of struct user_fpsimd_state, NT_PRFPREG on ARM64
+#define ARM64_FPSIMD_SIZE 528
+#define ARM64_FPSIMD_FPSR_OFFSET 512
+#define ARM64_FPSIMD_FPCR_OFFSET 516
+
+/**
+ * @brief FP/SIMD registers V0-V31 of an ARM64 Tracee (NT_PRFPREG)
+ */
+class ARM64FpRegisters : public RegisterSet {
+public:
+    ARM64FpRegisters(pid_t tracee_pid)
+        : RegisterSet(tracee_pid, NT_PRFPREG, ARM64_FPSIMD_SIZE) {}
+
+    bool getV(uint8_t idx, Vec128& value) {
+        return read(idx * sizeof(Vec128), value);
+    }
+
+    bool setV(uint8_t idx, const Vec128& value) {
+        return write(idx * sizeof(Vec128), value);
+    }
+
+    bool getFpsr(uint32_t& value) {
+        return read(ARM64_FPSIMD_FPSR_OFFSET, value);
+    }
+
+    bool getFpcr(uint32_t& value) {
+        return read(ARM64_FPSIMD_FPCR_OFFSET, value);
+    }
+};
+
+/// @brief maximum number of extended register sets of an architecture
+#define REGISTER_SETS_MAX 2
+
 /**
  * @brief Abstraction for represent Register of the Tracee
  * 
+ * The register block is cached for the duration of a stop, it is fetched
+ * from the Tracee on first access and written back only if a setter has
+ * modified it. The Tracee calls @ref onResume before it is resumed.
+ * 
 */
 class Registers {
 
@@ -30,6 +373,32 @@ protected:
     uint8_t frame_base_pointer_register_idx = 0;
     std::shared_ptr<spdlog::logger> m_log = spdlog::get("main");
 
+    /// @brief m_gp_reg_data holds the registers of the current stop
+    bool m_valid = false;
+
+    /// @brief m_gp_reg_data was modified and not written to the Tracee yet
+    bool m_dirty = false;
+
+    RegisterCacheStats m_cache_stats;
+
+    /// @brief fetch the registers if they are not cached yet
+    void ensureFetched() {
+        if (!m_valid)
+            fetch();
+    }
+
+    /// @brief register block is going to be modified
+    void markDirty() {
+        ensureFetched();
+        m_dirty = true;
+    }
+
+    /// @brief Extended register sets of the architecture, they are cached
+    /// and invalidated together with the general purpose registers
+    /// @param sets filled with at most REGISTER_SETS_MAX sets
+    /// @return size_t number of sets
+    virtual size_t extendedSets(RegisterSet** sets) { return 0; }
+
 public:
 
     Registers(pid_t tracee_pid, uint8_t _gp_reg_count, uint16_t _gp_reg_size)
@@ -46,44 +415,91 @@ public:
 
     void setPid(pid_t tracee_pid) { 
         m_pid = tracee_pid;
+        invalidate();
+
+        RegisterSet* sets[REGISTER_SETS_MAX];
+        size_t set_count = extendedSets(sets);
+        for (size_t i = 0; i < set_count; i++)
+            sets[i]->setPid(tracee_pid);
     }
 
-    /// @brief read the General Purpose register of the Tracee Process
+    /// @brief read the General Purpose register of the Tracee Process,
+    /// nothing is read if the registers of this stop are cached already
+    /// @param force read the registers even if they are cached
     /// @return return the ptrace error value
-    virtual int fetch() {
+    virtual int fetch(bool force = false) {
+        if (m_valid && !force) {
+            m_cache_stats.fetch_saved++;
+            return 0;
+        }
+
         struct iovec io;
         
         io.iov_base = reinterpret_cast<void *>(m_gp_reg_data);
         io.iov_len = m_gp_reg_size;
 
+        m_cache_stats.fetch_calls++;
         int pt_ret = ptrace(PTRACE_GETREGSET, m_pid, (void*)NT_PRSTATUS, (void*)&io);
         if (pt_ret < 0) {
             m_log->error("Unable to get tracee [pid : {}] register, Err code: {}", m_pid, pt_ret);
+        } else {
+            m_valid = true;
+            m_dirty = false;
         }
 
         return pt_ret;
     }
 
-    /// @brief Upate the general purpose register value to the Tracee Process
+    /// @brief Upate the general purpose register value to the Tracee Process,
+    /// nothing is written if no register was modified
     /// @return 
     virtual int update() {
+        if (!m_dirty) {
+            m_cache_stats.update_saved++;
+            return 0;
+        }
+
         struct iovec io;
 
         io.iov_base = reinterpret_cast<void *>(m_gp_reg_data);
         io.iov_len = m_gp_reg_size;
 
+        m_cache_stats.update_calls++;
         int ret = ptrace(PTRACE_SETREGSET, m_pid, (void*)NT_PRSTATUS, (void*)&io);
 
         if (ret < 0) {
             m_log->error("Unable to get tracee [pid : {}] register, Err code: {}", m_pid, ret);
+        } else {
+            m_dirty = false;
         }
         return ret;
     }
 
+    /// @brief Drop the cached registers, the next access fetches them again
+    void invalidate() {
+        m_valid = false;
+        m_dirty = false;
+    }
+
+    /// @brief Must be called right before the Tracee is resumed, pending
+    /// modifications are written and the cache is dropped
+    void onResume() {
+        update();
+        invalidate();
+
+        RegisterSet* sets[REGISTER_SETS_MAX];
+        size_t set_count = extendedSets(sets);
+        for (size_t i = 0; i < set_count; i++)
+            sets[i]->onResume();
+    }
+
+    const RegisterCacheStats& cacheStats() { return m_cache_stats; }
+
     /// @brief Creates a copy for General Purpose registers
     /// freeing the returned copy is the responsibility of the Caller
     /// @return return the copy of register.
     std::uintptr_t getRegisterCopy() {
+        ensureFetched();
         void* gp_reg_copy = malloc(m_gp_reg_size);
         memcpy(gp_reg_copy, reinterpret_cast<void*>(m_gp_reg_data), m_gp_reg_size);
         return reinterpret_cast<std::uintptr_t>(gp_reg_copy);
@@ -94,6 +510,8 @@ public:
     /// @param register_copy 
     void restoreRegisterCopy(std::uintptr_t register_copy) {
         memcpy(reinterpret_cast<void *>(m_gp_reg_data), reinterpret_cast<void *>(register_copy), m_gp_reg_size);
+        m_valid = true;
+        m_dirty = true;
     }
 
 };
@@ -115,10 +533,12 @@ public:
      : Registers::Registers(tracee_pid, _gp_reg_cnt, sizeof(T) * _gp_reg_cnt) {};
     
     virtual T getRegIdx(uint8_t reg_idx) {
+        ensureFetched();
         return reinterpret_cast<T *>(m_gp_reg_data)[reg_idx];
     }
 
     virtual void setRegIdx(uint8_t reg_idx, T value) {
+        markDirty();
         reinterpret_cast<T *>(m_gp_reg_data)[reg_idx] = value;
     }
 
@@ -128,6 +548,7 @@ public:
     }
 
     void setProgramCounter(T reg_val) {
+        markDirty();
         reinterpret_cast<T *>(m_gp_reg_data)[program_register_idx] = reg_val;
     }
 
@@ -145,7 +566,15 @@ public:
 
 #define ARCH_X86_GP_REG_CNT 17
 
-class X86Register: public IRegisters<uint32_t> {
+class X86Register final : public IRegisters<uint32_t> {
+
+    X86XStateRegisters m_xstate;
+
+protected:
+    size_t extendedSets(RegisterSet** sets) {
+        sets[0] = &m_xstate;
+        return 1;
+    }
 
 public:
     enum REGISTER_IDX : uint8_t {
@@ -169,7 +598,7 @@ public:
     };
 
     X86Register(pid_t tracee_pid)
-        : IRegisters<uint32_t>(tracee_pid, ARCH_X86_GP_REG_CNT) {
+        : IRegisters<uint32_t>(tracee_pid, ARCH_X86_GP_REG_CNT), m_xstate(tracee_pid) {
         program_register_idx = static_cast<uint8_t>(REGISTER_IDX::EIP);
         stack_pointer_register_idx = static_cast<uint8_t>(REGISTER_IDX::ESP);
         frame_base_pointer_register_idx = static_cast<uint8_t>(REGISTER_IDX::EBP);
@@ -179,6 +608,9 @@ public:
         return getProgramCounter() - 1;
     }
 
+    /// @brief x87/SSE/AVX state, fetched on first access
+    X86XStateRegisters& xstate() { return m_xstate; }
+
     void print();
 };
 
@@ -186,7 +618,17 @@ public:
 #define ARCH_AMD64_GP_REG_CNT 27
 
 
-class AMD64Register: public IRegisters<uint64_t> {
+class AMD64Register final : public IRegisters<uint64_t> {
+
+    X86FpRegisters m_fp;
+    X86XStateRegisters m_xstate;
+
+protected:
+    size_t extendedSets(RegisterSet** sets) {
+        sets[0] = &m_fp;
+        sets[1] = &m_xstate;
+        return 2;
+    }
 
 public:
     enum REGISTER_IDX : uint8_t {
@@ -220,7 +662,7 @@ public:
     };
 
     AMD64Register(pid_t tracee_pid)
-        : IRegisters<uint64_t>(tracee_pid, ARCH_AMD64_GP_REG_CNT) {
+        : IRegisters<uint64_t>(tracee_pid, ARCH_AMD64_GP_REG_CNT), m_fp(tracee_pid), m_xstate(tracee_pid) {
         program_register_idx = static_cast<uint8_t>(REGISTER_IDX::RIP);
         stack_pointer_register_idx = static_cast<uint8_t>(REGISTER_IDX::RSP);
         frame_base_pointer_register_idx = static_cast<uint8_t>(REGISTER_IDX::RBP);
@@ -230,6 +672,14 @@ public:
         return getProgramCounter() - 1;
     }
 
+    /// @brief x87/SSE registers, fetched on first access
+    X86FpRegisters& fp() { return m_fp; }
+
+    /// @brief x87/SSE/AVX/AVX-512 state, fetched on first access. Don't
+    /// modify the same register through fp() and xstate() during a stop,
+    /// both are written back on resume.
+    X86XStateRegisters& xstate() { return m_xstate; }
+
     void print();
 
 };
@@ -237,7 +687,7 @@ public:
 #define ARCH_ARM_GP_REG_CNT 18
 #define CPSR_THUMB 0x20
 
-class ARM32Register: public IRegisters<uint32_t> {
+class ARM32Register final : public IRegisters<uint32_t> {
     
     std::shared_ptr<spdlog::logger> m_log = spdlog::get("debugger");
 
@@ -305,37 +755,37 @@ public:
     }
 
     void print() {
-        m_log->trace("--------------------[ ARM REGISTER ]--------------------");
+        SPDLOG_LOGGER_TRACE(m_log, "--------------------[ ARM REGISTER ]--------------------");
 
         for(int i=0; i < ARCH_ARM_GP_REG_CNT; i++) {
             switch (i) {
             case PC:
-                m_log->trace("\tPC   {:#04x}", getRegIdx(i));
+                SPDLOG_LOGGER_TRACE(m_log, "\tPC   {:#04x}", getRegIdx(i));
                 break;
             case SP:
-                m_log->trace("\tSP   {:#04x}", getRegIdx(i));
+                SPDLOG_LOGGER_TRACE(m_log, "\tSP   {:#04x}", getRegIdx(i));
                 break;
             case LR:
-                m_log->trace("\tLR   {:#04x}", getRegIdx(i));
+                SPDLOG_LOGGER_TRACE(m_log, "\tLR   {:#04x}", getRegIdx(i));
                 break;
             case FP:
-                m_log->trace("\tFP   {:#04x}", getRegIdx(i));
+                SPDLOG_LOGGER_TRACE(m_log, "\tFP   {:#04x}", getRegIdx(i));
                 break;
             case IP:
-                m_log->trace("\tIP   {:#04x}", getRegIdx(i));
+                SPDLOG_LOGGER_TRACE(m_log, "\tIP   {:#04x}", getRegIdx(i));
                 break;
             case CPSR:
-                m_log->trace("\tCPSR {:#04x}", getRegIdx(i));
+                SPDLOG_LOGGER_TRACE(m_log, "\tCPSR {:#04x}", getRegIdx(i));
                 break;
             case ORIG_R0:
-                m_log->trace("\tORIG_R0 {:#04x}", getRegIdx(i));
+                SPDLOG_LOGGER_TRACE(m_log, "\tORIG_R0 {:#04x}", getRegIdx(i));
                 break;
             default:
-                m_log->trace("\tR{:<3} {:#04x}",i, getRegIdx(i));
+                SPDLOG_LOGGER_TRACE(m_log, "\tR{:<3} {:#04x}",i, getRegIdx(i));
                 break;
             }
         }
-        m_log->trace("--------------------[ ARM END REGISTER ]-----------------");
+        SPDLOG_LOGGER_TRACE(m_log, "--------------------[ ARM END REGISTER ]-----------------");
     };
 };
 
@@ -344,7 +794,15 @@ public:
 
 #define ARCH_ARM64_GP_REG_CNT 35
 
-class ARM64Register: public IRegisters<uint64_t> {
+class ARM64Register final : public IRegisters<uint64_t> {
+
+    ARM64FpRegisters m_fpsimd;
+
+protected:
+    size_t extendedSets(RegisterSet** sets) {
+        sets[0] = &m_fpsimd;
+        return 1;
+    }
 
 public:
     enum REGISTER_IDX : uint8_t {
@@ -386,7 +844,7 @@ public:
     };
 
     ARM64Register(pid_t tracee_pid)
-        : IRegisters<uint64_t>(tracee_pid, ARCH_ARM64_GP_REG_CNT) {
+        : IRegisters<uint64_t>(tracee_pid, ARCH_ARM64_GP_REG_CNT), m_fpsimd(tracee_pid) {
         
         program_register_idx = static_cast<uint8_t>(REGISTER_IDX::PC);
         stack_pointer_register_idx = static_cast<uint8_t>(REGISTER_IDX::SP);
@@ -397,9 +855,12 @@ public:
         return getProgramCounter();
     }
 
+    /// @brief FP/SIMD registers, fetched on first access
+    ARM64FpRegisters& fpsimd() { return m_fpsimd; }
+
     void print() {
         for(int i=0; i < ARCH_ARM64_GP_REG_CNT; i++) {
-            m_log->debug("X{:<3} {:#04x}",i, getRegIdx(i));
+            SPDLOG_LOGGER_DEBUG(m_log, "X{:<3} {:#04x}",i, getRegIdx(i));
         }
     };
 };
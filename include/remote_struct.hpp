@@ -0,0 +1,326 @@
+#ifndef H_REMOTE_STRUCT_H
+#define H_REMOTE_STRUCT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "config.hpp"
+#include "memory.hpp"
+
+/**
+ * @brief Size of the primitive types of the Tracee, the remote layouts
+ * are written in terms of these so the same definition describes the
+ * 32 and the 64 bit ABI
+ *
+ * @tparam arch architecture of the Tracee
+ */
+template <CPU_ARCH arch>
+struct RemoteAbi {
+    typedef uint64_t ptr_t;
+    typedef uint64_t size_t_;
+    typedef int64_t long_t;
+};
+
+template <>
+struct RemoteAbi<CPU_ARCH::X86> {
+    typedef uint32_t ptr_t;
+    typedef uint32_t size_t_;
+    typedef int32_t long_t;
+};
+
+template <>
+struct RemoteAbi<CPU_ARCH::ARM32> {
+    typedef uint32_t ptr_t;
+    typedef uint32_t size_t_;
+    typedef int32_t long_t;
+};
+
+typedef RemoteAbi<TARGET_CPU_ARCH> TargetAbi;
+
+/// @brief pointer in the Tracee memory space, as stored in Tracee structures
+typedef TargetAbi::ptr_t remote_ptr_t;
+
+/// @brief Tracee layout of struct iovec
+template <typename Abi = TargetAbi>
+struct remote_iovec_t {
+    typename Abi::ptr_t iov_base;
+    typename Abi::size_t_ iov_len;
+};
+
+/// @brief Tracee layout of struct msghdr
+template <typename Abi = TargetAbi>
+struct remote_msghdr_t {
+    typename Abi::ptr_t msg_name;
+    uint32_t msg_namelen;
+    typename Abi::ptr_t msg_iov;
+    typename Abi::size_t_ msg_iovlen;
+    typename Abi::ptr_t msg_control;
+    typename Abi::size_t_ msg_controllen;
+    int32_t msg_flags;
+};
+
+/// @brief Tracee layout of struct mmsghdr, used by sendmmsg/recvmmsg
+template <typename Abi = TargetAbi>
+struct remote_mmsghdr_t {
+    remote_msghdr_t<Abi> msg_hdr;
+    uint32_t msg_len;
+};
+
+/**
+ * @brief Typed pointer into the Tracee memory space
+ *
+ * Nothing is read when the pointer is created, it only describes what the
+ * pointer points to, see RemoteStruct and RemoteArray.
+ *
+ * @tparam T Tracee layout of the pointed type
+ */
+template <typename T>
+class RemotePtr {
+    uintptr_t m_addr;
+
+public:
+    RemotePtr() : m_addr(0) {}
+    explicit RemotePtr(uintptr_t addr) : m_addr(addr) {}
+
+    uintptr_t addr() const { return m_addr; }
+    bool null() const { return m_addr == 0; }
+
+    /// @brief pointer to the n-th element after this one
+    RemotePtr<T> operator+(size_t n) const { return RemotePtr<T>(m_addr + n * sizeof(T)); }
+};
+
+/**
+ * @brief Local copy of a structure of the Tracee
+ *
+ * The structure is read on first use of get(RemoteMemory&), or together
+ * with others through a RemoteFetchBatch. Pointer fields are followed with
+ * @ref follow which only creates the next RemoteStruct, nothing is read
+ * until it is used.
+ *
+ * @tparam T Tracee layout of the structure
+ */
+template <typename T>
+class RemoteStruct {
+    friend class RemoteFetchBatch;
+
+    uintptr_t m_addr;
+    T m_value;
+
+    /// @brief bytes read, 0 while not fetched, -1 on error
+    ssize_t m_result = 0;
+    bool m_fetched = false;
+
+public:
+    RemoteStruct() : m_addr(0) {}
+    explicit RemoteStruct(uintptr_t addr) : m_addr(addr) {}
+    explicit RemoteStruct(RemotePtr<T> ptr) : m_addr(ptr.addr()) {}
+
+    uintptr_t addr() const { return m_addr; }
+    bool fetched() const { return m_fetched; }
+
+    /// @brief the whole structure could be read
+    bool valid() const { return m_fetched && m_result == static_cast<ssize_t>(sizeof(T)); }
+
+    /**
+     * @brief Read the structure if it wasn't read yet
+     *
+     * @return true if the whole structure could be read
+     */
+    bool fetch(RemoteMemory& memory) {
+        if (!m_fetched) {
+            m_result = m_addr ? memory.readRemote(m_addr, &m_value, sizeof(T)) : -1;
+            m_fetched = true;
+        }
+        return valid();
+    }
+
+    /// @brief Fields of the structure, only meaningful if valid()
+    const T& get() const { return m_value; }
+    const T* operator->() const { return &m_value; }
+
+    /// @brief Read the structure on first use and return it
+    const T& get(RemoteMemory& memory) {
+        fetch(memory);
+        return m_value;
+    }
+
+    /**
+     * @brief Follow a pointer field, nothing is read
+     *
+     * @param field pointer field of T, e.g. &remote_msghdr_t<>::msg_name
+     * @return RemoteStruct<U> structure the field points to
+     */
+    template <typename U, typename P>
+    RemoteStruct<U> follow(P T::*field) const {
+        return RemoteStruct<U>(static_cast<uintptr_t>(m_value.*field));
+    }
+};
+
+/**
+ * @brief Local copy of an array of the Tracee
+ *
+ * @tparam T Tracee layout of the elements
+ */
+template <typename T>
+class RemoteArray {
+    friend class RemoteFetchBatch;
+
+    uintptr_t m_addr;
+    std::vector<T> m_values;
+    ssize_t m_result = 0;
+    bool m_fetched = false;
+
+public:
+    RemoteArray() : m_addr(0) {}
+    RemoteArray(uintptr_t addr, size_t count) : m_addr(addr), m_values(count) {}
+    RemoteArray(RemotePtr<T> ptr, size_t count) : m_addr(ptr.addr()), m_values(count) {}
+
+    uintptr_t addr() const { return m_addr; }
+    bool fetched() const { return m_fetched; }
+
+    /// @brief number of elements which could be read completely
+    size_t size() const {
+        return m_fetched && m_result > 0 ? m_result / sizeof(T) : 0;
+    }
+
+    bool fetch(RemoteMemory& memory) {
+        if (!m_fetched) {
+            m_result = (m_addr && !m_values.empty())
+                ? memory.readRemote(m_addr, m_values.data(), m_values.size() * sizeof(T)) : -1;
+            m_fetched = true;
+        }
+        return size() == m_values.size();
+    }
+
+    const T& operator[](size_t idx) const { return m_values[idx]; }
+};
+
+/**
+ * @brief Buffer of the Tracee, e.g. the data an iovec points to
+ *
+ * The data is held in the per-stop arena of RemoteMemory so it is only
+ * valid until the Tracee is resumed.
+ */
+class RemoteBuffer {
+    friend class RemoteFetchBatch;
+
+    uintptr_t m_addr;
+    size_t m_len;
+    uint8_t* m_data = nullptr;
+    ssize_t m_result = 0;
+    bool m_fetched = false;
+
+    uint8_t* allocate(RemoteMemory& memory) {
+        if (m_data == nullptr && m_len)
+            m_data = memory.arena().allocate(m_len);
+        return m_data;
+    }
+
+public:
+    RemoteBuffer() : m_addr(0), m_len(0) {}
+    RemoteBuffer(uintptr_t addr, size_t len) : m_addr(addr), m_len(len) {}
+
+    uintptr_t addr() const { return m_addr; }
+    bool fetched() const { return m_fetched; }
+
+    bool fetch(RemoteMemory& memory) {
+        if (!m_fetched) {
+            m_result = (m_addr && allocate(memory))
+                ? memory.readRemote(m_addr, m_data, m_len) : -1;
+            m_fetched = true;
+        }
+        return m_result == static_cast<ssize_t>(m_len);
+    }
+
+    /// @brief bytes which could be read
+    AddrView view() const {
+        return AddrView(m_data, m_addr, m_fetched && m_result > 0 ? m_result : 0);
+    }
+};
+
+/**
+ * @brief Read several remote objects with a single batched read
+ *
+ * Objects are queued with @ref add and read together by @ref fetch, which
+ * goes through RemoteMemory::readv. Pointer chasing is done one depth at a
+ * time, every object of a depth is queued before fetching, e.g. for
+ * sendmsg:
+ *
+ *     RemoteFetchBatch batch(memory);
+ *     RemoteStruct<remote_msghdr_t<>> msg(sc_trace.v_arg[1]);
+ *     batch.add(msg).fetch();
+ *
+ *     RemoteArray<remote_iovec_t<>> iov(msg->msg_iov, std::min<size_t>(msg->msg_iovlen, IOV_MAX));
+ *     batch.add(iov).fetch();
+ *
+ *     std::vector<RemoteBuffer> data;
+ *     for (size_t i = 0; i < iov.size(); i++)
+ *         data.push_back(RemoteBuffer(iov[i].iov_base, iov[i].iov_len));
+ *     for (auto& buf : data)
+ *         batch.add(buf);
+ *     batch.fetch();
+ *
+ * The queued objects must not be moved until fetch returns.
+ */
+class RemoteFetchBatch {
+    RemoteMemory& m_memory;
+    std::vector<RemoteIoVec> m_vecs;
+    std::vector<ssize_t*> m_results;
+    std::vector<bool*> m_fetched;
+
+    void queue(uintptr_t addr, size_t len, void* dest, ssize_t* result, bool* fetched) {
+        if (*fetched)
+            return;
+        if (addr == 0 || dest == nullptr || len == 0) {
+            *result = -1;
+            *fetched = true;
+            return;
+        }
+        m_vecs.push_back(RemoteIoVec(addr, len, dest));
+        m_results.push_back(result);
+        m_fetched.push_back(fetched);
+    }
+
+public:
+    RemoteFetchBatch(RemoteMemory& memory) : m_memory(memory) {}
+
+    template <typename T>
+    RemoteFetchBatch& add(RemoteStruct<T>& obj) {
+        queue(obj.m_addr, sizeof(T), &obj.m_value, &obj.m_result, &obj.m_fetched);
+        return *this;
+    }
+
+    template <typename T>
+    RemoteFetchBatch& add(RemoteArray<T>& obj) {
+        queue(obj.m_addr, obj.m_values.size() * sizeof(T), obj.m_values.data(), &obj.m_result, &obj.m_fetched);
+        return *this;
+    }
+
+    RemoteFetchBatch& add(RemoteBuffer& obj) {
+        queue(obj.m_addr, obj.m_len, obj.allocate(m_memory), &obj.m_result, &obj.m_fetched);
+        return *this;
+    }
+
+    /// @brief number of objects waiting for the next fetch
+    size_t pending() const { return m_vecs.size(); }
+
+    /**
+     * @brief Read every queued object
+     *
+     * @return int number of objects which were read completely
+     */
+    int fetch() {
+        int completed = m_vecs.empty() ? 0 : m_memory.readv(m_vecs);
+        for (size_t i = 0; i < m_vecs.size(); i++) {
+            *m_results[i] = m_vecs[i].result;
+            *m_fetched[i] = true;
+        }
+        m_vecs.clear();
+        m_results.clear();
+        m_fetched.clear();
+        return completed;
+    }
+};
+
+#endif
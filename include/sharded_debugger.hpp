@@ -0,0 +1,148 @@
+#ifndef H_SHARDED_DEBUGGER_H
+#define H_SHARDED_DEBUGGER_H
+
+#include <vector>
+#include <thread>
+#include <unistd.h>
+
+#include "spdlog/spdlog.h"
+
+#include "debugger.hpp"
+
+/**
+ * @brief Trace a process with several tracer threads
+ *
+ * A single Debugger serializes every stop of every Tracee, with many busy
+ * threads the tracer becomes the bottleneck. ShardedDebugger runs one
+ * Debugger (shard) per worker thread, each owning a subset of the Tracees.
+ *
+ * ptrace binds a Tracee to the thread which attached it, so each shard
+ * attaches its own Tracees from its worker thread and its event loop only
+ * reaps their events (__WNOTHREAD). Threads and processes created by a
+ * Tracee are auto-attached to the same tracer thread, they stay in the
+ * shard of their parent.
+ *
+ * Shared between the shards :
+ * - BreakpointMngr, every operation is serialized by its lock. The lock
+ *   is only taken on breakpoint hits and injections, the stops which
+ *   dominate the tracing cost (syscalls, signals) never touch it
+ * - the handlers added with add*Handler, they are registered to the
+ *   SyscallManager of every shard and can be called concurrently, they
+ *   must be thread safe
+ * - ResourceTracers, the File and Network Tracers pending or attached to
+ *   a descriptor. Descriptors belong to the process, a file opened by a
+ *   thread of one shard is traced for the threads of every shard
+ *
+ * Limitations :
+ * - on spawn the whole process is traced by the first shard, the other
+ *   shards are only used when attaching to a running process
+ * - ARM32 has no single stepping, it is emulated with temporary
+ *   breakpoints in the shared memory while stopAllThreads only stops the
+ *   threads of one shard. attach is rejected on ARM32 with more than one
+ *   shard, spawn traces the whole process in the first shard anyway
+ * - the Tracees attached by the shards don't use the page cache, the
+ *   threads of a process would share it across tracer threads
+ * - a breakpoint stepped over in place is put back once the last shard
+ *   stepping over it is done, meanwhile the hits of the other threads are
+ *   missed, as with a single Debugger
+ *
+ * @ingroup platform_support
+ */
+class ShardedDebugger {
+
+	std::shared_ptr<spdlog::logger> m_log = spdlog::get("debugger");
+
+	std::vector<Debugger*> m_shards;
+
+	/// @brief Tracees to attach per shard
+	std::vector<std::vector<pid_t>> m_shard_tids;
+
+	std::vector<std::thread> m_workers;
+
+	BreakpointMngr* m_breakpointMngr = nullptr;
+
+	ResourceTracers* m_resources = nullptr;
+
+	/// @brief process attached to, 0 when spawning
+	pid_t m_attach_pid = 0;
+
+	/// @brief /proc/<pid>/mem of the attached process, shared by the
+	/// threads of every shard. It has no page cache, PageCache isn't
+	/// thread safe.
+	RemoteMemory* m_address_space = nullptr;
+
+	std::vector<std::string> m_cmdline;
+
+	/// @brief attach/spawn the Tracees of the shard and run its event loop
+	void runShard(size_t shard_idx);
+
+public:
+
+	/**
+	 * @brief Create the shards
+	 *
+	 * @param target_desc
+	 * @param shard_count number of tracer threads, 0 for one per CPU
+	 */
+	ShardedDebugger(TargetDescription& target_desc, size_t shard_count = 0);
+
+	~ShardedDebugger();
+
+	size_t shardCount() { return m_shards.size(); }
+
+	Debugger& shard(size_t shard_idx) { return *m_shards[shard_idx]; }
+
+	ShardedDebugger& followFork();
+
+	ShardedDebugger& traceSyscall();
+
+	ShardedDebugger& setMemoryBackend(MemoryBackend backend);
+
+	ShardedDebugger& useDisplacedStepping();
+
+	/**
+	 * @brief Spread the threads of a running process over the shards,
+	 * nothing is attached until run()
+	 *
+	 * Fails with ErrArchitecture on ARM32 with more than one shard.
+	 *
+	 * @param tracee_pid Process ID to attach to
+	 * @return DebugResult
+	 */
+	DebugResult attach(pid_t tracee_pid);
+
+	/**
+	 * @brief Create a new process in the first shard when run() is called
+	 *
+	 * @param cmdline
+	 * @return DebugResult
+	 */
+	DebugResult spawn(std::vector<std::string>& cmdline);
+
+	/// @brief Start the worker threads and wait for all the shards to finish
+	void run();
+
+	void addBreakpoint(std::vector<std::string>& brk_pnt_str) {
+		for (auto& brk_pnt : brk_pnt_str)
+			m_breakpointMngr->parseModuleBrkPnt(brk_pnt);
+	};
+
+	BreakpointMngr* getBreakpointMngr() {
+		return m_breakpointMngr;
+	};
+
+	void addSyscallHandler(SyscallHandler* syscall_hdlr) {
+		for (auto shard : m_shards)
+			shard->addSyscallHandler(syscall_hdlr);
+	};
+
+	void addFileOperationHandler(FileOperationTracer* file_opts) {
+		m_resources->addFileOperationHandler(file_opts);
+	};
+
+	void addNetworkOperationHandler(NetworkOperationTracer* network_opts) {
+		m_resources->addNetworkOperationHandler(network_opts);
+	};
+};
+
+#endif
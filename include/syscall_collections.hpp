@@ -1,24 +1,85 @@
 #ifndef _H_SYSCALL_COLLECTIONS
 #define _H_SYSCALL_COLLECTIONS
 
+#include <climits>
+
 #include "utils.hpp"
+#include "remote_struct.hpp"
+
+/// @brief bytes of each sendmsg/recvmsg buffer shown in the debug log
+#define DATA_SOCKET_LOG_BYTES 256
 
 class DataSocket : public NetworkOperationTracer
 {
 
+	/// @brief Log the buffers of a sendmsg/recvmsg, at most @p len bytes and
+	/// DATA_SOCKET_LOG_BYTES of each buffer
+	void logMessage(DebugOpts &debug_opts, SyscallTraceData &sc_trace, size_t len)
+	{
+		// the buffers are only read to be logged
+		if (SPDLOG_ACTIVE_LEVEL > SHAMAN_LOG_LEVEL_DEBUG || !m_log->should_log(spdlog::level::debug))
+		{
+			return;
+		}
+
+		// msghdr -> msg_iov -> iov_base, one batched read per level
+		RemoteFetchBatch batch(debug_opts.m_memory);
+		RemoteStruct<remote_msghdr_t<>> msg(sc_trace.v_arg[1]);
+		batch.add(msg).fetch();
+		if (!msg.valid())
+		{
+			m_log->error("onMessage: failed to read the msghdr at {:x}", sc_trace.v_arg[1]);
+			return;
+		}
+
+		RemoteArray<remote_iovec_t<>> iov(msg->msg_iov, std::min<size_t>(msg->msg_iovlen, IOV_MAX));
+		batch.add(iov).fetch();
+
+		std::vector<RemoteBuffer> data;
+		for (size_t i = 0; i < iov.size() && len > 0; i++)
+		{
+			size_t iov_len = std::min<size_t>(iov[i].iov_len, len);
+			data.push_back(RemoteBuffer(iov[i].iov_base, std::min<size_t>(iov_len, DATA_SOCKET_LOG_BYTES)));
+			len -= iov_len;
+		}
+		for (auto &buf : data)
+		{
+			batch.add(buf);
+		}
+		batch.fetch();
+
+		for (auto &buf : data)
+		{
+			AddrView view = buf.view();
+			SPDLOG_LOGGER_DEBUG(m_log, "onMessage: {:x} {}", view.raddr(),
+				spdlog::to_hex(view.data(), view.data() + view.size()));
+		}
+	}
+
 	void onRecv(SyscallState sys_state, DebugOpts &debug_opts, SyscallTraceData &sc_trace)
 	{
 		char malicious_text[] = "This is malicious data which is been intercepted and fille with!";
-		if (sys_state == SyscallState::ON_EXIT)
+		if (sys_state == SyscallState::ON_EXIT && sc_trace.getSyscallNo() == SysCallId::RECVMSG)
+		{
+			if (static_cast<int64_t>(sc_trace.v_rval) > 0)
+			{
+				logMessage(debug_opts, sc_trace, sc_trace.v_rval);
+			}
+		}
+		else if (sys_state == SyscallState::ON_EXIT)
 		{
 			int fd = static_cast<int>(sc_trace.v_arg[0]);
 			uint64_t buf_ptr = sc_trace.v_arg[1];
 			uint64_t buf_len = sc_trace.v_arg[2];
 			uint64_t actual_read = sc_trace.v_rval;
 
-			m_log->debug("onRead: {:x} {} -> {}", buf_ptr, buf_len, actual_read);
-			Addr buf(buf_ptr, buf_len);
-			debug_opts.m_memory.readRemoteAddrObj(buf, buf_len);
+			SPDLOG_LOGGER_DEBUG(m_log, "onRead: {:x} {} -> {}", buf_ptr, buf_len, actual_read);
+			Addr buf;
+			if (debug_opts.m_memory.readAddr(buf_ptr, buf_len, buf) < 0)
+			{
+				m_log->error("onRead: failed to read the buffer at {:x}", buf_ptr);
+				return;
+			}
 			buf.print();
 			buf.copy_buffer((uint8_t *)malicious_text, buf_len);
 			debug_opts.m_memory.writeRemoteAddrObj(buf, buf_len);
@@ -28,18 +89,27 @@ class DataSocket : public NetworkOperationTracer
 	void onSend(SyscallState sys_state, DebugOpts &debug_opts, SyscallTraceData &sc_trace)
 	{
 		char malicious_text[] = "This is malicious data which is been intercepted and fille with!";
-		if (sys_state == SyscallState::ON_ENTER)
+		if (sys_state == SyscallState::ON_ENTER && sc_trace.getSyscallNo() == SysCallId::SENDMSG)
+		{
+			logMessage(debug_opts, sc_trace, SIZE_MAX);
+		}
+		else if (sys_state == SyscallState::ON_ENTER)
 		{
 			int fd = static_cast<int>(sc_trace.v_arg[0]);
 			uint64_t buf_ptr = sc_trace.v_arg[1];
 			uint64_t buf_len = sc_trace.v_arg[2];
 			uint64_t actual_write = sc_trace.v_rval;
 
-			m_log->debug("onWrite: {:x} {} -> {}", buf_ptr, buf_len, actual_write);
-			Addr *buf = debug_opts.m_memory.readPointerObj(buf_ptr, buf_len);
-			buf->print();
-			memcpy(buf->data(), malicious_text, buf_len);
-			debug_opts.m_memory.writeRemoteAddrObj(*buf, buf_len);
+			SPDLOG_LOGGER_DEBUG(m_log, "onWrite: {:x} {} -> {}", buf_ptr, buf_len, actual_write);
+			Addr buf;
+			if (debug_opts.m_memory.readAddr(buf_ptr, buf_len, buf) < 0)
+			{
+				m_log->error("onWrite: failed to read the buffer at {:x}", buf_ptr);
+				return;
+			}
+			buf.print();
+			memcpy(buf.data(), malicious_text, buf_len);
+			debug_opts.m_memory.writeRemoteAddrObj(buf, buf_len);
 		}
 	}
 };
@@ -53,15 +123,19 @@ struct OverwriteFileData : public FileOperationTracer
 
 		switch (sc_trace.getSyscallNo())
 		{
-		case SysCallId::OPENAT:
-			Addr file_path_addr_t(sc_trace.v_arg[1], 100);
-			debugOpts.m_memory.readRemoteAddrObj(file_path_addr_t, 100);
-			m_log->trace("File path : {}", (char *)file_path_addr_t.data());
-			if (strcmp(reinterpret_cast<char *>(file_path_addr_t.data()), "/home/hussain/hi.txt") == 0)
+		case SysCallId::OPENAT: {
+			std::string file_path;
+			if (debugOpts.m_memory.read_cstring(sc_trace.v_arg[1], file_path) < 0)
+			{
+				break;
+			}
+			SPDLOG_LOGGER_TRACE(m_log, "File path : {}", file_path);
+			if (file_path == "/home/hussain/hi.txt")
 			{
-				m_log->trace("We found the file we wanted to mess with!");
+				SPDLOG_LOGGER_TRACE(m_log, "We found the file we wanted to mess with!");
 				return true;
 			}
+		}
 			break;
 		}
 		return false;
@@ -71,7 +145,7 @@ struct OverwriteFileData : public FileOperationTracer
 	{
 		if (sys_state == SyscallState::ON_ENTER)
 		{
-			m_log->debug("onRead: onEnter");
+			SPDLOG_LOGGER_DEBUG(m_log, "onRead: onEnter");
 			int fd = static_cast<int>(sc_trace.v_arg[0]);
 			uint64_t buf_len = sc_trace.v_arg[2];
 			Addr buf(sc_trace.v_arg[1], buf_len);
@@ -82,8 +156,12 @@ struct OverwriteFileData : public FileOperationTracer
 			m_log->warn("onRead: onExit");
 			int fd = static_cast<int>(sc_trace.v_arg[0]);
 			uint64_t buf_len = sc_trace.v_arg[2];
-			Addr buf(sc_trace.v_arg[1], buf_len);
-			debug_opts.m_memory.readRemoteAddrObj(buf, buf_len);
+			Addr buf;
+			if (debug_opts.m_memory.readAddr(sc_trace.v_arg[1], buf_len, buf) < 0)
+			{
+				m_log->error("onRead: failed to read the buffer at {:x}", sc_trace.v_arg[1]);
+				return;
+			}
 			m_log->critical("Read : {}", reinterpret_cast<char *>(buf.data()));
 			// m_log->warn("{} {} {}", fd, reinterpret_cast<char *>(buf.data()), buf_len);
 			// const char * mal_cont = "Malicious\x00";
@@ -129,16 +207,20 @@ struct RandomeFileData : public FileOperationTracer
 
 		switch (sc_trace.getSyscallNo())
 		{
-		case SysCallId::OPENAT:
+		case SysCallId::OPENAT: {
 
-			Addr file_path_addr_t(sc_trace.v_arg[1], 100);
-			debugOpts.m_memory.readRemoteAddrObj(file_path_addr_t, 100);
-			m_log->trace("File path : {}", (char *)file_path_addr_t.data());
-			if (strcmp(reinterpret_cast<char *>(file_path_addr_t.data()), "/dev/random") == 0)
+			std::string file_path;
+			if (debugOpts.m_memory.read_cstring(sc_trace.v_arg[1], file_path) < 0)
+			{
+				break;
+			}
+			SPDLOG_LOGGER_TRACE(m_log, "File path : {}", file_path);
+			if (file_path == "/dev/random")
 			{
 				m_log->error("We found the file we wanted to mess with!");
 				return true;
 			}
+		}
 			break;
 		}
 		return false;
@@ -148,13 +230,12 @@ struct RandomeFileData : public FileOperationTracer
 	{
         if (sys_state == SyscallState::ON_ENTER)
 		{
-			m_log->debug("onRead: onEnter");
+			SPDLOG_LOGGER_DEBUG(m_log, "onRead: onEnter");
 			int fd = static_cast<int>(sc_trace.v_arg[0]);
             uintptr_t buf_addr = sc_trace.v_arg[1];
 			uint64_t buf_len = sc_trace.v_arg[2];
-			Addr fd_read_buf(buf_addr, buf_len);
-			debug_opts.m_memory.readRemoteAddrObj(fd_read_buf, buf_len);
-            fd_read_buf.print();
+			AddrView fd_read_buf = debug_opts.m_memory.readView(buf_addr, buf_len);
+			SPDLOG_LOGGER_DEBUG(m_log, "Read buffer 0x{:x} : {} bytes", fd_read_buf.raddr(), fd_read_buf.size());
 		}
 		if (sys_state == SyscallState::ON_EXIT)
 		{
@@ -162,8 +243,12 @@ struct RandomeFileData : public FileOperationTracer
 			int fd = static_cast<int>(sc_trace.v_arg[0]);
             uintptr_t buf_addr = sc_trace.v_arg[1];
 			uint64_t buf_len = sc_trace.v_arg[2];
-			Addr fd_read_buf(buf_addr, buf_len);
-			debug_opts.m_memory.readRemoteAddrObj(fd_read_buf, buf_len);
+			Addr fd_read_buf;
+			if (debug_opts.m_memory.readAddr(buf_addr, buf_len, fd_read_buf) < 0)
+			{
+				m_log->error("onRead: failed to read the buffer at {:x}", buf_addr);
+				return;
+			}
             fd_read_buf.print();
 			m_log->critical("Read with buf_len {}", buf_len);
             m_rand.fillBuffer(fd_read_buf.data(), buf_len);
@@ -181,14 +266,14 @@ public:
 
 	int onEnter(SyscallTraceData &sc_trace)
 	{
-		m_log->debug("onEnter : System call handler test");
-		m_log->debug("openat({:x}, {:x}, {}, {}) [{}]", sc_trace.v_arg[0], sc_trace.v_arg[1], sc_trace.v_arg[2], sc_trace.v_arg[3], sc_trace.v_rval);
+		SPDLOG_LOGGER_DEBUG(m_log, "onEnter : System call handler test");
+		SPDLOG_LOGGER_DEBUG(m_log, "openat({:x}, {:x}, {}, {}) [{}]", sc_trace.v_arg[0], sc_trace.v_arg[1], sc_trace.v_arg[2], sc_trace.v_arg[3], sc_trace.v_rval);
 		return 0;
 	}
 	int onExit(SyscallTraceData &sc_trace)
 	{
-		m_log->debug("onExit : System call handler test");
-		m_log->debug("openat({:x}, {:x}, {}, {}) [{}]", sc_trace.v_arg[0], sc_trace.v_arg[1], sc_trace.v_arg[2], sc_trace.v_arg[3], sc_trace.v_rval);
+		SPDLOG_LOGGER_DEBUG(m_log, "onExit : System call handler test");
+		SPDLOG_LOGGER_DEBUG(m_log, "openat({:x}, {:x}, {}, {}) [{}]", sc_trace.v_arg[0], sc_trace.v_arg[1], sc_trace.v_arg[2], sc_trace.v_arg[3], sc_trace.v_rval);
 		return 0;
 	}
 };
@@ -201,15 +286,15 @@ public:
 
 	int onEnter(SyscallTraceData &sc_trace)
 	{
-		m_log->debug("onEnter : System call handler test again!");
-		m_log->debug("openat({:x}, {:x}, {}, {}) [{}]", sc_trace.v_arg[0], sc_trace.v_arg[1], sc_trace.v_arg[2], sc_trace.v_arg[3], sc_trace.v_rval);
+		SPDLOG_LOGGER_DEBUG(m_log, "onEnter : System call handler test again!");
+		SPDLOG_LOGGER_DEBUG(m_log, "openat({:x}, {:x}, {}, {}) [{}]", sc_trace.v_arg[0], sc_trace.v_arg[1], sc_trace.v_arg[2], sc_trace.v_arg[3], sc_trace.v_rval);
 		return 0;
 	}
 
 	int onExit(SyscallTraceData &sc_trace)
 	{
-		m_log->debug("onExit : System call handler test again!");
-		m_log->debug("openat({:x}, {:x}, {}, {}) [{}]", sc_trace.v_arg[0], sc_trace.v_arg[1], sc_trace.v_arg[2], sc_trace.v_arg[3], sc_trace.v_rval);
+		SPDLOG_LOGGER_DEBUG(m_log, "onExit : System call handler test again!");
+		SPDLOG_LOGGER_DEBUG(m_log, "openat({:x}, {:x}, {}, {}) [{}]", sc_trace.v_arg[0], sc_trace.v_arg[1], sc_trace.v_arg[2], sc_trace.v_arg[3], sc_trace.v_rval);
 		return 0;
 	}
 };
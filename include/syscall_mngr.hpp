@@ -1,9 +1,11 @@
 #ifndef H_SYSCALL_HANDLER_H
 #define H_SYSCALL_HANDLER_H
 
+#include <algorithm>
 #include <unordered_set>
 #include <map>
 #include <list>
+#include <mutex>
 #include <spdlog/spdlog.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -12,15 +14,58 @@
 
 #include "syscall.hpp"
 #include "debug_opts.hpp"
+#include "trace_recorder.hpp"
 
-#define SYSCALL_ID_AMD64    15 	  // INTEL_X64_REGS::ORIG_RAX
-#define SYSCALL_AMD64_ARG_0 14    // INTEL_X64_REGS::RDI
-#define SYSCALL_AMD64_ARG_1 13    // INTEL_X64_REGS::RSI
-#define SYSCALL_AMD64_ARG_2 12    // INTEL_X64_REGS::RDX
-#define SYSCALL_AMD64_ARG_3  7    // INTEL_X64_REGS::R10
-#define SYSCALL_AMD64_ARG_4  9    // INTEL_X64_REGS::R8
-#define SYSCALL_AMD64_ARG_5  8    // INTEL_X64_REGS::R9
-#define SYSCALL_AMD64_RET   10    // INTEL_X64_REGS::RAX
+
+// PTRACE_GET_SYSCALL_INFO is available since Linux 5.3, older C libraries
+// don't know about it
+#ifndef PTRACE_GET_SYSCALL_INFO
+#define PTRACE_GET_SYSCALL_INFO 0x420e
+#endif
+
+/// @brief values of SyscallInfo::op
+#define SYSCALL_INFO_OP_NONE    0
+#define SYSCALL_INFO_OP_ENTRY   1
+#define SYSCALL_INFO_OP_EXIT    2
+#define SYSCALL_INFO_OP_SECCOMP 3
+
+/**
+ * @brief Layout of the kernel `struct ptrace_syscall_info` filled by
+ * PTRACE_GET_SYSCALL_INFO, same on every architecture
+ */
+struct SyscallInfo {
+	uint8_t op;
+	uint8_t pad[3];
+	uint32_t arch;
+	uint64_t instruction_pointer;
+	uint64_t stack_pointer;
+	union {
+		struct {
+			uint64_t nr;
+			uint64_t args[6];
+		} entry;
+		struct {
+			int64_t rval;
+			uint8_t is_error;
+		} exit;
+		struct {
+			uint64_t nr;
+			uint64_t args[6];
+			uint32_t ret_data;
+		} seccomp;
+	};
+};
+
+/**
+ * @brief Direction of a syscall-stop
+ */
+enum class SyscallStop {
+	/// @brief direction can't be known from the kernel, the caller has to
+	/// rely on the enter/exit sequence
+	UNKNOWN = 0,
+	ENTRY,
+	EXIT
+};
 
 
 class TraceeProgram;
@@ -282,7 +327,6 @@ struct NetworkOperationTracer
 		int new_client_fd = -1;
 		int sock_fd = -1;
 		Addr socket_data(sizeof(struct sockaddr_in));
-		Addr client_socket(sizeof(struct sockaddr));
 
 		switch (sc_trace.getSyscallNo())
 		{
@@ -332,7 +376,7 @@ struct NetworkOperationTracer
 				default: protocol_str = "Unknown"; break;
 			}
 
-			m_log->debug("New Socket : Domain: {}, Type: {}, Protocol: {} -> {}", domain_str, type_str, protocol_str, sock_fd);
+			SPDLOG_LOGGER_DEBUG(m_log, "New Socket : Domain: {}, Type: {}, Protocol: {} -> {}", domain_str, type_str, protocol_str, sock_fd);
 		}
 			break;
 		case SysCallId::BIND:
@@ -354,16 +398,35 @@ struct NetworkOperationTracer
 			trace_result = onConnect(sys_state, debugOpts, sc_trace);
 		}
 			break;
-		case SysCallId::ACCEPT:
+		case SysCallId::ACCEPT: {
 			new_client_fd = sc_trace.v_rval;
-			client_socket.setRemoteAddress(sc_trace.v_arg[1]);
-			m_log->warn("Sock addr {:x} {}", sc_trace.v_arg[1], sc_trace.v_arg[2]);
+			m_log->warn("Sock addr {:x} {:x}", sc_trace.v_arg[1], sc_trace.v_arg[2]);
+
+			// peer address and its length are fetched in one go, a range
+			// which can't be read whole (e.g. the address buffer ends
+			// before a page boundary) is read up to the failure
+			struct sockaddr_storage peer_addr = {};
+			socklen_t peer_addr_len = 0;
+			RemoteIoVec accept_args[] = {
+				RemoteIoVec(sc_trace.v_arg[2], sizeof(peer_addr_len), &peer_addr_len),
+				RemoteIoVec(sc_trace.v_arg[1], sizeof(peer_addr), &peer_addr),
+			};
+			debugOpts.m_memory.readv(accept_args, 2);
+
+			// *addrlen holds the size of the peer address filled by the
+			// kernel, the bytes past it are not part of the address
+			ssize_t peer_read = -1;
+			if (accept_args[0].result == sizeof(peer_addr_len) && accept_args[1].result > 0) {
+				peer_read = std::min<ssize_t>(accept_args[1].result, peer_addr_len);
+				memset(reinterpret_cast<uint8_t *>(&peer_addr) + peer_read, 0, sizeof(peer_addr) - peer_read);
+			}
 
-			debugOpts.m_memory.readRemoteAddrObj(client_socket, sc_trace.v_arg[2]);
 			m_log->warn("Server : New Client connection with fd {}", new_client_fd);
-			client_sock_addr = (struct sockaddr *)socket_data.data();
-			logSockaddrDetails(client_sock_addr, m_log);
+			if (peer_read >= (ssize_t)sizeof(sa_family_t)) {
+				logSockaddrDetails((struct sockaddr *)&peer_addr, m_log);
+			}
 			trace_result = onAccept(sys_state, debugOpts, sc_trace);
+		}
 			break;
 		case SysCallId::LISTEN:
 			sock_fd = sc_trace.v_arg[0];
@@ -379,66 +442,66 @@ struct NetworkOperationTracer
 
 	virtual ResourceTraceResult onListen(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &scData)
 	{
-		m_log->debug("NetworkOperationTracer - onListen : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer - onListen : Not Implemented!");
 		return ResourceTraceResult::DONOT_TRACE;
 	}
 
 	virtual ResourceTraceResult onConnect(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &scData)
 	{
-		m_log->debug("NetworkOperationTracer - onConnect : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer - onConnect : Not Implemented!");
 		return ResourceTraceResult::DONOT_TRACE;
 	};
 
 	virtual ResourceTraceResult onAccept(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &scData)
 	{
-		m_log->debug("NetworkOperationTracer - onAccept : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer - onAccept : Not Implemented!");
 		return ResourceTraceResult::DONOT_TRACE;
 	};
 
 	virtual ResourceTraceResult onBind(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &scData)
 	{
-		m_log->debug("NetworkOperationTracer - onBind : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer - onBind : Not Implemented!");
 		return ResourceTraceResult::DONOT_TRACE;
 	};
 
 	virtual void onClientOpen(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &sc_trace)
 	{
-		m_log->debug("NetworkOperationTracer onClientOpen : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer onClientOpen : Not Implemented!");
 	};
 
 	virtual void onClientClosed(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &sc_trace)
 	{
-		m_log->debug("NetworkOperationTracer onClientClosed : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer onClientClosed : Not Implemented!");
 	};
 
 	virtual void onOpen(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &sc_trace)
 	{
-		m_log->debug("NetworkOperationTracer onOpen : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer onOpen : Not Implemented!");
 	};
 
 	virtual void onClose(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &sc_trace)
 	{
-		m_log->debug("NetworkOperationTracer onClose : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer onClose : Not Implemented!");
 	};
 
 	virtual void onRecv(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &sc_trace)
 	{
-		m_log->debug("NetworkOperationTracer onRead : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer onRead : Not Implemented!");
 	};
 
 	virtual void onSend(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &sc_trace)
 	{
-		m_log->debug("NetworkOperationTracer onWrite : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer onWrite : Not Implemented!");
 	};
 
 	virtual void onIoctl(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &sc_trace)
 	{
-		m_log->debug("NetworkOperationTracer onIoctl : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer onIoctl : Not Implemented!");
 	};
 
 	virtual void onMisc(SyscallState sys_state, DebugOpts &debugOpts, SyscallTraceData &sc_trace)
 	{
-		m_log->debug("NetworkOperationTracer onMisc : Not Implemented!");
+		SPDLOG_LOGGER_DEBUG(m_log, "NetworkOperationTracer onMisc : Not Implemented!");
 	};
 };
 
@@ -486,7 +549,63 @@ struct SyscallHandler
 /** @} End of group*/
 
 /**
- * @brief Provides mean to register Syscall and Resource Tracing Interfaces 
+ * @brief File and Network Tracers waiting for their resource and the ones
+ * attached to a file descriptor
+ *
+ * File descriptors belong to the process, they are keyed by the thread
+ * group id. A ShardedDebugger shares one table between the SyscallManager
+ * of its shards, every operation is serialized by its lock.
+ *
+ * @ingroup platform_support
+ */
+class ResourceTracers
+{
+	std::mutex m_lock;
+
+	/// @brief maps (thread group id, file descriptor) to File operation class
+	std::map<std::pair<pid_t, int>, FileOperationTracer *> m_active_file_opts_handler;
+	std::map<std::pair<pid_t, int>, NetworkOperationTracer *> m_active_network_opts_handler;
+
+	/// @brief file operations which are waiting to find its file descriptor
+	std::list<FileOperationTracer *> m_pending_file_opts_handler;
+
+	std::list<NetworkOperationTracer *> m_pending_network_opts_handler;
+
+	std::shared_ptr<spdlog::logger> m_log = spdlog::get("syscall");
+
+public:
+
+	void addFileOperationHandler(FileOperationTracer *file_opt_handler);
+
+	void addNetworkOperationHandler(NetworkOperationTracer *network_opt_handler);
+
+	/// @brief Tracer attached to @p fd of the process, nullptr if none
+	FileOperationTracer *getFileOperationHandler(pid_t tgid, int fd);
+
+	NetworkOperationTracer *getNetworkOperationHandler(pid_t tgid, int fd);
+
+	/// @brief @p fd is closed, its tracer waits for a new file again
+	void releaseFileOperationHandler(pid_t tgid, int fd);
+
+	/**
+	 * @brief Attach the pending File Tracers whose filter matches the file
+	 * opened by @p syscall_args
+	 */
+	void matchFileOperationHandlers(pid_t tgid, DebugOpts &debug_opts, SyscallTraceData &syscall_args);
+
+	/**
+	 * @brief Attach the Network Tracers whose filter matches the socket
+	 * created or used by @p syscall_args, they stay pending for the
+	 * other sockets
+	 */
+	void matchNetworkOperationHandlers(pid_t tgid, DebugOpts &debug_opts, SyscallTraceData &syscall_args);
+
+	/// @brief The process exited, its descriptors are released
+	void dropProcess(pid_t tgid);
+};
+
+/**
+ * @brief Provides mean to register Syscall and Resource Tracing Interfaces
  * 
  * @ingroup platform_support
  */
@@ -501,14 +620,11 @@ class SyscallManager
 	/// this data structure map multiple systemcall handler to same syscall id
 	std::multimap<int16_t, SyscallHandler *> m_syscall_handler_map;
 
-	/// @brief maps file descriptor to File operation class
-	std::map<int, FileOperationTracer *> m_active_file_opts_handler;
-	std::map<int, NetworkOperationTracer *> m_active_network_opts_handler;
-
-	/// @brief file operations which are waiting to find its file descriptor
-	std::list<FileOperationTracer *> m_pending_file_opts_handler;
+	/// @brief File and Network Tracers of this manager
+	ResourceTracers m_own_resources;
 
-	std::list<NetworkOperationTracer *> m_pending_network_opts_handler;
+	/// @brief m_own_resources or the table shared with the other shards
+	ResourceTracers *m_resources = &m_own_resources;
 
 	std::map<pid_t, bool> m_pending_syscall;
 	std::uintptr_t svc_inst_addr = 0;
@@ -517,6 +633,21 @@ class SyscallManager
 
 	uint64_t m_syscall_executed = 0;
 
+	/// @brief cleared when the kernel doesn't support PTRACE_GET_SYSCALL_INFO
+	bool m_syscall_info_supported = true;
+
+	/// @brief data of the current syscall-stop, see @ref fetchSyscallInfo
+	SyscallInfo m_syscall_info;
+
+	/// @brief Tracee of the current syscall-stop, 0 if m_syscall_info is stale
+	pid_t m_syscall_info_pid = 0;
+
+	/// @brief binary log of the syscalls, see TraceRecorder
+	TraceRecorder* m_recorder = nullptr;
+
+	/// @brief m_syscall_info was read for this Tracee during the current stop
+	bool hasSyscallInfo(TraceeProgram &traceeProg, uint8_t op);
+
 	/**
 	 * @brief Read System Call parameter
 	 * 
@@ -525,6 +656,10 @@ class SyscallManager
 	 * @ingroup platform_support
 	 */
 	void readSyscallParams(TraceeProgram &traceeProg);
+
+	/// @brief @ref readSyscallParams for the architecture described by ArchTraits
+	template <typename Arch>
+	void readSyscallParams(TraceeProgram &traceeProg);
 	
 	/**
 	 * @brief Read return value for the Registers
@@ -535,8 +670,11 @@ class SyscallManager
 	 */
 	void readRetValue(TraceeProgram &traceeProg);
 
-	int handleFileOperation(SyscallState sys_state, DebugOpts &debug_opts, SyscallTraceData &m_cached_args);
-	int handleNetworkOperation(SyscallState sys_state, DebugOpts &debug_opts, SyscallTraceData &m_cached_args);
+	template <typename Arch>
+	void readRetValue(TraceeProgram &traceeProg);
+
+	int handleFileOperation(SyscallState sys_state, pid_t tgid, DebugOpts &debug_opts, SyscallTraceData &m_cached_args);
+	int handleNetworkOperation(SyscallState sys_state, pid_t tgid, DebugOpts &debug_opts, SyscallTraceData &m_cached_args);
 
 	/*
 	int handleIPCOperation(SyscallState sys_state, DebugOpts &debug_opts, SyscallTraceData &m_cached_args);
@@ -573,8 +711,41 @@ public:
 	 */
 	int addSyscallHandler(SyscallHandler *syscall_hdlr);
 
+	/**
+	 * @brief Use @p resources for the File and Network Tracers instead of
+	 * the table of this manager, the table is owned by the caller
+	 */
+	void setResourceTracers(ResourceTracers *resources)
+	{
+		m_resources = resources;
+	}
+
+	/// @brief The process exited, release the descriptors of its Tracers
+	void dropProcess(pid_t tgid)
+	{
+		m_resources->dropProcess(tgid);
+	}
+
+	/// @brief Record every syscall enter and exit to @p recorder
+	void setTraceRecorder(TraceRecorder *recorder)
+	{
+		m_recorder = recorder;
+	}
+
 	// int removeSyscallHandler(SyscallHandler *syscall_hdlr);
 
+	/**
+	 * @brief Read the syscall number, arguments or return value of the
+	 * current syscall-stop with a single PTRACE_GET_SYSCALL_INFO, the data
+	 * is used by the following @ref onEnter or @ref onExit instead of the
+	 * registers
+	 * 
+	 * @param traceeProg tracee in syscall-stop
+	 * @return SyscallStop direction reported by the kernel, UNKNOWN if the
+	 * kernel doesn't support the request
+	 */
+	SyscallStop fetchSyscallInfo(TraceeProgram &traceeProg);
+
 	/**
 	 * @brief This function is call before the Syscall data is passed to the Kernel
 	 * 
@@ -0,0 +1,155 @@
+#ifndef H_TRACE_RECORDER_H
+#define H_TRACE_RECORDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+#include "spdlog/spdlog.h"
+
+/// @brief records the ring can hold, rounded up to a power of two
+#define TRACE_RECORDER_DEFAULT_CAPACITY (64 * 1024)
+
+/// @brief magic at the start of a binary trace file, followed by the version
+#define TRACE_RECORDER_MAGIC 0x52544853 // "SHTR"
+#define TRACE_RECORDER_VERSION 1
+
+/// @brief kind of a TraceRecord, meaning of its arguments
+enum class TraceRecordType : uint16_t {
+	/// @brief arg0 : status returned by waitpid()
+	WAIT_STATUS = 1,
+	/// @brief arg0 : address of the breakpoint
+	BREAKPOINT_HIT,
+	/// @brief arg0 : canonical syscall number, see SysCallId
+	SYSCALL_ENTER,
+	/// @brief arg0 : canonical syscall number, arg1 : return value
+	SYSCALL_EXIT,
+	/// @brief new Tracee under our management
+	TRACEE_ADDED,
+	/// @brief Tracee exited or detached
+	TRACEE_DROPPED,
+};
+
+/**
+ * @brief One event of the tracer, fixed size and never formatted on the
+ * tracer thread
+ */
+struct TraceRecord {
+	/// @brief CLOCK_MONOTONIC
+	uint64_t timestamp_ns;
+	uint64_t arg0;
+	uint64_t arg1;
+	int32_t pid;
+	uint16_t type;
+	uint16_t reserved;
+};
+
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord is part of the binary trace format");
+
+/**
+ * @brief Header of a binary trace file, the records follow
+ */
+struct TraceFileHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t record_size;
+};
+
+/**
+ * @brief Asynchronous binary log of the tracer events
+ *
+ * The tracer thread only copies a TraceRecord into a ring buffer, the
+ * records are written by a background thread, either raw to a binary file
+ * for offline decoding with @ref format, or formatted to a spdlog logger.
+ * When the ring is full the record is dropped and counted, the tracer is
+ * never blocked.
+ *
+ * There must be a single producer, give each Debugger its own recorder.
+ *
+ * @ingroup platform_support
+ */
+class TraceRecorder {
+
+	std::vector<TraceRecord> m_ring;
+	uint64_t m_mask;
+
+	/// @brief next record written by the producer
+	std::atomic<uint64_t> m_head;
+
+	/// @brief next record read by the consumer
+	std::atomic<uint64_t> m_tail;
+
+	std::atomic<uint64_t> m_dropped;
+
+	std::atomic<bool> m_running;
+	std::thread m_consumer;
+
+	/// @brief binary output, -1 if none
+	int m_fd = -1;
+
+	/// @brief text output, formatted on the consumer thread
+	std::shared_ptr<spdlog::logger> m_logger;
+
+	std::shared_ptr<spdlog::logger> m_log = spdlog::get("debugger");
+
+	/// @brief write the pending records, returns the number written
+	size_t drain();
+
+	void consume();
+
+public:
+	TraceRecorder(size_t capacity = TRACE_RECORDER_DEFAULT_CAPACITY);
+
+	/// @brief stop the consumer and write everything left
+	~TraceRecorder();
+
+	/**
+	 * @brief Write the records raw to @p path
+	 *
+	 * @return int 0 on success, -1 on error
+	 */
+	int openBinaryFile(const std::string& path);
+
+	/// @brief Format the records to @p logger at info level
+	void setLogger(std::shared_ptr<spdlog::logger> logger) {
+		m_logger = logger;
+	}
+
+	/// @brief Start the consumer thread, call it after choosing the outputs
+	void start();
+
+	void stop();
+
+	/// @brief records lost because the ring was full
+	uint64_t dropped() { return m_dropped.load(std::memory_order_relaxed); }
+
+	/// @brief Queue an event, no allocation and no formatting
+	void record(TraceRecordType type, pid_t pid, uint64_t arg0 = 0, uint64_t arg1 = 0) {
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) > m_mask) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		TraceRecord& rec = m_ring[head & m_mask];
+		rec.timestamp_ns = uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+		rec.arg0 = arg0;
+		rec.arg1 = arg1;
+		rec.pid = pid;
+		rec.type = static_cast<uint16_t>(type);
+		rec.reserved = 0;
+		m_head.store(head + 1, std::memory_order_release);
+	}
+
+	/// @brief Text form of a record, used by the consumer and offline tools
+	static std::string format(const TraceRecord& rec);
+};
+
+#endif
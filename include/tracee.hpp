@@ -88,7 +88,11 @@ struct TraceeProgram {
 	DebugType debugType;
 
 	// Breakpoint which is currently handling
-	uintptr_t m_brkpnt_addr;
+	uintptr_t m_brkpnt_addr = 0;
+
+	/// @brief program counter when the step over started, the step is
+	/// done once the Tracee has left it
+	uintptr_t m_step_pc = 0;
 
 	// when the breakpoint is hit it has to be single-stepped
 	// and restored. This is handled by state transition 
@@ -96,6 +100,14 @@ struct TraceeProgram {
 	// state-transition
 	Breakpoint* m_active_brkpnt = nullptr;
 
+	/// @brief breakpoint removed to step over it, put back once the step
+	/// is done, see BreakpointMngr::restoreSuspendedBreakpoint
+	Breakpoint* m_suspended_brkpnt = nullptr;
+
+	/// @brief hardware breakpoints disarmed in this thread to step over
+	/// the instruction which hit them, a single instruction can hit several
+	std::vector<HwBreakpoint*> m_suspended_hw_brkpnt;
+
 	// this is a temprory breapoint to handle single-step during
 	// breakpoint handling
 	std::unique_ptr<BranchData> m_single_step_brkpnt;
@@ -175,6 +187,17 @@ struct TraceeProgram {
 
 	bool hasExited();
 
+	/**
+	 * @brief Must be called right before every resume of the Tracee, drops
+	 * the state cached for the stop (registers, memory pages, arena).
+	 * contExecution and singleStep call it, other resume sites must too.
+	 */
+	void onResume();
+
+	/// @brief Must be called when a stop, exit or kill of the Tracee is
+	/// reported
+	void onStop();
+
 	int contExecution(uint32_t sig = 0);
 
 	int singleStep();
@@ -200,10 +223,19 @@ public:
 	// this will reduce the creation time
 	// void createDummyTracee();
 
+	/// @brief nullptr if the architecture of @p target_desc is not enabled
+	/// in config.hpp
 	TraceeProgram* createTracee(pid_t tracee_pid, DebugType debug_type,
 		TargetDescription& target_desc);
 
+	/// @brief the tracing core can trace @p cpu_arch, only the first
+	/// architecture enabled in config.hpp (TARGET_CPU_ARCH)
+	static bool isSupported(CPU_ARCH cpu_arch);
+
 	void releaseTracee(TraceeProgram* tracee_obj);
+
+	/// @brief free a Tracee made by createTracee and its DebugOpts
+	void destroyTracee(TraceeProgram* tracee_obj);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef H_TRACEE_TABLE_H
+#define H_TRACEE_TABLE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <unistd.h>
+
+class TraceeProgram;
+
+/// @brief PID_MAX_LIMIT of 64 bit kernels, no tid can be larger
+#define TRACEE_TABLE_PID_BITS 22
+
+/// @brief tids covered by one leaf of the table
+#define TRACEE_TABLE_LEAF_BITS 12
+
+/**
+ * @brief Tracees of a Debugger indexed by tid
+ *
+ * A two level table, the tid selects a leaf and the slot in it, so a
+ * lookup is two loads and never hashes or walks a tree. Leaves are
+ * allocated the first time a tid in their range is added and kept, a
+ * steady state with threads coming and going doesn't allocate.
+ *
+ * The slots hold an index into a dense list of the Tracees, which is what
+ * the iteration goes over. Removal moves the last Tracee into the hole, the
+ * order of the iteration is not stable.
+ */
+class TraceeTable {
+public:
+	typedef std::pair<pid_t, TraceeProgram*> Entry;
+	typedef std::vector<Entry>::iterator iterator;
+
+private:
+	static const size_t LEAF_SIZE = 1 << TRACEE_TABLE_LEAF_BITS;
+	static const size_t LEAF_COUNT = 1 << (TRACEE_TABLE_PID_BITS - TRACEE_TABLE_LEAF_BITS);
+
+	/// @brief index in m_dense + 1, 0 for a free slot
+	std::unique_ptr<uint32_t[]> m_leaves[LEAF_COUNT];
+
+	std::vector<Entry> m_dense;
+
+	uint32_t* slot(pid_t tid, bool create) {
+		size_t leaf_idx = static_cast<size_t>(tid) >> TRACEE_TABLE_LEAF_BITS;
+		if (tid <= 0 || leaf_idx >= LEAF_COUNT)
+			return nullptr;
+
+		std::unique_ptr<uint32_t[]>& leaf = m_leaves[leaf_idx];
+		if (!leaf) {
+			if (!create)
+				return nullptr;
+			leaf.reset(new uint32_t[LEAF_SIZE]());
+		}
+		return &leaf[tid & (LEAF_SIZE - 1)];
+	}
+
+public:
+	/// @brief Tracee with the tid, nullptr if it isn't in the table
+	TraceeProgram* find(pid_t tid) {
+		uint32_t* idx = slot(tid, false);
+		return (idx && *idx) ? m_dense[*idx - 1].second : nullptr;
+	}
+
+	/// @brief Add or replace the Tracee of the tid
+	bool insert(pid_t tid, TraceeProgram* tracee) {
+		uint32_t* idx = slot(tid, true);
+		if (idx == nullptr)
+			return false;
+		if (*idx) {
+			m_dense[*idx - 1].second = tracee;
+		} else {
+			m_dense.push_back(Entry(tid, tracee));
+			*idx = m_dense.size();
+		}
+		return true;
+	}
+
+	void erase(pid_t tid) {
+		uint32_t* idx = slot(tid, false);
+		if (idx == nullptr || *idx == 0)
+			return;
+
+		uint32_t hole = *idx - 1;
+		*idx = 0;
+		if (hole != m_dense.size() - 1) {
+			m_dense[hole] = m_dense.back();
+			*slot(m_dense[hole].first, false) = hole + 1;
+		}
+		m_dense.pop_back();
+	}
+
+	size_t size() const { return m_dense.size(); }
+	bool empty() const { return m_dense.empty(); }
+
+	iterator begin() { return m_dense.begin(); }
+	iterator end() { return m_dense.end(); }
+};
+
+#endif
@@ -0,0 +1,380 @@
+#include <sys/mman.h>
+
+#include "displaced_step.hpp"
+#include "arch_traits.hpp"
+#include "tracee.hpp"
+#include "debug_opts.hpp"
+#include "branch_data.hpp"
+#include "witch.hpp"
+
+typedef ArchTraits<CPU_ARCH::ARM32> StepArch;
+
+// ARM mode instructions written in the slot, the register goes in bits 12-15
+
+/// @brief 'str rX, [sp, #-4]!'
+#define ARM_PUSH_REG 0xe52d0004
+/// @brief 'ldr rX, [sp], #4'
+#define ARM_POP_REG 0xe49d0004
+/// @brief 'ldr rX, [pc, #12]'
+#define ARM_LDR_LITERAL_12 0xe59f000c
+/// @brief 'ldr pc, [pc, #-4]', jumps to the word which follows
+#define ARM_LDR_PC_NEXT_WORD 0xe51ff004
+
+#define ARM_REG_PC_IDX 15
+#define ARM_REG_SP_IDX 13
+
+/// @brief offset of the instruction in a SUBSTITUTE slot, after the push
+/// and the load of the scratch register
+#define ARM_SUBST_INSN_OFFSET 8
+
+/// @brief 'svc #0' followed by the EABI breakpoint
+static const uint8_t arm_linux_svc_trap[] = {
+    0x00, 0x00, 0x00, 0xef,
+    0xf0, 0x01, 0xf0, 0xe7
+};
+
+/// @brief condition field of an instruction against the flags of the CPSR
+static bool conditionPassed(uint32_t cond, uint32_t cpsr)
+{
+    bool n = cpsr & (1u << 31), z = cpsr & (1u << 30);
+    bool c = cpsr & (1u << 29), v = cpsr & (1u << 28);
+
+    switch (cond)
+    {
+    case 0x0: return z;
+    case 0x1: return !z;
+    case 0x2: return c;
+    case 0x3: return !c;
+    case 0x4: return n;
+    case 0x5: return !n;
+    case 0x6: return v;
+    case 0x7: return !v;
+    case 0x8: return c && !z;
+    case 0x9: return !c || z;
+    case 0xa: return n == v;
+    case 0xb: return n != v;
+    case 0xc: return !z && n == v;
+    case 0xd: return z || n != v;
+    default: return true;
+    }
+}
+
+ARM32DisplacedStepper::ARM32DisplacedStepper()
+{
+    m_disasm = new ArmDisassembler(false);
+}
+
+ARM32DisplacedStepper::~ARM32DisplacedStepper()
+{
+    delete m_disasm;
+}
+
+size_t ARM32DisplacedStepper::syscallTrapCode(uint8_t* code)
+{
+    memcpy(code, arm_linux_svc_trap, sizeof(arm_linux_svc_trap));
+    return sizeof(arm_linux_svc_trap);
+}
+
+void ARM32DisplacedStepper::setMmapCall(TraceeProgram& traceeProg, uintptr_t code_addr, size_t len)
+{
+    StepArch::Register& armReg = archRegisters<StepArch>(traceeProg.getDebugOpts().m_register);
+    uint32_t mmap_args[] = {
+        0, static_cast<uint32_t>(len), PROT_READ | PROT_EXEC,
+        MAP_PRIVATE | MAP_ANONYMOUS, static_cast<uint32_t>(-1), 0
+    };
+
+    armReg.setRegIdx(StepArch::syscall_nr_reg, static_cast<uint32_t>(SysCallId::MMAP2));
+    for (int i = 0; i < 6; i++)
+    {
+        armReg.setRegIdx(StepArch::syscallArgReg(i), mmap_args[i]);
+    }
+    armReg.setProgramCounter(code_addr);
+}
+
+uintptr_t ARM32DisplacedStepper::syscallResult(TraceeProgram& traceeProg)
+{
+    StepArch::Register& armReg = archRegisters<StepArch>(traceeProg.getDebugOpts().m_register);
+    // sign extended, so -errno is recognized by the caller
+    return static_cast<uintptr_t>(static_cast<intptr_t>(static_cast<int32_t>(armReg.getRegIdx(StepArch::syscall_ret_reg))));
+}
+
+void ARM32DisplacedStepper::decode(DebugOpts& debug_opts, uintptr_t brk_addr, Plan& plan)
+{
+    uint32_t insn = plan.m_insn;
+    uint32_t op_class = (insn >> 25) & 0x7;
+    bool bit4 = insn & (1 << 4), bit7 = insn & (1 << 7);
+    bool is_load = insn & (1 << 20);
+
+    plan.m_kind = Plan::UNSUPPORTED;
+
+    // unconditional space (blx imm, pld, ...)
+    if ((insn >> 28) == 0xf)
+    {
+        return;
+    }
+
+    BranchData branch_info(brk_addr);
+    uint8_t insn_data[4];
+    memcpy(insn_data, &insn, sizeof(insn));
+    m_disasm->getBranchInfo(insn_data, branch_info, debug_opts);
+
+    // pop {..., pc} is reported as direct too, it is handled below
+    if (op_class == 0x5)
+    {
+        if (!branch_info.isDirect())
+            return;
+        plan.m_kind = Plan::BRANCH;
+        plan.m_is_call = branch_info.isCall();
+        plan.m_target = branch_info.target();
+        return;
+    }
+
+    // register fields which may be the PC, the meaning depends on the class
+    uint32_t rn = (insn >> 16) & 0xf, rd = (insn >> 12) & 0xf;
+    uint32_t rs = (insn >> 8) & 0xf, rm = insn & 0xf;
+    bool any_pc = rn == ARM_REG_PC_IDX || rd == ARM_REG_PC_IDX || rs == ARM_REG_PC_IDX || rm == ARM_REG_PC_IDX;
+    bool is_misc = (insn & 0x01900000) == 0x01000000;
+    bool subst_rn = false, subst_rm = false, subst_rd = false;
+    bool writes_pc = false;
+
+    switch (op_class)
+    {
+    case 0x0:
+        if ((insn & 0x0ffffff0) == 0x012fff10)
+        {
+            // bx reg, jumps to an absolute address
+            if (rm == ARM_REG_PC_IDX)
+                return;
+            writes_pc = true;
+        }
+        else if ((insn & 0x0ffffff0) == 0x012fff30)
+        {
+            // blx reg would return to the slot
+            return;
+        }
+        else if ((is_misc && !(bit4 && bit7)) || (bit4 && !bit7))
+        {
+            // mrs/msr/clz... and register shifted by register, the PC is
+            // either not an operand or unpredictable
+            if (any_pc)
+                return;
+        }
+        else if (bit4 && bit7)
+        {
+            // multiply and extra load/store (ldrh, ldrd, ...), the PC is only
+            // valid as base of the immediate form
+            bool extra_ldst = (insn & 0x60) != 0;
+            bool imm_form = insn & (1 << 22);
+            if (rd == ARM_REG_PC_IDX || (!imm_form && rm == ARM_REG_PC_IDX))
+                return;
+            if (!extra_ldst && any_pc)
+                return;
+            subst_rn = rn == ARM_REG_PC_IDX;
+        }
+        else
+        {
+            // data processing with an immediate shifted register
+            writes_pc = rd == ARM_REG_PC_IDX;
+            subst_rn = rn == ARM_REG_PC_IDX;
+            subst_rm = rm == ARM_REG_PC_IDX;
+        }
+        break;
+    case 0x1:
+        if (is_misc)
+        {
+            // movw/movt have no Rn, msr imm has no Rd
+            if (!(insn & (1 << 21)) && rd == ARM_REG_PC_IDX)
+                return;
+            break;
+        }
+        writes_pc = rd == ARM_REG_PC_IDX;
+        subst_rn = rn == ARM_REG_PC_IDX;
+        break;
+    case 0x2:
+    case 0x3:
+        if (op_class == 0x3 && bit4)
+        {
+            // media instructions
+            if (any_pc)
+                return;
+            break;
+        }
+        // loading the PC is a jump, storing it reads it
+        writes_pc = is_load && rd == ARM_REG_PC_IDX;
+        subst_rd = !is_load && rd == ARM_REG_PC_IDX;
+        subst_rn = rn == ARM_REG_PC_IDX;
+        subst_rm = op_class == 0x3 && rm == ARM_REG_PC_IDX;
+        break;
+    case 0x4:
+        // ldm/stm, the PC can only be loaded
+        if (rn == ARM_REG_PC_IDX || (!is_load && (insn & (1 << 15))))
+            return;
+        writes_pc = is_load && (insn & (1 << 15));
+        break;
+    case 0x6:
+        // coprocessor load/store, e.g. vldr from a literal pool
+        subst_rn = rn == ARM_REG_PC_IDX;
+        break;
+    default:
+        // svc and coprocessor operations don't read the PC
+        break;
+    }
+
+    if (!subst_rn && !subst_rm && !subst_rd)
+    {
+        // an instruction writing the PC never reaches the jump back, that
+        // is fine, its destination doesn't depend on the address
+        plan.m_kind = Plan::COPY;
+        return;
+    }
+
+    // the scratch register is restored after the instruction, which can't
+    // jump, and is saved on the stack, which the instruction can't use
+    if (writes_pc || rn == ARM_REG_SP_IDX || rd == ARM_REG_SP_IDX || rs == ARM_REG_SP_IDX || rm == ARM_REG_SP_IDX)
+    {
+        return;
+    }
+
+    uint8_t scratch_reg = 0;
+    while (scratch_reg == rn || scratch_reg == rd || scratch_reg == rs || scratch_reg == rm)
+    {
+        scratch_reg++;
+    }
+
+    if (subst_rn)
+        insn = (insn & ~(0xfu << 16)) | (scratch_reg << 16);
+    if (subst_rd)
+        insn = (insn & ~(0xfu << 12)) | (scratch_reg << 12);
+    if (subst_rm)
+        insn = (insn & ~0xfu) | scratch_reg;
+
+    plan.m_kind = Plan::SUBSTITUTE;
+    plan.m_scratch_reg = scratch_reg;
+    plan.m_relocated = insn;
+}
+
+ARM32DisplacedStepper::Plan& ARM32DisplacedStepper::plan(DebugOpts& debug_opts, uintptr_t brk_addr, uint32_t insn)
+{
+    auto plan_iter = m_plans.find(brk_addr);
+    if (plan_iter != m_plans.end() && plan_iter->second.m_insn == insn)
+    {
+        return plan_iter->second;
+    }
+
+    // first hit, or the code at the address has changed (dlclose/dlopen)
+    Plan& new_plan = m_plans[brk_addr];
+    new_plan.m_id = m_next_plan_id++;
+    new_plan.m_insn = insn;
+    decode(debug_opts, brk_addr, new_plan);
+    SPDLOG_LOGGER_DEBUG(m_log, "Displaced step of 0x{:x} : {:08x} kind {}", brk_addr, insn, new_plan.m_kind);
+    return new_plan;
+}
+
+bool ARM32DisplacedStepper::canStepOver(TraceeProgram& traceeProg, Breakpoint& bkpt)
+{
+    StepArch::Register& armReg = archRegisters<StepArch>(traceeProg.getDebugOpts().m_register);
+    if ((bkpt.m_addr & 1) || armReg.isThumbMode())
+    {
+        return false;
+    }
+
+    return plan(traceeProg.getDebugOpts(), bkpt.m_addr, bkpt.m_backupData.read_u32()).m_kind != Plan::UNSUPPORTED;
+}
+
+DisplacedStepResult ARM32DisplacedStepper::stepOver(TraceeProgram& traceeProg, Breakpoint& bkpt, ScratchSlot& slot)
+{
+    DebugOpts& debug_opts = traceeProg.getDebugOpts();
+    StepArch::Register& armReg = archRegisters<StepArch>(debug_opts.m_register);
+    uintptr_t brk_addr = bkpt.m_addr;
+    Plan& step = plan(debug_opts, brk_addr, bkpt.m_backupData.read_u32());
+
+    switch (step.m_kind)
+    {
+    case Plan::BRANCH:
+        if (conditionPassed(step.m_insn >> 28, armReg.getRegIdx(StepArch::Register::CPSR)))
+        {
+            if (step.m_is_call)
+                armReg.setRegIdx(StepArch::Register::LR, brk_addr + 4);
+            armReg.setProgramCounter(step.m_target);
+        }
+        else
+        {
+            armReg.setProgramCounter(brk_addr + 4);
+        }
+        return DisplacedStepResult::RESUMED;
+    case Plan::COPY:
+        if (slot.m_loaded != step.m_id)
+        {
+            uint32_t code[] = {step.m_insn, ARM_LDR_PC_NEXT_WORD, static_cast<uint32_t>(brk_addr + 4)};
+            debug_opts.m_memory.writeRemote(slot.m_addr, code, sizeof(code));
+            slot.m_loaded = step.m_id;
+            slot.m_brk_addr = brk_addr;
+        }
+        break;
+    case Plan::SUBSTITUTE:
+        if (slot.m_loaded != step.m_id)
+        {
+            // the scratch register holds what the PC reads as, the address
+            // of the instruction + 8
+            uint32_t reg_field = step.m_scratch_reg << 12;
+            uint32_t code[] = {
+                // keep in sync with ARM_SUBST_INSN_OFFSET
+                ARM_PUSH_REG | reg_field,
+                ARM_LDR_LITERAL_12 | reg_field,
+                step.m_relocated,
+                ARM_POP_REG | reg_field,
+                ARM_LDR_PC_NEXT_WORD,
+                static_cast<uint32_t>(brk_addr + 4),
+                static_cast<uint32_t>(brk_addr + 8)
+            };
+            debug_opts.m_memory.writeRemote(slot.m_addr, code, sizeof(code));
+            slot.m_loaded = step.m_id;
+            slot.m_brk_addr = brk_addr;
+        }
+        break;
+    default:
+        return DisplacedStepResult::UNSUPPORTED;
+    }
+
+    armReg.setProgramCounter(slot.m_addr);
+    return DisplacedStepResult::RESUMED;
+}
+
+bool ARM32DisplacedStepper::leaveSlot(TraceeProgram& traceeProg, ScratchSlot& slot)
+{
+    DebugOpts& debug_opts = traceeProg.getDebugOpts();
+    StepArch::Register& armReg = archRegisters<StepArch>(debug_opts.m_register);
+    uintptr_t pc = armReg.getProgramCounter();
+    if (pc < slot.m_addr || pc >= slot.m_addr + slotSize())
+    {
+        return false;
+    }
+
+    auto plan_iter = m_plans.find(slot.m_brk_addr);
+    if (plan_iter == m_plans.end() || plan_iter->second.m_id != slot.m_loaded)
+    {
+        m_log->error("No displaced step for the slot at 0x{:x}", slot.m_addr);
+        return false;
+    }
+
+    Plan& step = plan_iter->second;
+    uintptr_t offset = pc - slot.m_addr;
+    uintptr_t insn_offset = 0;
+    if (step.m_kind == Plan::SUBSTITUTE)
+    {
+        insn_offset = ARM_SUBST_INSN_OFFSET;
+        // between the push and the pop the scratch register is on the stack
+        if (offset >= 4 && offset <= ARM_SUBST_INSN_OFFSET + 4)
+        {
+            uint32_t sp = armReg.getStackPointer();
+            uint32_t saved_reg = 0;
+            debug_opts.m_memory.readRemote(sp, &saved_reg, sizeof(saved_reg));
+            armReg.setRegIdx(step.m_scratch_reg, saved_reg);
+            armReg.setRegIdx(StepArch::Register::SP, sp + 4);
+        }
+    }
+
+    bool rewound = offset <= insn_offset;
+    armReg.setProgramCounter(rewound ? slot.m_brk_addr : slot.m_brk_addr + 4);
+    return rewound;
+}
@@ -0,0 +1,139 @@
+#include <cstddef>
+#include <cstring>
+#include <errno.h>
+#include <elf.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+
+#include "hw_breakpoint.hpp"
+
+// control register fields, enabled for EL0 only
+#define ARM64_HW_CTRL_ENABLE 0x1
+#define ARM64_HW_CTRL_EL0 (0x2 << 1)
+#define ARM64_HW_CTRL_LSC_SHIFT 3
+#define ARM64_HW_CTRL_BAS_SHIFT 5
+
+#define ARM64_HW_LSC_LOAD 0x1
+#define ARM64_HW_LSC_STORE 0x2
+
+/// @brief byte address select of an A64 instruction
+#define ARM64_HW_BAS_INSN 0xf
+
+/// @brief layout of struct user_hwdebug_state
+struct ARM64HwDebugState {
+    uint32_t dbg_info;
+    uint32_t pad;
+    struct {
+        uint64_t addr;
+        uint32_t ctrl;
+        uint32_t pad;
+    } dbg_regs[16];
+};
+
+static bool readHwDebugState(pid_t tid, int nt_type, ARM64HwDebugState& state) {
+    struct iovec io;
+    memset(&state, 0, sizeof(state));
+    io.iov_base = &state;
+    io.iov_len = sizeof(state);
+    return ptrace(PTRACE_GETREGSET, tid, (void*)(long)nt_type, (void*)&io) == 0;
+}
+
+static bool writeHwDebugState(pid_t tid, int nt_type, ARM64HwDebugState& state, int reg_count) {
+    struct iovec io;
+    io.iov_base = &state;
+    io.iov_len = offsetof(ARM64HwDebugState, dbg_regs) + reg_count * sizeof(state.dbg_regs[0]);
+    return ptrace(PTRACE_SETREGSET, tid, (void*)(long)nt_type, (void*)&io) == 0;
+}
+
+int ARM64DebugRegisters::slotCount(pid_t tid) {
+    if (m_brk_count < 0) {
+        ARM64HwDebugState state;
+        m_brk_count = readHwDebugState(tid, NT_ARM_HW_BREAK, state) ? (state.dbg_info & 0xff) : 0;
+        m_watch_count = readHwDebugState(tid, NT_ARM_HW_WATCH, state) ? (state.dbg_info & 0xff) : 0;
+        SPDLOG_LOGGER_DEBUG(m_log, "{} hardware breakpoints, {} watchpoints", m_brk_count, m_watch_count);
+    }
+    return ARM64_HW_WATCH_SLOT_BASE + m_watch_count;
+}
+
+bool ARM64DebugRegisters::supports(int slot, HwBreakpointType type) {
+    if (type == HwBreakpointType::EXECUTE) {
+        return slot >= 0 && slot < m_brk_count;
+    }
+    return slot >= ARM64_HW_WATCH_SLOT_BASE && slot < ARM64_HW_WATCH_SLOT_BASE + m_watch_count;
+}
+
+bool ARM64DebugRegisters::arm(pid_t tid, int slot, uintptr_t addr, HwBreakpointType type, uint8_t len) {
+    bool is_watch = slot >= ARM64_HW_WATCH_SLOT_BASE;
+    int nt_type = is_watch ? NT_ARM_HW_WATCH : NT_ARM_HW_BREAK;
+    int reg_idx = is_watch ? slot - ARM64_HW_WATCH_SLOT_BASE : slot;
+
+    uint32_t ctrl = ARM64_HW_CTRL_ENABLE | ARM64_HW_CTRL_EL0;
+    if (is_watch) {
+        if (len == 0 || len > 8 || (addr & 7) + len > 8) {
+            m_log->error("Watchpoint 0x{:x} of {} bytes crosses a double word", addr, len);
+            return false;
+        }
+        // the kernel shifts the byte select by the offset of the address
+        uint32_t lsc = type == HwBreakpointType::WRITE ? ARM64_HW_LSC_STORE : (ARM64_HW_LSC_LOAD | ARM64_HW_LSC_STORE);
+        ctrl |= (lsc << ARM64_HW_CTRL_LSC_SHIFT) | (((1U << len) - 1) << ARM64_HW_CTRL_BAS_SHIFT);
+    } else {
+        ctrl |= ARM64_HW_BAS_INSN << ARM64_HW_CTRL_BAS_SHIFT;
+    }
+
+    ARM64HwDebugState state;
+    if (!readHwDebugState(tid, nt_type, state)) {
+        m_log->error("Unable to read debug registers of {}, errno {}", tid, errno);
+        return false;
+    }
+    state.dbg_regs[reg_idx].addr = addr;
+    state.dbg_regs[reg_idx].ctrl = ctrl;
+    if (!writeHwDebugState(tid, nt_type, state, reg_idx + 1)) {
+        m_log->error("Unable to write debug registers of {}, errno {}", tid, errno);
+        return false;
+    }
+    return true;
+}
+
+bool ARM64DebugRegisters::disarm(pid_t tid, int slot) {
+    bool is_watch = slot >= ARM64_HW_WATCH_SLOT_BASE;
+    int nt_type = is_watch ? NT_ARM_HW_WATCH : NT_ARM_HW_BREAK;
+    int reg_idx = is_watch ? slot - ARM64_HW_WATCH_SLOT_BASE : slot;
+
+    ARM64HwDebugState state;
+    if (!readHwDebugState(tid, nt_type, state)) {
+        return false;
+    }
+    state.dbg_regs[reg_idx].ctrl &= ~ARM64_HW_CTRL_ENABLE;
+    return writeHwDebugState(tid, nt_type, state, reg_idx + 1);
+}
+
+int ARM64DebugRegisters::hitSlot(pid_t tid) {
+    siginfo_t sig_info;
+    memset(&sig_info, 0, sizeof(sig_info));
+    if (ptrace(PTRACE_GETSIGINFO, tid, nullptr, &sig_info) < 0) {
+        return -1;
+    }
+    uintptr_t hit_addr = reinterpret_cast<uintptr_t>(sig_info.si_addr);
+
+    ARM64HwDebugState state;
+    if (readHwDebugState(tid, NT_ARM_HW_BREAK, state)) {
+        for (int reg_idx = 0; reg_idx < m_brk_count; reg_idx++) {
+            if ((state.dbg_regs[reg_idx].ctrl & ARM64_HW_CTRL_ENABLE) && state.dbg_regs[reg_idx].addr == hit_addr) {
+                return reg_idx;
+            }
+        }
+    }
+
+    // the access reported for a watchpoint may start before the watched
+    // bytes, they are matched by double word
+    if (readHwDebugState(tid, NT_ARM_HW_WATCH, state)) {
+        for (int reg_idx = 0; reg_idx < m_watch_count; reg_idx++) {
+            if ((state.dbg_regs[reg_idx].ctrl & ARM64_HW_CTRL_ENABLE) &&
+                (state.dbg_regs[reg_idx].addr & ~7ULL) == (hit_addr & ~7ULL)) {
+                return ARM64_HW_WATCH_SLOT_BASE + reg_idx;
+            }
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,604 @@
+#include <sys/mman.h>
+
+#include "displaced_step.hpp"
+#include "arch_traits.hpp"
+#include "tracee.hpp"
+#include "debug_opts.hpp"
+
+typedef ArchTraits<CPU_ARCH::AMD64> StepArch;
+
+/// @brief jcc condition of the unconditional jmp/call
+#define X86_COND_ALWAYS 0x10
+
+// layout of a RIP_RELATIVE slot :
+//   mov %reg, save(%rip)
+//   movabs $next_insn, %reg
+//   <instruction with (%reg) instead of (%rip)>
+//   mov save(%rip), %reg
+//   jmp *0(%rip)
+//   .quad next_insn
+//   ...
+//   save: .quad
+
+/// @brief 'mov %reg, disp32(%rip)' and back
+#define AMD64_RIP_MOV_SIZE 7
+/// @brief 'movabs $imm64, %reg'
+#define AMD64_MOVABS_SIZE 10
+/// @brief 'jmp *0(%rip)' followed by the destination
+#define AMD64_JUMP_BACK_SIZE 14
+/// @brief offset of the instruction in a RIP_RELATIVE slot
+#define AMD64_RIP_INSN_OFFSET (AMD64_RIP_MOV_SIZE + AMD64_MOVABS_SIZE)
+/// @brief offset of the saved scratch register in a RIP_RELATIVE slot
+#define AMD64_SLOT_SAVE_OFFSET 56
+
+/// @brief 'syscall' followed by 'int3'
+static const uint8_t amd64_syscall_trap[] = {0x0f, 0x05, 0xcc};
+
+/// @brief register index of the general purpose registers by hardware number
+static const uint8_t amd64_gpr_idx[] = {
+    StepArch::Register::RAX, StepArch::Register::RCX, StepArch::Register::RDX, StepArch::Register::RBX,
+    StepArch::Register::RSP, StepArch::Register::RBP, StepArch::Register::RSI, StepArch::Register::RDI,
+    StepArch::Register::R8, StepArch::Register::R9, StepArch::Register::R10, StepArch::Register::R11,
+    StepArch::Register::R12, StepArch::Register::R13, StepArch::Register::R14, StepArch::Register::R15
+};
+
+/// @brief registers the %rip operand can be replaced with, they need no
+/// REX.B and have no addressing special case
+static const uint8_t amd64_scratch_candidates[] = {0, 1, 2, 3, 6, 7};
+
+#define AMD64_GPR_RSP 4
+
+/// @brief hardware number of the general purpose register a capstone
+/// register is part of, -1 for the other registers
+static int gprNumber(unsigned int reg)
+{
+    switch (reg)
+    {
+    case X86_REG_AL: case X86_REG_AH: case X86_REG_AX: case X86_REG_EAX: case X86_REG_RAX: return 0;
+    case X86_REG_CL: case X86_REG_CH: case X86_REG_CX: case X86_REG_ECX: case X86_REG_RCX: return 1;
+    case X86_REG_DL: case X86_REG_DH: case X86_REG_DX: case X86_REG_EDX: case X86_REG_RDX: return 2;
+    case X86_REG_BL: case X86_REG_BH: case X86_REG_BX: case X86_REG_EBX: case X86_REG_RBX: return 3;
+    case X86_REG_SPL: case X86_REG_SP: case X86_REG_ESP: case X86_REG_RSP: return 4;
+    case X86_REG_BPL: case X86_REG_BP: case X86_REG_EBP: case X86_REG_RBP: return 5;
+    case X86_REG_SIL: case X86_REG_SI: case X86_REG_ESI: case X86_REG_RSI: return 6;
+    case X86_REG_DIL: case X86_REG_DI: case X86_REG_EDI: case X86_REG_RDI: return 7;
+    case X86_REG_R8B: case X86_REG_R8W: case X86_REG_R8D: case X86_REG_R8: return 8;
+    case X86_REG_R9B: case X86_REG_R9W: case X86_REG_R9D: case X86_REG_R9: return 9;
+    case X86_REG_R10B: case X86_REG_R10W: case X86_REG_R10D: case X86_REG_R10: return 10;
+    case X86_REG_R11B: case X86_REG_R11W: case X86_REG_R11D: case X86_REG_R11: return 11;
+    case X86_REG_R12B: case X86_REG_R12W: case X86_REG_R12D: case X86_REG_R12: return 12;
+    case X86_REG_R13B: case X86_REG_R13W: case X86_REG_R13D: case X86_REG_R13: return 13;
+    case X86_REG_R14B: case X86_REG_R14W: case X86_REG_R14D: case X86_REG_R14: return 14;
+    case X86_REG_R15B: case X86_REG_R15W: case X86_REG_R15D: case X86_REG_R15: return 15;
+    default: return -1;
+    }
+}
+
+/**
+ * @brief Offset of the opcode, after the legacy prefixes and the REX
+ *
+ * @param rex_offset [out] offset of the REX prefix, -1 if there is none
+ */
+static size_t skipPrefixes(const uint8_t* insn, size_t size, int* rex_offset)
+{
+    size_t pos = 0;
+    while (pos < size)
+    {
+        switch (insn[pos])
+        {
+        case 0xf0: case 0xf2: case 0xf3:
+        case 0x2e: case 0x36: case 0x3e: case 0x26: case 0x64: case 0x65:
+        case 0x66: case 0x67:
+            pos++;
+            continue;
+        }
+        break;
+    }
+
+    *rex_offset = -1;
+    if (pos < size && (insn[pos] & 0xf0) == 0x40)
+    {
+        *rex_offset = pos;
+        pos++;
+    }
+    return pos;
+}
+
+/// @brief condition code of a jcc rel8/rel32, -1 for the other jumps
+static int jccCondition(const uint8_t* insn, size_t size)
+{
+    int rex_offset;
+    size_t pos = skipPrefixes(insn, size, &rex_offset);
+    if (pos < size && (insn[pos] & 0xf0) == 0x70)
+    {
+        return insn[pos] & 0xf;
+    }
+    if (pos + 1 < size && insn[pos] == 0x0f && (insn[pos + 1] & 0xf0) == 0x80)
+    {
+        return insn[pos + 1] & 0xf;
+    }
+    return -1;
+}
+
+/// @brief condition code of a jcc against the EFLAGS
+static bool conditionPassed(uint8_t cond, uint64_t eflags)
+{
+    bool cf = eflags & (1 << 0), pf = eflags & (1 << 2), zf = eflags & (1 << 6);
+    bool sf = eflags & (1 << 7), of = eflags & (1 << 11);
+    bool passed;
+
+    if (cond == X86_COND_ALWAYS)
+    {
+        return true;
+    }
+
+    // odd conditions are the negation of the even ones
+    switch (cond >> 1)
+    {
+    case 0x0: passed = of; break;
+    case 0x1: passed = cf; break;
+    case 0x2: passed = zf; break;
+    case 0x3: passed = cf || zf; break;
+    case 0x4: passed = sf; break;
+    case 0x5: passed = pf; break;
+    case 0x6: passed = sf != of; break;
+    default: passed = zf || sf != of; break;
+    }
+    return (cond & 1) ? !passed : passed;
+}
+
+/// @brief 'mov %reg, disp(%rip)' (opcode 0x89) or 'mov disp(%rip), %reg'
+/// (0x8b) of a 64 bit register
+static size_t encodeRipMov(uint8_t* code, uint8_t opcode, uint8_t reg, int32_t disp)
+{
+    code[0] = 0x48;
+    code[1] = opcode;
+    code[2] = 0x05 | (reg << 3);
+    memcpy(code + 3, &disp, sizeof(disp));
+    return AMD64_RIP_MOV_SIZE;
+}
+
+/// @brief 'jmp *0(%rip)' followed by the destination
+static size_t encodeJumpBack(uint8_t* code, uint64_t dest)
+{
+    static const uint8_t jmp_next_qword[] = {0xff, 0x25, 0x00, 0x00, 0x00, 0x00};
+    memcpy(code, jmp_next_qword, sizeof(jmp_next_qword));
+    memcpy(code + sizeof(jmp_next_qword), &dest, sizeof(dest));
+    return AMD64_JUMP_BACK_SIZE;
+}
+
+AMD64DisplacedStepper::AMD64DisplacedStepper()
+{
+    if (cs_open(CS_ARCH_X86, CS_MODE_64, &m_handle) != CS_ERR_OK)
+    {
+        m_log->error("Apparently no support for x86 in capstone.lib");
+    }
+
+    m_cs_insn = cs_malloc(m_handle);
+
+    cs_option(m_handle, CS_OPT_DETAIL, CS_OPT_ON);
+}
+
+AMD64DisplacedStepper::~AMD64DisplacedStepper()
+{
+    cs_free(m_cs_insn, 1);
+    cs_close(&m_handle);
+}
+
+size_t AMD64DisplacedStepper::syscallTrapCode(uint8_t* code)
+{
+    memcpy(code, amd64_syscall_trap, sizeof(amd64_syscall_trap));
+    return sizeof(amd64_syscall_trap);
+}
+
+void AMD64DisplacedStepper::setMmapCall(TraceeProgram& traceeProg, uintptr_t code_addr, size_t len)
+{
+    StepArch::Register& amdReg = archRegisters<StepArch>(traceeProg.getDebugOpts().m_register);
+    // writable, the slots save the scratch register in themselves
+    uint64_t mmap_args[] = {
+        0, len, PROT_READ | PROT_WRITE | PROT_EXEC,
+        MAP_PRIVATE | MAP_ANONYMOUS, static_cast<uint64_t>(-1), 0
+    };
+
+    amdReg.setRegIdx(StepArch::syscall_nr_reg, static_cast<uint64_t>(AMD64_SYSCALL::MMAP));
+    for (int i = 0; i < 6; i++)
+    {
+        amdReg.setRegIdx(StepArch::syscallArgReg(i), mmap_args[i]);
+    }
+    amdReg.setProgramCounter(code_addr);
+}
+
+uintptr_t AMD64DisplacedStepper::syscallResult(TraceeProgram& traceeProg)
+{
+    StepArch::Register& amdReg = archRegisters<StepArch>(traceeProg.getDebugOpts().m_register);
+    return amdReg.getRegIdx(StepArch::syscall_ret_reg);
+}
+
+void AMD64DisplacedStepper::decode(uintptr_t brk_addr, const uint8_t* code, size_t code_size, Plan& plan)
+{
+    uint64_t address = brk_addr;
+
+    plan.m_kind = Plan::UNSUPPORTED;
+    plan.m_size = 0;
+    if (!cs_disasm_iter(m_handle, &code, &code_size, &address, m_cs_insn))
+    {
+        return;
+    }
+
+    const uint8_t* insn = m_cs_insn->bytes;
+    cs_detail* detail = m_cs_insn->detail;
+    cs_x86& x86 = detail->x86;
+    uintptr_t next_addr = brk_addr + m_cs_insn->size;
+
+    plan.m_size = m_cs_insn->size;
+    memcpy(plan.m_insn, insn, plan.m_size);
+
+    bool is_jump = false, is_call = false, is_ret = false, is_relative = false;
+    for (uint8_t i = 0; i < detail->groups_count; i++)
+    {
+        switch (detail->groups[i])
+        {
+        case CS_GRP_JUMP: is_jump = true; break;
+        case CS_GRP_CALL: is_call = true; break;
+        case CS_GRP_RET: is_ret = true; break;
+        case CS_GRP_BRANCH_RELATIVE: is_relative = true; break;
+        case CS_GRP_INT:
+        case CS_GRP_IRET:
+        case CS_GRP_PRIVILEGE:
+            return;
+        }
+    }
+    if (m_cs_insn->id == X86_INS_SYSCALL || m_cs_insn->id == X86_INS_SYSENTER)
+    {
+        return;
+    }
+
+    const cs_x86_op* mem_op = nullptr;
+    for (uint8_t i = 0; i < x86.op_count; i++)
+    {
+        if (x86.operands[i].type == X86_OP_MEM)
+            mem_op = &x86.operands[i];
+        else if (x86.operands[i].type == X86_OP_REG && x86.operands[i].reg == X86_REG_RIP)
+            return;
+    }
+    bool rip_based = mem_op != nullptr && mem_op->mem.base == X86_REG_RIP;
+
+    if (is_ret)
+    {
+        plan.m_kind = Plan::COPY;
+        return;
+    }
+
+    if (is_jump || is_call)
+    {
+        plan.m_is_call = m_cs_insn->id == X86_INS_CALL;
+        if (m_cs_insn->id != X86_INS_CALL && m_cs_insn->id != X86_INS_JMP)
+        {
+            // jcc, the loop/jrcxz family and the far jumps
+            int cond = jccCondition(insn, plan.m_size);
+            if (cond < 0 || x86.op_count != 1 || x86.operands[0].type != X86_OP_IMM)
+                return;
+            plan.m_kind = Plan::BRANCH;
+            plan.m_cond = cond;
+            plan.m_target = x86.operands[0].imm;
+            return;
+        }
+
+        const cs_x86_op& target = x86.operands[0];
+        if (target.type == X86_OP_IMM)
+        {
+            plan.m_kind = Plan::BRANCH;
+            plan.m_cond = X86_COND_ALWAYS;
+            plan.m_target = target.imm;
+        }
+        else if (target.type == X86_OP_REG)
+        {
+            // jmp *%reg goes to an absolute address, call would return to
+            // the slot
+            int reg_nr = gprNumber(target.reg);
+            if (!plan.m_is_call)
+            {
+                plan.m_kind = Plan::COPY;
+            }
+            else if (reg_nr >= 0)
+            {
+                plan.m_kind = Plan::INDIRECT;
+                plan.m_target = 0;
+                plan.m_target_reg = amd64_gpr_idx[reg_nr];
+            }
+        }
+        else if (rip_based)
+        {
+            // the pointer is read at the stop, e.g. call *foo@GOTPCREL(%rip)
+            if (target.mem.segment != X86_REG_INVALID)
+                return;
+            plan.m_kind = Plan::INDIRECT;
+            plan.m_target = next_addr + target.mem.disp;
+        }
+        else if (!plan.m_is_call)
+        {
+            plan.m_kind = Plan::COPY;
+        }
+        else
+        {
+            // 'call *mem' is 'ff /2', it becomes 'jmp *mem', 'ff /4', with the
+            // return address pushed beforehand, which moves the %rsp operands
+            uint8_t modrm_offset = x86.encoding.modrm_offset;
+            if (gprNumber(target.mem.base) == AMD64_GPR_RSP || gprNumber(target.mem.index) == AMD64_GPR_RSP)
+                return;
+            if (modrm_offset == 0 || modrm_offset >= plan.m_size || ((insn[modrm_offset] >> 3) & 0x7) != 2)
+                return;
+            memcpy(plan.m_relocated, insn, plan.m_size);
+            plan.m_relocated[modrm_offset] = (insn[modrm_offset] & ~0x38) | (4 << 3);
+            plan.m_kind = Plan::CALL_MEMORY;
+        }
+        return;
+    }
+
+    // xbegin and the like
+    if (is_relative)
+    {
+        return;
+    }
+
+    if (!rip_based)
+    {
+        plan.m_kind = Plan::COPY;
+        return;
+    }
+
+    uint8_t modrm_offset = x86.encoding.modrm_offset;
+    if (modrm_offset == 0 || modrm_offset >= plan.m_size || (insn[modrm_offset] & 0xc7) != 0x05)
+    {
+        return;
+    }
+
+    // the scratch register can't be one the instruction uses
+    uint32_t used_regs = 0;
+    for (uint8_t i = 0; i < x86.op_count; i++)
+    {
+        const cs_x86_op& op = x86.operands[i];
+        int reg_nr[] = {-1, -1};
+        if (op.type == X86_OP_REG)
+        {
+            reg_nr[0] = gprNumber(op.reg);
+        }
+        else if (op.type == X86_OP_MEM)
+        {
+            reg_nr[0] = gprNumber(op.mem.base);
+            reg_nr[1] = gprNumber(op.mem.index);
+        }
+        for (int reg : reg_nr)
+        {
+            if (reg >= 0)
+                used_regs |= 1 << reg;
+        }
+    }
+    for (uint8_t i = 0; i < detail->regs_read_count; i++)
+    {
+        int reg = gprNumber(detail->regs_read[i]);
+        if (reg >= 0)
+            used_regs |= 1 << reg;
+    }
+    for (uint8_t i = 0; i < detail->regs_write_count; i++)
+    {
+        int reg = gprNumber(detail->regs_write[i]);
+        if (reg >= 0)
+            used_regs |= 1 << reg;
+    }
+
+    int scratch_reg = -1;
+    for (uint8_t candidate : amd64_scratch_candidates)
+    {
+        if (!(used_regs & (1 << candidate)))
+        {
+            scratch_reg = candidate;
+            break;
+        }
+    }
+    if (scratch_reg < 0)
+    {
+        return;
+    }
+
+    // mod 00 r/m 101 (disp32 from %rip) becomes mod 10 r/m reg (disp32 from
+    // reg), the length is the same and the displacement is kept
+    memcpy(plan.m_relocated, insn, plan.m_size);
+    plan.m_relocated[modrm_offset] = 0x80 | (insn[modrm_offset] & 0x38) | scratch_reg;
+
+    // the B bit extending r/m is ignored for %rip, it no longer is
+    int rex_offset;
+    size_t opcode_offset = skipPrefixes(insn, plan.m_size, &rex_offset);
+    if (rex_offset >= 0)
+    {
+        plan.m_relocated[rex_offset] &= ~0x01;
+    }
+    else if (opcode_offset + 1 < plan.m_size && (insn[opcode_offset] == 0xc4 || insn[opcode_offset] == 0x62 ||
+             (insn[opcode_offset] == 0x8f && modrm_offset != opcode_offset + 1)))
+    {
+        // VEX3/EVEX/XOP store it inverted
+        plan.m_relocated[opcode_offset + 1] |= 0x20;
+    }
+
+    plan.m_kind = Plan::RIP_RELATIVE;
+    plan.m_scratch_reg = scratch_reg;
+}
+
+AMD64DisplacedStepper::Plan& AMD64DisplacedStepper::plan(uintptr_t brk_addr, const uint8_t* code, size_t code_size)
+{
+    auto plan_iter = m_plans.find(brk_addr);
+    if (plan_iter != m_plans.end())
+    {
+        Plan& cached = plan_iter->second;
+        if (cached.m_size != 0 && cached.m_size <= code_size && memcmp(cached.m_insn, code, cached.m_size) == 0)
+        {
+            return cached;
+        }
+    }
+
+    // first hit, or the code at the address has changed (dlclose/dlopen)
+    Plan& new_plan = m_plans[brk_addr];
+    new_plan.m_id = m_next_plan_id++;
+    decode(brk_addr, code, code_size, new_plan);
+    SPDLOG_LOGGER_DEBUG(m_log, "Displaced step of 0x{:x} : {} bytes kind {}", brk_addr, new_plan.m_size, new_plan.m_kind);
+    return new_plan;
+}
+
+void AMD64DisplacedStepper::pushReturnAddress(TraceeProgram& traceeProg, uintptr_t ret_addr)
+{
+    DebugOpts& debug_opts = traceeProg.getDebugOpts();
+    StepArch::Register& amdReg = archRegisters<StepArch>(debug_opts.m_register);
+    uint64_t stack_ptr = amdReg.getStackPointer() - sizeof(uint64_t);
+    uint64_t ret_value = ret_addr;
+
+    debug_opts.m_memory.writeRemote(stack_ptr, &ret_value, sizeof(ret_value));
+    amdReg.setRegIdx(StepArch::Register::RSP, stack_ptr);
+}
+
+bool AMD64DisplacedStepper::canStepOver(TraceeProgram& traceeProg, Breakpoint& bkpt)
+{
+    DebugOpts& debug_opts = traceeProg.getDebugOpts();
+    uint8_t code[X86_MAX_INSN_SIZE];
+
+    // the instruction may end close to an unmapped page, take what there is
+    ssize_t code_size = debug_opts.m_memory.readRemote(bkpt.m_addr, code, sizeof(code));
+    if (code_size <= 0)
+    {
+        return false;
+    }
+    code[0] = bkpt.m_backupData.read_u8();
+
+    Plan& step = plan(bkpt.m_addr, code, code_size);
+    if (step.m_kind == Plan::INDIRECT && step.m_target != 0)
+    {
+        // unreadable, the instruction faults, let it do so in place
+        uint64_t target = 0;
+        if (debug_opts.m_memory.readRemote(step.m_target, &target, sizeof(target)) != sizeof(target))
+            return false;
+        m_indirect_target = target;
+    }
+    return step.m_kind != Plan::UNSUPPORTED;
+}
+
+DisplacedStepResult AMD64DisplacedStepper::stepOver(TraceeProgram& traceeProg, Breakpoint& bkpt, ScratchSlot& slot)
+{
+    DebugOpts& debug_opts = traceeProg.getDebugOpts();
+    StepArch::Register& amdReg = archRegisters<StepArch>(debug_opts.m_register);
+    uintptr_t brk_addr = bkpt.m_addr;
+
+    auto plan_iter = m_plans.find(brk_addr);
+    if (plan_iter == m_plans.end())
+    {
+        return DisplacedStepResult::UNSUPPORTED;
+    }
+
+    Plan& step = plan_iter->second;
+    uintptr_t next_addr = brk_addr + step.m_size;
+    uint8_t code[AMD64_SLOT_SAVE_OFFSET];
+    size_t code_len = 0;
+
+    switch (step.m_kind)
+    {
+    case Plan::BRANCH:
+        if (conditionPassed(step.m_cond, amdReg.getRegIdx(StepArch::Register::EFLAGS)))
+        {
+            if (step.m_is_call)
+                pushReturnAddress(traceeProg, next_addr);
+            amdReg.setProgramCounter(step.m_target);
+        }
+        else
+        {
+            amdReg.setProgramCounter(next_addr);
+        }
+        return DisplacedStepResult::RESUMED;
+    case Plan::INDIRECT:
+    {
+        uintptr_t target = step.m_target != 0 ? m_indirect_target : amdReg.getRegIdx(step.m_target_reg);
+        if (step.m_is_call)
+            pushReturnAddress(traceeProg, next_addr);
+        amdReg.setProgramCounter(target);
+        return DisplacedStepResult::RESUMED;
+    }
+    case Plan::CALL_MEMORY:
+        pushReturnAddress(traceeProg, next_addr);
+        memcpy(code, step.m_relocated, step.m_size);
+        code_len = step.m_size;
+        break;
+    case Plan::COPY:
+        memcpy(code, step.m_insn, step.m_size);
+        code_len = step.m_size;
+        code_len += encodeJumpBack(code + code_len, next_addr);
+        break;
+    case Plan::RIP_RELATIVE:
+        code_len += encodeRipMov(code, 0x89, step.m_scratch_reg, AMD64_SLOT_SAVE_OFFSET - AMD64_RIP_MOV_SIZE);
+        code[code_len++] = 0x48;
+        code[code_len++] = 0xb8 | step.m_scratch_reg;
+        memcpy(code + code_len, &next_addr, sizeof(uint64_t));
+        code_len += sizeof(uint64_t);
+        memcpy(code + code_len, step.m_relocated, step.m_size);
+        code_len += step.m_size;
+        code_len += encodeRipMov(code + code_len, 0x8b, step.m_scratch_reg,
+            AMD64_SLOT_SAVE_OFFSET - (code_len + AMD64_RIP_MOV_SIZE));
+        code_len += encodeJumpBack(code + code_len, next_addr);
+        break;
+    default:
+        return DisplacedStepResult::UNSUPPORTED;
+    }
+
+    if (slot.m_loaded != step.m_id)
+    {
+        debug_opts.m_memory.writeRemote(slot.m_addr, code, code_len);
+        slot.m_loaded = step.m_id;
+        slot.m_brk_addr = brk_addr;
+    }
+    amdReg.setProgramCounter(slot.m_addr);
+    return DisplacedStepResult::RESUMED;
+}
+
+bool AMD64DisplacedStepper::leaveSlot(TraceeProgram& traceeProg, ScratchSlot& slot)
+{
+    DebugOpts& debug_opts = traceeProg.getDebugOpts();
+    StepArch::Register& amdReg = archRegisters<StepArch>(debug_opts.m_register);
+    uintptr_t pc = amdReg.getProgramCounter();
+    if (pc < slot.m_addr || pc >= slot.m_addr + slotSize())
+    {
+        return false;
+    }
+
+    auto plan_iter = m_plans.find(slot.m_brk_addr);
+    if (plan_iter == m_plans.end() || plan_iter->second.m_id != slot.m_loaded)
+    {
+        m_log->error("No displaced step for the slot at 0x{:x}", slot.m_addr);
+        return false;
+    }
+
+    Plan& step = plan_iter->second;
+    uintptr_t offset = pc - slot.m_addr;
+    bool rewound;
+
+    switch (step.m_kind)
+    {
+    case Plan::RIP_RELATIVE:
+        // the register is saved by the first instruction and restored by
+        // the one after the relocated instruction
+        if (offset >= AMD64_RIP_MOV_SIZE && offset < static_cast<uintptr_t>(AMD64_RIP_INSN_OFFSET + step.m_size + AMD64_RIP_MOV_SIZE))
+        {
+            uint64_t saved_reg = 0;
+            debug_opts.m_memory.readRemote(slot.m_addr + AMD64_SLOT_SAVE_OFFSET, &saved_reg, sizeof(saved_reg));
+            amdReg.setRegIdx(amd64_gpr_idx[step.m_scratch_reg], saved_reg);
+        }
+        rewound = offset <= AMD64_RIP_INSN_OFFSET;
+        break;
+    case Plan::CALL_MEMORY:
+        // the jmp didn't happen, drop the return address
+        amdReg.setRegIdx(StepArch::Register::RSP, amdReg.getStackPointer() + sizeof(uint64_t));
+        rewound = true;
+        break;
+    default:
+        rewound = offset < step.m_size;
+        break;
+    }
+
+    amdReg.setProgramCounter(rewound ? slot.m_brk_addr : slot.m_brk_addr + step.m_size);
+    return rewound;
+}
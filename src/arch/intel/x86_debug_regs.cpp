@@ -0,0 +1,121 @@
+#include <cstddef>
+#include <errno.h>
+#include <sys/ptrace.h>
+#include <sys/user.h>
+
+#include "hw_breakpoint.hpp"
+
+// DR7, local enable bit of the slot and its access type and length fields
+#define X86_DR7_ENABLE(slot) (1UL << ((slot) * 2))
+#define X86_DR7_RW_SHIFT(slot) (16 + (slot) * 4)
+#define X86_DR7_LEN_SHIFT(slot) (18 + (slot) * 4)
+#define X86_DR7_SLOT_MASK(slot) (X86_DR7_ENABLE(slot) | (0xfUL << X86_DR7_RW_SHIFT(slot)))
+
+#define X86_DR7_RW_EXECUTE 0x0
+#define X86_DR7_RW_WRITE 0x1
+#define X86_DR7_RW_READ_WRITE 0x3
+
+// DR6, the slots which triggered
+#define X86_DR6_TRAP_MASK 0xf
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86_DEBUG_REG_OFFSET(reg_idx) \
+    (offsetof(struct user, u_debugreg) + (reg_idx) * sizeof(((struct user*)0)->u_debugreg[0]))
+#endif
+
+long X86DebugRegisters::peek(pid_t tid, int reg_idx, bool& ok) {
+#if defined(X86_DEBUG_REG_OFFSET)
+    errno = 0;
+    long value = ptrace(PTRACE_PEEKUSER, tid, (void*)X86_DEBUG_REG_OFFSET(reg_idx), nullptr);
+    ok = errno == 0;
+    if (!ok) {
+        m_log->error("Unable to read DR{} of {}, errno {}", reg_idx, tid, errno);
+    }
+    return value;
+#else
+    ok = false;
+    return 0;
+#endif
+}
+
+bool X86DebugRegisters::poke(pid_t tid, int reg_idx, unsigned long value) {
+#if defined(X86_DEBUG_REG_OFFSET)
+    if (ptrace(PTRACE_POKEUSER, tid, (void*)X86_DEBUG_REG_OFFSET(reg_idx), (void*)value) < 0) {
+        m_log->error("Unable to write DR{} of {}, errno {}", reg_idx, tid, errno);
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool X86DebugRegisters::arm(pid_t tid, int slot, uintptr_t addr, HwBreakpointType type, uint8_t len) {
+    unsigned long rw_bits = X86_DR7_RW_EXECUTE;
+    unsigned long len_bits = 0;
+
+    if (type != HwBreakpointType::EXECUTE) {
+        rw_bits = type == HwBreakpointType::WRITE ? X86_DR7_RW_WRITE : X86_DR7_RW_READ_WRITE;
+        switch (len) {
+        case 1: len_bits = 0x0; break;
+        case 2: len_bits = 0x1; break;
+        case 4: len_bits = 0x3; break;
+        case 8: len_bits = 0x2; break;
+        default:
+            m_log->error("Invalid watchpoint length {}", len);
+            return false;
+        }
+        if (addr & (len - 1)) {
+            m_log->error("Watchpoint 0x{:x} isn't aligned on its length {}", addr, len);
+            return false;
+        }
+    }
+
+    bool ok = false;
+    unsigned long dr7 = peek(tid, X86_DR_CONTROL, ok);
+    if (!ok) {
+        return false;
+    }
+
+    // the kernel checks the address when the slot is enabled in DR7
+    if (!poke(tid, slot, addr)) {
+        return false;
+    }
+
+    dr7 &= ~X86_DR7_SLOT_MASK(slot);
+    dr7 |= X86_DR7_ENABLE(slot) |
+        (rw_bits << X86_DR7_RW_SHIFT(slot)) |
+        (len_bits << X86_DR7_LEN_SHIFT(slot));
+    return poke(tid, X86_DR_CONTROL, dr7);
+}
+
+bool X86DebugRegisters::disarm(pid_t tid, int slot) {
+    bool ok = false;
+    unsigned long dr7 = peek(tid, X86_DR_CONTROL, ok);
+    if (!ok) {
+        return false;
+    }
+
+    if (!poke(tid, X86_DR_CONTROL, dr7 & ~X86_DR7_SLOT_MASK(slot))) {
+        return false;
+    }
+    return poke(tid, slot, 0);
+}
+
+int X86DebugRegisters::hitSlot(pid_t tid) {
+    bool ok = false;
+    unsigned long dr6 = peek(tid, X86_DR_STATUS, ok);
+    if (!ok) {
+        return -1;
+    }
+
+    // the status is sticky, clear it so the next hit only reports its slot
+    poke(tid, X86_DR_STATUS, 0);
+
+    for (int slot = 0; slot < X86_DEBUG_REG_SLOTS; slot++) {
+        if (dr6 & X86_DR6_TRAP_MASK & (1UL << slot)) {
+            return slot;
+        }
+    }
+    return -1;
+}
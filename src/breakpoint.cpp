@@ -2,6 +2,7 @@
 #include "breakpoint.hpp"
 #include "debug_opts.hpp"
 #include "tracee.hpp"
+#include "arch_traits.hpp"
 
 Breakpoint::Breakpoint(
     std::string &modname, uintptr_t offset, uintptr_t bk_addr,
@@ -13,16 +14,7 @@ Breakpoint::Breakpoint(
         m_label = spdlog::fmt_lib::format("{}@{:x}", m_modname.c_str(), offset);
     }
 
-#if defined(SUPPORT_ARCH_X86) || defined(SUPPORT_ARCH_AMD64)
-    m_bkpt_injector = new X86BreakpointInjector();
-#elif defined(SUPPORT_ARCH_ARM)
-    m_bkpt_injector = new ARMBreakpointInjector();
-#elif defined(SUPPORT_ARCH_ARM64)
-    m_bkpt_injector = new ARM64BreakpointInjector();
-#else
-    m_log->critical("Breakpoint No Architecture is specified");
-    exit(-1);
-#endif
+    m_bkpt_injector = new TargetArch::Injector();
 }
 
 // Breakpoint::~Breakpoint() {
@@ -64,7 +56,7 @@ void Breakpoint::setAddress(uintptr_t brkpnt_addr)
 {
     // set concrete offset of breakpoint in process memory space
     m_addr = brkpnt_addr;
-    m_backupData = std::unique_ptr<Addr>(new Addr(m_addr, 8));
+    m_backupData = Addr(m_addr, 8);
 }
 
 bool Breakpoint::shouldEnable()
@@ -100,4 +92,15 @@ int Breakpoint::disable(TraceeProgram &traceeProg)
     m_bkpt_injector->restore(traceeProg.getDebugOpts(), m_backupData);
     m_enabled = false;
     return 1;
-};
\ No newline at end of file
+};
+void Breakpoint::enableInBuffer(TraceeProgram &traceeProg, uint8_t *code)
+{
+    m_bkpt_injector->injectInBuffer(traceeProg.getDebugOpts(), code, m_backupData);
+    m_enabled = true;
+}
+
+void Breakpoint::disableInBuffer(TraceeProgram &traceeProg, uint8_t *code)
+{
+    m_bkpt_injector->restoreInBuffer(traceeProg.getDebugOpts(), code, m_backupData);
+    m_enabled = false;
+}
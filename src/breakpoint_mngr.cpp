@@ -1,23 +1,28 @@
+#include <algorithm>
+
 #include "breakpoint_mngr.hpp"
 #include "debugger.hpp"
 #include "tracee.hpp"
 #include "debug_opts.hpp"
 #include "branch_data.hpp"
 #include "witch.hpp"
+#include "arch_traits.hpp"
 
 
 BreakpointMngr::BreakpointMngr(TargetDescription& _target_desc) : m_target_desc(_target_desc) {
     m_arm_disasm = new ArmDisassembler(false);
+    m_debug_regs = new TargetArch::DebugRegisters();
 };
 
 void BreakpointMngr::parseModuleBrkPnt(std::string &brk_mod_addr)
 {
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
     std::list<Breakpoint *> brk_offset;
-    m_log->trace("BRK {}", brk_mod_addr.c_str());
+    SPDLOG_LOGGER_TRACE(m_log, "BRK {}", brk_mod_addr.c_str());
 
     auto mod_idx = brk_mod_addr.find("@");
     std::string mod_name = brk_mod_addr.substr(0, mod_idx);
-    m_log->trace("Module {}", mod_name.c_str());
+    SPDLOG_LOGGER_TRACE(m_log, "Module {}", mod_name.c_str());
 
     int pnt_idx = mod_idx, prev_idx = mod_idx;
 
@@ -30,7 +35,7 @@ void BreakpointMngr::parseModuleBrkPnt(std::string &brk_mod_addr)
             mod_offset = stoi(brk_mod_addr.substr(prev_idx, pnt_idx - prev_idx), 0, 16);
         else
             mod_offset = stoi(brk_mod_addr.substr(prev_idx), 0, 16);
-        m_log->trace("  Off {:x}", mod_offset);
+        SPDLOG_LOGGER_TRACE(m_log, "  Off {:x}", mod_offset);
 
         brk_offset.push_back(new Breakpoint(mod_name, mod_offset));
     }
@@ -40,6 +45,7 @@ void BreakpointMngr::parseModuleBrkPnt(std::string &brk_mod_addr)
 
 void BreakpointMngr::addBrkPnt(BreakpointPtr brkPtr)
 {
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
 
     std::list<Breakpoint *> pending_bkpt_list;
 
@@ -47,7 +53,7 @@ void BreakpointMngr::addBrkPnt(BreakpointPtr brkPtr)
     if (pnd_brk_iter != m_pending.end())
     {
         pending_bkpt_list = pnd_brk_iter->second;
-        m_log->trace("Module in which the breakpoint will be inject is found!");
+        SPDLOG_LOGGER_TRACE(m_log, "Module in which the breakpoint will be inject is found!");
     }
     // Module in which you want to inject breakpoint is not found! Appending at the top
 
@@ -55,63 +61,173 @@ void BreakpointMngr::addBrkPnt(BreakpointPtr brkPtr)
     m_pending[brkPtr->m_modname] = pending_bkpt_list;
 }
 
+void BreakpointMngr::addHwBreakpoint(HwBreakpoint* brkPtr)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    m_hw_pending.push_back(brkPtr);
+}
+
 /// @brief inject the pending breakpoint of the module for which
 ///        the breakpoint is register
 void BreakpointMngr::inject(TraceeProgram& traceeProgram)
 {
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
     DebugOpts& debug_opts = traceeProgram.getDebugOpts();
     debug_opts.m_procMap.print();
-    m_log->trace("Yeeahh... Injecting all the pending Breakpoints!");
-    
-    BreakpointInjector* brkPntInjector;
-    
-    /*
-    if (m_target_desc.m_cpu_arch == CPU_ARCH::AMD64 || m_target_desc.m_cpu_arch == CPU_ARCH::X86) {
-        brkPntInjector = new X86BreakpointInjector();
-    } else if(m_target_desc.m_cpu_arch == CPU_ARCH::ARM32) {
-        brkPntInjector = new ARMBreakpointInjector();
-    } else if(m_target_desc.m_cpu_arch == CPU_ARCH::ARM64) {
-        brkPntInjector = new ARM64BreakpointInjector();
-    }
-    */
+    SPDLOG_LOGGER_TRACE(m_log, "Yeeahh... Injecting all the pending Breakpoints!");
+
+    std::vector<Breakpoint *> brk_batch;
 
-    for (auto pend_iter = m_pending.cbegin(); pend_iter != m_pending.cend();)
+    for (auto pend_iter = m_pending.begin(); pend_iter != m_pending.end();)
     {
         // find the module base address
         std::string mod_name = pend_iter->first;
         auto mod_base_addr = debug_opts.m_procMap.findModuleBaseAddr(mod_name);
 
         // iterate over all the breakpoint for that module
-        // for(auto brkpnt_obj: pend_iter->second) {
-        auto brk_pending_objs = pend_iter->second;
-        while (!brk_pending_objs.empty())
+        for (Breakpoint *brkpnt_obj : pend_iter->second)
         {
-            Breakpoint *brkpnt_obj = brk_pending_objs.back();
-            // brkpnt_obj->setInjector(brkPntInjector);
             uintptr_t brk_addr = mod_base_addr + brkpnt_obj->m_offset;
-            m_log->debug("Setting Brk at addr : 0x{:x}", brk_addr);
+            SPDLOG_LOGGER_DEBUG(m_log, "Setting Brk at addr : 0x{:x}", brk_addr);
             brkpnt_obj->setAddress(brk_addr);
-            brkpnt_obj->enable(traceeProgram);
-            m_log->trace("This is debug stop!");
-            // brkpnt_obj->addPid(debug_opts.getPid());
             m_active_brkpnt[brk_addr] = brkpnt_obj;
-            // auto bb_obj = placeSingleStepBreakpoint(debug_opts, brk_addr + 4);
-            // m_active_brkpnt[brk_addr + 4] = bb_obj.release(); 
-            brk_pending_objs.pop_back();
+            brk_batch.push_back(brkpnt_obj);
+        }
+        pend_iter = m_pending.erase(pend_iter);
+    }
+
+    writeBreakpoints(traceeProgram, brk_batch, true);
+
+    if (!m_hw_pending.empty())
+    {
+        if (m_hw_brkpnt.empty())
+        {
+            m_hw_brkpnt.resize(m_debug_regs->slotCount(traceeProgram.pid()), nullptr);
+        }
+
+        for (HwBreakpoint *hw_brkpnt : m_hw_pending)
+        {
+            int slot = 0;
+            while (slot < static_cast<int>(m_hw_brkpnt.size()) &&
+                   (m_hw_brkpnt[slot] != nullptr || !m_debug_regs->supports(slot, hw_brkpnt->m_hw_type)))
+            {
+                slot++;
+            }
+
+            if (slot == static_cast<int>(m_hw_brkpnt.size()))
+            {
+                m_log->error("No debug register left for {}", hw_brkpnt->m_label.c_str());
+                continue;
+            }
+
+            uintptr_t mod_base_addr = debug_opts.m_procMap.findModuleBaseAddr(hw_brkpnt->m_modname);
+            hw_brkpnt->setAddress(mod_base_addr + hw_brkpnt->m_offset);
+            hw_brkpnt->m_debug_regs = m_debug_regs;
+            hw_brkpnt->m_slot = slot;
+            m_hw_brkpnt[slot] = hw_brkpnt;
+            SPDLOG_LOGGER_DEBUG(m_log, "Hardware breakpoint at addr : 0x{:x} slot {}", hw_brkpnt->m_addr, slot);
+        }
+        m_hw_pending.clear();
+    }
+
+    // debug registers aren't inherited, every new thread is armed here
+    for (HwBreakpoint *hw_brkpnt : m_hw_brkpnt)
+    {
+        if (hw_brkpnt != nullptr && hw_brkpnt->shouldEnable())
+        {
+            hw_brkpnt->enable(traceeProgram);
+        }
+    }
+    SPDLOG_LOGGER_TRACE(m_log, "All breakpoints injected!");
+}
+
+void BreakpointMngr::disarm(TraceeProgram& traceeProgram)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    std::vector<Breakpoint *> brk_batch;
+
+    for (auto& brk_entry : m_active_brkpnt)
+    {
+        if (brk_entry.second->isEnabled())
+            brk_batch.push_back(brk_entry.second);
+    }
+
+    writeBreakpoints(traceeProgram, brk_batch, false);
+
+    for (HwBreakpoint *hw_brkpnt : m_hw_brkpnt)
+    {
+        if (hw_brkpnt != nullptr)
+            hw_brkpnt->disable(traceeProgram);
+    }
+    SPDLOG_LOGGER_TRACE(m_log, "{} breakpoints removed!", brk_batch.size());
+}
+
+void BreakpointMngr::writeBreakpoints(TraceeProgram& traceeProgram, std::vector<Breakpoint*>& brkpnts, bool enable)
+{
+    RemoteMemory& memory = traceeProgram.getDebugOpts().m_memory;
+    const uintptr_t page_mask = ~static_cast<uintptr_t>(BRKPNT_BATCH_PAGE_SIZE - 1);
+    std::vector<uint8_t> code;
+
+    std::sort(brkpnts.begin(), brkpnts.end(), [](Breakpoint *lhs, Breakpoint *rhs) {
+        return lhs->m_addr < rhs->m_addr;
+    });
+
+    size_t first = 0;
+    while (first < brkpnts.size())
+    {
+        // the copy starts at the first breakpoint of the page and ends with
+        // the instruction backup of the last one
+        uintptr_t page_addr = brkpnts[first]->m_addr & page_mask;
+        uintptr_t span_start = brkpnts[first]->m_addr;
+        uintptr_t span_end = span_start;
+        size_t last = first;
+        for (; last < brkpnts.size() && (brkpnts[last]->m_addr & page_mask) == page_addr; last++)
+        {
+            span_end = std::max<uintptr_t>(span_end, brkpnts[last]->m_addr + brkpnts[last]->m_backupData.size());
+        }
+
+        code.resize(span_end - span_start);
+        ssize_t ret = memory.readRemote(span_start, code.data(), code.size());
+        if (ret != static_cast<ssize_t>(code.size()))
+        {
+            // the backup of the last breakpoint runs into a page which
+            // can't be read, let the injector deal with each of them
+            SPDLOG_LOGGER_DEBUG(m_log, "Can't batch breakpoints of page 0x{:x}", page_addr);
+            for (size_t idx = first; idx < last; idx++)
+            {
+                if (enable)
+                    brkpnts[idx]->enable(traceeProgram);
+                else
+                    brkpnts[idx]->disable(traceeProgram);
+            }
+        }
+        else
+        {
+            for (size_t idx = first; idx < last; idx++)
+            {
+                uint8_t *brk_code = code.data() + (brkpnts[idx]->m_addr - span_start);
+                if (enable)
+                    brkpnts[idx]->enableInBuffer(traceeProgram, brk_code);
+                else
+                    brkpnts[idx]->disableInBuffer(traceeProgram, brk_code);
+            }
+            if (memory.writeRemote(span_start, code.data(), code.size()) != static_cast<ssize_t>(code.size()))
+            {
+                m_log->error("Failed to write breakpoints of page 0x{:x}", page_addr);
+            }
         }
-        pend_iter = m_pending.erase(pend_iter); // or "it = m.erase(it)" since C++11
+        first = last;
     }
-    m_log->trace("All breakpoints injected!");
 }
 
 Breakpoint* BreakpointMngr::getBreakpointObj(uintptr_t bk_addr)
 {
-    auto brk_pnt_iter = m_active_brkpnt.find(bk_addr);
-    if (brk_pnt_iter != m_active_brkpnt.end())
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    Breakpoint** brk_obj = m_active_brkpnt.find(bk_addr);
+    if (brk_obj != nullptr)
     {
         // breakpoint is found, its under over management
-        auto brk_obj = brk_pnt_iter->second;
-        return brk_obj;
+        return *brk_obj;
     }
     else
     {
@@ -122,12 +238,12 @@ Breakpoint* BreakpointMngr::getBreakpointObj(uintptr_t bk_addr)
 
 void BreakpointMngr::restoreSuspendedBreakpoint(TraceeProgram& traceeProgram)
 {
-    DebugOpts& debug_opts = traceeProgram.getDebugOpts();
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
 
-    m_log->debug("Restoring breakpoint and resuming execution!");
+    SPDLOG_LOGGER_DEBUG(m_log, "Restoring breakpoint and resuming execution!");
 #if defined(SUPPORT_ARCH_ARM)
     if(traceeProgram.m_single_step_brkpnt) {
-        m_log->trace("Remove temp Single Step breakpoints");
+        SPDLOG_LOGGER_TRACE(m_log, "Remove temp Single Step breakpoints");
         // additional step over logic required on case of ARM architecture 
         std::unique_ptr<BranchData> branch_info_brkpt = std::move(traceeProgram.m_single_step_brkpnt);
         branch_info_brkpt->m_target_brkpt->disable(traceeProgram);
@@ -137,36 +253,53 @@ void BreakpointMngr::restoreSuspendedBreakpoint(TraceeProgram& traceeProgram)
     }
 #endif
 
-    auto sus_bkpt_iter = m_suspendedBrkPnt.find(debug_opts.m_pid);
-    if (sus_bkpt_iter != m_suspendedBrkPnt.end()) {
-        // tracee is found, its under over management
-        auto suspend_bkpt_obj = sus_bkpt_iter->second;
+    for (HwBreakpoint* hw_brkpnt : traceeProgram.m_suspended_hw_brkpnt) {
+        if (!hw_brkpnt->m_retired && hw_brkpnt->shouldEnable()) {
+            hw_brkpnt->enable(traceeProgram);
+        }
+    }
+    traceeProgram.m_suspended_hw_brkpnt.clear();
 
-        if (suspend_bkpt_obj->shouldEnable()) {
+    Breakpoint* suspend_bkpt_obj = traceeProgram.m_suspended_brkpnt;
+    if (suspend_bkpt_obj != nullptr) {
+
+        auto step_iter = m_step_overs.find(suspend_bkpt_obj->m_addr);
+        if (step_iter != m_step_overs.end() && --step_iter->second > 0) {
+            // a thread of another shard is still executing the original
+            // instruction, it puts the breakpoint back when it is done
+            SPDLOG_LOGGER_TRACE(m_log, "Breakpoint at addr {:x} is still stepped over", suspend_bkpt_obj->m_addr);
+        } else if (suspend_bkpt_obj->shouldEnable()) {
             suspend_bkpt_obj->enable(traceeProgram);
-            m_log->trace("Breakpoint restored at addr {:x}", suspend_bkpt_obj->m_addr);
+            SPDLOG_LOGGER_TRACE(m_log, "Breakpoint restored at addr {:x}", suspend_bkpt_obj->m_addr);
         } else {
-            m_log->trace("Not restoring");
+            SPDLOG_LOGGER_TRACE(m_log, "Not restoring");
             // although we don't need breakpoint object we are not deleting 
             // it that because it will be later used to summarize 
             // execution information
         }
-        m_suspendedBrkPnt.erase(debug_opts.m_pid);
+        if (step_iter != m_step_overs.end() && step_iter->second == 0) {
+            m_step_overs.erase(step_iter);
+        }
+        traceeProgram.m_suspended_brkpnt = nullptr;
     } else {
-        m_log->info("No suspended breakpoint found!");
-        auto suspend_bkpt_obj = nullptr;
+        SPDLOG_LOGGER_INFO(m_log, "No suspended breakpoint found!");
     }
 }
 
+bool BreakpointMngr::hasSuspendedBrkPnt(TraceeProgram& traceeProgram)
+{
+    return traceeProgram.m_suspended_brkpnt != nullptr || !traceeProgram.m_suspended_hw_brkpnt.empty();
+}
+
 BreakpointPtr BreakpointMngr::handleBreakpointHit(TraceeProgram& traceeProgram, uintptr_t brk_addr)
 {
-    DebugOpts& debug_opts = traceeProgram.getDebugOpts();
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
     // PC points to the next instruction after execution
-    m_log->trace("Breakpoint Hit! addr 0x{:x}", brk_addr);
+    SPDLOG_LOGGER_TRACE(m_log, "Breakpoint Hit! addr 0x{:x}", brk_addr);
     // find the breakpoint object for further processing
     BreakpointPtr brk_obj = getBreakpointObj(brk_addr);
     if (brk_obj == nullptr) {
-        m_log->trace("No Breakpoint Handler found!");
+        SPDLOG_LOGGER_TRACE(m_log, "No Breakpoint Handler found!");
         exit(-1);
         return nullptr;
     }
@@ -174,7 +307,8 @@ BreakpointPtr BreakpointMngr::handleBreakpointHit(TraceeProgram& traceeProgram,
     if(brk_obj->shouldEnable()) {
         // store the object to restore after the breakpoint
         // stepover is done
-        m_suspendedBrkPnt[debug_opts.m_pid] = brk_obj;
+        traceeProgram.m_suspended_brkpnt = brk_obj;
+        m_step_overs[brk_addr]++;
     }
 
     // the actual breakpoint handling logic
@@ -186,10 +320,261 @@ BreakpointPtr BreakpointMngr::handleBreakpointHit(TraceeProgram& traceeProgram,
     return brk_obj;
 }
 
+bool BreakpointMngr::handleHwBreakpointHit(TraceeProgram& traceeProgram)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    int slot = m_debug_regs->hitSlot(traceeProgram.pid());
+    if (slot < 0 || slot >= static_cast<int>(m_hw_brkpnt.size()) || m_hw_brkpnt[slot] == nullptr) {
+        m_log->error("No hardware breakpoint found for the trap of {}", traceeProgram.pid());
+        return true;
+    }
+
+    HwBreakpoint* hw_brkpnt = m_hw_brkpnt[slot];
+    disarmRetiredHw(traceeProgram);
+    if (hw_brkpnt->m_retired) {
+        // the thread was still armed when the last hit happened elsewhere
+        SPDLOG_LOGGER_TRACE(m_log, "Retired hardware breakpoint 0x{:x} hit by {}", hw_brkpnt->m_addr, traceeProgram.pid());
+        return true;
+    }
+
+    SPDLOG_LOGGER_TRACE(m_log, "Hardware breakpoint Hit! addr 0x{:x}", hw_brkpnt->m_addr);
+    hw_brkpnt->handle(traceeProgram);
+
+    if (!hw_brkpnt->shouldEnable()) {
+        // last hit, the other threads are disarmed when they stop
+        hw_brkpnt->disable(traceeProgram);
+        hw_brkpnt->m_retired = true;
+        m_hw_retiring++;
+        releaseHwSlot(hw_brkpnt);
+        return true;
+    }
+
+    if (archResumeOverHwBreakpoint(traceeProgram.m_target_desc.m_cpu_arch,
+            traceeProgram.getDebugOpts().m_register, hw_brkpnt->m_hw_type)) {
+        return true;
+    }
+
+    // armed again by restoreSuspendedBreakpoint after the step over
+    traceeProgram.m_suspended_hw_brkpnt.push_back(hw_brkpnt);
+    hw_brkpnt->disable(traceeProgram);
+    return false;
+}
+
+void BreakpointMngr::releaseHwSlot(HwBreakpoint* hw_brkpnt)
+{
+    if (!hw_brkpnt->m_retired || hw_brkpnt->armedAnywhere() || hw_brkpnt->m_slot < 0) {
+        return;
+    }
+
+    SPDLOG_LOGGER_DEBUG(m_log, "Releasing slot {} of hardware breakpoint 0x{:x}", hw_brkpnt->m_slot, hw_brkpnt->m_addr);
+    m_hw_brkpnt[hw_brkpnt->m_slot] = nullptr;
+    hw_brkpnt->m_slot = -1;
+    m_hw_retiring--;
+}
+
+void BreakpointMngr::disarmRetiredHw(TraceeProgram& traceeProgram)
+{
+    if (m_hw_retiring.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    for (HwBreakpoint* hw_brkpnt : m_hw_brkpnt) {
+        if (hw_brkpnt != nullptr && hw_brkpnt->m_retired && hw_brkpnt->armedIn(traceeProgram.pid())) {
+            hw_brkpnt->disable(traceeProgram);
+            releaseHwSlot(hw_brkpnt);
+        }
+    }
+}
+
+void BreakpointMngr::dropHwThread(TraceeProgram& traceeProgram)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    traceeProgram.m_suspended_hw_brkpnt.clear();
+    for (HwBreakpoint* hw_brkpnt : m_hw_brkpnt) {
+        if (hw_brkpnt != nullptr) {
+            hw_brkpnt->forgetThread(traceeProgram.pid());
+            releaseHwSlot(hw_brkpnt);
+        }
+    }
+}
+
+bool BreakpointMngr::retireBreakpoint(TraceeProgram& traceeProgram, uintptr_t brk_addr)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    Breakpoint** brk_iter = m_active_brkpnt.find(brk_addr);
+    if (brk_iter == nullptr) {
+        return false;
+    }
+    // copied, handle() may add breakpoints and move the map storage
+    Breakpoint* brk_obj = *brk_iter;
+
+    if (brk_obj->shouldEnable()) {
+        return false;
+    }
+
+    std::set<uintptr_t>& retired_addrs = m_retired_addrs[traceeProgram.tid()];
+    if (retired_addrs.count(brk_addr) > 0) {
+        // another thread of the process hit it first, it was handled
+        // already. The code may even be restored by now if this stop was
+        // reaped late, the thread is only rewound and resumed
+        return true;
+    }
+
+    brk_obj->handle(traceeProgram);
+    m_retired_brkpnt[traceeProgram.tid()].push_back(brk_obj);
+    retired_addrs.insert(brk_addr);
+    return true;
+}
+
+void BreakpointMngr::restoreRetiredBreakpoints(TraceeProgram& traceeProgram)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    auto retired_iter = m_retired_brkpnt.find(traceeProgram.tid());
+    if (retired_iter == m_retired_brkpnt.end()) {
+        return;
+    }
+
+    SPDLOG_LOGGER_TRACE(m_log, "Restoring {} retired breakpoints", retired_iter->second.size());
+    writeBreakpoints(traceeProgram, retired_iter->second, false);
+    m_retired_brkpnt.erase(retired_iter);
+}
+
+void BreakpointMngr::enableDisplacedStepping()
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    if (m_displaced_stepper == nullptr) {
+        m_displaced_stepper = new TargetArch::Stepper();
+    }
+}
+
+DisplacedStepResult BreakpointMngr::displacedStepOver(TraceeProgram& traceeProgram, uintptr_t brk_addr, int& exit_status)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    if (m_displaced_stepper == nullptr || m_displaced_stepper->slotSize() == 0) {
+        return DisplacedStepResult::UNSUPPORTED;
+    }
+
+    BreakpointPtr brk_obj = getBreakpointObj(brk_addr);
+    if (brk_obj == nullptr || !m_displaced_stepper->canStepOver(traceeProgram, *brk_obj)) {
+        return DisplacedStepResult::UNSUPPORTED;
+    }
+
+    auto pad_iter = m_scratch_pads.find(traceeProgram.tid());
+    if (pad_iter == m_scratch_pads.end()) {
+        uintptr_t scratch_addr = m_displaced_stepper->allocateScratch(traceeProgram, SCRATCH_PAD_SIZE, exit_status);
+        if (exit_status != -1) {
+            // nothing left to step over, another thread of the process
+            // may still allocate the pad
+            return DisplacedStepResult::EXITED;
+        }
+        // a failed allocation is kept as an empty pad, it isn't retried on
+        // every hit
+        ScratchPad scratch_pad;
+        if (scratch_addr != 0) {
+            scratch_pad = ScratchPad(scratch_addr, m_displaced_stepper->slotSize());
+        }
+        pad_iter = m_scratch_pads.insert(std::make_pair(traceeProgram.tid(), scratch_pad)).first;
+    }
+
+    ScratchSlot* slot = pad_iter->second.slotFor(traceeProgram.pid());
+    if (slot == nullptr) {
+        return DisplacedStepResult::UNSUPPORTED;
+    }
+
+    // the handler already ran when the Tracee was moved back on the
+    // breakpoint by leaveScratchSlot, the signal handler may hit other
+    // breakpoints before it gets there
+    if (slot->m_rewound == brk_addr) {
+        slot->m_rewound = 0;
+    } else {
+        // the actual breakpoint handling logic
+        brk_obj->handle(traceeProgram);
+    }
+
+    if (!brk_obj->shouldEnable()) {
+        // last hit, the original instruction is put back and executed in place
+        brk_obj->disable(traceeProgram);
+        archSetProgramCounter(traceeProgram.m_target_desc.m_cpu_arch, traceeProgram.getDebugOpts().m_register, brk_addr);
+        return DisplacedStepResult::RESUMED;
+    }
+
+    return m_displaced_stepper->stepOver(traceeProgram, *brk_obj, *slot);
+}
+
+void BreakpointMngr::leaveScratchSlot(TraceeProgram& traceeProgram)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    if (m_displaced_stepper == nullptr) {
+        return;
+    }
+
+    auto pad_iter = m_scratch_pads.find(traceeProgram.tid());
+    if (pad_iter == m_scratch_pads.end()) {
+        return;
+    }
+
+    ScratchSlot* slot = pad_iter->second.findSlot(traceeProgram.pid());
+    if (slot != nullptr && m_displaced_stepper->leaveSlot(traceeProgram, *slot)) {
+        slot->m_rewound = slot->m_brk_addr;
+    }
+}
+
+void BreakpointMngr::releaseScratchSlot(TraceeProgram& traceeProgram)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    auto pad_iter = m_scratch_pads.find(traceeProgram.tid());
+    if (pad_iter == m_scratch_pads.end()) {
+        return;
+    }
+
+    ScratchPad& scratch_pad = pad_iter->second;
+    scratch_pad.release(traceeProgram.pid());
+    if (traceeProgram.pid() == traceeProgram.tid()) {
+        scratch_pad.m_leader_gone = true;
+    }
+
+    // the leader may have left with pthread_exit, the pad is only dropped
+    // once no thread runs in it anymore
+    if (scratch_pad.m_leader_gone && !scratch_pad.inUse()) {
+        m_scratch_pads.erase(pad_iter);
+    }
+}
+
+void BreakpointMngr::dropSuspendedBreakpoint(TraceeProgram& traceeProgram)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    Breakpoint* suspend_bkpt_obj = traceeProgram.m_suspended_brkpnt;
+    if (suspend_bkpt_obj == nullptr) {
+        return;
+    }
+
+    auto step_iter = m_step_overs.find(suspend_bkpt_obj->m_addr);
+    if (step_iter != m_step_overs.end() && --step_iter->second == 0) {
+        m_step_overs.erase(step_iter);
+    }
+    traceeProgram.m_suspended_brkpnt = nullptr;
+}
+
+void BreakpointMngr::dropScratchPad(TraceeProgram& traceeProgram)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    m_scratch_pads.erase(traceeProgram.tid());
+    dropRetiredBreakpoints(traceeProgram.tid());
+}
+
+void BreakpointMngr::dropRetiredBreakpoints(pid_t tgid)
+{
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
+    m_retired_brkpnt.erase(tgid);
+    m_retired_addrs.erase(tgid);
+}
+
 void BreakpointMngr::printStats()
 {
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
     uint64_t bkpt_count = 0, bkpt_total = 0, brk_pt_exec_cnt = 0;
-    m_log->info("------[ Breakpoint Stats ]-----");
+    SPDLOG_LOGGER_INFO(m_log, "------[ Breakpoint Stats ]-----");
     for (auto i = m_active_brkpnt.begin(); i != m_active_brkpnt.end(); i++)
     {
         auto brk_pt = i->second;
@@ -200,19 +585,21 @@ void BreakpointMngr::printStats()
         }
         // m_log->info("{} {}", brk_pt->m_label.c_str(), brk_pt->getHitCount());
     }
-    m_log->info("Number Of Breakpoint Hits : {}/{}", bkpt_count, bkpt_total);
-    m_log->info("Total Breakpoint Hits     : {}", brk_pt_exec_cnt);
-    m_log->info("[------------------------------");
+    SPDLOG_LOGGER_INFO(m_log, "Number Of Breakpoint Hits : {}/{}", bkpt_count, bkpt_total);
+    SPDLOG_LOGGER_INFO(m_log, "Total Breakpoint Hits     : {}", brk_pt_exec_cnt);
+    SPDLOG_LOGGER_INFO(m_log, "[------------------------------");
 };
 
 void BreakpointMngr::placeSingleStepBreakpoint(uintptr_t brkpt_hit_addr, TraceeProgram& traceeProgram) {
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
 
     DebugOpts& debug_opts = traceeProgram.getDebugOpts();
-    auto branch_info_iter = m_branch_info_cache.find(brkpt_hit_addr);
+    std::unique_ptr<BranchData>* cached_branch_info = m_branch_info_cache.find(brkpt_hit_addr);
     
-    if (branch_info_iter != m_branch_info_cache.end()) {
+    // empty while another thread is stepping over the same address
+    if (cached_branch_info != nullptr && *cached_branch_info) {
         // tracee is found, its under over management
-        std::unique_ptr<BranchData> ss_branch_info = std::move(branch_info_iter->second);
+        std::unique_ptr<BranchData> ss_branch_info = std::move(*cached_branch_info);
         
         if(ss_branch_info->isConditional()) {
             /**
@@ -222,9 +609,8 @@ void BreakpointMngr::placeSingleStepBreakpoint(uintptr_t brkpt_hit_addr, TraceeP
              */
             ss_branch_info->m_target = 0;
             ss_branch_info->m_fall_target = 0;
-            AddrPtr inst_data = debug_opts.m_memory.readPointerObj(brkpt_hit_addr, 4);
-            m_arm_disasm->getBranchInfo(inst_data->data(), *ss_branch_info, debug_opts);
-            delete inst_data;
+            AddrView inst_data = debug_opts.m_memory.readView(brkpt_hit_addr, 4);
+            m_arm_disasm->getBranchInfo(inst_data.data(), *ss_branch_info, debug_opts);
             ss_branch_info->m_target_brkpt->setAddress(ss_branch_info->m_target);
             if(ss_branch_info->m_fall_target) {
                 if(ss_branch_info->m_fall_target_brkpt == nullptr) {
@@ -241,33 +627,32 @@ void BreakpointMngr::placeSingleStepBreakpoint(uintptr_t brkpt_hit_addr, TraceeP
         // of the to execute and then restore at those orginal breakpoint
         // from that location
         ss_branch_info->m_target_brkpt->enable(traceeProgram);
-        m_log->debug("Target breakpoint at 0x{:x}", ss_branch_info->m_target);
+        SPDLOG_LOGGER_DEBUG(m_log, "Target breakpoint at 0x{:x}", ss_branch_info->m_target);
         if(ss_branch_info->m_fall_target) {
-            m_log->debug("Fall through breakpoint at 0x{:x}", ss_branch_info->m_fall_target);
+            SPDLOG_LOGGER_DEBUG(m_log, "Fall through breakpoint at 0x{:x}", ss_branch_info->m_fall_target);
             ss_branch_info->m_fall_target_brkpt->enable(traceeProgram);
         }
         traceeProgram.m_single_step_brkpnt = std::move(ss_branch_info);
     } else {
 
-        m_log->info("No Branch data found!");
+        SPDLOG_LOGGER_INFO(m_log, "No Branch data found!");
         
         // we are encounter the breakpoint address for the first time we need to
         // calculate the branch destination
         std::unique_ptr<BranchData> branch_info(new BranchData(brkpt_hit_addr));
         // we need this instruction data in case we are in computed target instruction
         // and we need to emulate the instruction everytime.
-        AddrPtr inst_data = debug_opts.m_memory.readPointerObj(brkpt_hit_addr, 4);
-        m_arm_disasm->getBranchInfo(inst_data->data(), *branch_info, debug_opts);
+        AddrView inst_data = debug_opts.m_memory.readView(brkpt_hit_addr, 4);
+        m_arm_disasm->getBranchInfo(inst_data.data(), *branch_info, debug_opts);
         // branch_info->print();
-        delete inst_data;
-        m_log->debug("Target breakpoint at 0x{:x}", branch_info->m_target);
+        SPDLOG_LOGGER_DEBUG(m_log, "Target breakpoint at 0x{:x}", branch_info->m_target);
         std::unique_ptr<Breakpoint> targetBranchBkpt(new Breakpoint(*new std::string("single-stop-target"), 0));
         // targetBranchBkpt->setInjector(new ARMBreakpointInjector());
         targetBranchBkpt->makeSingleStep(branch_info->m_target);
         targetBranchBkpt->enable(traceeProgram);
         branch_info->m_target_brkpt = std::move(targetBranchBkpt);
         if(branch_info->m_fall_target) {
-            m_log->debug("Fall through breakpoint at 0x{:x}", branch_info->m_fall_target);
+            SPDLOG_LOGGER_DEBUG(m_log, "Fall through breakpoint at 0x{:x}", branch_info->m_fall_target);
             std::unique_ptr<Breakpoint> targetFallBranchBkpt(new Breakpoint(*new std::string("single-stop-fall-target"), 0));
             targetFallBranchBkpt->makeSingleStep(branch_info->m_fall_target);
             targetFallBranchBkpt->enable(traceeProgram);
@@ -19,6 +19,7 @@ CoverageTraceWriter::CoverageTraceWriter(uint64_t pipe_id) {
 
 void CoverageTraceWriter::write_module_info()
 {
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
     uint16_t mod_id = 0;
     uint16_t rec_type = static_cast<uint16_t>(CoverageRecordType::MODULE);
     for (std::string &mod_name : m_module_names)
@@ -46,6 +47,7 @@ void CoverageTraceWriter::write_module_info()
 
 uint16_t CoverageTraceWriter::add_module(std::string module_name, uint64_t base_addr)
 {
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
     m_module_names.push_back(module_name);
     m_module_id_map[module_name] = m_mod_curr_id;
     update_module_base_addr(module_name, base_addr);
@@ -55,6 +57,7 @@ uint16_t CoverageTraceWriter::add_module(std::string module_name, uint64_t base_
 
 void CoverageTraceWriter::record_cov(pid_t tracee_pid, uint16_t module_id, uint64_t execution_addr)
 {
+    std::lock_guard<std::recursive_mutex> guard(m_lock);
     uint16_t rec_type = static_cast<uint16_t>(CoverageRecordType::BASIC_BLOCK);
 
     uint32_t exec_offset = (execution_addr - m_module_map[module_id]) & 0xFFFFFFFF;
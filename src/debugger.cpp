@@ -1,12 +1,13 @@
-#include <set>
 // We have to make raw syscall to stop threads
 #include <sys/syscall.h> 
 #include <signal.h>
+#include <algorithm>
 
 #include "debugger.hpp"
 #include "modules.hpp"
 #include "tracee.hpp"
 #include "syscall_injector.hpp"
+#include "arch_traits.hpp"
 #include "config.hpp"
 
 Debugger::Debugger(TargetDescription &_target_desc)
@@ -18,6 +19,111 @@ Debugger::Debugger(TargetDescription &_target_desc)
 	m_syscall_injector = new SyscallInjector();
 }
 
+Debugger &Debugger::useEventPoller()
+{
+	if (m_event_poller == nullptr)
+	{
+		m_event_poller = new EventPoller();
+		for (auto &tracee : m_tracees)
+		{
+			m_event_poller->watchProcess(tracee.first);
+		}
+	}
+	return *this;
+}
+
+int Debugger::addFdWatch(int fd, uint32_t events, EventPoller::FdCallback callback)
+{
+	useEventPoller();
+	return m_event_poller->addFdWatch(fd, events, callback);
+}
+
+int Debugger::removeFdWatch(int fd)
+{
+	if (m_event_poller == nullptr)
+	{
+		return -1;
+	}
+	return m_event_poller->removeFdWatch(fd);
+}
+
+int Debugger::addTimer(uint64_t interval_ms, EventPoller::TimerCallback callback, bool periodic)
+{
+	useEventPoller();
+	return m_event_poller->addTimer(interval_ms, callback, periodic);
+}
+
+int Debugger::removeTimer(int timer_id)
+{
+	if (m_event_poller == nullptr)
+	{
+		return -1;
+	}
+	return m_event_poller->removeTimer(timer_id);
+}
+
+int Debugger::waitTraceeEvent(int *wait_status)
+{
+	if (m_event_poller == nullptr || !m_event_poller->valid())
+	{
+		return waitpid(-1, wait_status, m_wait_options);
+	}
+
+	while (true)
+	{
+		int ret_wait = waitpid(-1, wait_status, m_wait_options | WNOHANG);
+		if (ret_wait != 0)
+		{
+			// a busy Tracee always has an event to reap, the descriptors
+			// and timers would starve behind it
+			if (ret_wait > 0 && ++m_reaped_since_poll >= EVENT_POLLER_REAP_BATCH)
+			{
+				m_reaped_since_poll = 0;
+				m_event_poller->poll(0);
+			}
+			return ret_wait;
+		}
+		// SIGCHLD stays pending while blocked, an event reported after
+		// the waitpid above still wakes up the poll
+		m_reaped_since_poll = 0;
+		if (m_event_poller->poll() < 0)
+		{
+			return -1;
+		}
+	}
+}
+
+void Debugger::resumeRetiredTracees()
+{
+	// the first Tracee of a process writes the breakpoints of all of them
+	for (pid_t tracee_pid : m_retired_tracees)
+	{
+		TraceeProgram *tracee_prog = m_tracees.find(tracee_pid);
+		if (tracee_prog != nullptr)
+		{
+			m_breakpointMngr->restoreRetiredBreakpoints(*tracee_prog);
+		}
+	}
+
+	for (pid_t tracee_pid : m_retired_tracees)
+	{
+		TraceeProgram *tracee_prog = m_tracees.find(tracee_pid);
+		if (tracee_prog != nullptr)
+		{
+			tracee_prog->contExecution(0);
+		}
+	}
+	m_retired_tracees.clear();
+	m_retired_events = 0;
+}
+
+void Debugger::dropRetiredTracee(pid_t tracee_pid)
+{
+	m_retired_tracees.erase(
+		std::remove(m_retired_tracees.begin(), m_retired_tracees.end(), tracee_pid),
+		m_retired_tracees.end());
+}
+
 void Debugger::addBreakpoint(std::vector<std::string> &_brk_pnt_str)
 {
 	for (auto brk_pnt : _brk_pnt_str)
@@ -28,6 +134,12 @@ void Debugger::addBreakpoint(std::vector<std::string> &_brk_pnt_str)
 
 DebugResult Debugger::spawn(std::vector<std::string> &cmdline)
 {
+	if (!TraceeFactory::isSupported(m_target_desc.m_cpu_arch))
+	{
+		m_log->error("Target architecture is not enabled in config.hpp");
+		return DebugResult::ErrArchitecture;
+	}
+
 	// covert cmdline arguments to exev parameter type
 	std::vector<const char *> args;
 
@@ -43,7 +155,7 @@ DebugResult Debugger::spawn(std::vector<std::string> &cmdline)
 	// remove the program path argument list
 	// cmdline.erase(cmdline.begin());
 	m_argv = &cmdline;
-	m_log->info("Spawning new process : {}", m_prog->c_str());
+	SPDLOG_LOGGER_INFO(m_log, "Spawning new process : {}", m_prog->c_str());
 	pid_t childPid = fork();
 
 	if (childPid == -1)
@@ -65,6 +177,13 @@ DebugResult Debugger::spawn(std::vector<std::string> &cmdline)
 			return DebugResult::ErrAttachingPtrace;
 		}
 
+		// the EventPoller blocks SIGCHLD in the tracer, the program must
+		// not inherit the mask
+		sigset_t child_mask;
+		sigemptyset(&child_mask);
+		sigaddset(&child_mask, SIGCHLD);
+		sigprocmask(SIG_UNBLOCK, &child_mask, nullptr);
+
 		int status_code = execvp(args[0], const_cast<char *const *>(args.data()));
 
 		if (status_code == -1)
@@ -78,7 +197,7 @@ DebugResult Debugger::spawn(std::vector<std::string> &cmdline)
 		return DebugResult::Success;
 	}
 
-	m_log->debug("New Child spawed with PID {}", childPid);
+	SPDLOG_LOGGER_DEBUG(m_log, "New Child spawed with PID {}", childPid);
 
 	m_leader_tracee = addChildTracee(childPid);
 
@@ -94,35 +213,163 @@ TraceeProgram *Debugger::addChildTracee(pid_t child_tracee_pid)
 	}
 	else
 	{
-		m_log->debug("New child {} is added to tracee list!", child_tracee_pid);
+		SPDLOG_LOGGER_DEBUG(m_log, "New child {} is added to tracee list!", child_tracee_pid);
 		auto trace_flag = DebugType::DEFAULT;
 		if (m_traceSyscall)
 		{
 			trace_flag = DebugType::TRACE_SYSCALL;
 		}
 		auto tracee_obj = m_tracee_factory->createTracee(child_tracee_pid, trace_flag, m_target_desc);
+		if (tracee_obj == nullptr)
+		{
+			m_log->error("Failed to create the tracee for child {}", child_tracee_pid);
+			return nullptr;
+		}
 		// tracee_obj->setDebugger(this);
 
 		if (m_followFork)
 			tracee_obj->followFork();
 
+		tracee_obj->getDebugOpts().m_memory.setBackend(m_memBackend);
+
+		if (m_pageCache)
+		{
+			// text pages can only be kept across stops if we get to see
+			// the syscalls which can remap them
+			tracee_obj->getDebugOpts().m_memory.enablePageCache(PAGE_CACHE_DEFAULT_PAGES, m_traceSyscall);
+		}
+
 		// tracee_obj->addPendingBrkPnt(brk_pnt_str);
 
-		m_tracees.insert(std::make_pair(child_tracee_pid, tracee_obj));
+		m_tracees.insert(child_tracee_pid, tracee_obj);
+		if (m_recorder != nullptr)
+		{
+			m_recorder->record(TraceRecordType::TRACEE_ADDED, child_tracee_pid);
+		}
+		if (m_event_poller != nullptr)
+		{
+			m_event_poller->watchProcess(child_tracee_pid);
+		}
 		return tracee_obj;
 	}
 }
 
 void Debugger::dropChildTracee(TraceeProgram *child_tracee)
 {
-	m_log->debug("Dropping child tracee PID : {}", child_tracee->pid());
+	SPDLOG_LOGGER_DEBUG(m_log, "Dropping child tracee PID : {}", child_tracee->pid());
+	const RegisterCacheStats &reg_stats = child_tracee->getDebugOpts().m_register.cacheStats();
+	SPDLOG_LOGGER_DEBUG(m_log, "Register cache : GETREGSET {} (saved {}) SETREGSET {} (saved {})",
+		reg_stats.fetch_calls, reg_stats.fetch_saved, reg_stats.update_calls, reg_stats.update_saved);
+	if (m_event_poller != nullptr)
+	{
+		m_event_poller->unwatchProcess(child_tracee->pid());
+	}
+	if (m_recorder != nullptr)
+	{
+		m_recorder->record(TraceRecordType::TRACEE_DROPPED, child_tracee->pid());
+	}
+	if (m_breakpointMngr != nullptr)
+	{
+		m_breakpointMngr->releaseScratchSlot(*child_tracee);
+		m_breakpointMngr->dropSuspendedBreakpoint(*child_tracee);
+		m_breakpointMngr->dropHwThread(*child_tracee);
+	}
+	dropRetiredTracee(child_tracee->pid());
 	m_tracees.erase(child_tracee->pid());
+	if (child_tracee->pid() == child_tracee->tid())
+	{
+		// the leader is reported last, the descriptors are closed
+		m_syscallMngr->dropProcess(child_tracee->tid());
+	}
+	if (m_breakpointMngr != nullptr)
+	{
+		// the process is gone with its leader or its last thread, the
+		// id can be reused
+		bool process_gone = child_tracee->pid() == child_tracee->tid();
+		if (!process_gone)
+		{
+			process_gone = true;
+			for (auto &tracee : m_tracees)
+			{
+				if (tracee.second->tid() == child_tracee->tid())
+				{
+					process_gone = false;
+					break;
+				}
+			}
+		}
+		if (process_gone)
+		{
+			m_breakpointMngr->dropRetiredBreakpoints(child_tracee->tid());
+		}
+	}
 	m_tracee_factory->releaseTracee(child_tracee);
 }
 
+void Debugger::adoptHeldEvent(TraceeProgram *child_tracee, DebugEventQueue &pending_events)
+{
+	auto held_iter = m_held_events.find(child_tracee->pid());
+	if (held_iter == m_held_events.end())
+	{
+		return;
+	}
+
+	SPDLOG_LOGGER_DEBUG(m_log, "Adopting the early event of child {}", child_tracee->pid());
+	DebugEventPtr held_event = std::move(held_iter->second);
+	m_held_events.erase(held_iter);
+	m_held_order.erase(
+		std::remove(m_held_order.begin(), m_held_order.end(), child_tracee->pid()),
+		m_held_order.end());
+	getTrapReason(held_event, child_tracee);
+	pending_events.push(std::move(held_event));
+}
+
+void Debugger::finishStepOver(TraceeProgram *tracee_prog, SteppingBreakpoints &active_breakpoint, DebugEventQueue &pending_events)
+{
+	m_breakpointMngr->restoreSuspendedBreakpoint(*tracee_prog);
+	DebugEventQueue *waiting_events = active_breakpoint.release(tracee_prog->m_brkpnt_addr);
+	SPDLOG_LOGGER_INFO(m_log, "Breakpoint handled 0x{:x}", tracee_prog->m_brkpnt_addr);
+
+	if (waiting_events != nullptr)
+	{
+		// Once we have handled this breakpoint we want to see if there
+		// is another thread which has been block because of same breakpoint
+		// in that case de-queue the event and put it in the active process queue
+		// move the event from per-thread pending queue to the queue
+		// which will start processing the event
+		SPDLOG_LOGGER_DEBUG(m_log, "We have pending breakpoint to process!");
+		pending_events.push(waiting_events->pop());
+		active_breakpoint.compact(tracee_prog->m_brkpnt_addr);
+	}
+	tracee_prog->m_brkpnt_addr = 0;
+	tracee_prog->m_active_brkpnt = nullptr;
+}
+
+void Debugger::holdEvent(DebugEventPtr &debug_event)
+{
+	pid_t held_pid = debug_event->m_pid;
+	if (m_held_events.count(held_pid) > 0)
+	{
+		m_log->warn("Dropping the previous held event of {}", held_pid);
+		m_held_order.erase(
+			std::remove(m_held_order.begin(), m_held_order.end(), held_pid),
+			m_held_order.end());
+	}
+	else if (m_held_order.size() >= HELD_EVENTS_MAX)
+	{
+		// nobody has claimed this pid for a long time, it isn't a child
+		// of a Tracee
+		m_log->warn("Dropping the held event of unknown pid {}", m_held_order.front());
+		m_held_events.erase(m_held_order.front());
+		m_held_order.erase(m_held_order.begin());
+	}
+	m_held_events[held_pid] = std::move(debug_event);
+	m_held_order.push_back(held_pid);
+}
+
 void Debugger::printAllTraceesInfo()
 {
-	m_log->debug("Tracee state : ");
+	SPDLOG_LOGGER_DEBUG(m_log, "Tracee state : ");
 	TraceeProgram *tc_info = nullptr;
 	for (auto i = m_tracees.begin(); i != m_tracees.end(); i++)
 	{
@@ -140,13 +387,13 @@ bool Debugger::isBreakpointTrap(siginfo_t *info)
 	{
 	// one of these will be set if a breakpoint was hit
 	case SI_KERNEL:
-		m_log->trace("Breakpoint TRAP : KERNEL");
+		SPDLOG_LOGGER_TRACE(m_log, "Breakpoint TRAP : KERNEL");
 	case TRAP_BRKPT:
-		m_log->trace("Breakpoint TRAP : Software");
+		SPDLOG_LOGGER_TRACE(m_log, "Breakpoint TRAP : Software");
 		return true;
 	case TRAP_TRACE:
 		// this will be set if the signal was sent by single stepping
-		m_log->trace("Breakpoint : TRAP_TRACE, possibly due to single stepping!");
+		SPDLOG_LOGGER_TRACE(m_log, "Breakpoint : TRAP_TRACE, possibly due to single stepping!");
 		return true;
 	default:
 		m_log->error("Unknown SIGTRAP code {}", info->si_code);
@@ -172,7 +419,7 @@ void Debugger::getTrapReason(DebugEventPtr &debug_event, TraceeProgram *tracee_i
 	{
 		if (PT_IF_CLONE(event.stopped.status))
 		{
-			m_log->trace("SIGTRAP : CLONE");
+			SPDLOG_LOGGER_TRACE(m_log, "SIGTRAP : CLONE");
 			new_pid = 0;
 			int pt_ret = ptrace(PTRACE_GETEVENTMSG, signalled_pid, 0, &new_pid);
 			// m_log->trace("SIGTRAP : PT CLONE : ret {}");
@@ -181,19 +428,19 @@ void Debugger::getTrapReason(DebugEventPtr &debug_event, TraceeProgram *tracee_i
 		}
 		else if (PT_IF_EXEC(event.stopped.status))
 		{
-			m_log->trace("SIGTRAP : Exec");
+			SPDLOG_LOGGER_TRACE(m_log, "SIGTRAP : Exec");
 			trap_reason.status = TrapReason::EXEC;
 			trap_reason.pid = -1;
 		}
 		else if (PT_IF_EXIT(event.stopped.status))
 		{
-			m_log->trace("SIGTRAP : Exit");
+			SPDLOG_LOGGER_TRACE(m_log, "SIGTRAP : Exit");
 			trap_reason.status = TrapReason::EXIT;
 			trap_reason.pid = -1;
 		}
 		else if (PT_IF_FORK(event.stopped.status))
 		{
-			m_log->trace("SIGTRAP : Fork");
+			SPDLOG_LOGGER_TRACE(m_log, "SIGTRAP : Fork");
 			new_pid = 0;
 			int pt_ret = ptrace(PTRACE_GETEVENTMSG, signalled_pid, 0, &new_pid);
 			trap_reason.status = TrapReason::FORK;
@@ -201,7 +448,7 @@ void Debugger::getTrapReason(DebugEventPtr &debug_event, TraceeProgram *tracee_i
 		}
 		else if (PT_IF_VFORK(event.stopped.status))
 		{
-			m_log->trace("SIGTRAP : VFork");
+			SPDLOG_LOGGER_TRACE(m_log, "SIGTRAP : VFork");
 			new_pid = 0;
 			// Get the PID of the new process
 			int pt_ret = ptrace(PTRACE_GETEVENTMSG, signalled_pid, 0, &new_pid);
@@ -214,11 +461,17 @@ void Debugger::getTrapReason(DebugEventPtr &debug_event, TraceeProgram *tracee_i
 			{
 				siginfo_t sig_info = {0};
 				ptrace(PTRACE_GETSIGINFO, signalled_pid, nullptr, &sig_info);
-				if (isBreakpointTrap(&sig_info))
+				if (sig_info.si_code == TRAP_HWBKPT)
+				{
+					trap_reason.status = TrapReason::HW_BREAKPOINT;
+					trap_reason.pid = signalled_pid;
+					SPDLOG_LOGGER_TRACE(m_log, "SIGTRAP : TID [{}] Hardware breakpoint was hit !", trap_reason.pid);
+				}
+				else if (isBreakpointTrap(&sig_info))
 				{
 					trap_reason.status = TrapReason::BREAKPOINT;
 					trap_reason.pid = signalled_pid;
-					m_log->trace("SIGTRAP : TID [{}] Breakpoint was hit !", trap_reason.pid);
+					SPDLOG_LOGGER_TRACE(m_log, "SIGTRAP : TID [{}] Breakpoint was hit !", trap_reason.pid);
 				}
 				else
 				{
@@ -229,7 +482,7 @@ void Debugger::getTrapReason(DebugEventPtr &debug_event, TraceeProgram *tracee_i
 	}
 	else if (event.type == TraceeEvent::STOPPED && PT_IF_SYSCALL(event.stopped.signal))
 	{
-		m_log->trace("SIGTRAP : SYSCALL");
+		SPDLOG_LOGGER_TRACE(m_log, "SIGTRAP : SYSCALL");
 		trap_reason.status = TrapReason::SYSCALL;
 		trap_reason.pid = signalled_pid;
 	}
@@ -266,7 +519,7 @@ void Debugger::getTrapReason(DebugEventPtr &debug_event, TraceeProgram *tracee_i
 	}
 	else
 	{
-		m_log->debug("Not a stop signal!");
+		SPDLOG_LOGGER_DEBUG(m_log, "Not a stop signal!");
 	}
 }
 
@@ -280,7 +533,7 @@ DebugResult Debugger::stopThread(TraceeProgram &stopTracee)
 		m_log->error("Failed to stop the thread id {} and pid {}", stopTracee.pid(), stopTracee.tid());
 		return DebugResult::ErrStopThread;
 	}
-	m_log->trace("Successfully Stopped the pid {} and tid {}", stopTracee.pid(), stopTracee.tid());
+	SPDLOG_LOGGER_TRACE(m_log, "Successfully Stopped the pid {} and tid {}", stopTracee.pid(), stopTracee.tid());
 	return DebugResult::Success;
 }
 
@@ -305,7 +558,7 @@ DebugResult Debugger::stopAllThreads()
 DebugResult Debugger::attach(pid_t tracee_pid)
 {
 
-	m_log->info("Attaching to thread : {}", tracee_pid);
+	SPDLOG_LOGGER_INFO(m_log, "Attaching to thread : {}", tracee_pid);
 	DebugResult attachResult = attachThread(tracee_pid);
 	if (attachResult != DebugResult::Success)
 	{
@@ -315,14 +568,22 @@ DebugResult Debugger::attach(pid_t tracee_pid)
 	traceeProgram->getDebugOpts().m_procMap.list_child_threads();
 
 	auto child_pids = traceeProgram->getDebugOpts().m_procMap.m_child_thread_pids;
-	m_log->info("Attaching to child threads, No of threads {}", tracee_pid, child_pids.size());
+	SPDLOG_LOGGER_INFO(m_log, "Attaching to child threads, No of threads {}", tracee_pid, child_pids.size());
 
 	// Attach to all the children thread id
 	for (auto iter = child_pids.begin(); iter != child_pids.end(); ++iter)
 	{
 		pid_t child_pid = *iter;
-		m_log->info("Child pid {}", child_pid);
-		attachThread(child_pid);
+		SPDLOG_LOGGER_INFO(m_log, "Child pid {}", child_pid);
+		if (attachThread(child_pid) != DebugResult::Success)
+		{
+			continue;
+		}
+		// the threads share the address space, as do those added on CLONE,
+		// so the writes of one invalidate the pages cached by the others
+		TraceeProgram *child_tracee = getTracee(child_pid);
+		child_tracee->setThreadGroupid(tracee_pid);
+		child_tracee->getDebugOpts().m_memory.shareAddressSpace(traceeProgram->getDebugOpts().m_memory);
 	}
 	return DebugResult::Success;
 }
@@ -337,11 +598,17 @@ DebugResult Debugger::attachThread(pid_t tracee_pid)
 		return DebugResult::ErrStopThread;
 	}
 
+	if (!TraceeFactory::isSupported(m_target_desc.m_cpu_arch))
+	{
+		m_log->error("Target architecture is not enabled in config.hpp");
+		return DebugResult::ErrArchitecture;
+	}
+
 	int pt_ret = ptrace(PTRACE_ATTACH, tracee_pid, 0, 0);
 
 	if (pt_ret == 0)
 	{
-		m_log->trace("Attach successful for pid : {}", tracee_pid);
+		SPDLOG_LOGGER_TRACE(m_log, "Attach successful for pid : {}", tracee_pid);
 		TraceeProgram *traceeProg = addChildTracee(tracee_pid);
 		traceeProg->toAttach();
 	}
@@ -356,17 +623,12 @@ DebugResult Debugger::attachThread(pid_t tracee_pid)
 
 TraceeProgram *Debugger::getTracee(pid_t tracee_pid)
 {
-	auto tracee_iter = m_tracees.find(tracee_pid);
-	if (tracee_iter != m_tracees.end())
-	{
-		// tracee is found, its under over management
-		return tracee_iter->second;
-	}
-	else
+	TraceeProgram *tracee_prog = m_tracees.find(tracee_pid);
+	if (tracee_prog == nullptr)
 	{
-		m_log->info("Tracee not found!");
-		return nullptr;
+		SPDLOG_LOGGER_INFO(m_log, "Tracee not found!");
 	}
+	return tracee_prog;
 }
 
 bool Debugger::eventLoop()
@@ -374,10 +636,10 @@ bool Debugger::eventLoop()
 
 	DebugOpts *debug_opts = nullptr;
 	TraceeProgram *traceeProgram;
-	siginfo_t pt_sig_info = {0};
+	int wait_status = 0;
 	// TraceeEvent event;
 	// TrapReason trap_reason;
-	DebugEventPtr debug_event(new DebugEvent());
+	DebugEventPtr debug_event = DebugEvent::allocate();
 	int ret_wait = -1;
 
 	/**
@@ -391,21 +653,25 @@ bool Debugger::eventLoop()
 	 * in the queue.
 	 */
 
-	std::map<uintptr_t, std::queue<DebugEventPtr>> pending_thread_debug_event;
-	/**
-	 * This variable stored the address of the breakpoint which we are currently
-	 * processing. This might make is invisible while it is been handled. 
-	 */
-	std::set<uintptr_t> active_breakpoint;
-	std::queue<DebugEventPtr> pending_debug_events;
+	SteppingBreakpoints active_breakpoint;
+	DebugEventQueue pending_debug_events;
 
 	bool processing_pending_event = false;
 	uintptr_t brk_addr = 0; // breakpoint hit address
 
+	if (m_event_poller != nullptr)
+	{
+		m_event_poller->blockChildSignal();
+	}
+
+	if (m_displacedStepping)
+	{
+		m_breakpointMngr->enableDisplacedStepping();
+	}
+
 	while (!m_tracees.empty())
 	{
-		m_log->debug("------------------------------");
-		pt_sig_info.si_pid = 0;
+		SPDLOG_LOGGER_DEBUG(m_log, "------------------------------");
 		traceeProgram = nullptr;
 		debug_event->makeInvalid();
 		debug_opts = nullptr;
@@ -413,131 +679,86 @@ bool Debugger::eventLoop()
 		m_signalled_pid = 0;
 		ret_wait = -1;
 
-		printAllTraceesInfo();
+		if (m_log->should_log(spdlog::level::debug))
+		{
+			printAllTraceesInfo();
+		}
 
 		if (!pending_debug_events.empty())
 		{
 			processing_pending_event = true;
-			m_log->info("We have pending events. Pending {}", pending_debug_events.size());
-			debug_event = std::move(pending_debug_events.front());
-			pending_debug_events.pop();
+			SPDLOG_LOGGER_INFO(m_log, "We have pending events. Pending {}", pending_debug_events.size());
+			debug_event = pending_debug_events.pop();
 			m_signalled_pid = debug_event->m_pid;
 			debug_event->event.print();
 			debug_event->reason.print();
-			m_log->debug("Pending Signaled Pid {}", m_signalled_pid);
+			SPDLOG_LOGGER_DEBUG(m_log, "Pending Signaled Pid {}", m_signalled_pid);
 		}
 		else
 		{
 			processing_pending_event = false;
-			ret_wait = waitid(
-				P_ALL, 0,
-				&pt_sig_info,
-				WEXITED | WSTOPPED | WCONTINUED | WNOWAIT);
+			if (!m_retired_tracees.empty() && m_retired_tracees.size() < RETIRED_TRACEES_MAX &&
+				m_retired_events < RETIRED_EVENTS_MAX)
+			{
+				// take the events which are already there before resuming
+				// the Tracees waiting on a retired breakpoint, a stream of
+				// events from other Tracees can't keep them waiting forever
+				ret_wait = waitpid(-1, &wait_status, m_wait_options | WNOHANG);
+				m_retired_events++;
+			}
+
+			if (ret_wait <= 0)
+			{
+				resumeRetiredTracees();
+				// reap the event right away, one syscall per event
+				ret_wait = waitTraceeEvent(&wait_status);
+			}
 
 			if (ret_wait == -1)
 			{
-				m_log->critical("waitid failed!");
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				m_log->critical("waitpid failed! {}", strerror(errno));
 				exit(-1);
 			}
-			m_signalled_pid = pt_sig_info.si_pid;
-			m_log->info("Signaled Pid : {} Signal Code : {}", m_signalled_pid, pt_sig_info.si_code);
-		}
-
-		if (m_signalled_pid == 0)
-		{
-			m_log->warn("Special Case of waitid(), please handle it!");
-			exit(-1);
-		}
-
-		auto tracee_iter = m_tracees.find(m_signalled_pid);
-		if (tracee_iter != m_tracees.end())
-		{
-			// tracee is found, its under over management
-			traceeProgram = tracee_iter->second;
-		}
-		else
-		{
-			m_log->info("Tracee not found!");
-			traceeProgram = nullptr;
+			m_signalled_pid = ret_wait;
+			decode_wait_status(wait_status, debug_event);
+			debug_event->m_pid = m_signalled_pid;
+			if (m_recorder != nullptr)
+			{
+				m_recorder->record(TraceRecordType::WAIT_STATUS, m_signalled_pid, wait_status);
+			}
+			SPDLOG_LOGGER_INFO(m_log, "Signaled Pid : {} Status : {:#x}", m_signalled_pid, wait_status);
 		}
 
+		traceeProgram = m_tracees.find(m_signalled_pid);
 		if (traceeProgram == nullptr)
 		{
 			/**
-			 * It is possible that this PID is not under our management,
-			 * so now we have to check if any of our tracees have an
-			 * event for us. We are no longer going to receieve signal from
-			 * the `waitid()` as that may infinitely give us the same PID.
-			 * However, the PID that it is reporting could be a child from
-			 * a `fork()` event from one of our debuggees, and to get that
-			 * `fork()` event we have to "look ahead" in the signal queue
-			 * by non-blocking checking for signals from all of our
-			 * tracees.
-			 *
-			 * This is designed for the very real case as such:
+			 * The PID is not under our management yet. This is the very
+			 * real case of a new child whose initial stop is reported
+			 * before the fork/clone event of its parent:
 			 *
 			 * signal_queue = [
 			 *    STOP event from new child,
 			 *    TRAP event from tracee telling us it forked the child,
 			 * ]
 			 *
-			 * If we do not do this look ahead, the debugger will just
-			 * infinitely loop on `waitid()` and never observe a PID
-			 * under our control.
-			 *
-			 * It is also possible that we got a spurious `waitid()`
-			 * indicating the PID of _another_ [`Debugger`] instance had
-			 * an event. In this case, none of our tracees will have a
-			 * signal, and we'll just go back to `waitid()` without doing
-			 * anything. There's non-zero overhead to this, but I don't
-			 * think there is any other way to implement this without pidfd
-			 * which we are not using as it is too modern of a feature for
-			 * the targets we want to support.
+			 * The event is already reaped, park it until the parent event
+			 * adds the child, see adoptHeldEvent.
 			 */
-
-			m_log->info("Tracee is not under over management");
-
-			// reset the current processed tracee info
-			debug_event->makeInvalid();
-
-			// we are not sure which pid has caused this issue
-			m_signalled_pid = -1;
-			bool found_event = false;
-
-			for (auto i = m_tracees.begin(); i != m_tracees.end(); i++)
-			{
-				// Go through all known tracees looking for events
-				pid_t tracee_pid = i->first;
-				get_wait_event(tracee_pid, debug_event);
-				traceeProgram = i->second;
-				m_log->debug("Inspecting ");
-				traceeProgram->printStatus();
-				debug_event->event.print();
-				if (debug_event->event.isValidEvent())
-				{
-					found_event = true;
-					m_log->debug("Event from PID : {}", tracee_pid);
-					m_signalled_pid = tracee_pid;
-					traceeProgram = m_tracees[m_signalled_pid];
-					debug_event->m_pid = m_signalled_pid;
-					break;
-				}
-			}
-			if (!found_event)
-			{
-				// if this happens, and we are not handling ptrace events properly.
-				// This mean we need to solve and Edge case. Its an OS level issue
-				m_log->critical("No tracee with event found! This should not happend, handle it!");
-				continue;
-			}
+			SPDLOG_LOGGER_INFO(m_log, "Tracee {} is not under our management, holding its event", m_signalled_pid);
+			holdEvent(debug_event);
+			debug_event = DebugEvent::allocate();
+			continue;
 		}
-		else
+
+		if (debug_event->event.type != TraceeEvent::CONTINUED)
 		{
-			if (!processing_pending_event)
-			{
-				get_wait_event(m_signalled_pid, debug_event);
-				debug_event->m_pid = m_signalled_pid;
-			}
+			// the other threads may only cache its pages while it is stopped
+			traceeProgram->onStop();
 		}
 
 		if (!processing_pending_event)
@@ -545,6 +766,13 @@ bool Debugger::eventLoop()
 			getTrapReason(debug_event, traceeProgram);
 		}
 
+		if (debug_event->event.type == TraceeEvent::STOPPED && debug_event->reason.status != TrapReason::HW_BREAKPOINT)
+		{
+			// a retired hardware breakpoint can only be disarmed in a
+			// stopped thread
+			m_breakpointMngr->disarmRetiredHw(*traceeProgram);
+		}
+
 		// debug_event->print();
 
 		auto tracee_flags = PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEEXEC | PTRACE_O_TRACEEXIT;
@@ -558,20 +786,20 @@ bool Debugger::eventLoop()
 		case TraceeState::ATTACH:
 			if (debug_event->event.type == TraceeEvent::STOPPED)
 			{
-				m_log->info("Thread has stopped!");
+				SPDLOG_LOGGER_INFO(m_log, "Thread has stopped!");
 				// traceeProgram->toStateRunning();
 				// traceeProgram->contExecution();
 			}
 			else
 			{
-				m_log->info("Thread hasn't stopped yet!");
+				SPDLOG_LOGGER_INFO(m_log, "Thread hasn't stopped yet!");
 			}
 			// Process `INITIAL_STOP` occurs right after the attach is successful
 			// not putting a 'break' statement was an intentional
 		case TraceeState::INITIAL_STOP:
 		{
 
-			m_log->info("Initial Stop, prepaing the tracee!");
+			SPDLOG_LOGGER_INFO(m_log, "Initial Stop, prepaing the tracee!");
 
 			if (m_followFork)
 			{
@@ -612,24 +840,10 @@ bool Debugger::eventLoop()
 			debug_opts = &traceeProgram->getDebugOpts();
 			debug_opts->m_register.fetch();
 
-			if (traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::AMD64)
-			{
-				AMD64Register &amdReg = reinterpret_cast<AMD64Register &>(debug_opts->m_register);
-				brk_addr = amdReg.getBreakpointAddr();
-			}
-			else if (traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::ARM32)
-			{
-				ARM32Register &armReg = reinterpret_cast<ARM32Register &>(debug_opts->m_register);
-				brk_addr = armReg.getBreakpointAddr();
-			}
-			else if (traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::ARM64)
-			{
-				ARM64Register &arm64Reg = reinterpret_cast<ARM64Register &>(debug_opts->m_register);
-				brk_addr = arm64Reg.getBreakpointAddr();
-			}
+			brk_addr = archBreakpointAddr(traceeProgram->m_target_desc.m_cpu_arch, debug_opts->m_register);
 
-			m_log->debug("Breakpoint Restore Hit addr : 0x{:x} ", brk_addr);
-			m_log->debug("Restoring Breakpoint addr : 0x{:x}", traceeProgram->m_brkpnt_addr);
+			SPDLOG_LOGGER_DEBUG(m_log, "Breakpoint Restore Hit addr : 0x{:x} ", brk_addr);
+			SPDLOG_LOGGER_DEBUG(m_log, "Restoring Breakpoint addr : 0x{:x}", traceeProgram->m_brkpnt_addr);
 
 			// debug_event->print();
 			if (debug_event->event.type == TraceeEvent::STOPPED && debug_event->reason.status == TrapReason::BREAKPOINT)
@@ -640,27 +854,37 @@ bool Debugger::eventLoop()
 				// step, at this stage we will restore the original breakpoint and remove the
 				// single-step breakpoint
 
-				m_breakpointMngr->restoreSuspendedBreakpoint(*traceeProgram);
-				active_breakpoint.erase(traceeProgram->m_brkpnt_addr);
-				m_log->info("Breakpoint handled 0x{:x}", traceeProgram->m_brkpnt_addr);
-
-				if (!pending_thread_debug_event[traceeProgram->m_brkpnt_addr].empty())
-				{
-					// Once we have handled this breakpoint we want to see if there
-					// is another thread which has been block because of same breakpoint
-					// in that case de-queue the event and put it in the active process queue
-					// move the event from per-thread pending queue to the queue
-					// which will start processing the event
-					m_log->debug("We have pending breakpoint to process!");
-					pending_debug_events.push(std::move(pending_thread_debug_event[traceeProgram->m_brkpnt_addr].front()));
-					pending_thread_debug_event[traceeProgram->m_brkpnt_addr].pop();
-				}
-				traceeProgram->m_brkpnt_addr = 0;
-				traceeProgram->m_active_brkpnt = nullptr;
+				finishStepOver(traceeProgram, active_breakpoint, pending_debug_events);
 				// continue the execution
 				traceeProgram->toStateRunning();
 				traceeProgram->contExecution(0);
 			}
+			else if (debug_event->event.type == TraceeEvent::STOPPED && debug_event->reason.status == TrapReason::HW_BREAKPOINT)
+			{
+				// a watchpoint hit by the stepped instruction is reported
+				// instead of the end of the step, an execute breakpoint on
+				// the instruction itself before it
+				uintptr_t step_pc = archProgramCounter(traceeProgram->m_target_desc.m_cpu_arch, debug_opts->m_register);
+
+				bool step_done = step_pc != traceeProgram->m_step_pc;
+				if (step_done)
+				{
+					finishStepOver(traceeProgram, active_breakpoint, pending_debug_events);
+				}
+
+				if (m_breakpointMngr->handleHwBreakpointHit(*traceeProgram) && step_done)
+				{
+					traceeProgram->toStateRunning();
+					traceeProgram->contExecution(0);
+				}
+				else
+				{
+					// still stepping, or stepping over the hardware breakpoint
+					// which has just been disarmed
+					traceeProgram->m_step_pc = step_pc;
+					traceeProgram->singleStep();
+				}
+			}
 			else
 			{
 				m_log->error("Processing and Invalid Event! State transistion is invalid!");
@@ -669,11 +893,11 @@ bool Debugger::eventLoop()
 			break;
 		case TraceeState::RUNNING:
 
-			m_log->debug("RUNNING");
+			SPDLOG_LOGGER_DEBUG(m_log, "RUNNING");
 			switch (debug_event->event.type)
 			{
 			case TraceeEvent::EXITED:
-				m_log->info("EXITED : process {} has exited!", m_signalled_pid);
+				SPDLOG_LOGGER_INFO(m_log, "EXITED : process {} has exited!", m_signalled_pid);
 				traceeProgram->toStateExited();
 				break;
 			case TraceeEvent::SIGNALED:
@@ -682,12 +906,12 @@ bool Debugger::eventLoop()
 				break;
 			case TraceeEvent::STOPPED:
 			{
-				m_log->info("STOPPED : ");
+				SPDLOG_LOGGER_INFO(m_log, "STOPPED : ");
 				if (debug_event->reason.status == TrapReason::CLONE ||
 					debug_event->reason.status == TrapReason::FORK ||
 					debug_event->reason.status == TrapReason::VFORK)
 				{
-					m_log->trace("CLONE/FORK/VFORK");
+					SPDLOG_LOGGER_TRACE(m_log, "CLONE/FORK/VFORK");
 					// you will be getting this event when you are not following
 					// system call event
 					// m_log->error("You shouldn't be getting this event!");
@@ -695,13 +919,15 @@ bool Debugger::eventLoop()
 					if (debug_event->reason.status == TrapReason::CLONE)
 					{
 						// attach(debug_event->reason.pid);
-						tracee_prog->setThreadGroupid(m_leader_tracee->pid());
-						m_log->trace("New Thead is created with pid {} and tgid {}!", tracee_prog->pid(), tracee_prog->tid());
+						tracee_prog->setThreadGroupid(traceeProgram->tid());
+						tracee_prog->getDebugOpts().m_memory.shareAddressSpace(traceeProgram->getDebugOpts().m_memory);
+						SPDLOG_LOGGER_TRACE(m_log, "New Thead is created with pid {} and tgid {}!", tracee_prog->pid(), tracee_prog->tid());
 					}
+					adoptHeldEvent(tracee_prog, pending_debug_events);
 				}
 				else if (debug_event->reason.status == TrapReason::EXEC)
 				{
-					m_log->trace("EXEC: new child has been added please hand over to a different debugger");
+					SPDLOG_LOGGER_TRACE(m_log, "EXEC: new child has been added please hand over to a different debugger");
 					// New child has been added which is completed different from our
 					// process so probablity create new Debugger instance and hand
 					// this child to that instance
@@ -709,12 +935,15 @@ bool Debugger::eventLoop()
 					// Fork-exec pattern new child memory is completely different so we need to parse
 					// it again and delete the old data
 					traceeProgram->getDebugOpts().m_procMap.parse();
+					traceeProgram->getDebugOpts().m_memory.onAddressSpaceReset();
+					m_breakpointMngr->dropScratchPad(*traceeProgram);
+					dropRetiredTracee(traceeProgram->pid());
 					// m_procMap.print();
 				}
 				else if (debug_event->reason.status == TrapReason::EXIT)
 				{
 					// toStateExited();
-					m_log->trace("EXIT");
+					SPDLOG_LOGGER_TRACE(m_log, "EXIT");
 					// traceeProgram->contExecution();
 				}
 				else if (debug_event->reason.status == TrapReason::SYSCALL)
@@ -724,7 +953,17 @@ bool Debugger::eventLoop()
 					// NOTE: OS has not clear way to
 					// distingish if the call is syscall enter or exit
 					// and its debugger responsibity to track it
-					m_log->debug("SYSCALL ENTER");
+					if (m_syscallMngr->fetchSyscallInfo(*traceeProgram) == SyscallStop::EXIT)
+					{
+						// the kernel says this is an exit, we have missed the
+						// entry (e.g. attached while the tracee was in a syscall).
+						// The arguments of that syscall were never read and the
+						// exit stop doesn't hold them, don't run the handlers
+						SPDLOG_LOGGER_DEBUG(m_log, "SYSCALL EXIT without ENTER, ignored");
+						traceeProgram->contExecution();
+						break;
+					}
+					SPDLOG_LOGGER_DEBUG(m_log, "SYSCALL ENTER");
 					m_syscallMngr->onEnter(*traceeProgram);
 					if (traceeProgram->m_inject_call)
 					{
@@ -736,6 +975,25 @@ bool Debugger::eventLoop()
 						traceeProgram->toStateSysCall();
 					}
 				}
+				else if (debug_event->reason.status == TrapReason::HW_BREAKPOINT)
+				{
+					// the code isn't patched, nobody else is stepping over
+					// this breakpoint
+					debug_opts = &traceeProgram->getDebugOpts();
+					debug_opts->m_register.fetch();
+					if (m_breakpointMngr->handleHwBreakpointHit(*traceeProgram))
+					{
+						traceeProgram->contExecution(0);
+					}
+					else
+					{
+						// the slot is armed again in BREAKPOINT_HIT
+						traceeProgram->m_step_pc = archProgramCounter(traceeProgram->m_target_desc.m_cpu_arch, debug_opts->m_register);
+						traceeProgram->toStateBreakpoint();
+						traceeProgram->singleStep();
+					}
+					break;
+				}
 				else if (debug_event->reason.status == TrapReason::BREAKPOINT)
 				{
 					/**
@@ -756,38 +1014,63 @@ bool Debugger::eventLoop()
 					debug_opts = &traceeProgram->getDebugOpts();
 					debug_opts->m_register.fetch();
 
-					uintptr_t brk_addr = 0;
-
-					// if (traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::AMD64) {
-#if defined(SUPPORT_ARCH_AMD64)
-					AMD64Register &amdReg = reinterpret_cast<AMD64Register &>(debug_opts->m_register);
-					brk_addr = amdReg.getBreakpointAddr();
-#elif defined(SUPPORT_ARCH_ARM)
-					// } else if (traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::ARM32) {
-					ARM32Register &armReg = reinterpret_cast<ARM32Register &>(debug_opts->m_register);
-					brk_addr = armReg.getBreakpointAddr();
-#elif defined(SUPPORT_ARCH_ARM64)
-					// } else if (traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::ARM64) {
-					ARM64Register &armReg = reinterpret_cast<ARM64Register &>(debug_opts->m_register);
-					brk_addr = armReg.getBreakpointAddr();
-#endif
-
-					if (active_breakpoint.count(brk_addr) > 0)
+					CPU_ARCH cpu_arch = traceeProgram->m_target_desc.m_cpu_arch;
+					uintptr_t brk_addr = archBreakpointAddr(cpu_arch, debug_opts->m_register);
+
+					if (active_breakpoint.isStepping(brk_addr))
 					{
 						//  prev_brk_addr == brk_addr && prev_pid != debug_opts->getPid()) {}
-						m_log->info("Breakpoint stepover race condition!");
-						m_log->info("{} pid is attempting to execute {} pid's breakpoint handler", debug_opts->getPid(), prev_pid);
-						m_log->info("Breakpoint address 0x{:x}", brk_addr);
+						SPDLOG_LOGGER_INFO(m_log, "Breakpoint stepover race condition!");
+						SPDLOG_LOGGER_INFO(m_log, "{} pid is attempting to execute {} pid's breakpoint handler", debug_opts->getPid(), prev_pid);
+						SPDLOG_LOGGER_INFO(m_log, "Breakpoint address 0x{:x}", brk_addr);
 						// pending_debug_events.push(std::move(debug_event));
-						pending_thread_debug_event[brk_addr].push(std::move(debug_event));
-						debug_event = std::move(DebugEventPtr(new DebugEvent()));
+						active_breakpoint.defer(brk_addr, std::move(debug_event));
+						debug_event = DebugEvent::allocate();
+						break;
+					}
+
+					if (m_recorder != nullptr)
+					{
+						m_recorder->record(TraceRecordType::BREAKPOINT_HIT, m_signalled_pid, brk_addr);
+					}
+
+					if (m_breakpointMngr->retireBreakpoint(*traceeProgram, brk_addr))
+					{
+						// single shot, the original instruction is put back
+						// and executed in place, without a step over
+						archSetProgramCounter(cpu_arch, debug_opts->m_register, brk_addr);
+						m_retired_tracees.push_back(m_signalled_pid);
 						break;
 					}
 
+					if (m_displacedStepping)
+					{
+						int exit_status = -1;
+						DisplacedStepResult step_result = m_breakpointMngr->displacedStepOver(*traceeProgram, brk_addr, exit_status);
+						if (step_result == DisplacedStepResult::RESUMED)
+						{
+							// the breakpoint never left the memory, there is no
+							// step over to wait for
+							traceeProgram->contExecution(0);
+							break;
+						}
+						if (step_result == DisplacedStepResult::EXITED)
+						{
+							// the exit was reaped meanwhile, process it as if it
+							// came from waitpid
+							DebugEventPtr exit_event = DebugEvent::allocate();
+							decode_wait_status(exit_status, exit_event);
+							exit_event->m_pid = m_signalled_pid;
+							pending_debug_events.push(std::move(exit_event));
+							break;
+						}
+					}
+
 					traceeProgram->m_active_brkpnt = m_breakpointMngr->getBreakpointObj(brk_addr);
 					traceeProgram->m_brkpnt_addr = brk_addr;
+					traceeProgram->m_step_pc = brk_addr;
 
-					active_breakpoint.insert(brk_addr);
+					active_breakpoint.acquire(brk_addr);
 
 					// prev_brk_addr = brk_addr;
 					// prev_pid = debug_opts->getPid();
@@ -798,39 +1081,27 @@ bool Debugger::eventLoop()
 					// not the place to handle it
 					// debug_opts->m_register->print();
 					auto bkpt_obj = m_breakpointMngr->handleBreakpointHit(*traceeProgram, brk_addr);
-#if defined(SUPPORT_ARCH_X86) || defined(SUPPORT_ARCH_AMD64)
-					// if (traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::AMD64 ||
-					// 	traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::X86) {
-					// AMD64Register &amdReg = reinterpret_cast<AMD64Register &>(debug_opts->m_register);
-					amdReg.setProgramCounter(brk_addr);
-					amdReg.update();
-					traceeProgram->toStateBreakpoint();
-					traceeProgram->singleStep();
-#elif defined(SUPPORT_ARCH_ARM)
-					// } else if (traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::ARM32) {
-					// ARM32Register& armReg = reinterpret_cast<ARM32Register&>(debug_opts->m_register);
-					if (bkpt_obj->shouldEnable())
+					if (archHasSingleStep(cpu_arch))
+					{
+						archSetProgramCounter(cpu_arch, debug_opts->m_register, brk_addr);
+						debug_opts->m_register.update();
+						traceeProgram->toStateBreakpoint();
+						traceeProgram->singleStep();
+					}
+					else if (bkpt_obj->shouldEnable())
 					{
 						// Single stepping is not supported in ARM32 Linux Kernel, so we have
 						// to do it ourself!
 						m_breakpointMngr->placeSingleStepBreakpoint(brk_addr, *traceeProgram);
 						stopAllThreads();
 						traceeProgram->toStateBreakpoint();
+						traceeProgram->contExecution(0);
 					}
 					else
 					{
 						traceeProgram->toStateRunning();
+						traceeProgram->contExecution(0);
 					}
-					traceeProgram->contExecution(0);
-#elif defined(SUPPORT_ARCH_ARM64)
-					// } else if (traceeProgram->m_target_desc.m_cpu_arch == CPU_ARCH::ARM64) {
-					traceeProgram->toStateBreakpoint();
-					traceeProgram->singleStep();
-					// }
-#else
-					m_log->error("Invalid Architecture is specified");
-					exit(-1);
-#endif
 
 					// debug_opts->m_register->print();
 					break;
@@ -838,6 +1109,12 @@ bool Debugger::eventLoop()
 				else
 				{
 					m_log->warn("Not sure why we have stopped!");
+					if (m_displacedStepping)
+					{
+						// the signal handler must not run on top of the
+						// scratch slot
+						m_breakpointMngr->leaveScratchSlot(*traceeProgram);
+					}
 					traceeProgram->contExecution(debug_event->event.signaled.signal);
 					break;
 				}
@@ -846,7 +1123,7 @@ bool Debugger::eventLoop()
 			}
 			break;
 			case TraceeEvent::CONTINUED:
-				m_log->debug("CONTINUED");
+				SPDLOG_LOGGER_DEBUG(m_log, "CONTINUED");
 				traceeProgram->contExecution();
 				break;
 			default:
@@ -861,7 +1138,7 @@ bool Debugger::eventLoop()
 		// Processing `IN_SYSCALL` occurs right after the 'INJECT_SYSCALL' exit
 		// not putting a 'break' statement was an intentional
 		case TraceeState::IN_SYSCALL:
-			m_log->debug("State SYSCALL");
+			SPDLOG_LOGGER_DEBUG(m_log, "State SYSCALL");
 			/**
 			 * DOCS :
 			 * Syscall-enter-stop and syscall-exit-stop are indistinguishable
@@ -877,7 +1154,7 @@ bool Debugger::eventLoop()
 			switch (debug_event->event.type)
 			{
 			case TraceeEvent::EXITED:
-				m_log->info("SYSCALL : EXITED : process {} has exited!", m_signalled_pid);
+				SPDLOG_LOGGER_INFO(m_log, "SYSCALL : EXITED : process {} has exited!", m_signalled_pid);
 				traceeProgram->toStateExited();
 				break;
 			case TraceeEvent::SIGNALED:
@@ -888,10 +1165,20 @@ bool Debugger::eventLoop()
 
 				if (debug_event->reason.status == TrapReason::SYSCALL)
 				{
-					m_log->info("SYSCALL EXIT");
-					// change the state once we have process the event
-					m_syscallMngr->onExit(*traceeProgram);
-					traceeProgram->toStateRunning();
+					if (m_syscallMngr->fetchSyscallInfo(*traceeProgram) == SyscallStop::ENTRY)
+					{
+						// the kernel says this is a new entry, the exit of the
+						// previous syscall was never reported to us
+						SPDLOG_LOGGER_DEBUG(m_log, "SYSCALL ENTER without EXIT");
+						m_syscallMngr->onEnter(*traceeProgram);
+					}
+					else
+					{
+						SPDLOG_LOGGER_INFO(m_log, "SYSCALL EXIT");
+						// change the state once we have process the event
+						m_syscallMngr->onExit(*traceeProgram);
+						traceeProgram->toStateRunning();
+					}
 				}
 				else if (debug_event->reason.status == TrapReason::CLONE ||
 						 // this function processes "PTRACE_EVENT stops" event
@@ -900,25 +1187,31 @@ bool Debugger::eventLoop()
 				{
 					// this can happend when you are dealing with fork/vfork/clone
 					// system call
-					m_log->trace("SYSCALL: CLONE/FORK/VFORK");
+					SPDLOG_LOGGER_TRACE(m_log, "SYSCALL: CLONE/FORK/VFORK");
 					TraceeProgram *tracee_prog = addChildTracee(debug_event->reason.pid);
 					if (debug_event->reason.status == TrapReason::CLONE)
 					{
 						// attach(debug_event->reason.pid);
-						tracee_prog->setThreadGroupid(m_leader_tracee->pid());
-						m_log->trace("New Thead is created with pid {} and tgid {}!", tracee_prog->pid(), tracee_prog->tid());
+						tracee_prog->setThreadGroupid(traceeProgram->tid());
+						tracee_prog->getDebugOpts().m_memory.shareAddressSpace(traceeProgram->getDebugOpts().m_memory);
+						SPDLOG_LOGGER_TRACE(m_log, "New Thead is created with pid {} and tgid {}!", tracee_prog->pid(), tracee_prog->tid());
 					}
+					adoptHeldEvent(tracee_prog, pending_debug_events);
 					// traceeProgram->contExecution();
 				}
 				else if (debug_event->reason.status == TrapReason::EXEC)
 				{
-					m_log->trace("SYSCALL: EXEC");
+					SPDLOG_LOGGER_TRACE(m_log, "SYSCALL: EXEC");
+					traceeProgram->getDebugOpts().m_procMap.parse();
+					traceeProgram->getDebugOpts().m_memory.onAddressSpaceReset();
+					m_breakpointMngr->dropScratchPad(*traceeProgram);
+					dropRetiredTracee(traceeProgram->pid());
 					// traceeProgram->contExecution();
 				}
 				else if (debug_event->reason.status == TrapReason::EXIT)
 				{
 					// toStateExited();
-					m_log->trace("SYSCALL: EXIT");
+					SPDLOG_LOGGER_TRACE(m_log, "SYSCALL: EXIT");
 					// traceeProgram->contExecution();
 				}
 				else
@@ -943,6 +1236,6 @@ bool Debugger::eventLoop()
 		}
 	}
 	m_breakpointMngr->printStats();
-	m_log->info("There are not tracee left to debug. Exiting!");
+	SPDLOG_LOGGER_INFO(m_log, "There are not tracee left to debug. Exiting!");
 	return true;
 }
@@ -0,0 +1,216 @@
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "displaced_step.hpp"
+#include "tracee.hpp"
+#include "debug_opts.hpp"
+
+/// @brief longest syscallTrapCode of the architectures
+#define SYSCALL_TRAP_CODE_MAX 16
+
+ScratchPad::ScratchPad(uintptr_t base, size_t slot_size) : m_base(base)
+{
+    for (size_t offset = 0; offset + slot_size <= SCRATCH_PAD_SIZE; offset += slot_size)
+    {
+        ScratchSlot slot;
+        slot.m_addr = base + offset;
+        m_slots.push_back(slot);
+    }
+}
+
+ScratchSlot* ScratchPad::slotFor(pid_t tid)
+{
+    auto slot_iter = m_slot_of.find(tid);
+    if (slot_iter != m_slot_of.end())
+    {
+        return &m_slots[slot_iter->second];
+    }
+
+    for (size_t idx = 0; idx < m_slots.size(); idx++)
+    {
+        if (m_slots[idx].m_owner == 0)
+        {
+            m_slots[idx].m_owner = tid;
+            m_slot_of[tid] = idx;
+            return &m_slots[idx];
+        }
+    }
+    return nullptr;
+}
+
+ScratchSlot* ScratchPad::findSlot(pid_t tid)
+{
+    auto slot_iter = m_slot_of.find(tid);
+    if (slot_iter == m_slot_of.end())
+    {
+        return nullptr;
+    }
+    return &m_slots[slot_iter->second];
+}
+
+void ScratchPad::release(pid_t tid)
+{
+    auto slot_iter = m_slot_of.find(tid);
+    if (slot_iter == m_slot_of.end())
+    {
+        return;
+    }
+    m_slots[slot_iter->second].m_owner = 0;
+    m_slot_of.erase(slot_iter);
+}
+
+/// @brief AT_ENTRY of the process, 0 if it couldn't be read
+static uintptr_t readEntryPoint(pid_t pid)
+{
+    char auxv_path[64];
+    snprintf(auxv_path, sizeof(auxv_path), "/proc/%d/auxv", pid);
+
+    int auxv_fd = open(auxv_path, O_RDONLY | O_CLOEXEC);
+    if (auxv_fd < 0)
+    {
+        return 0;
+    }
+
+    // the tracer is built for the architecture of the Tracee, the auxv
+    // entries have our word size
+    unsigned long entry[2];
+    uintptr_t entry_point = 0;
+    while (read(auxv_fd, entry, sizeof(entry)) == sizeof(entry) && entry[0] != AT_NULL)
+    {
+        if (entry[0] == AT_ENTRY)
+        {
+            entry_point = entry[1];
+            break;
+        }
+    }
+    close(auxv_fd);
+    return entry_point;
+}
+
+uintptr_t DisplacedStepper::allocateScratch(TraceeProgram& traceeProg, size_t len, int& exit_status)
+{
+    exit_status = -1;
+
+    DebugOpts& debug_opts = traceeProg.getDebugOpts();
+    pid_t tid = traceeProg.pid();
+
+    uint8_t trap_code[SYSCALL_TRAP_CODE_MAX];
+    size_t code_len = syscallTrapCode(trap_code);
+    if (code_len == 0)
+    {
+        return 0;
+    }
+
+    uintptr_t entry_point = readEntryPoint(tid);
+    if (entry_point == 0)
+    {
+        m_log->error("No entry point for {}, can't allocate the scratch pad", tid);
+        return 0;
+    }
+
+    uint8_t code_backup[SYSCALL_TRAP_CODE_MAX];
+    if (debug_opts.m_memory.readRemote(entry_point, code_backup, code_len) != static_cast<ssize_t>(code_len))
+    {
+        m_log->error("Failed to read the entry point 0x{:x}", entry_point);
+        return 0;
+    }
+
+    std::uintptr_t reg_backup = debug_opts.m_register.getRegisterCopy();
+
+    debug_opts.m_memory.writeRemote(entry_point, trap_code, code_len);
+    setMmapCall(traceeProg, entry_point, len);
+    debug_opts.m_register.update();
+
+    // signals which arrive meanwhile are raised again once we are done
+    std::vector<int> pending_signals;
+    int wait_status = 0;
+    bool trapped = false;
+    bool interrupted = false;
+    traceeProg.onResume();
+    ptrace(PTRACE_CONT, tid, 0, 0);
+    while (true)
+    {
+        pid_t wait_ret = waitpid(tid, &wait_status, __WALL);
+        if (wait_ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (wait_ret != tid)
+        {
+            if (interrupted)
+            {
+                break;
+            }
+            // the code and the registers can't be restored under a running
+            // thread, the stub would run on its own
+            m_log->error("Waiting for {} failed while allocating the scratch pad : {}", tid, strerror(errno));
+            syscall(SYS_tkill, tid, SIGSTOP);
+            interrupted = true;
+            continue;
+        }
+
+        traceeProg.onStop();
+        if (!WIFSTOPPED(wait_status))
+        {
+            // the event is reaped, the debugger has to drop the Tracee
+            m_log->error("Tracee {} is gone while allocating the scratch pad", tid);
+            exit_status = wait_status;
+            free(reinterpret_cast<void *>(reg_backup));
+            return 0;
+        }
+        if (WSTOPSIG(wait_status) == SIGTRAP && (wait_status >> 16) == 0)
+        {
+            trapped = true;
+            break;
+        }
+        if (interrupted && WSTOPSIG(wait_status) == SIGSTOP)
+        {
+            // our own stop, the stub didn't complete
+            break;
+        }
+        if (WSTOPSIG(wait_status) != SIGTRAP)
+        {
+            pending_signals.push_back(WSTOPSIG(wait_status));
+        }
+        traceeProg.onResume();
+        ptrace(PTRACE_CONT, tid, 0, 0);
+    }
+
+    uintptr_t scratch_addr = 0;
+    if (trapped)
+    {
+        scratch_addr = syscallResult(traceeProg);
+        // mmap returns -errno on failure
+        if (scratch_addr > static_cast<uintptr_t>(-4096))
+        {
+            m_log->error("mmap of the scratch pad failed in {} : {}", tid, strerror(-static_cast<int>(scratch_addr)));
+            scratch_addr = 0;
+        }
+    }
+    else
+    {
+        m_log->error("Lost the Tracee {} while allocating the scratch pad", tid);
+    }
+
+    debug_opts.m_memory.writeRemote(entry_point, code_backup, code_len);
+    debug_opts.m_register.restoreRegisterCopy(reg_backup);
+    free(reinterpret_cast<void *>(reg_backup));
+
+    if (scratch_addr != 0)
+    {
+        debug_opts.m_memory.onMappingChange(scratch_addr, len);
+        SPDLOG_LOGGER_DEBUG(m_log, "Scratch pad of {} at 0x{:x}", traceeProg.tid(), scratch_addr);
+    }
+
+    for (int sig : pending_signals)
+    {
+        syscall(SYS_tkill, tid, sig);
+    }
+    return scratch_addr;
+}
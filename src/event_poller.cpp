@@ -0,0 +1,270 @@
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include "event_poller.hpp"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+#define EVENT_POLLER_MAX_EVENTS 32
+
+EventPoller::EventPoller()
+{
+	m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epoll_fd < 0)
+	{
+		m_log->error("epoll_create1 failed : {}", strerror(errno));
+	}
+}
+
+EventPoller::~EventPoller()
+{
+	for (auto &timer : m_timers)
+	{
+		close(timer.first);
+	}
+	for (auto &pidfd : m_pidfds)
+	{
+		close(pidfd.second);
+	}
+	if (m_signal_fd >= 0)
+	{
+		close(m_signal_fd);
+	}
+	if (m_epoll_fd >= 0)
+	{
+		close(m_epoll_fd);
+	}
+}
+
+int EventPoller::addToEpoll(int fd, uint32_t events)
+{
+	struct epoll_event ev = {};
+	ev.events = events;
+	ev.data.fd = fd;
+	if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+	{
+		m_log->error("Failed to watch fd {} : {}", fd, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+void EventPoller::removeFromEpoll(int fd)
+{
+	epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int EventPoller::blockChildSignal()
+{
+	if (m_signal_fd >= 0)
+	{
+		return 0;
+	}
+
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+	m_signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (m_signal_fd < 0)
+	{
+		m_log->error("signalfd failed : {}", strerror(errno));
+		return -1;
+	}
+	return addToEpoll(m_signal_fd, EPOLLIN);
+}
+
+int EventPoller::blockProcessChildSignal()
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	return pthread_sigmask(SIG_BLOCK, &mask, nullptr) == 0 ? 0 : -1;
+}
+
+int EventPoller::addFdWatch(int fd, uint32_t events, FdCallback callback)
+{
+	if (m_fd_watches.count(fd) > 0)
+	{
+		m_log->warn("fd {} is already watched", fd);
+		return -1;
+	}
+	if (addToEpoll(fd, events) < 0)
+	{
+		return -1;
+	}
+	m_fd_watches[fd] = callback;
+	return 0;
+}
+
+int EventPoller::removeFdWatch(int fd)
+{
+	if (m_fd_watches.erase(fd) == 0)
+	{
+		return -1;
+	}
+	removeFromEpoll(fd);
+	return 0;
+}
+
+int EventPoller::addTimer(uint64_t interval_ms, TimerCallback callback, bool periodic)
+{
+	int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timer_fd < 0)
+	{
+		m_log->error("timerfd_create failed : {}", strerror(errno));
+		return -1;
+	}
+
+	struct itimerspec spec = {};
+	spec.it_value.tv_sec = interval_ms / 1000;
+	spec.it_value.tv_nsec = (interval_ms % 1000) * 1000000;
+	if (interval_ms == 0)
+	{
+		// a zero it_value disarms the timer, fire right away instead
+		spec.it_value.tv_nsec = 1;
+	}
+	if (periodic)
+	{
+		spec.it_interval = spec.it_value;
+	}
+
+	if (timerfd_settime(timer_fd, 0, &spec, nullptr) < 0 || addToEpoll(timer_fd, EPOLLIN) < 0)
+	{
+		m_log->error("Failed to arm timer : {}", strerror(errno));
+		close(timer_fd);
+		return -1;
+	}
+
+	m_timers[timer_fd] = {callback, periodic};
+	return timer_fd;
+}
+
+int EventPoller::removeTimer(int timer_id)
+{
+	if (m_timers.erase(timer_id) == 0)
+	{
+		return -1;
+	}
+	removeFromEpoll(timer_id);
+	close(timer_id);
+	return 0;
+}
+
+void EventPoller::watchProcess(pid_t pid)
+{
+	if (m_pidfds.count(pid) > 0)
+	{
+		return;
+	}
+
+	int pid_fd = syscall(SYS_pidfd_open, pid, 0);
+	if (pid_fd < 0)
+	{
+		// not a thread group leader, or a kernel older than 5.3
+		m_log->trace("No pidfd for {} : {}", pid, strerror(errno));
+		return;
+	}
+
+	if (addToEpoll(pid_fd, EPOLLIN) < 0)
+	{
+		close(pid_fd);
+		return;
+	}
+	m_pidfds[pid] = pid_fd;
+	m_pidfd_owner[pid_fd] = pid;
+}
+
+void EventPoller::unwatchProcess(pid_t pid)
+{
+	auto pidfd_iter = m_pidfds.find(pid);
+	if (pidfd_iter == m_pidfds.end())
+	{
+		return;
+	}
+	removeFromEpoll(pidfd_iter->second);
+	close(pidfd_iter->second);
+	m_pidfd_owner.erase(pidfd_iter->second);
+	m_pidfds.erase(pidfd_iter);
+}
+
+int EventPoller::poll(int timeout_ms)
+{
+	struct epoll_event events[EVENT_POLLER_MAX_EVENTS];
+
+	if (timeout_ms < 0 || timeout_ms > EVENT_POLLER_MAX_WAIT_MS)
+	{
+		timeout_ms = EVENT_POLLER_MAX_WAIT_MS;
+	}
+
+	int ready = epoll_wait(m_epoll_fd, events, EVENT_POLLER_MAX_EVENTS, timeout_ms);
+	if (ready < 0)
+	{
+		if (errno == EINTR)
+		{
+			return 1;
+		}
+		m_log->error("epoll_wait failed : {}", strerror(errno));
+		return -1;
+	}
+
+	// the timeout bounds the delay of a SIGCHLD we didn't receive
+	int tracee_ready = ready == 0 ? 1 : 0;
+
+	for (int idx = 0; idx < ready; idx++)
+	{
+		int fd = events[idx].data.fd;
+
+		if (fd == m_signal_fd)
+		{
+			// several SIGCHLD may be coalesced, the caller drains waitpid
+			struct signalfd_siginfo sig_info;
+			while (read(m_signal_fd, &sig_info, sizeof(sig_info)) == sizeof(sig_info))
+				;
+			tracee_ready = 1;
+			continue;
+		}
+
+		if (m_pidfd_owner.count(fd) > 0)
+		{
+			// process exited, reaped by waitpid and unwatched on drop
+			tracee_ready = 1;
+			continue;
+		}
+
+		auto timer_iter = m_timers.find(fd);
+		if (timer_iter != m_timers.end())
+		{
+			uint64_t expirations = 0;
+			if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+			{
+				continue;
+			}
+			// copied, the callback is allowed to remove its own timer
+			Timer timer = timer_iter->second;
+			if (!timer.periodic)
+			{
+				removeTimer(fd);
+			}
+			timer.callback();
+			continue;
+		}
+
+		auto watch_iter = m_fd_watches.find(fd);
+		if (watch_iter != m_fd_watches.end())
+		{
+			FdCallback callback = watch_iter->second;
+			callback(fd, events[idx].events);
+		}
+	}
+
+	return tracee_ready;
+}
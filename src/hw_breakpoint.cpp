@@ -0,0 +1,58 @@
+#include <algorithm>
+
+#include "hw_breakpoint.hpp"
+#include "tracee.hpp"
+
+HwBreakpoint &HwBreakpoint::addThread(pid_t tid)
+{
+    m_tids.push_back(tid);
+    return *this;
+}
+
+bool HwBreakpoint::armedFor(pid_t tid)
+{
+    return m_tids.empty() || std::find(m_tids.begin(), m_tids.end(), tid) != m_tids.end();
+}
+
+bool HwBreakpoint::armedIn(pid_t tid)
+{
+    return std::find(m_armed_tids.begin(), m_armed_tids.end(), tid) != m_armed_tids.end();
+}
+
+void HwBreakpoint::forgetThread(pid_t tid)
+{
+    m_armed_tids.erase(std::remove(m_armed_tids.begin(), m_armed_tids.end(), tid), m_armed_tids.end());
+    m_enabled = armedAnywhere();
+}
+
+int HwBreakpoint::enable(TraceeProgram &traceeProg)
+{
+    if (m_debug_regs == nullptr || m_slot < 0 || !armedFor(traceeProg.pid()))
+    {
+        return 0;
+    }
+
+    if (!m_debug_regs->arm(traceeProg.pid(), m_slot, m_addr, m_hw_type, m_len))
+    {
+        m_log->error("Unable to arm hardware breakpoint 0x{:x} in {}", m_addr, traceeProg.pid());
+        return 0;
+    }
+    if (!armedIn(traceeProg.pid()))
+    {
+        m_armed_tids.push_back(traceeProg.pid());
+    }
+    m_enabled = true;
+    return 1;
+}
+
+int HwBreakpoint::disable(TraceeProgram &traceeProg)
+{
+    if (m_debug_regs == nullptr || m_slot < 0 || !armedFor(traceeProg.pid()))
+    {
+        return 0;
+    }
+
+    m_debug_regs->disarm(traceeProg.pid(), m_slot);
+    forgetThread(traceeProg.pid());
+    return 1;
+}
@@ -9,22 +9,22 @@ void TraceeEvent::print() {
 	// spdlog::debug("[{}] TraceeStatus", pid);
 	switch (type) {
 		case TraceeEvent::EXITED :
-			spdlog::debug("EXITED : {}",exited.status);
+			SPDLOG_DEBUG("EXITED : {}",exited.status);
 			break;
 		case TraceeEvent::SIGNALED:
-			spdlog::debug("SIGNALED : {}",signaled.signal);
+			SPDLOG_DEBUG("SIGNALED : {}",signaled.signal);
 			break;
 		case TraceeEvent::STOPPED:
-			spdlog::debug("STOPPED : signal {} {}",stopped.signal, stopped.status);
+			SPDLOG_DEBUG("STOPPED : signal {} {}",stopped.signal, stopped.status);
 			break;
 		case TraceeEvent::CONTINUED:
-			spdlog::debug("CONTINUED");
+			SPDLOG_DEBUG("CONTINUED");
 			break;
 		case TraceeEvent::INVALID:
-			spdlog::debug("INVALID");
+			SPDLOG_DEBUG("INVALID");
 			break;
 		default:
-			spdlog::debug("Don't Know");
+			SPDLOG_DEBUG("Don't Know");
 			break;
 	}
 
@@ -35,33 +35,62 @@ TraceeEvent::~TraceeEvent() {
 	type = TraceeEvent::INVALID;
 }
 
-int get_wait_event(pid_t pid, DebugEventPtr& debug_event) {
-    int child_status;
-    int wait_ret = waitpid(pid, &child_status, WNOHANG | WCONTINUED);
-    if (wait_ret == -1) {
-        spdlog::error("waitpid failed !");
-    }
-	if (wait_ret == 0) {
-		// this is no event for the child, exit no futher detail needed
-		spdlog::warn("There is no event for the child, exit no futher detail needed!");
-		return -1;
+/**
+ * @brief Free events of the thread, events are taken and given back by the
+ * event loop of the same thread
+ */
+struct DebugEventPool {
+	DebugEvent* m_free = nullptr;
+
+	/// @brief the thread is exiting, events released later are freed
+	bool m_closed = false;
+
+	~DebugEventPool() {
+		m_closed = true;
+		while (m_free) {
+			DebugEvent* next = m_free->m_next;
+			delete m_free;
+			m_free = next;
+		}
+	}
+};
+
+static thread_local DebugEventPool debug_event_pool;
+
+DebugEventPtr DebugEvent::allocate() {
+	DebugEvent* debug_event = debug_event_pool.m_free;
+	if (debug_event == nullptr)
+		return DebugEventPtr(new DebugEvent());
+
+	debug_event_pool.m_free = debug_event->m_next;
+	debug_event->m_next = nullptr;
+	debug_event->m_pid = 0;
+	debug_event->makeInvalid();
+	return DebugEventPtr(debug_event);
+}
+
+void DebugEventRecycler::operator()(DebugEvent* debug_event) const {
+	if (debug_event_pool.m_closed) {
+		delete debug_event;
+		return;
 	}
+	debug_event->m_next = debug_event_pool.m_free;
+	debug_event_pool.m_free = debug_event;
+}
+
+int decode_wait_status(int child_status, DebugEventPtr& debug_event) {
 	if (WIFSIGNALED(child_status)) {
-		// cout << "WIFSIGNALED" << endl;
 		debug_event->event.type = TraceeEvent::SIGNALED;
 		debug_event->event.signaled.signal = WTERMSIG(child_status);
 		debug_event->event.signaled.dumped =  WCOREDUMP(child_status);
 	} else if (WIFEXITED(child_status)) {
-		// cout << "WIFEXITED" << endl;
 		debug_event->event.type = TraceeEvent::EXITED;
 		debug_event->event.exited.status = WEXITSTATUS(child_status);
 	} else if (WIFSTOPPED(child_status)) {
-		// cout << "WIFSTOPPED" << endl;
 		debug_event->event.type = TraceeEvent::STOPPED;
 		debug_event->event.stopped.signal = WSTOPSIG(child_status);
 		debug_event->event.stopped.status = child_status;
 	} else if (WIFCONTINUED(child_status)) {
-		// cout << "WIFCONTINUED" << endl;
 		debug_event->event.type = TraceeEvent::CONTINUED;
 	} else {
 		spdlog::error("Unreachable Tracee state please handle it!");
@@ -71,26 +100,43 @@ int get_wait_event(pid_t pid, DebugEventPtr& debug_event) {
 	return 0;
 }
 
+int get_wait_event(pid_t pid, DebugEventPtr& debug_event) {
+    int child_status;
+    int wait_ret = waitpid(pid, &child_status, WNOHANG | WCONTINUED);
+    if (wait_ret == -1) {
+        spdlog::error("waitpid failed !");
+    }
+	if (wait_ret == 0) {
+		// this is no event for the child, exit no futher detail needed
+		spdlog::warn("There is no event for the child, exit no futher detail needed!");
+		return -1;
+	}
+	return decode_wait_status(child_status, debug_event);
+}
+
 void TrapReason::print() {
-	spdlog::debug("[{}] TrapReason", pid);
+	SPDLOG_DEBUG("[{}] TrapReason", pid);
 	switch (status) {
 		case TrapReason::EXEC :
-			spdlog::debug("EXITED");
+			SPDLOG_DEBUG("EXITED");
 			break;
 		case TrapReason::FORK:
-			spdlog::debug("FORK");
+			SPDLOG_DEBUG("FORK");
 			break;
 		case TrapReason::BREAKPOINT:
-			spdlog::debug("BREAKPOINT");
+			SPDLOG_DEBUG("BREAKPOINT");
+			break;
+		case TrapReason::HW_BREAKPOINT:
+			SPDLOG_DEBUG("HW BREAKPOINT");
 			break;
 		case TrapReason::SYSCALL:
-			spdlog::debug("SYSCALL");
+			SPDLOG_DEBUG("SYSCALL");
 			break;
 		case TrapReason::ERROR:
-			spdlog::debug("ERROR");
+			SPDLOG_DEBUG("ERROR");
 			break;
 		case TrapReason::INVALID:
-			spdlog::debug("INVALID");
+			SPDLOG_DEBUG("INVALID");
 			break;
 	}
 }
@@ -2,51 +2,143 @@
 #include <sys/ptrace.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <algorithm>
 
 #include "spdlog/spdlog.h"
 #include "spdlog/fmt/bin_to_hex.h"
 #include "memory.hpp"
+#include "modules.hpp"
 
-Addr::Addr(uint64_t _r_addr, size_t _size)
-    : m_size(_size), r_addr(_r_addr)
+void Addr::allocate(size_t _size)
+{
+    if (_size <= ADDR_INLINE_SIZE)
+    {
+        m_data = m_inline;
+        m_capacity = ADDR_INLINE_SIZE;
+        m_owned = false;
+    }
+    else
+    {
+        m_data = (uint8_t *)malloc(_size);
+        m_capacity = _size;
+        m_owned = true;
+    }
+}
+
+void Addr::release()
 {
-    if (_size < 8)
+    if (m_owned)
     {
-        _size = 8;
+        free(m_data);
     }
-    m_data = (uint8_t *)malloc(_size);
+    m_data = nullptr;
+    m_capacity = 0;
+    m_owned = false;
+}
+
+Addr::Addr(uint64_t _r_addr, size_t _size)
+    : r_addr(_r_addr), m_size(_size)
+{
+    allocate(_size);
 }
 
 Addr::Addr(size_t _size)
-    : m_size(_size), r_addr(0)
+    : r_addr(0), m_size(_size)
+{
+    allocate(_size);
+}
+
+Addr::Addr(AddrArena &arena, uint64_t _r_addr, size_t _size)
+    : r_addr(_r_addr), m_size(_size)
+{
+    if (_size <= ADDR_INLINE_SIZE)
+    {
+        allocate(_size);
+    }
+    else
+    {
+        m_data = arena.allocate(_size);
+        m_capacity = _size;
+    }
+}
+
+Addr::Addr(const Addr &addrObj)
+    : r_addr(addrObj.r_addr), m_size(addrObj.m_size)
 {
-    if (_size < 8)
+    if (addrObj.m_data != nullptr)
     {
-        _size = 8;
+        allocate(m_size);
+        memcpy(m_data, addrObj.m_data, m_size);
     }
-    m_data = (uint8_t *)malloc(_size);
 }
 
-Addr::Addr(Addr &addrObj)
+Addr::Addr(Addr &&addrObj)
 {
+    *this = std::move(addrObj);
+}
+
+Addr &Addr::operator=(const Addr &addrObj)
+{
+    if (this != &addrObj)
+    {
+        release();
+        m_size = addrObj.m_size;
+        r_addr = addrObj.r_addr;
+        if (addrObj.m_data != nullptr)
+        {
+            allocate(m_size);
+            memcpy(m_data, addrObj.m_data, m_size);
+        }
+    }
+    return *this;
+}
+
+Addr &Addr::operator=(Addr &&addrObj)
+{
+    if (this == &addrObj)
+    {
+        return *this;
+    }
+
+    release();
     m_size = addrObj.m_size;
     r_addr = addrObj.r_addr;
-    m_data = (uint8_t *)malloc(m_size);
-    memcpy(m_data, addrObj.m_data, addrObj.m_size);
+
+    if (addrObj.m_data == addrObj.m_inline)
+    {
+        // inline storage can't be stolen, copy it over
+        memcpy(m_inline, addrObj.m_inline, ADDR_INLINE_SIZE);
+        m_data = m_inline;
+        m_capacity = ADDR_INLINE_SIZE;
+    }
+    else
+    {
+        m_data = addrObj.m_data;
+        m_capacity = addrObj.m_capacity;
+        m_owned = addrObj.m_owned;
+    }
+
+    addrObj.m_data = nullptr;
+    addrObj.m_capacity = 0;
+    addrObj.m_owned = false;
+    addrObj.m_size = 0;
+    addrObj.r_addr = 0;
+    return *this;
 }
 
 void Addr::print()
 {
     auto log = spdlog::get("main");
-    std::vector<uint8_t> hex_data_copy(m_size);
-    memcpy(hex_data_copy.data(), m_data, m_size);
-    log->warn("Addr | raddr 0x{:x}, size {}, data {:Xpn}", r_addr, m_size, spdlog::to_hex(hex_data_copy));
+    if (!log->should_log(spdlog::level::warn))
+        return;
+    log->warn("Addr | raddr 0x{:x}, size {}, data {:Xpn}", r_addr, m_size, spdlog::to_hex(m_data, m_data + m_size));
 }
 
 Addr::~Addr()
 {
-    free(m_data);
-    m_data = NULL;
+    release();
     r_addr = 0;
     m_size = 0;
 }
@@ -59,8 +151,24 @@ void Addr::clean()
 
 void Addr::resize(uint64_t new_size)
 {
+    if (new_size > m_capacity)
+    {
+        uint8_t *old_data = m_data;
+        bool old_owned = m_owned;
+
+        m_data = (uint8_t *)malloc(new_size);
+        m_capacity = new_size;
+        m_owned = true;
+        if (old_data != nullptr)
+        {
+            memcpy(m_data, old_data, m_size);
+        }
+        if (old_owned)
+        {
+            free(old_data);
+        }
+    }
     m_size = new_size;
-    m_data = (uint8_t *)realloc(m_data, new_size);
 }
 
 int8_t Addr::read_i8()
@@ -193,130 +301,799 @@ int64_t Addr::read_i64()
     return value;
 }
 
-// ------------- REMOTE MEMORY MANAGEMENT ---------------
-#include <stdlib.h>
+// ------------- ARENA ---------------
 
-RemoteMemory::RemoteMemory(pid_t tracee_pid)
+AddrArena::~AddrArena()
 {
-    m_pid = tracee_pid;
-    // O_RDWR
-#ifdef SUPPORT_MEM_FILE
-    char path[100] = {0};
+    reset();
+    for (auto block : m_blocks)
+    {
+        free(block);
+    }
+    m_blocks.clear();
+}
+
+uint8_t *AddrArena::allocate(size_t size)
+{
+    // keep the buffers aligned for the typed reads
+    size = (size + 7) & ~(size_t)7;
 
-    sprintf(path, "/proc/%d/mem", m_pid);
-    m_mem_fd = fopen(path, "rb+");
+    if (size > ADDR_ARENA_BLOCK_SIZE / 4)
+    {
+        uint8_t *large_alloc = (uint8_t *)malloc(size);
+        m_large_allocs.push_back(large_alloc);
+        return large_alloc;
+    }
+
+    if (m_blocks.empty() || m_offset + size > ADDR_ARENA_BLOCK_SIZE)
+    {
+        if (!m_blocks.empty())
+        {
+            m_block_idx++;
+        }
+        if (m_block_idx == m_blocks.size())
+        {
+            m_blocks.push_back((uint8_t *)malloc(ADDR_ARENA_BLOCK_SIZE));
+        }
+        m_offset = 0;
+    }
 
-    // m_mem_file = new std::fstream(path,
-    //     std::ios::binary | std::ios::in | std::ios::out);
+    uint8_t *buf = m_blocks[m_block_idx] + m_offset;
+    m_offset += size;
+    return buf;
+}
 
-    // if (m_mem_file->is_open()) {
-    if (m_mem_fd != NULL)
+void AddrArena::reset()
+{
+    for (auto large_alloc : m_large_allocs)
     {
-        spdlog::info("Mem file {} is open!", path);
+        free(large_alloc);
+    }
+    m_large_allocs.clear();
+    m_block_idx = 0;
+    m_offset = 0;
+}
+
+// ------------- PAGE CACHE ---------------
+
+PageCache::~PageCache()
+{
+    clear();
+    for (auto page : m_free_pages)
+    {
+        delete page;
+    }
+    m_free_pages.clear();
+}
+
+const uint8_t *PageCache::lookup(uintptr_t page_addr)
+{
+    auto page_iter = m_pages.find(page_addr);
+    if (page_iter != m_pages.end())
+    {
+        CachedPage *page = page_iter->second;
+        if (page->m_persistent || page->m_epoch == m_epoch)
+        {
+            m_stats.hits++;
+            return page->m_data;
+        }
+    }
+    m_stats.misses++;
+    return nullptr;
+}
+
+uint8_t *PageCache::insert(uintptr_t page_addr, bool persistent)
+{
+    CachedPage *page = nullptr;
+    auto page_iter = m_pages.find(page_addr);
+
+    if (page_iter != m_pages.end())
+    {
+        // stale page, refill it in place
+        page = page_iter->second;
     }
     else
     {
-        spdlog::info("Error opening {} Mem file!", path);
+        if (m_pages.size() >= m_max_pages)
+        {
+            evict();
+        }
+
+        if (!m_free_pages.empty())
+        {
+            page = m_free_pages.back();
+            m_free_pages.pop_back();
+        }
+        else
+        {
+            page = new CachedPage;
+        }
+        m_pages[page_addr] = page;
+    }
+
+    page->m_epoch = m_epoch;
+    page->m_persistent = persistent;
+    return page->m_data;
+}
+
+void PageCache::evict()
+{
+    // first get rid of the pages from the previous stops
+    for (auto page_iter = m_pages.begin(); page_iter != m_pages.end();)
+    {
+        CachedPage *page = page_iter->second;
+        if (!page->m_persistent && page->m_epoch != m_epoch)
+        {
+            m_free_pages.push_back(page);
+            page_iter = m_pages.erase(page_iter);
+        }
+        else
+        {
+            ++page_iter;
+        }
+    }
+
+    if (m_pages.size() >= m_max_pages)
+    {
+        clear();
+    }
+}
+
+void PageCache::drop(uintptr_t page_addr)
+{
+    auto page_iter = m_pages.find(page_addr);
+    if (page_iter != m_pages.end())
+    {
+        m_free_pages.push_back(page_iter->second);
+        m_pages.erase(page_iter);
+    }
+}
+
+void PageCache::invalidate(uintptr_t addr, size_t len)
+{
+    uintptr_t page_addr = addr & ~(uintptr_t)(PAGE_CACHE_BLOCK_SIZE - 1);
+    uintptr_t end_addr = addr + len;
+
+    if (len / PAGE_CACHE_BLOCK_SIZE > m_pages.size())
+    {
+        // range is bigger than the cache, walk the cache instead
+        for (auto page_iter = m_pages.begin(); page_iter != m_pages.end();)
+        {
+            if (page_iter->first + PAGE_CACHE_BLOCK_SIZE > addr && page_iter->first < end_addr)
+            {
+                m_free_pages.push_back(page_iter->second);
+                page_iter = m_pages.erase(page_iter);
+                m_stats.invalidations++;
+            }
+            else
+            {
+                ++page_iter;
+            }
+        }
+        return;
+    }
+
+    for (; page_addr < end_addr; page_addr += PAGE_CACHE_BLOCK_SIZE)
+    {
+        auto page_iter = m_pages.find(page_addr);
+        if (page_iter != m_pages.end())
+        {
+            m_free_pages.push_back(page_iter->second);
+            m_pages.erase(page_iter);
+            m_stats.invalidations++;
+        }
+    }
+}
+
+void PageCache::clear()
+{
+    m_stats.invalidations += m_pages.size();
+    for (auto &page_entry : m_pages)
+    {
+        m_free_pages.push_back(page_entry.second);
+    }
+    m_pages.clear();
+    m_volatile_ranges.clear();
+    m_volatile_overflow = 0;
+}
+
+void PageCache::markVolatile(uintptr_t addr, size_t len, uint64_t stamp)
+{
+    const uintptr_t page_mask = PAGE_CACHE_BLOCK_SIZE - 1;
+    uintptr_t start = addr & ~page_mask;
+    uintptr_t end = len > UINTPTR_MAX - addr ? UINTPTR_MAX : addr + len;
+    end = end > UINTPTR_MAX - page_mask ? UINTPTR_MAX : (end + page_mask) & ~page_mask;
+
+    // merge with the ranges it overlaps or touches, the merged range
+    // takes the newest stamp
+    auto range_iter = m_volatile_ranges.upper_bound(start);
+    if (range_iter != m_volatile_ranges.begin())
+    {
+        auto prev_iter = std::prev(range_iter);
+        if (prev_iter->second.m_end >= start)
+        {
+            start = prev_iter->first;
+            end = std::max(end, prev_iter->second.m_end);
+            range_iter = prev_iter;
+        }
+    }
+    while (range_iter != m_volatile_ranges.end() && range_iter->first <= end)
+    {
+        end = std::max(end, range_iter->second.m_end);
+        range_iter = m_volatile_ranges.erase(range_iter);
+    }
+
+    if (m_volatile_ranges.size() >= PAGE_CACHE_DEFAULT_PAGES)
+    {
+        // too many remaps to keep track of, stop trusting the maps parsed
+        // so far, the ones parsed later don't need the ranges
+        m_volatile_overflow = stamp;
+        m_volatile_ranges.clear();
+        return;
+    }
+
+    VolatileRange range = {end, stamp};
+    m_volatile_ranges[start] = range;
+}
+
+bool PageCache::isVolatile(uintptr_t page_addr, uint64_t map_generation)
+{
+    if (map_generation <= m_volatile_overflow)
+    {
+        return true;
+    }
+
+    auto range_iter = m_volatile_ranges.upper_bound(page_addr);
+    if (range_iter == m_volatile_ranges.begin())
+    {
+        return false;
+    }
+    --range_iter;
+    return page_addr < range_iter->second.m_end && range_iter->second.m_stamp >= map_generation;
+}
+
+// ------------- /proc/<pid>/mem ---------------
+
+bool MemFile::open()
+{
+    if (m_fd.load(std::memory_order_acquire) >= 0)
+    {
+        return true;
+    }
+
+    // the tracer threads of the shards may share the handle
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (m_fd.load(std::memory_order_relaxed) >= 0)
+    {
+        return true;
+    }
+
+    if (m_failed)
+    {
+        return false;
+    }
+
+    char path[64] = {0};
+    snprintf(path, sizeof(path), "/proc/%d/mem", m_pid);
+    int fd = ::open(path, O_RDWR | O_CLOEXEC);
+    m_read_only = false;
+
+    if (fd < 0 && errno == EACCES)
+    {
+        // still usable for reads, writes go through the other backends
+        fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        m_read_only = true;
+    }
+
+    if (fd < 0)
+    {
+        spdlog::debug("Error opening {} Mem file : {}", path, strerror(errno));
+        m_failed = true;
+        return false;
+    }
+    m_fd.store(fd, std::memory_order_release);
+    return true;
+}
+
+void MemFile::close()
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    int fd = m_fd.exchange(-1);
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+void MemFile::reopen(pid_t pid)
+{
+    close();
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_pid = pid;
+    m_failed = false;
+    m_read_only = false;
+}
+
+ssize_t MemFile::read(uintptr_t _remote_addr, uint8_t *_buf, size_t _len)
+{
+    if (!open())
+    {
+        return -1;
+    }
+    return pread(m_fd.load(std::memory_order_relaxed), _buf, _len, static_cast<off_t>(_remote_addr));
+}
+
+ssize_t MemFile::write(uintptr_t _remote_addr, const uint8_t *_buf, size_t _len)
+{
+    if (!open() || m_read_only)
+    {
+        return -1;
     }
-#endif
+    return pwrite(m_fd.load(std::memory_order_relaxed), _buf, _len, static_cast<off_t>(_remote_addr));
+}
+
+// ------------- REMOTE MEMORY MANAGEMENT ---------------
+
+/// @brief number of ranges handed to a single process_vm_readv call
+#define REMOTE_IOV_BATCH 64
+RemoteMemory::RemoteMemory(pid_t tracee_pid)
+    : m_mem_file(std::make_shared<MemFile>(tracee_pid))
+{
+    m_pid = tracee_pid;
 }
 
 RemoteMemory::~RemoteMemory()
 {
-#ifdef SUPPORT_MEM_FILE
-    // m_mem_file->close();
-    // m_mem_file = nullptr;
-#endif
+    // a Tracee may be dropped while running, don't keep the other threads
+    // of the process away from the page cache
+    onStop();
     m_pid = 0;
 };
 
-int RemoteMemory::readRemoteAddrObj(Addr &dest, size_t readSize)
+void RemoteMemory::enablePageCache(size_t max_pages, bool persist_text)
 {
+    m_page_cache = std::make_shared<PageCache>(max_pages, persist_text);
+}
+
+void RemoteMemory::shareAddressSpace(RemoteMemory &other)
+{
+    m_page_cache = other.m_page_cache;
+    m_mem_file = other.m_mem_file;
+}
+
+ssize_t RemoteMemory::readProcessVm(uintptr_t _remote_addr, uint8_t *_buf, size_t _len)
+{
+    struct iovec local_iov = {_buf, _len};
+    struct iovec remote_iov = {reinterpret_cast<void *>(_remote_addr), _len};
 
-    unsigned int bytes_read = 0;
-#ifdef SUPPORT_MEM_FILE
-    // m_mem_file->seekg(dest.r_addr);
-    // m_mem_file->read((char *)m_data, readSize);
+    ssize_t ret = process_vm_readv(m_pid, &local_iov, 1, &remote_iov, 1, 0);
+    if (ret < 0 && (errno == ENOSYS || errno == EPERM))
+    {
+        spdlog::debug("process_vm_readv not usable for {} ({}), falling back", m_pid, strerror(errno));
+        m_backend = MemoryBackend::MEM_FILE;
+    }
+    return ret;
+}
 
-    if (fseeko(m_mem_fd, dest.raddr(), SEEK_SET) != -1)
+ssize_t RemoteMemory::writeProcessVm(uintptr_t _remote_addr, const uint8_t *_buf, size_t _len)
+{
+    struct iovec local_iov = {const_cast<uint8_t *>(_buf), _len};
+    struct iovec remote_iov = {reinterpret_cast<void *>(_remote_addr), _len};
+
+    ssize_t ret = process_vm_writev(m_pid, &local_iov, 1, &remote_iov, 1, 0);
+    if (ret < 0 && (errno == ENOSYS || errno == EPERM))
     {
-        bytes_read = fread((void *)dest.m_data, 1, readSize, m_mem_fd);
-        if (bytes_read != -1)
+        spdlog::debug("process_vm_writev not usable for {} ({}), falling back", m_pid, strerror(errno));
+        m_backend = MemoryBackend::MEM_FILE;
+    }
+    return ret;
+}
+
+ssize_t RemoteMemory::readMemFile(uintptr_t _remote_addr, uint8_t *_buf, size_t _len)
+{
+    ssize_t ret = m_mem_file->read(_remote_addr, _buf, _len);
+    if (ret < 0 && m_mem_file->failed() && m_backend == MemoryBackend::MEM_FILE)
+    {
+        m_backend = MemoryBackend::PTRACE;
+    }
+    return ret;
+}
+
+ssize_t RemoteMemory::writeMemFile(uintptr_t _remote_addr, const uint8_t *_buf, size_t _len)
+{
+    ssize_t ret = m_mem_file->write(_remote_addr, _buf, _len);
+    if (ret < 0 && m_mem_file->failed() && m_backend == MemoryBackend::MEM_FILE)
+    {
+        m_backend = MemoryBackend::PTRACE;
+    }
+    return ret;
+}
+
+ssize_t RemoteMemory::readPtrace(uintptr_t _remote_addr, uint8_t *_buf, size_t _len)
+{
+    size_t bytes_read = 0;
+
+    // Tracee memory is read one word at a time, the address doesn't
+    // need to be aligned but the last word might be partially copied
+    while (bytes_read < _len)
+    {
+        errno = 0;
+        long word = ptrace(PTRACE_PEEKDATA, m_pid, _remote_addr + bytes_read, NULL);
+        if (errno != 0)
         {
-            spdlog::info("Read done {} {}", dest.raddr(), readSize);
-            return 0;
+            break;
         }
-        spdlog::error("Read not done");
+
+        size_t chunk = std::min(sizeof(long), _len - bytes_read);
+        memcpy(_buf + bytes_read, &word, chunk);
+        bytes_read += chunk;
     }
-    else
+
+    return bytes_read > 0 ? static_cast<ssize_t>(bytes_read) : -1;
+}
+
+ssize_t RemoteMemory::writePtrace(uintptr_t _remote_addr, const uint8_t *_buf, size_t _len)
+{
+    size_t bytes_write = 0;
+
+    while (bytes_write < _len)
+    {
+        uintptr_t write_addr = _remote_addr + bytes_write;
+        size_t chunk = _len - bytes_write;
+        long word = 0;
+
+        if (chunk < sizeof(long))
+        {
+            // partial word, merge the remaining bytes with the
+            // existing content of the Tracee memory
+            errno = 0;
+            word = ptrace(PTRACE_PEEKDATA, m_pid, write_addr, NULL);
+            if (errno != 0)
+            {
+                break;
+            }
+        }
+        else
+        {
+            chunk = sizeof(long);
+        }
+
+        memcpy(&word, _buf + bytes_write, chunk);
+        if (ptrace(PTRACE_POKEDATA, m_pid, write_addr, word) < 0)
+        {
+            break;
+        }
+        bytes_write += chunk;
+    }
+
+    return bytes_write > 0 ? static_cast<ssize_t>(bytes_write) : -1;
+}
+
+ssize_t RemoteMemory::readDirect(uintptr_t _remote_addr, uint8_t *buf, size_t _len)
+{
+    size_t done = 0;
+    ssize_t ret;
+
+    if (_len == 0)
     {
-        spdlog::error("Seek not done!");
+        return 0;
     }
-    return 0;
-#else
-    if (readSize < 8)
+
+    if (m_backend == MemoryBackend::PROCESS_VM)
     {
-        readSize = 8;
+        ret = readProcessVm(_remote_addr, buf, _len);
+        if (ret > 0)
+        {
+            done = ret;
+        }
     }
 
-    memset(dest.m_data, 0, readSize);
+    // process_vm_readv stops at the first page it can't access (e.g. PROT_NONE),
+    // /proc/<pid>/mem and ptrace can still read those.
+    if (done < _len && m_backend != MemoryBackend::PTRACE)
+    {
+        ret = readMemFile(_remote_addr + done, buf + done, _len - done);
+        if (ret > 0)
+        {
+            done += ret;
+        }
+    }
 
-    long *read_addr = (long *)dest.raddr();
-    long *copy_addr = (long *)dest.m_data;
-    unsigned long ret;
+    if (done < _len)
+    {
+        ret = readPtrace(_remote_addr + done, buf + done, _len - done);
+        if (ret > 0)
+        {
+            done += ret;
+        }
+    }
+
+    if (done == 0)
+    {
+        spdlog::debug("Failed to read {} bytes at 0x{:x} from {}", _len, _remote_addr, m_pid);
+        return -1;
+    }
+    return done;
+}
+
+/// @brief read-only private file mapping, its pages only change when
+/// they are remapped
+static bool isTextRegion(const ProcMap *region)
+{
+    return region->inode != 0 && (region->perms & ProcMap::PERMS_READ) &&
+        !(region->perms & (ProcMap::PERMS_WRITE | ProcMap::PERMS_SHARED));
+}
 
-    do
+bool RemoteMemory::isTextPage(uintptr_t page_addr)
+{
+    if (!m_page_cache->persistText() || m_proc_map == nullptr)
     {
-        ret = ptrace(PTRACE_PEEKTEXT, m_pid, (read_addr++), NULL);
-        // printf("RD : %p\n", ret);
-        *(copy_addr++) = ret;
-        bytes_read += sizeof(long);
-    } while (ret && bytes_read < (readSize - sizeof(long)));
+        return false;
+    }
 
-    // spdlog::debug("read pid : {}", m_pid);
+    ProcMap *region = m_proc_map->findRegion(page_addr);
+    if (region == nullptr || !isTextRegion(region))
+    {
+        return false;
+    }
 
-    return bytes_read;
-#endif
+    return !m_page_cache->isVolatile(page_addr, m_proc_map->generation());
 }
 
-int RemoteMemory::writeRemoteAddrObj(Addr &dest, size_t writeSize)
+void RemoteMemory::onMappingChange(uintptr_t _remote_addr, size_t _len)
 {
+    if (!m_page_cache)
+    {
+        return;
+    }
+
+    m_page_cache->invalidate(_remote_addr, _len);
+    if (!m_page_cache->persistText() || m_proc_map == nullptr)
+    {
+        return;
+    }
 
-    uint32_t bytes_write = 0;
-#ifdef SUPPORT_MEM_FILE
-    // m_mem_file->seekg(dest.r_addr);
-    // m_mem_file->write((char *)m_data, writeSize);
-    if (fseeko(m_mem_fd, dest.raddr(), SEEK_SET) != -1)
+    // only the text pages of the parsed map are trusted across stops, the
+    // other remaps (heap, stacks, anonymous mmap) don't need to be tracked
+    uintptr_t end_addr = _len > UINTPTR_MAX - _remote_addr ? UINTPTR_MAX : _remote_addr + _len;
+    for (const ProcMap *region : m_proc_map->regions())
     {
-        bytes_write = fwrite((void *)dest.m_data, 1, writeSize, m_mem_fd);
-        if (bytes_write != -1)
+        if (region->addr_begin >= end_addr)
         {
-            spdlog::info("Write done {} {}", dest.raddr(), bytes_write);
-            return 0;
-        };
-        spdlog::error("Write not done");
+            break;
+        }
+        if (region->addr_end > _remote_addr && isTextRegion(region))
+        {
+            m_page_cache->markVolatile(_remote_addr, _len, ProcessMap::lastGeneration());
+            return;
+        }
     }
-    else
+}
+
+ssize_t RemoteMemory::readCached(uintptr_t _remote_addr, uint8_t *_buf, size_t _len)
+{
+    size_t done = 0;
+
+    if (_len == 0)
+    {
+        return 0;
+    }
+
+    while (done < _len)
+    {
+        uintptr_t cur_addr = _remote_addr + done;
+        uintptr_t page_addr = cur_addr & ~(uintptr_t)(PAGE_CACHE_BLOCK_SIZE - 1);
+        size_t page_off = cur_addr - page_addr;
+        size_t chunk = std::min(PAGE_CACHE_BLOCK_SIZE - page_off, _len - done);
+
+        const uint8_t *page_data = m_page_cache->lookup(page_addr);
+        if (page_data == nullptr)
+        {
+            bool persistent = isTextPage(page_addr);
+            if (!persistent && !m_page_cache->stable())
+            {
+                // another thread is running, the page may change under us
+                ssize_t ret = readDirect(cur_addr, _buf + done, chunk);
+                if (ret > 0)
+                {
+                    done += ret;
+                }
+                if (ret != static_cast<ssize_t>(chunk))
+                {
+                    break;
+                }
+                continue;
+            }
+
+            uint8_t *page_slot = m_page_cache->insert(page_addr, persistent);
+            if (readDirect(page_addr, page_slot, PAGE_CACHE_BLOCK_SIZE) != PAGE_CACHE_BLOCK_SIZE)
+            {
+                // page is not entirely accessible, read the rest without caching
+                m_page_cache->drop(page_addr);
+                ssize_t ret = readDirect(cur_addr, _buf + done, _len - done);
+                if (ret > 0)
+                {
+                    done += ret;
+                }
+                break;
+            }
+            page_data = page_slot;
+        }
+
+        memcpy(_buf + done, page_data + page_off, chunk);
+        done += chunk;
+    }
+
+    return done > 0 ? static_cast<ssize_t>(done) : -1;
+}
+
+ssize_t RemoteMemory::readRemote(uintptr_t _remote_addr, void *_buf, size_t _len)
+{
+    uint8_t *buf = reinterpret_cast<uint8_t *>(_buf);
+
+    if (m_page_cache && _len <= PAGE_CACHE_MAX_READ)
     {
-        spdlog::error("Seek not done!");
+        return readCached(_remote_addr, buf, _len);
     }
-    return 0;
-#else
-    long *write_addr = (long *)dest.raddr();
-    long *copy_addr = (long *)dest.m_data;
-    long ret;
+    return readDirect(_remote_addr, buf, _len);
+}
+
+ssize_t RemoteMemory::writeRemote(uintptr_t _remote_addr, const void *_buf, size_t _len)
+{
+    const uint8_t *buf = reinterpret_cast<const uint8_t *>(_buf);
+    size_t done = 0;
+    ssize_t ret;
 
-    do
+    if (_len == 0)
     {
-        ret = ptrace(PTRACE_POKEDATA, m_pid, (write_addr++), *(copy_addr++));
-        // printf("WD : %lu \t", ret);
-        bytes_write += sizeof(long);
-        // printf("%lu %lu %d\n", bytes_write , (writeSize - sizeof(long)), ret > -1);
-    } while ((ret > -1) && bytes_write < (writeSize - sizeof(long)));
+        return 0;
+    }
 
-    return bytes_write;
-#endif
-    // spdlog::debug("write pid : {}", m_pid);
+    if (m_process_vm_writes && m_backend == MemoryBackend::PROCESS_VM)
+    {
+        ret = writeProcessVm(_remote_addr, buf, _len);
+        if (ret > 0)
+        {
+            done = ret;
+        }
+    }
+
+    // process_vm_writev honours the page protection and fails on the
+    // read-only text pages (e.g. breakpoints), /proc/<pid>/mem doesn't,
+    // so it is tried first for writes.
+    if (done < _len && m_backend != MemoryBackend::PTRACE)
+    {
+        ret = writeMemFile(_remote_addr + done, buf + done, _len - done);
+        if (ret > 0)
+        {
+            done += ret;
+        }
+    }
+
+    if (done < _len && !m_process_vm_writes && m_backend == MemoryBackend::PROCESS_VM)
+    {
+        ret = writeProcessVm(_remote_addr + done, buf + done, _len - done);
+        if (ret > 0)
+        {
+            done += ret;
+        }
+    }
+
+    if (done < _len)
+    {
+        ret = writePtrace(_remote_addr + done, buf + done, _len - done);
+        if (ret > 0)
+        {
+            done += ret;
+        }
+    }
+
+    if (m_page_cache)
+    {
+        m_page_cache->invalidate(_remote_addr, _len);
+    }
+
+    if (done == 0)
+    {
+        spdlog::debug("Failed to write {} bytes at 0x{:x} to {}", _len, _remote_addr, m_pid);
+        return -1;
+    }
+    return done;
+}
+
+int RemoteMemory::readv(RemoteIoVec *_vecs, size_t _count)
+{
+    struct iovec local_iov[REMOTE_IOV_BATCH];
+    struct iovec remote_iov[REMOTE_IOV_BATCH];
+    size_t batch_idx[REMOTE_IOV_BATCH];
+    int completed = 0;
+    size_t idx = 0;
+
+    while (idx < _count)
+    {
+        size_t batch_len = 0;
+
+        // collect the next batch, NULL pointers and empty ranges are
+        // resolved without going to the kernel
+        for (; idx < _count && batch_len < REMOTE_IOV_BATCH; idx++)
+        {
+            RemoteIoVec &vec = _vecs[idx];
+            if (vec.len == 0)
+            {
+                vec.result = 0;
+                completed++;
+                continue;
+            }
+
+            if (vec.raddr == 0)
+            {
+                vec.result = -1;
+                continue;
+            }
+
+            vec.result = 0;
+            local_iov[batch_len].iov_base = vec.dest;
+            local_iov[batch_len].iov_len = vec.len;
+            remote_iov[batch_len].iov_base = reinterpret_cast<void *>(vec.raddr);
+            remote_iov[batch_len].iov_len = vec.len;
+            batch_idx[batch_len] = idx;
+            batch_len++;
+        }
+
+        size_t batch_pos = 0;
+        while (batch_pos < batch_len)
+        {
+            ssize_t ret = -1;
+            if (m_backend == MemoryBackend::PROCESS_VM)
+            {
+                ret = process_vm_readv(m_pid, local_iov + batch_pos, batch_len - batch_pos,
+                                       remote_iov + batch_pos, batch_len - batch_pos, 0);
+                if (ret < 0 && (errno == ENOSYS || errno == EPERM))
+                {
+                    m_backend = MemoryBackend::MEM_FILE;
+                }
+            }
+
+            // process_vm_readv stops at the first range it can't transfer,
+            // account the bytes of the ranges which were read in the batch
+            size_t transferred = ret > 0 ? ret : 0;
+            while (batch_pos < batch_len && transferred >= local_iov[batch_pos].iov_len)
+            {
+                RemoteIoVec &vec = _vecs[batch_idx[batch_pos]];
+                transferred -= vec.len;
+                vec.result = vec.len;
+                completed++;
+                batch_pos++;
+            }
+
+            if (batch_pos == batch_len)
+            {
+                break;
+            }
+
+            // the failing range is read on its own with the fallback
+            // backends, then the batch restarts from the next range
+            RemoteIoVec &vec = _vecs[batch_idx[batch_pos]];
+            vec.result = readRemote(vec.raddr, vec.dest, vec.len);
+            if (vec.result == static_cast<ssize_t>(vec.len))
+            {
+                completed++;
+            }
+            batch_pos++;
+        }
+    }
+
+    return completed;
+}
+
+int RemoteMemory::readRemoteAddrObj(Addr &dest, size_t readSize)
+{
+    return readRemote(dest.raddr(), dest.m_data, readSize);
+}
+
+int RemoteMemory::writeRemoteAddrObj(Addr &dest, size_t writeSize)
+{
+    return writeRemote(dest.raddr(), dest.m_data, writeSize);
 }
 
 Addr *RemoteMemory::readPointerObj(uintptr_t _remote_addr, uint64_t _buffer_size)
@@ -326,7 +1103,56 @@ Addr *RemoteMemory::readPointerObj(uintptr_t _remote_addr, uint64_t _buffer_size
     return remote_addr_obj;
 }
 
-int RemoteMemory::read_cstring(Addr *data)
+AddrView RemoteMemory::readView(uintptr_t _remote_addr, size_t _size)
+{
+    uint8_t *buf = m_arena.allocate(_size);
+    ssize_t ret = readRemote(_remote_addr, buf, _size);
+    return AddrView(buf, _remote_addr, ret > 0 ? ret : 0);
+}
+
+int RemoteMemory::readAddr(uintptr_t _remote_addr, size_t _size, Addr &dest)
 {
-    return 0;
+    dest = Addr(m_arena, _remote_addr, _size);
+    return readRemote(_remote_addr, dest.data(), _size);
+}
+
+ssize_t RemoteMemory::read_cstring(uintptr_t _remote_addr, std::string &str, size_t max_len)
+{
+    uint8_t chunk_buf[PAGE_CACHE_BLOCK_SIZE];
+    uintptr_t cur_addr = _remote_addr;
+    // bytes scanned so far, the terminator has to be within max_len bytes
+    size_t scanned = 0;
+
+    str.clear();
+
+    while (scanned < max_len)
+    {
+        // never read past the page boundary, the next page might not be mapped
+        size_t chunk = PAGE_CACHE_BLOCK_SIZE - (cur_addr & (PAGE_CACHE_BLOCK_SIZE - 1));
+        chunk = std::min(chunk, max_len - scanned);
+
+        ssize_t ret = readRemote(cur_addr, chunk_buf, chunk);
+        if (ret <= 0)
+        {
+            return -1;
+        }
+
+        const uint8_t *nul_pos = reinterpret_cast<const uint8_t *>(memchr(chunk_buf, 0, ret));
+        if (nul_pos != nullptr)
+        {
+            str.append(reinterpret_cast<const char *>(chunk_buf), nul_pos - chunk_buf);
+            return str.size();
+        }
+
+        str.append(reinterpret_cast<const char *>(chunk_buf), ret);
+        if (static_cast<size_t>(ret) < chunk)
+        {
+            // rest of the page is not readable
+            return -1;
+        }
+        cur_addr += ret;
+        scanned += ret;
+    }
+
+    return -1;
 }
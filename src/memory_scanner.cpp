@@ -0,0 +1,342 @@
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "memory_scanner.hpp"
+
+// ------------- PATTERNS ---------------
+
+static int hexNibble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+bool ScanPattern::fromString(const std::string &pattern_str, ScanPattern &pattern)
+{
+    pattern.m_bytes.clear();
+    pattern.m_mask.clear();
+
+    size_t pos = 0;
+    while (pos < pattern_str.size())
+    {
+        if (pattern_str[pos] == ' ')
+        {
+            pos++;
+            continue;
+        }
+
+        if (pattern_str[pos] == '?')
+        {
+            pattern.m_bytes.push_back(0x00);
+            pattern.m_mask.push_back(0x00);
+            pos += (pos + 1 < pattern_str.size() && pattern_str[pos + 1] == '?') ? 2 : 1;
+            continue;
+        }
+
+        if (pos + 1 >= pattern_str.size())
+        {
+            return false;
+        }
+
+        int high = hexNibble(pattern_str[pos]);
+        int low = hexNibble(pattern_str[pos + 1]);
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+        pattern.m_bytes.push_back(static_cast<uint8_t>((high << 4) | low));
+        pattern.m_mask.push_back(0xff);
+        pos += 2;
+    }
+
+    return !pattern.m_bytes.empty();
+}
+
+int PatternMatcher::addPattern(ScanPattern pattern)
+{
+    if (pattern.m_bytes.empty() || pattern.m_bytes.size() != pattern.m_mask.size())
+    {
+        return -1;
+    }
+
+    // pick a fully defined byte as anchor, 0x00 and 0xff are common in
+    // memory and produce a lot of candidates so they are used last
+    pattern.m_anchor = -1;
+    for (size_t i = 0; i < pattern.m_bytes.size(); i++)
+    {
+        if (pattern.m_mask[i] != 0xff)
+        {
+            continue;
+        }
+        if (pattern.m_anchor < 0)
+        {
+            pattern.m_anchor = i;
+        }
+        if (pattern.m_bytes[i] != 0x00 && pattern.m_bytes[i] != 0xff)
+        {
+            pattern.m_anchor = i;
+            break;
+        }
+    }
+
+    if (pattern.m_anchor < 0)
+    {
+        return -1;
+    }
+
+    for (size_t i = 0; i < pattern.m_bytes.size(); i++)
+    {
+        pattern.m_bytes[i] &= pattern.m_mask[i];
+    }
+
+    pattern.m_id = m_patterns.size();
+    m_max_size = std::max(m_max_size, pattern.size());
+    m_patterns.push_back(pattern);
+    return pattern.m_id;
+}
+
+bool PatternMatcher::search(const uint8_t *data, size_t len, size_t max_start,
+                            const std::function<bool(size_t, int)> &on_match) const
+{
+    for (const ScanPattern &pattern : m_patterns)
+    {
+        if (pattern.size() > len)
+        {
+            continue;
+        }
+
+        // candidate start offsets are [0, limit)
+        size_t limit = std::min(len - pattern.size() + 1, max_start);
+        size_t anchor = pattern.m_anchor;
+        uint8_t anchor_byte = pattern.m_bytes[anchor];
+        size_t pos = 0;
+
+#if defined(__SSE2__)
+        const __m128i needle = _mm_set1_epi8(static_cast<char>(anchor_byte));
+        for (; pos + 16 <= limit; pos += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos + anchor));
+            unsigned int hits = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+            while (hits)
+            {
+                size_t start = pos + __builtin_ctz(hits);
+                hits &= hits - 1;
+                if (pattern.match(data + start) && !on_match(start, pattern.m_id))
+                {
+                    return false;
+                }
+            }
+        }
+#endif
+
+        while (pos < limit)
+        {
+            const uint8_t *hit = reinterpret_cast<const uint8_t *>(
+                memchr(data + pos + anchor, anchor_byte, limit - pos));
+            if (hit == nullptr)
+            {
+                break;
+            }
+            size_t start = (hit - data) - anchor;
+            if (pattern.match(data + start) && !on_match(start, pattern.m_id))
+            {
+                return false;
+            }
+            pos = start + 1;
+        }
+    }
+    return true;
+}
+
+// ------------- SCANNER ---------------
+
+int MemoryScanner::addPattern(const std::vector<uint8_t> &bytes, const std::vector<uint8_t> &mask)
+{
+    ScanPattern pattern;
+    pattern.m_bytes = bytes;
+    pattern.m_mask = mask;
+    return m_matcher.addPattern(pattern);
+}
+
+int MemoryScanner::addPattern(const std::vector<uint8_t> &bytes)
+{
+    return addPattern(bytes, std::vector<uint8_t>(bytes.size(), 0xff));
+}
+
+int MemoryScanner::addPattern(const std::string &pattern_str)
+{
+    ScanPattern pattern;
+    if (!ScanPattern::fromString(pattern_str, pattern))
+    {
+        m_log->error("Invalid scan pattern : {}", pattern_str);
+        return -1;
+    }
+    return m_matcher.addPattern(pattern);
+}
+
+namespace {
+
+/// @brief part of a region searched by one worker
+struct ScanChunk {
+    const ProcMap *region;
+    uintptr_t addr;
+    size_t len;
+};
+
+} // namespace
+
+size_t MemoryScanner::scanRegions(const std::vector<ProcMap *> &regions, const ScanCallback &on_match)
+{
+    // bytes shared by two consecutive chunks, enough for a match to
+    // start at the end of a chunk and end in the next one
+    size_t overlap = m_matcher.maxPatternSize() - 1;
+    size_t chunk_size = std::max(m_chunk_size, m_matcher.maxPatternSize());
+    std::vector<ScanChunk> chunks;
+
+    for (const ProcMap *region : regions)
+    {
+        if ((region->perms & m_perms_required) != m_perms_required ||
+            (region->perms & m_perms_excluded) != 0)
+        {
+            continue;
+        }
+
+        // not readable through /proc/<pid>/mem or process_vm_readv
+        if (region->path != nullptr && (*region->path == "[vvar]" || *region->path == "[vsyscall]"))
+        {
+            continue;
+        }
+
+        for (uintptr_t addr = region->addr_begin; addr < region->addr_end; addr += chunk_size)
+        {
+            size_t len = std::min<uintptr_t>(chunk_size, region->addr_end - addr);
+            chunks.push_back({region, addr, len});
+        }
+    }
+
+    if (chunks.empty())
+    {
+        return 0;
+    }
+
+    pid_t pid = m_memory.pid();
+    MemoryBackend backend = m_memory.backend();
+    unsigned int thread_count = m_threads ? m_threads : std::thread::hardware_concurrency();
+    thread_count = std::max(1u, std::min<unsigned int>(thread_count, chunks.size()));
+
+    // other threads would get ESRCH from PTRACE_PEEKDATA and skip their
+    // chunks, only the tracer may read the memory
+    if (backend == MemoryBackend::PTRACE)
+    {
+        thread_count = 1;
+    }
+
+    std::atomic<size_t> next_chunk(0);
+    std::atomic<bool> stop(false);
+    std::mutex report_lock;
+    size_t reported = 0;
+
+    auto worker = [&]() {
+        // every worker has its own RemoteMemory, the one of the Tracee holds
+        // the page cache and the arena which are not thread safe
+        RemoteMemory memory(pid);
+        memory.setBackend(backend);
+        std::vector<uint8_t> buffer(chunk_size + overlap);
+
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            size_t idx = next_chunk.fetch_add(1);
+            if (idx >= chunks.size())
+            {
+                break;
+            }
+
+            const ScanChunk &chunk = chunks[idx];
+            size_t read_len = chunk.len + std::min<uintptr_t>(overlap, chunk.region->addr_end - chunk.addr - chunk.len);
+            ssize_t ret = memory.readRemote(chunk.addr, buffer.data(), read_len);
+            if (ret <= 0)
+            {
+                // unmapped since the map was parsed, or not readable at all
+                continue;
+            }
+
+            m_matcher.search(buffer.data(), ret, chunk.len, [&](size_t offset, int pattern_id) {
+                std::lock_guard<std::mutex> guard(report_lock);
+                if (stop.load(std::memory_order_relaxed))
+                {
+                    return false;
+                }
+                ScanMatch match = {chunk.region, chunk.addr + offset, pattern_id};
+                reported++;
+                if (!on_match(match))
+                {
+                    stop.store(true);
+                    return false;
+                }
+                return true;
+            });
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < thread_count; i++)
+    {
+        workers.push_back(std::thread(worker));
+    }
+    worker();
+
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+
+    m_log->debug("Scanned {} chunks with {} threads, {} matches", chunks.size(), thread_count, reported);
+    return reported;
+}
+
+size_t MemoryScanner::scan(const ScanCallback &on_match)
+{
+    if (m_matcher.empty())
+    {
+        return 0;
+    }
+
+    if (m_tracee_running)
+    {
+        m_running_map.setPid(m_memory.pid());
+        if (m_running_map.parse() < 0)
+        {
+            m_log->error("Failed to parse the process map of {}", m_memory.pid());
+            return 0;
+        }
+        return scanRegions(m_running_map.regions(), on_match);
+    }
+
+    if (m_proc_map.regions().empty() && m_proc_map.parse() < 0)
+    {
+        m_log->error("Failed to parse the process map of {}", m_memory.pid());
+        return 0;
+    }
+    return scanRegions(m_proc_map.regions(), on_match);
+}
+
+std::vector<ScanMatch> MemoryScanner::scan()
+{
+    std::vector<ScanMatch> matches;
+    scan([&matches](const ScanMatch &match) {
+        matches.push_back(match);
+        return true;
+    });
+    return matches;
+}
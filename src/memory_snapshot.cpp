@@ -0,0 +1,318 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstring>
+#include <sys/mman.h>
+
+#include "memory_snapshot.hpp"
+
+MemorySnapshot::MemorySnapshot(RemoteMemory &memory, ProcessMap &proc_map)
+    : m_memory(memory), m_proc_map(proc_map)
+{
+    m_page_size = sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief Kernels built without CONFIG_MEM_SOFT_DIRTY accept the clear_refs
+ * request but never flag a page, check once on a page of our own
+ */
+static bool softDirtySupported()
+{
+    static int supported = -1;
+    if (supported >= 0)
+    {
+        return supported;
+    }
+
+    supported = 0;
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    volatile uint8_t *page = reinterpret_cast<volatile uint8_t *>(
+        mmap(nullptr, page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (page == MAP_FAILED)
+    {
+        return supported;
+    }
+
+    int clear_fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    int pagemap_fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    if (clear_fd >= 0 && pagemap_fd >= 0 && write(clear_fd, CLEAR_REFS_SOFT_DIRTY, 1) == 1)
+    {
+        page[0] = 1;
+        uint64_t entry = 0;
+        off_t offset = (reinterpret_cast<uintptr_t>(page) / page_size) * sizeof(uint64_t);
+        if (pread(pagemap_fd, &entry, sizeof(entry), offset) == sizeof(entry))
+        {
+            supported = (entry & PAGEMAP_SOFT_DIRTY) ? 1 : 0;
+        }
+    }
+
+    if (clear_fd >= 0)
+        close(clear_fd);
+    if (pagemap_fd >= 0)
+        close(pagemap_fd);
+    munmap(const_cast<uint8_t *>(page), page_size);
+    return supported;
+}
+
+bool MemorySnapshot::clearSoftDirty()
+{
+    if (!softDirtySupported())
+    {
+        m_log->debug("Soft-dirty tracking not supported by the kernel");
+        return false;
+    }
+
+    char path[64] = {0};
+    snprintf(path, sizeof(path), "/proc/%d/clear_refs", m_memory.pid());
+
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        m_log->debug("Error opening {} : {}", path, strerror(errno));
+        return false;
+    }
+
+    bool ret = write(fd, CLEAR_REFS_SOFT_DIRTY, 1) == 1;
+    if (!ret)
+    {
+        m_log->debug("Soft-dirty tracking not available for {} : {}", m_memory.pid(), strerror(errno));
+    }
+    close(fd);
+    return ret;
+}
+
+int MemorySnapshot::take()
+{
+    m_regions.clear();
+
+    if (m_proc_map.parse() < 0)
+    {
+        m_log->error("Failed to parse the process map of {}", m_memory.pid());
+        return -1;
+    }
+
+    for (const ProcMap *region : m_proc_map.regions())
+    {
+        uint8_t perms = ProcMap::PERMS_READ | ProcMap::PERMS_WRITE | ProcMap::PERMS_PRIVATE;
+        if ((region->perms & perms) != perms)
+        {
+            continue;
+        }
+
+        SnapshotRegion snap_region;
+        snap_region.addr_begin = region->addr_begin;
+        snap_region.addr_end = region->addr_end;
+        if (region->path != nullptr)
+        {
+            snap_region.path = *region->path;
+        }
+        m_regions.push_back(snap_region);
+    }
+
+    // allocate everything before reading, readv needs stable buffers
+    std::vector<RemoteIoVec> vecs;
+    vecs.reserve(m_regions.size());
+    for (auto &snap_region : m_regions)
+    {
+        snap_region.data.resize(snap_region.addr_end - snap_region.addr_begin);
+        vecs.push_back(RemoteIoVec(snap_region.addr_begin, snap_region.data.size(), snap_region.data.data()));
+    }
+
+    m_memory.readv(vecs);
+
+    // only keep the pages which were read, restoring the others would
+    // overwrite the Tracee memory with zeroes
+    size_t kept = 0;
+    for (size_t i = 0; i < vecs.size(); i++)
+    {
+        SnapshotRegion &snap_region = m_regions[i];
+        size_t read_len = vecs[i].result > 0 ? vecs[i].result : 0;
+        read_len -= read_len % m_page_size;
+
+        if (read_len != vecs[i].len)
+        {
+            m_log->warn("Snapshot of region 0x{:x} is incomplete, {} of {} bytes read",
+                        vecs[i].raddr, vecs[i].result, vecs[i].len);
+            snap_region.data.resize(read_len);
+            snap_region.addr_end = snap_region.addr_begin + read_len;
+        }
+
+        if (read_len == 0)
+        {
+            continue;
+        }
+        if (kept != i)
+        {
+            m_regions[kept] = std::move(snap_region);
+        }
+        kept++;
+    }
+    m_regions.resize(kept);
+
+    m_soft_dirty = clearSoftDirty();
+    m_log->debug("Snapshot of {} : {} regions, {} bytes, soft-dirty {}",
+                 m_memory.pid(), m_regions.size(), size(), m_soft_dirty);
+    return 0;
+}
+
+size_t MemorySnapshot::size()
+{
+    size_t total = 0;
+    for (auto &snap_region : m_regions)
+    {
+        total += snap_region.data.size();
+    }
+    return total;
+}
+
+int MemorySnapshot::dirtyPages(std::vector<uintptr_t> &pages, std::vector<const uint8_t *> &baselines)
+{
+    pages.clear();
+    baselines.clear();
+
+    if (!m_soft_dirty)
+    {
+        for (auto &snap_region : m_regions)
+        {
+            for (uintptr_t addr = snap_region.addr_begin; addr < snap_region.addr_end; addr += m_page_size)
+            {
+                pages.push_back(addr);
+                baselines.push_back(snap_region.data.data() + (addr - snap_region.addr_begin));
+            }
+        }
+        return 0;
+    }
+
+    char path[64] = {0};
+    snprintf(path, sizeof(path), "/proc/%d/pagemap", m_memory.pid());
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        m_log->error("Error opening {} : {}", path, strerror(errno));
+        return -1;
+    }
+
+    std::vector<uint64_t> entries;
+    for (auto &snap_region : m_regions)
+    {
+        // one 64 bit entry per page, indexed by the page number
+        size_t page_count = (snap_region.addr_end - snap_region.addr_begin) / m_page_size;
+        off_t offset = (snap_region.addr_begin / m_page_size) * sizeof(uint64_t);
+        entries.resize(page_count);
+
+        ssize_t ret = pread(fd, entries.data(), page_count * sizeof(uint64_t), offset);
+        if (ret < 0)
+        {
+            m_log->error("Error reading the pagemap of 0x{:x} : {}", snap_region.addr_begin, strerror(errno));
+            close(fd);
+            return -1;
+        }
+
+        size_t entry_count = ret / sizeof(uint64_t);
+        for (size_t i = 0; i < entry_count; i++)
+        {
+            if (entries[i] & PAGEMAP_SOFT_DIRTY)
+            {
+                pages.push_back(snap_region.addr_begin + i * m_page_size);
+                baselines.push_back(snap_region.data.data() + i * m_page_size);
+            }
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+MemoryDiff MemorySnapshot::diff(bool compare_content)
+{
+    MemoryDiff result;
+    std::vector<uintptr_t> pages;
+    std::vector<const uint8_t *> baselines;
+
+    if (dirtyPages(pages, baselines) < 0 || pages.empty())
+    {
+        return result;
+    }
+
+    result.m_current.resize(pages.size() * m_page_size);
+    std::vector<RemoteIoVec> vecs;
+    vecs.reserve(pages.size());
+    for (size_t i = 0; i < pages.size(); i++)
+    {
+        vecs.push_back(RemoteIoVec(pages[i], m_page_size, result.m_current.data() + i * m_page_size));
+    }
+    m_memory.readv(vecs);
+
+    for (size_t i = 0; i < pages.size(); i++)
+    {
+        const uint8_t *current = result.m_current.data() + i * m_page_size;
+
+        if (vecs[i].result != static_cast<ssize_t>(m_page_size))
+        {
+            // unmapped since the snapshot
+            continue;
+        }
+
+        if (compare_content && memcmp(baselines[i], current, m_page_size) == 0)
+        {
+            continue;
+        }
+        result.m_pages.push_back({pages[i], baselines[i], current});
+    }
+
+    return result;
+}
+
+int MemorySnapshot::restore()
+{
+    std::vector<uintptr_t> pages;
+    std::vector<const uint8_t *> baselines;
+
+    if (m_soft_dirty)
+    {
+        if (dirtyPages(pages, baselines) < 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        // every page would be written back, only write those which changed
+        MemoryDiff changed = diff(true);
+        for (const DirtyPage &page : changed)
+        {
+            pages.push_back(page.addr);
+            baselines.push_back(page.baseline);
+        }
+    }
+
+    size_t idx = 0;
+    while (idx < pages.size())
+    {
+        // pages of the same region are contiguous in the snapshot as well,
+        // write each run of dirty pages at once
+        size_t run = 1;
+        while (idx + run < pages.size() &&
+               pages[idx + run] == pages[idx] + run * m_page_size &&
+               baselines[idx + run] == baselines[idx] + run * m_page_size)
+        {
+            run++;
+        }
+
+        if (m_memory.writeRemote(pages[idx], baselines[idx], run * m_page_size) < 0)
+        {
+            m_log->warn("Failed to restore {} pages at 0x{:x}", run, pages[idx]);
+        }
+        idx += run;
+    }
+
+    // our own writes flagged the pages again
+    if (m_soft_dirty)
+    {
+        m_soft_dirty = clearSoftDirty();
+    }
+
+    m_log->debug("Restored {} pages of {}", pages.size(), m_memory.pid());
+    return pages.size();
+}
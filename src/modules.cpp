@@ -1,5 +1,6 @@
 #include <vector>
 #include <algorithm>
+#include <atomic>
 #include <dirent.h>
 #include "modules.hpp"
 
@@ -39,7 +40,7 @@ uintptr_t ProcessMap::findModuleBaseAddr(std::string &module_path) {
         }
     );
     if (val != std::end(m_map)) {
-        m_log->debug("Module '{}' found at base addr : 0x{:x}", (*val)->path->c_str(), (*val)->addr_begin);
+        SPDLOG_LOGGER_DEBUG(m_log, "Module '{}' found at base addr : 0x{:x}", (*val)->path->c_str(), (*val)->addr_begin);
         return (*val)->addr_begin;
     }
     m_log->error("Module '{}' not found!", module_path.c_str());
@@ -92,6 +93,15 @@ void ProcessMap::parseProcessMapFile(FILE *procmaps_file)
     }
 }
 
+/// @brief generations of the parsed maps, the tracer threads of the
+/// shards parse concurrently
+static std::atomic<uint64_t> g_map_generation(0);
+
+uint64_t ProcessMap::lastGeneration()
+{
+    return g_map_generation.load(std::memory_order_relaxed);
+}
+
 int ProcessMap::parse()
 {
     char path[100];
@@ -109,6 +119,8 @@ int ProcessMap::parse()
         m_log->error("error opening proc/{}/maps file!", m_pid);
         return -1;
     }
+    clear();
+    m_generation = ++g_map_generation;
     parseProcessMapFile(procmaps_file);
     errno_saver = errno;
     if (fclose(procmaps_file) != -1)
@@ -116,6 +128,23 @@ int ProcessMap::parse()
     return 0;
 }
 
+ProcMap* ProcessMap::findRegion(uintptr_t addr) {
+    for (auto proc_map : m_map) {
+        if (addr >= proc_map->addr_begin && addr < proc_map->addr_end) {
+            return proc_map;
+        }
+    }
+    return nullptr;
+}
+
+void ProcessMap::clear() {
+    for (auto proc_map : m_map) {
+        delete proc_map->path;
+        delete proc_map;
+    }
+    m_map.clear();
+}
+
 void ProcessMap::permStr(uint8_t perm_val, char * pem_str) {
     if (perm_val & ProcMap::PERMS_READ) {
         pem_str[0]='r';
@@ -156,14 +185,14 @@ void ProcessMap::list_child_threads() {
 }
 
 void ProcessMap::print() {
-    m_log->debug("----------------[ PROCESS MAP ]----------------");
+    SPDLOG_LOGGER_DEBUG(m_log, "----------------[ PROCESS MAP ]----------------");
     char pem_str[5];
     for (auto ir : m_map) {
         memset(pem_str, '-', sizeof(pem_str) -1 );
         pem_str[5] = '\x0';
         permStr(ir->perms, pem_str);
-        m_log->debug("{:x} {:x} {} {}", ir->addr_begin, ir->addr_end, pem_str, ir->path->c_str());
+        SPDLOG_LOGGER_DEBUG(m_log, "{:x} {:x} {} {}", ir->addr_begin, ir->addr_end, pem_str, ir->path->c_str());
     }
-    m_log->debug("----------------[     END     ]----------------");
+    SPDLOG_LOGGER_DEBUG(m_log, "----------------[     END     ]----------------");
 }
 
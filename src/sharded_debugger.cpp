@@ -0,0 +1,158 @@
+#include "sharded_debugger.hpp"
+#include "branch_data.hpp"
+#include "modules.hpp"
+#include "tracee.hpp"
+#include "arch_traits.hpp"
+
+ShardedDebugger::ShardedDebugger(TargetDescription &target_desc, size_t shard_count)
+{
+	if (shard_count == 0)
+	{
+		shard_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	m_breakpointMngr = new BreakpointMngr(target_desc);
+	m_resources = new ResourceTracers();
+	m_shard_tids.resize(shard_count);
+
+	for (size_t idx = 0; idx < shard_count; idx++)
+	{
+		Debugger *shard = new Debugger(target_desc);
+		shard->setBreakpointMngr(m_breakpointMngr);
+		shard->setResourceTracers(m_resources);
+		m_shards.push_back(shard);
+	}
+}
+
+ShardedDebugger::~ShardedDebugger()
+{
+	for (auto &worker : m_workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+	for (auto shard : m_shards)
+	{
+		delete shard;
+	}
+	delete m_breakpointMngr;
+	delete m_resources;
+	delete m_address_space;
+}
+
+ShardedDebugger &ShardedDebugger::followFork()
+{
+	for (auto shard : m_shards)
+		shard->followFork();
+	return *this;
+}
+
+ShardedDebugger &ShardedDebugger::traceSyscall()
+{
+	for (auto shard : m_shards)
+		shard->traceSyscall();
+	return *this;
+}
+
+ShardedDebugger &ShardedDebugger::useDisplacedStepping()
+{
+	for (auto shard : m_shards)
+		shard->useDisplacedStepping();
+	return *this;
+}
+
+ShardedDebugger &ShardedDebugger::setMemoryBackend(MemoryBackend backend)
+{
+	for (auto shard : m_shards)
+		shard->setMemoryBackend(backend);
+	return *this;
+}
+
+DebugResult ShardedDebugger::attach(pid_t tracee_pid)
+{
+	if (!TargetArch::has_single_step && m_shards.size() > 1)
+	{
+		// the emulated single step breakpoints are in the shared memory,
+		// stopAllThreads only keeps the threads of one shard away from them
+		m_log->error("Attaching with {} shards is not supported on this architecture, use a single shard", m_shards.size());
+		return DebugResult::ErrArchitecture;
+	}
+
+	ProcessMap proc_map(tracee_pid);
+	proc_map.list_child_threads();
+
+	if (proc_map.m_child_thread_pids.empty())
+	{
+		m_log->error("No threads found for pid {}", tracee_pid);
+		return DebugResult::ErrAttachingPtrace;
+	}
+
+	m_attach_pid = tracee_pid;
+	delete m_address_space;
+	m_address_space = new RemoteMemory(tracee_pid);
+	size_t shard_idx = 0;
+	for (pid_t tid : proc_map.m_child_thread_pids)
+	{
+		m_shard_tids[shard_idx].push_back(tid);
+		shard_idx = (shard_idx + 1) % m_shard_tids.size();
+	}
+
+	m_log->info("Attaching to {} threads of {} with {} shards",
+				proc_map.m_child_thread_pids.size(), tracee_pid, m_shards.size());
+	return DebugResult::Success;
+}
+
+DebugResult ShardedDebugger::spawn(std::vector<std::string> &cmdline)
+{
+	m_attach_pid = 0;
+	m_cmdline = cmdline;
+	return DebugResult::Success;
+}
+
+void ShardedDebugger::runShard(size_t shard_idx)
+{
+	Debugger *shard = m_shards[shard_idx];
+
+	if (m_attach_pid == 0)
+	{
+		// the Tracee is traced by the thread which forked it
+		if (shard_idx != 0)
+			return;
+
+		if (shard->spawn(m_cmdline) != DebugResult::Success)
+		{
+			m_log->error("Shard {} : failed to spawn the process", shard_idx);
+			return;
+		}
+	}
+	else
+	{
+		for (pid_t tid : m_shard_tids[shard_idx])
+		{
+			if (shard->attachThread(tid) != DebugResult::Success)
+				continue;
+			TraceeProgram *tracee_prog = shard->getTracee(tid);
+			tracee_prog->setThreadGroupid(m_attach_pid);
+			// one /proc/<pid>/mem handle for the whole process
+			tracee_prog->getDebugOpts().m_memory.shareAddressSpace(*m_address_space);
+		}
+	}
+
+	m_log->debug("Shard {} : running the event loop", shard_idx);
+	shard->eventLoop();
+	m_log->debug("Shard {} : no Tracee left", shard_idx);
+}
+
+void ShardedDebugger::run()
+{
+	for (size_t idx = 0; idx < m_shards.size(); idx++)
+	{
+		m_workers.push_back(std::thread(&ShardedDebugger::runShard, this, idx));
+	}
+
+	for (auto &worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
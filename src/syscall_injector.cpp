@@ -1,4 +1,8 @@
 #include "syscall_injector.hpp"
+#include "arch_traits.hpp"
+
+/// @brief injection writes an ARM `svc` instruction, only ARM32 is supported
+typedef ArchTraits<CPU_ARCH::ARM32> InjectArch;
 
 void SyscallInjector::injectSyscall(std::unique_ptr<SyscallInject> syscall_data)
 {
@@ -29,10 +33,15 @@ void SyscallInjector::execute(TraceeProgram &traceeProg)
 		m_log->debug("We don't have syscall to inject");
 		return;
 	}
+	if (traceeProg.m_target_desc.m_cpu_arch != CPU_ARCH::ARM32)
+	{
+		m_log->error("Syscall injection is not supported this CPU Architecture");
+		return;
+	}
 	m_log->debug("Injecting syscall into the Tracee");
 	DebugOpts &debug_opts = traceeProg.m_debug_opts;
-	ARM32Register *armRegObj = dynamic_cast<ARM32Register *>(&debug_opts.m_register);
-	armRegObj->fetch();
+	InjectArch::Register &armRegObj = archRegisters<InjectArch>(debug_opts.m_register);
+	armRegObj.fetch();
 
 	// Pop one syscall which we want to inject
 	traceeProg.m_inject_call = std::move(m_pending_syscall_inject.back());
@@ -42,7 +51,7 @@ void SyscallInjector::execute(TraceeProgram &traceeProg)
     
 	const uint32_t arm_inst_size = 4;
 	// address of the next instruction after the breakpoint address
-	std::uintptr_t bkpt_pc = armRegObj->getProgramCounter() + arm_inst_size;
+	std::uintptr_t bkpt_pc = armRegObj.getProgramCounter() + arm_inst_size;
 	
 	m_log->debug("Instruction injection addr {:x}", bkpt_pc);
 	
@@ -65,21 +74,21 @@ void SyscallInjector::execute(TraceeProgram &traceeProg)
 
 void SyscallInjector::setSyscallParams(TraceeProgram &traceeProg) {
 	DebugOpts &debug_opts = traceeProg.m_debug_opts;
-	ARM32Register *armRegObj = dynamic_cast<ARM32Register *>(&debug_opts.m_register);
 	switch (traceeProg.m_target_desc.m_cpu_arch)
 	{
 	case CPU_ARCH::ARM32:
+	{
+		InjectArch::Register &armRegObj = archRegisters<InjectArch>(debug_opts.m_register);
 		// Setup syscall ID
-		armRegObj->setRegIdx(ARM32Register::R7, traceeProg.m_inject_call->m_syscall_id);
+		armRegObj.setRegIdx(InjectArch::syscall_nr_reg, traceeProg.m_inject_call->m_syscall_id);
 		// setup sycall parameter
-		armRegObj->setRegIdx(ARM32Register::R0, traceeProg.m_inject_call->m_sys_args[0]);
-		armRegObj->setRegIdx(ARM32Register::R1, traceeProg.m_inject_call->m_sys_args[1]);
-		armRegObj->setRegIdx(ARM32Register::R2, traceeProg.m_inject_call->m_sys_args[2]);
-		armRegObj->setRegIdx(ARM32Register::R3, traceeProg.m_inject_call->m_sys_args[3]);
-		armRegObj->setRegIdx(ARM32Register::R4, traceeProg.m_inject_call->m_sys_args[4]);
-		armRegObj->setRegIdx(ARM32Register::R5, traceeProg.m_inject_call->m_sys_args[5]);
-		armRegObj->update();
+		for (int i = 0; i < SYSCALL_MAXARGS; i++)
+		{
+			armRegObj.setRegIdx(InjectArch::syscallArgReg(i), traceeProg.m_inject_call->m_sys_args[i]);
+		}
+		armRegObj.update();
 		break;
+	}
 	default:
 		m_log->error("Syscall injection is not supported this CPU Architecture");
 	}
@@ -106,13 +115,18 @@ void SyscallInjector::restoreProgramState(TraceeProgram &traceeProg) {
 
 
 void SyscallInjector::cleanUp(TraceeProgram &traceeProg) {
+	if (traceeProg.m_target_desc.m_cpu_arch != CPU_ARCH::ARM32)
+	{
+		m_log->error("Syscall injection is not supported this CPU Architecture");
+		return;
+	}
 	DebugOpts &debug_opts = traceeProg.m_debug_opts;
-	ARM32Register *armRegObj = dynamic_cast<ARM32Register *>(&debug_opts.m_register);
-	armRegObj->fetch();
+	InjectArch::Register &armRegObj = archRegisters<InjectArch>(debug_opts.m_register);
+	armRegObj.fetch();
 	m_log->debug("Syscall Injection Done!");
 
 	// armRegObj->print();
-	traceeProg.m_inject_call->m_ret_value = armRegObj->getRegIdx(ARM32Register::R0);
+	traceeProg.m_inject_call->m_ret_value = armRegObj.getRegIdx(InjectArch::syscall_ret_reg);
 	m_log->debug("Inject Return value : {:x}", traceeProg.m_inject_call->m_ret_value);
 	traceeProg.m_inject_call->onComplete();
 
@@ -143,7 +157,7 @@ void SyscallInjector::cleanUp(TraceeProgram &traceeProg) {
 	// inject call, May be don't need to put it here!
 	const uint32_t arm_inst_size = 4;
 	// address of the previous instruction after the breakpoint address
-	armRegObj->setProgramCounter(armRegObj->getProgramCounter() - arm_inst_size);
+	armRegObj.setProgramCounter(armRegObj.getProgramCounter() - arm_inst_size);
 	// traceeProg.m_inject_call.reset();
 	traceeProg.m_inject_call = std::move(inject_syscall);
 	setSyscallParams(traceeProg);
@@ -1,6 +1,10 @@
 #include "syscall_mngr.hpp"
+#include "arch_traits.hpp"
 #include "tracee.hpp"
+#include <climits>
 #include <sys/un.h>
+#include <sys/ptrace.h>
+#include <errno.h>
 #include <linux/netlink.h>
 
 // this system call which are related to filer operations
@@ -124,136 +128,236 @@ static const std::unordered_set<int16_t> TIME_OPTS_SYSCALL_ID{
 
 };
 
-/**
- *  src : https://chromium.googlesource.com/chromiumos/docs/+/HEAD/constants/syscalls.md
- *	arch	syscall NR	return	arg0	arg1	arg2	arg3	arg4	arg5
- *	arm		r7			r0		r0		r1		r2		r3		r4		r5
- *	arm64	x8			x0		x0		x1		x2		x3		x4		x5
- *	x86	    eax			eax		ebx		ecx		edx		esi		edi		ebp
- *	x86_64	rax			rax		rdi		rsi		rdx		r10		r8		r9
- */
+SyscallStop SyscallManager::fetchSyscallInfo(TraceeProgram &traceeProg)
+{
+	m_syscall_info_pid = 0;
+
+	if (!m_syscall_info_supported)
+	{
+		return SyscallStop::UNKNOWN;
+	}
+
+	long ret = ptrace((__ptrace_request)PTRACE_GET_SYSCALL_INFO, traceeProg.pid(),
+		(void *)sizeof(m_syscall_info), &m_syscall_info);
+
+	if (ret < 0)
+	{
+		if (errno == EIO || errno == EINVAL)
+		{
+			SPDLOG_LOGGER_INFO(m_log, "PTRACE_GET_SYSCALL_INFO is not supported, reading syscalls from the registers");
+			m_syscall_info_supported = false;
+		}
+		return SyscallStop::UNKNOWN;
+	}
+
+	m_syscall_info_pid = traceeProg.pid();
+	switch (m_syscall_info.op)
+	{
+	case SYSCALL_INFO_OP_ENTRY:
+		return SyscallStop::ENTRY;
+	case SYSCALL_INFO_OP_EXIT:
+		return SyscallStop::EXIT;
+	default:
+		m_syscall_info_pid = 0;
+		return SyscallStop::UNKNOWN;
+	}
+}
+
+bool SyscallManager::hasSyscallInfo(TraceeProgram &traceeProg, uint8_t op)
+{
+	return m_syscall_info_pid == traceeProg.pid() && m_syscall_info.op == op;
+}
+
+template <typename Arch>
 void SyscallManager::readSyscallParams(TraceeProgram &traceeProg)
 {
-	SysCallId sys_id = SysCallId::NO_SYSCALL;
 	int16_t call_id;
-	DebugOpts &debug_opts = traceeProg.m_debug_opts;
-	AMD64Register *amdRegObj;
-	ARM64Register *arm64RegObj;
-	X86Register *x86RegObj;
-	ARM32Register *armRegObj;
 
-	debug_opts.m_register.fetch();
+	if (hasSyscallInfo(traceeProg, SYSCALL_INFO_OP_ENTRY))
+	{
+		// the kernel has handed us everything, no need for the registers
+		call_id = static_cast<int16_t>(m_syscall_info.entry.nr);
+		m_cached_args.syscall_id = Arch::canonicalize(call_id);
+		for (int i = 0; i < SYSCALL_MAXARGS; i++)
+		{
+			m_cached_args.v_arg[i] = m_syscall_info.entry.args[i];
+		}
+		return;
+	}
+
+	typename Arch::Register &regs = archRegisters<Arch>(traceeProg.m_debug_opts.m_register);
+	regs.fetch();
+
+	call_id = static_cast<int16_t>(regs.getRegIdx(Arch::syscall_id_reg));
+	m_cached_args.syscall_id = Arch::canonicalize(call_id);
+	for (int i = 0; i < SYSCALL_MAXARGS; i++)
+	{
+		m_cached_args.v_arg[i] = regs.getRegIdx(Arch::syscallArgReg(i));
+	}
+}
+
+void SyscallManager::readSyscallParams(TraceeProgram &traceeProg)
+{
 	switch (traceeProg.m_target_desc.m_cpu_arch)
 	{
-	case CPU_ARCH::AMD64:
-		amdRegObj = dynamic_cast<AMD64Register *>(&debug_opts.m_register);
-		call_id = static_cast<int16_t>(amdRegObj->getRegIdx(SYSCALL_ID_AMD64));
-		// m_log->debug("raw call id {}", call_id);
-		sys_id = amd64_canonicalize_syscall(static_cast<AMD64_SYSCALL>(call_id));
-		// m_log->debug("Syscall {}", sys_id.getString());
-		m_cached_args.syscall_id = sys_id;
-
-		m_cached_args.v_arg[0] = amdRegObj->getRegIdx(SYSCALL_AMD64_ARG_0);
-		m_cached_args.v_arg[1] = amdRegObj->getRegIdx(SYSCALL_AMD64_ARG_1);
-		m_cached_args.v_arg[2] = amdRegObj->getRegIdx(SYSCALL_AMD64_ARG_2);
-		m_cached_args.v_arg[3] = amdRegObj->getRegIdx(SYSCALL_AMD64_ARG_3);
-		m_cached_args.v_arg[4] = amdRegObj->getRegIdx(SYSCALL_AMD64_ARG_4);
-		m_cached_args.v_arg[5] = amdRegObj->getRegIdx(SYSCALL_AMD64_ARG_5);
-		break;
-	case CPU_ARCH::X86:
-		m_log->error("Archictecture not Implemented!");
-		x86RegObj = dynamic_cast<X86Register *>(&debug_opts.m_register);
-		call_id = static_cast<int16_t>(armRegObj->getRegIdx(X86Register::EAX));
-		sys_id = i386_canonicalize_syscall(call_id);
-		m_cached_args.syscall_id = sys_id;
-		break;
-	case CPU_ARCH::ARM64:
-		m_log->debug("reading prams");
-		arm64RegObj = dynamic_cast<ARM64Register *>(&debug_opts.m_register);
-		call_id = static_cast<int16_t>(arm64RegObj->getRegIdx(ARM64Register::X8));
-		m_log->debug("raw call id {}", call_id);
-		sys_id = arm64_canonicalize_syscall(static_cast<ARM64_SYSCALL>(call_id));
-		m_cached_args.syscall_id = sys_id;
-
-		m_cached_args.v_arg[0] = arm64RegObj->getRegIdx(ARM64Register::X0);
-		m_cached_args.v_arg[1] = arm64RegObj->getRegIdx(ARM64Register::X1);
-		m_cached_args.v_arg[2] = arm64RegObj->getRegIdx(ARM64Register::X2);
-		m_cached_args.v_arg[3] = arm64RegObj->getRegIdx(ARM64Register::X3);
-		m_cached_args.v_arg[4] = arm64RegObj->getRegIdx(ARM64Register::X4);
-		m_cached_args.v_arg[5] = arm64RegObj->getRegIdx(ARM64Register::X5);
-		break;
-	case CPU_ARCH::ARM32:
-		armRegObj = dynamic_cast<ARM32Register *>(&debug_opts.m_register);
-
-		call_id = static_cast<int16_t>(armRegObj->getRegIdx(ARM32Register::R7));
-		m_log->debug("Raw Syscall id {}", call_id);
-		sys_id = arm32_canonicalize_syscall(call_id);
-		// m_log->debug("Syscall {}", sys_id.getString());
-		m_cached_args.syscall_id = sys_id;
-
-		m_cached_args.v_arg[0] = armRegObj->getRegIdx(ARM32Register::R0);
-		m_cached_args.v_arg[1] = armRegObj->getRegIdx(ARM32Register::R1);
-		m_cached_args.v_arg[2] = armRegObj->getRegIdx(ARM32Register::R2);
-		m_cached_args.v_arg[3] = armRegObj->getRegIdx(ARM32Register::R3);
-		m_cached_args.v_arg[4] = armRegObj->getRegIdx(ARM32Register::R4);
-		m_cached_args.v_arg[5] = armRegObj->getRegIdx(ARM32Register::R5);
-		// armRegObj->print();
-		break;
+	ARCH_DISPATCH(readSyscallParams<Arch>(traceeProg))
 	default:
 		m_log->error("Invalid Archictecture");
 		break;
-	};
+	}
 }
 
+template <typename Arch>
 void SyscallManager::readRetValue(TraceeProgram &traceeProg)
 {
+	if (hasSyscallInfo(traceeProg, SYSCALL_INFO_OP_EXIT))
+	{
+		m_cached_args.v_rval = m_syscall_info.exit.rval;
+		if (Arch::cpu_arch == CPU_ARCH::ARM32)
+		{
+			svc_inst_addr = m_syscall_info.instruction_pointer - 1;
+		}
+		return;
+	}
 
-	DebugOpts &debug_opts = traceeProg.m_debug_opts;
-	SysCallId sys_id = SysCallId::NO_SYSCALL;
-	X86Register *x86RegObj = nullptr;
-	AMD64Register *regObj = nullptr;
-	ARM32Register *armRegObj = nullptr;
-	ARM64Register *arm64RegObj = nullptr;
+	typename Arch::Register &regs = archRegisters<Arch>(traceeProg.m_debug_opts.m_register);
+	regs.fetch();
+	if (Arch::cpu_arch == CPU_ARCH::ARM32)
+	{
+		svc_inst_addr = regs.getProgramCounter() - 1;
+	}
+	m_cached_args.v_rval = regs.getRegIdx(Arch::syscall_ret_reg);
+}
 
+void SyscallManager::readRetValue(TraceeProgram &traceeProg)
+{
 	switch (traceeProg.m_target_desc.m_cpu_arch)
 	{
-	case CPU_ARCH::X86:
-		x86RegObj = dynamic_cast<X86Register *>(&debug_opts.m_register);
-		x86RegObj->fetch();
-		m_cached_args.v_rval = x86RegObj->getRegIdx(X86Register::EAX);
-		break;
-	case CPU_ARCH::AMD64:
-		regObj = dynamic_cast<AMD64Register *>(&debug_opts.m_register);
-		regObj->fetch();
-		m_cached_args.v_rval = regObj->getRegIdx(AMD64Register::RAX);
-		break;
-	case CPU_ARCH::ARM32:
-		armRegObj = dynamic_cast<ARM32Register *>(&debug_opts.m_register);
-		armRegObj->fetch();
-		svc_inst_addr = armRegObj->getProgramCounter() - 1;
-		m_cached_args.v_rval = armRegObj->getRegIdx(ARM32Register::R0);
-		// armRegObj->print();
-		break;
-	case CPU_ARCH::ARM64:
-		arm64RegObj = dynamic_cast<ARM64Register *>(&debug_opts.m_register);
-		arm64RegObj->fetch();
-		m_cached_args.v_rval = arm64RegObj->getRegIdx(ARM64Register::X0);
-		break;
+	ARCH_DISPATCH(readRetValue<Arch>(traceeProg))
 	default:
 		m_log->error("Invalid Archictecture");
 		break;
 	}
 }
 
-int SyscallManager::addFileOperationHandler(FileOperationTracer *file_opt_handler)
+void ResourceTracers::addFileOperationHandler(FileOperationTracer *file_opt_handler)
 {
+	std::lock_guard<std::mutex> guard(m_lock);
 	m_pending_file_opts_handler.push_front(file_opt_handler);
+}
+
+void ResourceTracers::addNetworkOperationHandler(NetworkOperationTracer *network_opt_handler)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_pending_network_opts_handler.push_front(network_opt_handler);
+}
+
+FileOperationTracer *ResourceTracers::getFileOperationHandler(pid_t tgid, int fd)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	auto file_ops_iter = m_active_file_opts_handler.find({tgid, fd});
+	if (file_ops_iter == m_active_file_opts_handler.end())
+		return nullptr;
+	return file_ops_iter->second;
+}
+
+NetworkOperationTracer *ResourceTracers::getNetworkOperationHandler(pid_t tgid, int fd)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	auto socket_opts_iter = m_active_network_opts_handler.find({tgid, fd});
+	if (socket_opts_iter == m_active_network_opts_handler.end())
+		return nullptr;
+	return socket_opts_iter->second;
+}
+
+void ResourceTracers::releaseFileOperationHandler(pid_t tgid, int fd)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	auto file_ops_iter = m_active_file_opts_handler.find({tgid, fd});
+	if (file_ops_iter == m_active_file_opts_handler.end())
+		return;
+	m_pending_file_opts_handler.push_front(file_ops_iter->second);
+	m_active_file_opts_handler.erase(file_ops_iter);
+}
+
+void ResourceTracers::matchFileOperationHandlers(pid_t tgid, DebugOpts &debug_opts, SyscallTraceData &syscall_args)
+{
+	// the lock is held while filtering, a tracer is moved out of the
+	// pending list by a single thread
+	std::lock_guard<std::mutex> guard(m_lock);
+	for (auto file_opt_iter = m_pending_file_opts_handler.begin();
+		 file_opt_iter != m_pending_file_opts_handler.end();)
+	{
+		FileOperationTracer *f_opts = *file_opt_iter;
+		if (f_opts->onFilter(debug_opts, syscall_args))
+		{
+			f_opts->onOpen(SyscallState::ON_EXIT, debug_opts, syscall_args);
+			// found the match, removing it from the list
+			file_opt_iter = m_pending_file_opts_handler.erase(file_opt_iter);
+			int resource_fd = syscall_args.v_rval;
+			m_active_file_opts_handler[{tgid, resource_fd}] = f_opts;
+		}
+		else
+		{
+			++file_opt_iter;
+		}
+	}
+}
+
+void ResourceTracers::matchNetworkOperationHandlers(pid_t tgid, DebugOpts &debug_opts, SyscallTraceData &syscall_args)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	for (NetworkOperationTracer *network_opt : m_pending_network_opts_handler)
+	{
+		if (network_opt->onFilter(SyscallState::ON_EXIT, debug_opts, syscall_args) == ResourceTraceResult::TRACE_AND_KEEP)
+		{
+			network_opt->onOpen(SyscallState::ON_EXIT, debug_opts, syscall_args);
+			// Once you we have found the resource we want to trace, we are not
+			// removing it in case of network is becasue there will be a different
+			// file descriptor used by the each client in case of server
+			int resource_fd = -1;
+			if (syscall_args.syscall_id == SysCallId::SOCKET ||
+				syscall_args.syscall_id == SysCallId::ACCEPT)
+			{
+				// in-case of both of this syscall new fd are return
+				// value
+				resource_fd = syscall_args.v_rval;
+			}
+			else
+			{
+				resource_fd = syscall_args.v_arg[0];
+			}
+			SPDLOG_LOGGER_INFO(m_log, "Network Tracer match found for resource_fd {}", resource_fd);
+			m_active_network_opts_handler[{tgid, resource_fd}] = network_opt;
+		}
+	}
+}
+
+void ResourceTracers::dropProcess(pid_t tgid)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	auto first = m_active_file_opts_handler.lower_bound({tgid, INT_MIN});
+	auto last = m_active_file_opts_handler.upper_bound({tgid, INT_MAX});
+	for (auto file_ops_iter = first; file_ops_iter != last; ++file_ops_iter)
+	{
+		m_pending_file_opts_handler.push_front(file_ops_iter->second);
+	}
+	m_active_file_opts_handler.erase(first, last);
+
+	m_active_network_opts_handler.erase(
+		m_active_network_opts_handler.lower_bound({tgid, INT_MIN}),
+		m_active_network_opts_handler.upper_bound({tgid, INT_MAX}));
+}
+
+int SyscallManager::addFileOperationHandler(FileOperationTracer *file_opt_handler)
+{
+	m_resources->addFileOperationHandler(file_opt_handler);
 	return 0;
 }
 
 int SyscallManager::addNetworkOperationHandler(NetworkOperationTracer *network_opt_handler)
 {
-	m_pending_network_opts_handler.push_front(network_opt_handler);
+	m_resources->addNetworkOperationHandler(network_opt_handler);
 	return 0;
 }
 
@@ -278,20 +382,19 @@ int SyscallManager::removeSyscallHandler(SyscallHandler *syscall_hdlr)
 }
 */
 
-int SyscallManager::handleFileOperation(SyscallState sys_state, DebugOpts &debug_opts, SyscallTraceData &syscall_args)
+int SyscallManager::handleFileOperation(SyscallState sys_state, pid_t tgid, DebugOpts &debug_opts, SyscallTraceData &syscall_args)
 {
 	int fd = static_cast<int>(syscall_args.v_arg[0]);
 
-	auto file_ops_iter = m_active_file_opts_handler.find(fd);
+	// File operation handler which has matched the file descriptor
+	FileOperationTracer *file_ops_obj = m_resources->getFileOperationHandler(tgid, fd);
 
-	if (file_ops_iter == m_active_file_opts_handler.end())
+	if (file_ops_obj == nullptr)
 	{
 		// Not found!
-		m_log->trace("No FileOperation is registered for fd {}", fd);
+		SPDLOG_LOGGER_TRACE(m_log, "No FileOperation is registered for fd {}", fd);
 		return 0;
 	}
-	// File operation handler which has matched the file descriptor
-	FileOperationTracer *file_ops_obj = file_ops_iter->second;
 
 	switch (syscall_args.syscall_id.getValue())
 	{
@@ -328,8 +431,7 @@ int SyscallManager::handleFileOperation(SyscallState sys_state, DebugOpts &debug
 		// Tracing this descriptor has to be release form here as the
 		// resource is essentially destoryed
 		file_ops_obj->onClose(sys_state, debug_opts, syscall_args);
-		m_pending_file_opts_handler.push_front(file_ops_obj);
-		m_active_file_opts_handler.erase(fd);
+		m_resources->releaseFileOperationHandler(tgid, fd);
 		break;
 	case SysCallId::IOCTL:
 		file_ops_obj->onIoctl(sys_state, debug_opts, syscall_args);
@@ -370,20 +472,18 @@ void logSockaddrDetails(const sockaddr *addr, std::shared_ptr<spdlog::logger> lo
 	}
 }
 
-int SyscallManager::handleNetworkOperation(SyscallState sys_state, DebugOpts &debug_opts, SyscallTraceData &syscall_args)
+int SyscallManager::handleNetworkOperation(SyscallState sys_state, pid_t tgid, DebugOpts &debug_opts, SyscallTraceData &syscall_args)
 {
 	int fd = static_cast<int>(syscall_args.v_arg[0]);
 
-	auto socket_opts_iter = m_active_network_opts_handler.find(fd);
+	NetworkOperationTracer *network_opts_obj = m_resources->getNetworkOperationHandler(tgid, fd);
 
-	if (socket_opts_iter == m_active_network_opts_handler.end())
+	if (network_opts_obj == nullptr)
 	{
 		// Not found!
-		m_log->trace("No NetworkOperationTracer is registered for fd {}", fd);
+		SPDLOG_LOGGER_TRACE(m_log, "No NetworkOperationTracer is registered for fd {}", fd);
 		return 0;
 	}
-	// Found
-	NetworkOperationTracer *network_opts_obj = socket_opts_iter->second;
 
 	switch (syscall_args.syscall_id.getValue())
 	{
@@ -436,20 +536,25 @@ int SyscallManager::onEnter(TraceeProgram &traceeProg)
 {
 	m_syscall_executed++;
 	DebugOpts &debug_opts = traceeProg.m_debug_opts;
-	m_log->debug("Syscall Inst {}", m_syscall_executed);
+	SPDLOG_LOGGER_DEBUG(m_log, "Syscall Inst {}", m_syscall_executed);
 	readSyscallParams(traceeProg);
+	m_syscall_info_pid = 0;
+	if (m_recorder != nullptr)
+	{
+		m_recorder->record(TraceRecordType::SYSCALL_ENTER, traceeProg.pid(), m_cached_args.getSyscallNo());
+	}
 	// m_log->debug("ID {}", m_cached_args.getSyscallNo());
 
 	// File operation handler
 	if (FILE_OPTS_SYSCALL_ID.count(m_cached_args.getSyscallNo()))
 	{
-		m_log->trace("FILE OPT DETECED");
-		handleFileOperation(SyscallState::ON_ENTER, debug_opts, m_cached_args);
+		SPDLOG_LOGGER_TRACE(m_log, "FILE OPT DETECED");
+		handleFileOperation(SyscallState::ON_ENTER, traceeProg.tid(), debug_opts, m_cached_args);
 	}
 
 	if (NETWORK_OPTS_SYSCALL_ID.count(m_cached_args.getSyscallNo()))
 	{
-		handleNetworkOperation(SyscallState::ON_ENTER, debug_opts, m_cached_args);
+		handleNetworkOperation(SyscallState::ON_ENTER, traceeProg.tid(), debug_opts, m_cached_args);
 	}
 
 	// Find and invoke system call handler
@@ -466,10 +571,10 @@ int SyscallManager::onEnter(TraceeProgram &traceeProg)
 	if (sys_hdl_not_fnd)
 	{
 		// Not found!
-		m_log->trace("onEnter : No syscall handler is registered for this syscall number");
+		SPDLOG_LOGGER_TRACE(m_log, "onEnter : No syscall handler is registered for this syscall number");
 	}
 
-	m_log->debug("NAME : -> {}", m_cached_args.syscall_id.getString());
+	SPDLOG_LOGGER_DEBUG(m_log, "NAME : -> {}", m_cached_args.syscall_id.getString());
 	return 0;
 }
 
@@ -478,95 +583,72 @@ int SyscallManager::onExit(TraceeProgram &traceeProg)
 	DebugOpts &debug_opts = traceeProg.m_debug_opts;
 
 	readRetValue(traceeProg);
-	m_log->debug("NAME : <- {} 0x{:x}", m_cached_args.syscall_id.getString(), m_cached_args.v_rval);
+	m_syscall_info_pid = 0;
+	if (m_recorder != nullptr)
+	{
+		m_recorder->record(TraceRecordType::SYSCALL_EXIT, traceeProg.pid(), m_cached_args.getSyscallNo(), m_cached_args.v_rval);
+	}
+	SPDLOG_LOGGER_DEBUG(m_log, "NAME : <- {} 0x{:x}", m_cached_args.syscall_id.getString(), m_cached_args.v_rval);
 
 	// Resource Tracing check has to be done on exit because if there is a
 	// match you need resource identifier for futher tracing operation
-	NetworkOperationTracer *network_opt = nullptr;
-
-	// Check if any of the File Operation Tracer is getting created
-	// if so then check the criteria and if 'onFilter' method returns
-	// true then move the tracer from pending state to active state
-	FileOperationTracer *f_opts = nullptr;
-
-	int resource_fd = -1;
 
 	// This is checking if new resource is getting created, if so
-	// try to attach tracer to the file descriptor
+	// try to attach tracer to the file descriptor. If 'onFilter' method
+	// returns true the tracer moves from pending state to active state
 	if (m_cached_args.syscall_id == SysCallId::OPENAT ||
 		m_cached_args.syscall_id == SysCallId::OPEN ||
 		m_cached_args.syscall_id == SysCallId::CREAT)
 	{
-		// File operation detector
-		for (auto file_opt_iter = m_pending_file_opts_handler.begin();
-			 file_opt_iter != m_pending_file_opts_handler.end();)
-		{
-			f_opts = *file_opt_iter;
-			if (f_opts->onFilter(debug_opts, m_cached_args))
-			{
-				f_opts->onOpen(SyscallState::ON_EXIT, debug_opts, m_cached_args);
-				// found the match, removing it from the list
-				file_opt_iter = m_pending_file_opts_handler.erase(file_opt_iter);
-				resource_fd = m_cached_args.v_rval;
-				m_active_file_opts_handler[resource_fd] = f_opts;
-			}
-			else
-			{
-				++file_opt_iter;
-			}
-		}
+		m_resources->matchFileOperationHandlers(traceeProg.tid(), debug_opts, m_cached_args);
 	}
 
 	// This is calling the active Resource Tracer
 	if (FILE_OPTS_SYSCALL_ID.count(m_cached_args.getSyscallNo()))
 	{
-		m_log->debug("FILE OPT DETECED");
-		handleFileOperation(SyscallState::ON_EXIT, debug_opts, m_cached_args);
+		SPDLOG_LOGGER_DEBUG(m_log, "FILE OPT DETECED");
+		handleFileOperation(SyscallState::ON_EXIT, traceeProg.tid(), debug_opts, m_cached_args);
 	}
 
-	// reset the value to use the same variable for network resource matching
-	resource_fd = -1;
-
 	if (m_cached_args.syscall_id == SysCallId::SOCKET ||
 		m_cached_args.syscall_id == SysCallId::ACCEPT ||
 		m_cached_args.syscall_id == SysCallId::CONNECT ||
 		m_cached_args.syscall_id == SysCallId::LISTEN ||
 		m_cached_args.syscall_id == SysCallId::BIND)
 	{
-
-		for (auto network_opt_iter = m_pending_network_opts_handler.begin();
-			 network_opt_iter != m_pending_network_opts_handler.end();)
-		{
-			network_opt = *network_opt_iter;
-			if (network_opt->onFilter(SyscallState::ON_EXIT, debug_opts, m_cached_args) == ResourceTraceResult::TRACE_AND_KEEP)
-			{
-				network_opt->onOpen(SyscallState::ON_EXIT, debug_opts, m_cached_args);
-				// Once you we have found the resource we want to trace, we are not
-				// removing it in case of network is becasue there will be a different
-				// file descriptor used by the each client in case of server
-
-				if (m_cached_args.syscall_id == SysCallId::SOCKET ||
-					m_cached_args.syscall_id == SysCallId::ACCEPT)
-				{
-					// in-case of both of this syscall new fd are return
-					// value
-					resource_fd = m_cached_args.v_rval;
-				}
-				else
-				{
-					resource_fd = m_cached_args.v_arg[0];
-				}
-				m_log->info("Network Tracer match found for resource_fd {}", resource_fd);
-				m_active_network_opts_handler[resource_fd] = network_opt;
-			}
-			++network_opt_iter;
-		}
+		m_resources->matchNetworkOperationHandlers(traceeProg.tid(), debug_opts, m_cached_args);
 	}
 
 	if (NETWORK_OPTS_SYSCALL_ID.count(m_cached_args.getSyscallNo()))
 	{
-		m_log->debug("NETWORK OPT DETECED");
-		handleNetworkOperation(SyscallState::ON_EXIT, debug_opts, m_cached_args);
+		SPDLOG_LOGGER_DEBUG(m_log, "NETWORK OPT DETECED");
+		handleNetworkOperation(SyscallState::ON_EXIT, traceeProg.tid(), debug_opts, m_cached_args);
+	}
+
+	// Cached pages of the remapped range can't be trusted anymore, failed
+	// calls (-errno) leave the mapping untouched
+	bool syscall_failed = m_cached_args.v_rval < 0 && m_cached_args.v_rval > -4096;
+	switch (syscall_failed ? SysCallId::NO_SYSCALL : m_cached_args.getSyscallNo())
+	{
+	case SysCallId::MMAP2:
+		debug_opts.m_memory.onMappingChange(m_cached_args.v_rval, m_cached_args.v_arg[1]);
+		break;
+	case SysCallId::MPROTECT:
+	case SysCallId::MUNMAP:
+		debug_opts.m_memory.onMappingChange(m_cached_args.v_arg[0], m_cached_args.v_arg[1]);
+		break;
+	case SysCallId::MREMAP:
+		debug_opts.m_memory.onMappingChange(m_cached_args.v_arg[0], m_cached_args.v_arg[1]);
+		debug_opts.m_memory.onMappingChange(m_cached_args.v_rval, m_cached_args.v_arg[2]);
+		break;
+	case SysCallId::OLD_MMAP:
+	case SysCallId::SHMAT:
+	case SysCallId::SHMDT:
+		// range is not known from the arguments
+		debug_opts.m_memory.onMappingChange(0, UINTPTR_MAX);
+		break;
+	default:
+		break;
 	}
 
 	// Find and invoke system call handler
@@ -583,7 +665,7 @@ int SyscallManager::onExit(TraceeProgram &traceeProg)
 	if (sys_hdl_not_fnd)
 	{
 		// Not found!
-		m_log->trace("onExit : No syscall handler is registered for this syscall number");
+		SPDLOG_LOGGER_TRACE(m_log, "onExit : No syscall handler is registered for this syscall number");
 	}
 	return 0;
 }
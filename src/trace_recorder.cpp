@@ -0,0 +1,140 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#include "trace_recorder.hpp"
+#include "syscall.hpp"
+
+/// @brief how long the consumer sleeps when the ring is empty
+#define TRACE_RECORDER_IDLE_US 1000
+
+TraceRecorder::TraceRecorder(size_t capacity)
+	: m_head(0), m_tail(0), m_dropped(0), m_running(false)
+{
+	size_t ring_size = 1;
+	while (ring_size < capacity)
+	{
+		ring_size <<= 1;
+	}
+	m_ring.resize(ring_size);
+	m_mask = ring_size - 1;
+}
+
+TraceRecorder::~TraceRecorder()
+{
+	stop();
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+	}
+}
+
+int TraceRecorder::openBinaryFile(const std::string &path)
+{
+	m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (m_fd < 0)
+	{
+		m_log->error("Failed to open the trace file {} : {}", path, strerror(errno));
+		return -1;
+	}
+
+	TraceFileHeader header = {TRACE_RECORDER_MAGIC, TRACE_RECORDER_VERSION, sizeof(TraceRecord)};
+	if (write(m_fd, &header, sizeof(header)) != sizeof(header))
+	{
+		m_log->error("Failed to write the trace file header : {}", strerror(errno));
+		close(m_fd);
+		m_fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+void TraceRecorder::start()
+{
+	if (m_running.exchange(true))
+	{
+		return;
+	}
+	m_consumer = std::thread(&TraceRecorder::consume, this);
+}
+
+void TraceRecorder::stop()
+{
+	if (!m_running.exchange(false))
+	{
+		return;
+	}
+	m_consumer.join();
+	drain();
+	if (m_dropped.load() > 0)
+	{
+		m_log->warn("Trace recorder dropped {} records", m_dropped.load());
+	}
+}
+
+size_t TraceRecorder::drain()
+{
+	uint64_t tail = m_tail.load(std::memory_order_relaxed);
+	uint64_t head = m_head.load(std::memory_order_acquire);
+	size_t count = head - tail;
+
+	while (tail != head)
+	{
+		// contiguous part of the ring, at most up to its end
+		size_t begin = tail & m_mask;
+		size_t chunk = std::min<uint64_t>(head - tail, m_ring.size() - begin);
+
+		if (m_fd >= 0)
+		{
+			size_t len = chunk * sizeof(TraceRecord);
+			if (write(m_fd, &m_ring[begin], len) != static_cast<ssize_t>(len))
+			{
+				m_log->error("Failed to write the trace records : {}", strerror(errno));
+			}
+		}
+		if (m_logger)
+		{
+			for (size_t idx = begin; idx < begin + chunk; idx++)
+			{
+				m_logger->info(format(m_ring[idx]));
+			}
+		}
+
+		tail += chunk;
+		m_tail.store(tail, std::memory_order_release);
+	}
+	return count;
+}
+
+void TraceRecorder::consume()
+{
+	while (m_running.load(std::memory_order_relaxed))
+	{
+		if (drain() == 0)
+		{
+			usleep(TRACE_RECORDER_IDLE_US);
+		}
+	}
+}
+
+std::string TraceRecorder::format(const TraceRecord &rec)
+{
+	switch (static_cast<TraceRecordType>(rec.type))
+	{
+	case TraceRecordType::WAIT_STATUS:
+		return spdlog::fmt_lib::format("{} [{}] wait status {:#x}", rec.timestamp_ns, rec.pid, rec.arg0);
+	case TraceRecordType::BREAKPOINT_HIT:
+		return spdlog::fmt_lib::format("{} [{}] breakpoint 0x{:x}", rec.timestamp_ns, rec.pid, rec.arg0);
+	case TraceRecordType::SYSCALL_ENTER:
+		return spdlog::fmt_lib::format("{} [{}] syscall -> {}", rec.timestamp_ns, rec.pid,
+			SysCallId(static_cast<int16_t>(rec.arg0)).getString());
+	case TraceRecordType::SYSCALL_EXIT:
+		return spdlog::fmt_lib::format("{} [{}] syscall <- {} 0x{:x}", rec.timestamp_ns, rec.pid,
+			SysCallId(static_cast<int16_t>(rec.arg0)).getString(), rec.arg1);
+	case TraceRecordType::TRACEE_ADDED:
+		return spdlog::fmt_lib::format("{} [{}] tracee added", rec.timestamp_ns, rec.pid);
+	case TraceRecordType::TRACEE_DROPPED:
+		return spdlog::fmt_lib::format("{} [{}] tracee dropped", rec.timestamp_ns, rec.pid);
+	}
+	return spdlog::fmt_lib::format("{} [{}] unknown record {}", rec.timestamp_ns, rec.pid, rec.type);
+}
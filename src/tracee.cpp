@@ -1,6 +1,7 @@
 #include "tracee.hpp"
 #include "branch_data.hpp"
 #include "syscall_injector.hpp"
+#include "arch_traits.hpp"
 
 
 TraceeProgram::TraceeProgram(pid_t _tracee_pid, DebugType debug_type,
@@ -54,18 +55,29 @@ bool TraceeProgram::hasExited() {
 	return m_state == TraceeState::EXITED;
 }
 
+void TraceeProgram::onResume() {
+	m_debug_opts.m_memory.onResume();
+	m_debug_opts.m_register.onResume();
+}
+
+void TraceeProgram::onStop() {
+	m_debug_opts.m_memory.onStop();
+}
+
 int TraceeProgram::contExecution(uint32_t sig) {
 	int pt_ret = -1;
 	int mode = debugType | DebugType::DEFAULT;
+
+	onResume();
 	
 	if (debugType & DebugType::DEFAULT) {
-		m_log->trace("contExec Tracee CONT");
+		SPDLOG_LOGGER_TRACE(m_log, "contExec Tracee CONT");
 		pt_ret = ptrace(PTRACE_CONT, pid(), 0L, sig);
 	} else if (debugType & DebugType::TRACE_SYSCALL) {
-		m_log->trace("contExec Tracee Syscall");
+		SPDLOG_LOGGER_TRACE(m_log, "contExec Tracee Syscall");
 		pt_ret = ptrace(PTRACE_SYSCALL, pid(), 0L, sig);
 	} else if (debugType & DebugType::SINGLE_STEP) {
-		m_log->trace("contExec single step");
+		SPDLOG_LOGGER_TRACE(m_log, "contExec single step");
 		pt_ret = ptrace(PTRACE_SINGLESTEP, pid(), 0L, sig);
 	}
 
@@ -76,6 +88,7 @@ int TraceeProgram::contExecution(uint32_t sig) {
 }
 
 int TraceeProgram::singleStep() {
+	onResume();
 	int pt_ret = ptrace(PTRACE_SINGLESTEP, pid(), 0L, 0);
 	if(pt_ret < 0) {
 		m_log->error("failed to single step! Err code : {} ", pt_ret);
@@ -116,7 +129,7 @@ std::string TraceeProgram::getStateString() {
 }
 
 void TraceeProgram::printStatus() {
-	m_log->debug("PID : {} TID : {} State : {}", pid(), tid(), getStateString());
+	SPDLOG_LOGGER_DEBUG(m_log, "PID : {} TID : {} State : {}", pid(), tid(), getStateString());
 }
 
 // void TraceeProgram::addPendingBrkPnt(std::vector<std::string>& brk_pnt_str) {
@@ -127,33 +140,47 @@ void TraceeProgram::printStatus() {
 
 TraceeProgram* TraceeFactory::createTracee(pid_t tracee_pid, DebugType debug_type, TargetDescription& target_desc) {
 	
-	Registers* cpuRegister;
+	Registers* cpuRegister = nullptr;
 
 	switch (target_desc.m_cpu_arch) {
-		case CPU_ARCH::X86:
-			cpuRegister = new X86Register(tracee_pid);
-			break;
-		case CPU_ARCH::AMD64:
-			cpuRegister = new AMD64Register(tracee_pid);
-			break;
-		case CPU_ARCH::ARM32:
-			cpuRegister = new ARM32Register(tracee_pid);
-			break;
-		case CPU_ARCH::ARM64:
-			cpuRegister = new ARM64Register(tracee_pid);
-			break;
+		ARCH_DISPATCH(cpuRegister = new Arch::Register(tracee_pid))
 		default:
-			spdlog::error("Invalid ARCH parameter for register");
-		break;
+			spdlog::error("Architecture {} is not enabled in config.hpp", static_cast<int>(target_desc.m_cpu_arch));
+			return nullptr;
 	}
 
+	RemoteMemory* remote_mem = new RemoteMemory(tracee_pid);
+	ProcessMap* proc_map = new ProcessMap(tracee_pid);
+	remote_mem->setProcessMap(proc_map);
+
 	DebugOpts* db_opts = new DebugOpts(tracee_pid, *cpuRegister,
-		*new RemoteMemory(tracee_pid),*new ProcessMap(tracee_pid));
+		*remote_mem, *proc_map);
 	TraceeProgram* traceeProg = new TraceeProgram(tracee_pid, debug_type, *db_opts, target_desc);
 	
 	return traceeProg;
 }
 
+bool TraceeFactory::isSupported(CPU_ARCH cpu_arch) {
+	// the breakpoint injector, the displaced stepper and the debug
+	// registers are only built for the first enabled architecture
+	return cpu_arch == TARGET_CPU_ARCH;
+}
+
+void TraceeFactory::destroyTracee(TraceeProgram* tracee_obj) {
+	DebugOpts& db_opts = tracee_obj->getDebugOpts();
+
+	switch (tracee_obj->m_target_desc.m_cpu_arch) {
+		ARCH_DISPATCH(delete &archRegisters<Arch>(db_opts.m_register))
+		default:
+		break;
+	}
+
+	delete &db_opts.m_memory;
+	delete &db_opts.m_procMap;
+	delete &db_opts;
+	delete tracee_obj;
+}
+
 void TraceeFactory::releaseTracee(TraceeProgram* tracee_obj) {
 	m_cached_tracee.push_back(tracee_obj);
 }
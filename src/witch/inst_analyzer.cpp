@@ -51,9 +51,9 @@ bool ARMInstAnalyzer::getBranchDest(cs_insn* inst, BranchData& branch_info, Debu
             if (detail->arm.operands[i].reg == ARM_REG_PC) {
                 // read the stack memory and figure out the branch destination
                 // printf("PC idx %d = [SP - %d]\n", i + 1, i*4);
-                Addr* sp_addr = debug_opts.m_memory.readPointerObj(arm_reg.getStackPointer() + 4, 4);
+                AddrView sp_data = debug_opts.m_memory.readView(arm_reg.getStackPointer() + 4, 4);
                 branch_info.m_direct_branch = true;
-                branch_info.m_target = sp_addr->read_u32();
+                branch_info.m_target = sp_data.read_u32();
                 _found_dest = true;
             }
         }
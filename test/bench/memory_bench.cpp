@@ -0,0 +1,353 @@
+/**
+ * @file memory_bench.cpp
+ * @brief Throughput and latency of the RemoteMemory backends
+ *
+ * The benchmark forks itself, the child stops right after PTRACE_TRACEME
+ * so its address space is a copy of ours and every address of the local
+ * buffer is valid in the Tracee as well. The child is never resumed.
+ *
+ * usage: memory_bench [--json] [--quick] [--backend process_vm|mem_file|ptrace]
+ *
+ * Every measurement is printed as one CSV row (or JSON object) :
+ * backend, test, size, count, iterations, total_ns, ns_per_op, mib_per_s
+ *
+ * The backend column names the mechanism which actually moved the data.
+ * RemoteMemory writes through /proc/<pid>/mem before process_vm_writev
+ * by default, those write rows of the process_vm pass are labelled
+ * "process_vm/mem_file". The pass measures the writes a second time with
+ * RemoteMemory::setProcessVmWrites, labelled "process_vm".
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <csignal>
+#include <string>
+#include <vector>
+#include <random>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/null_sink.h"
+
+#include "memory.hpp"
+#include "modules.hpp"
+#include "registers.hpp"
+#include "debug_opts.hpp"
+#include "breakpoint.hpp"
+
+#define BENCH_BUFFER_SIZE (16 * 1024 * 1024)
+
+/// @brief bytes moved per measurement, the iterations are derived from it
+#define BENCH_TARGET_BYTES (256 * 1024 * 1024ULL)
+
+static uint8_t *bench_buffer = nullptr;
+
+/// @brief breakpoints are injected here, never executed
+__attribute__((noinline)) static int bench_target_fn(int val)
+{
+    return val * 3 + 1;
+}
+
+struct BenchResult {
+    std::string backend;
+    std::string test;
+    size_t size;
+    size_t count;
+    size_t iterations;
+    uint64_t total_ns;
+};
+
+class BenchReport {
+    bool m_json;
+    bool m_first = true;
+
+public:
+    BenchReport(bool json) : m_json(json)
+    {
+        if (m_json)
+            printf("[\n");
+        else
+            printf("backend,test,size,count,iterations,total_ns,ns_per_op,mib_per_s\n");
+    }
+
+    ~BenchReport()
+    {
+        if (m_json)
+            printf("\n]\n");
+    }
+
+    void add(const BenchResult &res)
+    {
+        double ns_per_op = res.iterations ? double(res.total_ns) / res.iterations : 0;
+        double bytes = double(res.size) * res.count * res.iterations;
+        double mib_per_s = res.total_ns ? (bytes / (1024.0 * 1024.0)) / (res.total_ns / 1e9) : 0;
+
+        if (m_json)
+        {
+            printf("%s  {\"backend\": \"%s\", \"test\": \"%s\", \"size\": %zu, \"count\": %zu, "
+                   "\"iterations\": %zu, \"total_ns\": %llu, \"ns_per_op\": %.1f, \"mib_per_s\": %.2f}",
+                   m_first ? "" : ",\n", res.backend.c_str(), res.test.c_str(), res.size, res.count,
+                   res.iterations, (unsigned long long)res.total_ns, ns_per_op, mib_per_s);
+        }
+        else
+        {
+            printf("%s,%s,%zu,%zu,%zu,%llu,%.1f,%.2f\n", res.backend.c_str(), res.test.c_str(),
+                   res.size, res.count, res.iterations, (unsigned long long)res.total_ns,
+                   ns_per_op, mib_per_s);
+        }
+        m_first = false;
+        fflush(stdout);
+    }
+};
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+static const char *backendName(MemoryBackend backend)
+{
+    switch (backend)
+    {
+    case MemoryBackend::PROCESS_VM:
+        return "process_vm";
+    case MemoryBackend::MEM_FILE:
+        return "mem_file";
+    case MemoryBackend::PTRACE:
+        return "ptrace";
+    }
+    return "unknown";
+}
+
+/// @brief name of the mechanism used by RemoteMemory::writeRemote
+static const char *writeBackendName(MemoryBackend backend)
+{
+    if (backend == MemoryBackend::PROCESS_VM)
+        return "process_vm/mem_file";
+    return backendName(backend);
+}
+
+static size_t iterationsFor(size_t bytes_per_op, MemoryBackend backend, bool quick)
+{
+    uint64_t target = BENCH_TARGET_BYTES;
+    // one syscall per word, keep the run time reasonable
+    if (backend == MemoryBackend::PTRACE)
+        target /= 32;
+    if (quick)
+        target /= 16;
+
+    size_t iterations = target / bytes_per_op;
+    return std::max<size_t>(3, std::min<size_t>(iterations, 100000));
+}
+
+static void benchWrite(BenchReport &report, RemoteMemory &memory, const char *backend,
+                       const std::vector<uint8_t> &local, size_t size, size_t iterations)
+{
+    uintptr_t remote = reinterpret_cast<uintptr_t>(bench_buffer);
+
+    uint64_t start = nowNs();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        if (memory.writeRemote(remote, local.data(), size) != static_cast<ssize_t>(size))
+        {
+            fprintf(stderr, "write of %zu bytes failed\n", size);
+            break;
+        }
+    }
+    report.add({backend, "write", size, 1, iterations, nowNs() - start});
+}
+
+static void benchSequential(BenchReport &report, RemoteMemory &memory, bool quick)
+{
+    static const size_t sizes[] = {8, 64, 512, 4096, 64 * 1024, 1024 * 1024, BENCH_BUFFER_SIZE};
+    std::vector<uint8_t> local(BENCH_BUFFER_SIZE);
+    MemoryBackend mem_backend = memory.backend();
+    const char *backend = backendName(mem_backend);
+    uintptr_t remote = reinterpret_cast<uintptr_t>(bench_buffer);
+
+    for (size_t size : sizes)
+    {
+        size_t iterations = iterationsFor(size, memory.backend(), quick);
+
+        uint64_t start = nowNs();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            if (memory.readRemote(remote, local.data(), size) != static_cast<ssize_t>(size))
+            {
+                fprintf(stderr, "read of %zu bytes failed\n", size);
+                break;
+            }
+        }
+        report.add({backend, "read", size, 1, iterations, nowNs() - start});
+
+        benchWrite(report, memory, writeBackendName(mem_backend), local, size, iterations);
+
+        // the buffer is writable, process_vm_writev moves all of it
+        if (mem_backend == MemoryBackend::PROCESS_VM)
+        {
+            memory.setProcessVmWrites(true);
+            benchWrite(report, memory, backend, local, size, iterations);
+            memory.setProcessVmWrites(false);
+        }
+    }
+}
+
+static void benchScattered(BenchReport &report, RemoteMemory &memory, bool quick)
+{
+    static const size_t counts[] = {1, 64, 4096};
+    const char *backend = backendName(memory.backend());
+    std::mt19937_64 rng(0x5a4d);
+
+    for (size_t count : counts)
+    {
+        std::vector<uint64_t> values(count);
+        std::vector<RemoteIoVec> vecs(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            uintptr_t offset = (rng() % (BENCH_BUFFER_SIZE / sizeof(uint64_t))) * sizeof(uint64_t);
+            vecs[i] = RemoteIoVec(reinterpret_cast<uintptr_t>(bench_buffer) + offset, sizeof(uint64_t), &values[i]);
+        }
+
+        size_t iterations = iterationsFor(count * 4096, memory.backend(), quick);
+
+        // one RemoteMemory call per address
+        uint64_t start = nowNs();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            for (size_t j = 0; j < count; j++)
+                memory.readRemote(vecs[j].raddr, &values[j], sizeof(uint64_t));
+        }
+        report.add({backend, "scatter_read", sizeof(uint64_t), count, iterations, nowNs() - start});
+
+        // all the addresses in one batch
+        start = nowNs();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            memory.readv(vecs);
+        }
+        report.add({backend, "scatter_readv", sizeof(uint64_t), count, iterations, nowNs() - start});
+    }
+}
+
+static void benchBreakpoint(BenchReport &report, DebugOpts &debug_opts, bool quick)
+{
+#if defined(SUPPORT_ARCH_AMD64) || defined(SUPPORT_ARCH_X86)
+    X86BreakpointInjector injector;
+#elif defined(SUPPORT_ARCH_ARM64)
+    ARM64BreakpointInjector injector;
+#else
+    ARMBreakpointInjector injector;
+#endif
+    // the breakpoint is read and written, report the write mechanism
+    const char *backend = writeBackendName(debug_opts.m_memory.backend());
+    Addr backup(reinterpret_cast<uintptr_t>(&bench_target_fn), 8);
+    size_t iterations = quick ? 2000 : 20000;
+    if (debug_opts.m_memory.backend() == MemoryBackend::PTRACE)
+        iterations /= 4;
+
+    uint64_t start = nowNs();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        injector.inject(debug_opts, backup);
+        injector.restore(debug_opts, backup);
+    }
+    report.add({backend, "bkpt_inject_restore", backup.size(), 1, iterations, nowNs() - start});
+}
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    bool quick = false;
+    std::vector<MemoryBackend> backends = {MemoryBackend::PROCESS_VM, MemoryBackend::MEM_FILE, MemoryBackend::PTRACE};
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--json")
+        {
+            json = true;
+        }
+        else if (arg == "--quick")
+        {
+            quick = true;
+        }
+        else if (arg == "--backend" && i + 1 < argc)
+        {
+            std::string name = argv[++i];
+            backends.clear();
+            for (MemoryBackend backend : {MemoryBackend::PROCESS_VM, MemoryBackend::MEM_FILE, MemoryBackend::PTRACE})
+            {
+                if (name == backendName(backend))
+                    backends.push_back(backend);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--json] [--quick] [--backend process_vm|mem_file|ptrace]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (backends.empty())
+    {
+        fprintf(stderr, "unknown backend\n");
+        return 1;
+    }
+
+    // the library logs to these, keep the measurements free of logging
+    for (auto name : {"main", "bkpt", "syscall", "res_tracer", "debugger", "disasm", "tracee"})
+        spdlog::create<spdlog::sinks::null_sink_mt>(name);
+
+    bench_buffer = reinterpret_cast<uint8_t *>(aligned_alloc(4096, BENCH_BUFFER_SIZE));
+    for (size_t i = 0; i < BENCH_BUFFER_SIZE; i++)
+        bench_buffer[i] = i * 7;
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        ptrace(PTRACE_TRACEME, 0, 0, 0);
+        raise(SIGSTOP);
+        _exit(bench_target_fn(0));
+    }
+
+    int status;
+    if (child < 0 || waitpid(child, &status, 0) != child || !WIFSTOPPED(status))
+    {
+        fprintf(stderr, "failed to start the tracee\n");
+        return 1;
+    }
+
+    {
+        BenchReport report(json);
+        for (MemoryBackend backend : backends)
+        {
+            RemoteMemory memory(child);
+            memory.setBackend(backend);
+            ProcessMap proc_map(child);
+#if defined(SUPPORT_ARCH_AMD64)
+            AMD64Register regs(child);
+#elif defined(SUPPORT_ARCH_X86)
+            X86Register regs(child);
+#elif defined(SUPPORT_ARCH_ARM64)
+            ARM64Register regs(child);
+#else
+            ARM32Register regs(child);
+#endif
+            DebugOpts debug_opts(child, regs, memory, proc_map);
+
+            benchSequential(report, memory, quick);
+            benchScattered(report, memory, quick);
+            benchBreakpoint(report, debug_opts, quick);
+        }
+    }
+
+    kill(child, SIGKILL);
+    waitpid(child, &status, 0);
+    free(bench_buffer);
+    return 0;
+}
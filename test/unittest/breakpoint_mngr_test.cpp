@@ -0,0 +1,102 @@
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "breakpoint_mngr.hpp"
+#include "branch_data.hpp"
+#include "self_tracee.hpp"
+
+#define TEST_PAGE_SIZE 4096
+
+class WriteBreakpointsTest : public SelfTraceeTest {
+protected:
+    BreakpointMngr *m_brkpnt_mngr = nullptr;
+    std::string m_modname = "unittest";
+
+    /// @brief two pages, written in place by the batch and by the
+    /// breakpoints one at a time
+    uint8_t *m_batched = nullptr;
+    uint8_t *m_single = nullptr;
+    uint8_t *m_original = nullptr;
+
+    std::vector<Breakpoint *> m_brkpnts;
+
+    void SetUp()
+    {
+        SelfTraceeTest::SetUp();
+        m_brkpnt_mngr = new BreakpointMngr(m_target_desc);
+
+        m_batched = reinterpret_cast<uint8_t *>(aligned_alloc(TEST_PAGE_SIZE, 2 * TEST_PAGE_SIZE));
+        m_single = reinterpret_cast<uint8_t *>(aligned_alloc(TEST_PAGE_SIZE, 2 * TEST_PAGE_SIZE));
+        m_original = new uint8_t[2 * TEST_PAGE_SIZE];
+        for (size_t i = 0; i < 2 * TEST_PAGE_SIZE; i++)
+            m_original[i] = i * 7 + 1;
+        memcpy(m_batched, m_original, 2 * TEST_PAGE_SIZE);
+        memcpy(m_single, m_original, 2 * TEST_PAGE_SIZE);
+    }
+
+    void TearDown()
+    {
+        free(m_batched);
+        free(m_single);
+        delete[] m_original;
+        for (Breakpoint *brkpnt : m_brkpnts)
+            delete brkpnt;
+        delete m_brkpnt_mngr;
+        SelfTraceeTest::TearDown();
+    }
+
+    std::vector<Breakpoint *> breakpointsAt(uint8_t *buffer, const std::vector<size_t> &offsets)
+    {
+        std::vector<Breakpoint *> brkpnts;
+        for (size_t offset : offsets)
+        {
+            Breakpoint *brkpnt = new Breakpoint(m_modname, offset);
+            brkpnt->setAddress(reinterpret_cast<uintptr_t>(buffer) + offset);
+            brkpnts.push_back(brkpnt);
+            m_brkpnts.push_back(brkpnt);
+        }
+        return brkpnts;
+    }
+};
+
+TEST_F(WriteBreakpointsTest, SameCodeAsOneAtATime)
+{
+    // unsorted, two on adjacent bytes, one whose backup runs into the
+    // second page, which is a batch of its own
+    std::vector<size_t> offsets = {0x1020, 0x11, 0x10, 0xffc, 0x800, 0x17f0};
+    std::vector<Breakpoint *> batch = breakpointsAt(m_batched, offsets);
+    std::vector<Breakpoint *> single = breakpointsAt(m_single, offsets);
+
+    m_brkpnt_mngr->writeBreakpoints(*m_tracee, batch, true);
+    for (Breakpoint *brkpnt : single)
+        brkpnt->enable(*m_tracee);
+
+    EXPECT_EQ(memcmp(m_batched, m_single, 2 * TEST_PAGE_SIZE), 0);
+    EXPECT_NE(memcmp(m_batched, m_original, 2 * TEST_PAGE_SIZE), 0);
+
+    for (size_t idx = 1; idx < batch.size(); idx++)
+        EXPECT_LT(batch[idx - 1]->m_addr, batch[idx]->m_addr);
+    for (Breakpoint *brkpnt : batch)
+        EXPECT_TRUE(brkpnt->isEnabled());
+
+    m_brkpnt_mngr->writeBreakpoints(*m_tracee, batch, false);
+    EXPECT_EQ(memcmp(m_batched, m_original, 2 * TEST_PAGE_SIZE), 0);
+    for (Breakpoint *brkpnt : batch)
+        EXPECT_FALSE(brkpnt->isEnabled());
+}
+
+TEST_F(WriteBreakpointsTest, BackupHoldsOriginalCode)
+{
+    std::vector<Breakpoint *> batch = breakpointsAt(m_batched, {0x40, 0x1040});
+    m_brkpnt_mngr->writeBreakpoints(*m_tracee, batch, true);
+
+    for (Breakpoint *brkpnt : batch)
+    {
+        size_t offset = brkpnt->m_addr - reinterpret_cast<uintptr_t>(m_batched);
+        EXPECT_EQ(memcmp(brkpnt->m_backupData.data(), m_original + offset, brkpnt->m_backupData.size()), 0);
+    }
+
+    m_brkpnt_mngr->writeBreakpoints(*m_tracee, batch, false);
+}
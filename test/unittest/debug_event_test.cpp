@@ -0,0 +1,89 @@
+#include <set>
+#include <gtest/gtest.h>
+
+#include "linux_debugger.hpp"
+
+static DebugEventPtr eventOf(pid_t pid)
+{
+    DebugEventPtr debug_event = DebugEvent::allocate();
+    debug_event->m_pid = pid;
+    return debug_event;
+}
+
+TEST(DebugEventQueue, FifoOrder)
+{
+    DebugEventQueue event_queue;
+    EXPECT_TRUE(event_queue.empty());
+
+    for (pid_t pid = 1; pid <= 3; pid++)
+        event_queue.push(eventOf(pid));
+    EXPECT_EQ(event_queue.size(), 3u);
+
+    for (pid_t pid = 1; pid <= 3; pid++)
+    {
+        DebugEventPtr debug_event = event_queue.pop();
+        EXPECT_EQ(debug_event->m_pid, pid);
+        EXPECT_EQ(debug_event->m_next, nullptr);
+    }
+    EXPECT_TRUE(event_queue.empty());
+    EXPECT_EQ(event_queue.size(), 0u);
+
+    // the tail is reset once the queue is drained
+    event_queue.push(eventOf(4));
+    EXPECT_EQ(event_queue.pop()->m_pid, 4);
+}
+
+TEST(DebugEventQueue, MoveTakesTheEvents)
+{
+    DebugEventQueue event_queue;
+    event_queue.push(eventOf(1));
+    event_queue.push(eventOf(2));
+
+    DebugEventQueue moved_queue(std::move(event_queue));
+    EXPECT_TRUE(event_queue.empty());
+    EXPECT_EQ(moved_queue.size(), 2u);
+
+    event_queue = std::move(moved_queue);
+    EXPECT_TRUE(moved_queue.empty());
+    EXPECT_EQ(event_queue.pop()->m_pid, 1);
+    EXPECT_EQ(event_queue.pop()->m_pid, 2);
+}
+
+TEST(DebugEventPool, ReleasedEventIsReused)
+{
+    DebugEvent *first = nullptr;
+    {
+        DebugEventPtr debug_event = eventOf(42);
+        debug_event->event.type = TraceeEvent::STOPPED;
+        first = debug_event.get();
+    }
+
+    DebugEventPtr debug_event = DebugEvent::allocate();
+    EXPECT_EQ(debug_event.get(), first);
+    // nothing of the previous use is left
+    EXPECT_EQ(debug_event->m_pid, 0);
+    EXPECT_EQ(debug_event->m_next, nullptr);
+    EXPECT_EQ(debug_event->event.type, TraceeEvent::INVALID);
+    EXPECT_EQ(debug_event->reason.status, TrapReason::INVALID);
+}
+
+TEST(DebugEventPool, QueueGivesItsEventsBack)
+{
+    std::set<DebugEvent *> queued;
+    {
+        DebugEventQueue event_queue;
+        for (pid_t pid = 1; pid <= 4; pid++)
+        {
+            DebugEventPtr debug_event = eventOf(pid);
+            queued.insert(debug_event.get());
+            event_queue.push(std::move(debug_event));
+        }
+    }
+
+    std::vector<DebugEventPtr> reused;
+    for (size_t idx = 0; idx < queued.size(); idx++)
+    {
+        reused.push_back(DebugEvent::allocate());
+        EXPECT_EQ(queued.count(reused.back().get()), 1u);
+    }
+}
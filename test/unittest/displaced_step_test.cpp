@@ -0,0 +1,186 @@
+#include <cstring>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "displaced_step.hpp"
+#include "self_tracee.hpp"
+
+#define TEST_BRK_ADDR 0x401000
+
+#if defined(SUPPORT_ARCH_ARM)
+/// @brief the branches are decoded by the ArmDisassembler, which takes the
+/// DebugOpts of a Tracee, the test process is used. The Tracee only has
+/// ARM32 registers when the architecture is compiled in.
+class ARM32DisplacedStepTest : public SelfTraceeTest {
+protected:
+    typedef ARM32DisplacedStepper::Plan Plan;
+
+    ARM32DisplacedStepper m_stepper;
+
+    ARM32DisplacedStepTest() : SelfTraceeTest(CPU_ARCH::ARM32)
+    {
+        m_target_desc.m_cpu_mode = CPU_MODE::ARM;
+    }
+
+    Plan decode(uint32_t insn)
+    {
+        Plan plan = {};
+        plan.m_insn = insn;
+        m_stepper.decode(m_tracee->getDebugOpts(), TEST_BRK_ADDR, plan);
+        return plan;
+    }
+};
+
+TEST_F(ARM32DisplacedStepTest, PcRelativeLoad)
+{
+    // ldr r0, [pc, #8]
+    Plan plan = decode(0xe59f0008);
+    ASSERT_EQ(plan.m_kind, Plan::SUBSTITUTE);
+    // r0 is the destination, r8 the offset field read as Rm
+    EXPECT_EQ(plan.m_scratch_reg, 1);
+    // ldr r0, [r1, #8]
+    EXPECT_EQ(plan.m_relocated, 0xe5910008u);
+}
+
+TEST_F(ARM32DisplacedStepTest, PcRelativeDataProcessing)
+{
+    // add r0, pc, #4
+    Plan plan = decode(0xe28f0004);
+    ASSERT_EQ(plan.m_kind, Plan::SUBSTITUTE);
+    EXPECT_EQ(plan.m_relocated, 0xe2810004u);
+
+    // add pc, pc, r0 both reads and writes the PC
+    EXPECT_EQ(decode(0xe08ff000).m_kind, Plan::UNSUPPORTED);
+}
+
+TEST_F(ARM32DisplacedStepTest, Branches)
+{
+    // b +8, the PC reads 8 bytes ahead
+    Plan plan = decode(0xea000000);
+    ASSERT_EQ(plan.m_kind, Plan::BRANCH);
+    EXPECT_FALSE(plan.m_is_call);
+    EXPECT_EQ(plan.m_target, TEST_BRK_ADDR + 8u);
+
+    // bl -8, to itself
+    plan = decode(0xebfffffe);
+    ASSERT_EQ(plan.m_kind, Plan::BRANCH);
+    EXPECT_TRUE(plan.m_is_call);
+    EXPECT_EQ(plan.m_target, TEST_BRK_ADDR);
+}
+
+TEST_F(ARM32DisplacedStepTest, CopiedAndInPlace)
+{
+    // mov r0, r1 and bx lr don't depend on their address
+    EXPECT_EQ(decode(0xe1a00001).m_kind, Plan::COPY);
+    EXPECT_EQ(decode(0xe12fff1e).m_kind, Plan::COPY);
+
+    // blx r3 would return to the slot
+    EXPECT_EQ(decode(0xe12fff33).m_kind, Plan::UNSUPPORTED);
+}
+#endif
+
+/// @brief decode only, nothing is executed or written in a Tracee
+class AMD64DisplacedStepTest : public ::testing::Test {
+protected:
+    typedef AMD64DisplacedStepper::Plan Plan;
+
+    AMD64DisplacedStepper m_stepper;
+
+    Plan decode(const std::vector<uint8_t> &code)
+    {
+        Plan plan = {};
+        m_stepper.decode(TEST_BRK_ADDR, code.data(), code.size(), plan);
+        return plan;
+    }
+};
+
+TEST_F(AMD64DisplacedStepTest, RipRelativeLoad)
+{
+    // mov 0x10(%rip), %rax
+    std::vector<uint8_t> code = {0x48, 0x8b, 0x05, 0x10, 0x00, 0x00, 0x00};
+    Plan plan = decode(code);
+
+    ASSERT_EQ(plan.m_kind, Plan::RIP_RELATIVE);
+    EXPECT_EQ(plan.m_size, code.size());
+    // %rax is used, %rcx is the first free one
+    EXPECT_EQ(plan.m_scratch_reg, 1);
+    // mov 0x10(%rcx), %rax, same length and displacement
+    std::vector<uint8_t> relocated = {0x48, 0x8b, 0x81, 0x10, 0x00, 0x00, 0x00};
+    EXPECT_EQ(memcmp(plan.m_relocated, relocated.data(), relocated.size()), 0);
+}
+
+TEST_F(AMD64DisplacedStepTest, RipRelativeClearsRexB)
+{
+    // mov 0x10(%rip), %rax with a REX.B, ignored for %rip
+    std::vector<uint8_t> code = {0x49, 0x8b, 0x05, 0x10, 0x00, 0x00, 0x00};
+    Plan plan = decode(code);
+
+    ASSERT_EQ(plan.m_kind, Plan::RIP_RELATIVE);
+    EXPECT_EQ(plan.m_relocated[0], 0x48);
+    EXPECT_EQ(plan.m_relocated[2], 0x80 | plan.m_scratch_reg);
+}
+
+TEST_F(AMD64DisplacedStepTest, RipRelativeAvoidsUsedRegisters)
+{
+    // cmp %rcx, 0x20(%rip), %rcx can't be the scratch register
+    std::vector<uint8_t> code = {0x48, 0x39, 0x0d, 0x20, 0x00, 0x00, 0x00};
+    Plan plan = decode(code);
+
+    ASSERT_EQ(plan.m_kind, Plan::RIP_RELATIVE);
+    EXPECT_NE(plan.m_scratch_reg, 1);
+    EXPECT_EQ(plan.m_relocated[2], 0x80 | (code[2] & 0x38) | plan.m_scratch_reg);
+}
+
+TEST_F(AMD64DisplacedStepTest, RelativeBranches)
+{
+    // jmp rel32
+    Plan plan = decode({0xe9, 0x10, 0x00, 0x00, 0x00});
+    ASSERT_EQ(plan.m_kind, Plan::BRANCH);
+    EXPECT_FALSE(plan.m_is_call);
+    EXPECT_EQ(plan.m_target, TEST_BRK_ADDR + 5 + 0x10);
+    uint8_t always = plan.m_cond;
+
+    // call rel32, backwards
+    plan = decode({0xe8, 0xfb, 0xff, 0xff, 0xff});
+    ASSERT_EQ(plan.m_kind, Plan::BRANCH);
+    EXPECT_TRUE(plan.m_is_call);
+    EXPECT_EQ(plan.m_target, TEST_BRK_ADDR);
+
+    // jne rel8
+    plan = decode({0x75, 0x10});
+    ASSERT_EQ(plan.m_kind, Plan::BRANCH);
+    EXPECT_FALSE(plan.m_is_call);
+    EXPECT_NE(plan.m_cond, always);
+    EXPECT_EQ(plan.m_target, TEST_BRK_ADDR + 2 + 0x10);
+}
+
+TEST_F(AMD64DisplacedStepTest, IndirectCalls)
+{
+    // call *0x20(%rip), the pointer is read at the stop
+    Plan plan = decode({0xff, 0x15, 0x20, 0x00, 0x00, 0x00});
+    ASSERT_EQ(plan.m_kind, Plan::INDIRECT);
+    EXPECT_TRUE(plan.m_is_call);
+    EXPECT_EQ(plan.m_target, TEST_BRK_ADDR + 6 + 0x20);
+
+    // call *%rax
+    plan = decode({0xff, 0xd0});
+    ASSERT_EQ(plan.m_kind, Plan::INDIRECT);
+    EXPECT_EQ(plan.m_target, 0u);
+
+    // call *0x8(%rax) becomes jmp *0x8(%rax)
+    plan = decode({0xff, 0x50, 0x08});
+    ASSERT_EQ(plan.m_kind, Plan::CALL_MEMORY);
+    EXPECT_EQ(plan.m_relocated[1], 0x60);
+}
+
+TEST_F(AMD64DisplacedStepTest, CopiedAndInPlace)
+{
+    // push %rbp, ret and jmp *%rax don't depend on their address
+    EXPECT_EQ(decode({0x55}).m_kind, Plan::COPY);
+    EXPECT_EQ(decode({0xc3}).m_kind, Plan::COPY);
+    EXPECT_EQ(decode({0xff, 0xe0}).m_kind, Plan::COPY);
+
+    // syscall and int3 are stepped over in place
+    EXPECT_EQ(decode({0x0f, 0x05}).m_kind, Plan::UNSUPPORTED);
+    EXPECT_EQ(decode({0xcc}).m_kind, Plan::UNSUPPORTED);
+}
@@ -0,0 +1,123 @@
+#include <map>
+#include <gtest/gtest.h>
+
+#include "flat_addr_map.hpp"
+
+/// @brief instruction addresses, they share their low bits and collide
+static uintptr_t insnAddr(size_t idx)
+{
+    return 0x400000 + idx * 0x10;
+}
+
+TEST(FlatAddrMap, FindAfterInsert)
+{
+    FlatAddrMap<int> addr_map;
+    EXPECT_EQ(addr_map.find(0x1000), nullptr);
+
+    addr_map[0x1000] = 1;
+    addr_map[0x2000] = 2;
+
+    ASSERT_NE(addr_map.find(0x1000), nullptr);
+    EXPECT_EQ(*addr_map.find(0x1000), 1);
+    EXPECT_EQ(*addr_map.find(0x2000), 2);
+    EXPECT_EQ(addr_map.find(0x3000), nullptr);
+    EXPECT_EQ(addr_map.size(), 2u);
+}
+
+TEST(FlatAddrMap, EraseMissingAddress)
+{
+    FlatAddrMap<int> addr_map;
+    addr_map.erase(0x1000);
+
+    addr_map[0x1000] = 1;
+    addr_map.erase(0x2000);
+    EXPECT_EQ(addr_map.size(), 1u);
+    EXPECT_EQ(*addr_map.find(0x1000), 1);
+}
+
+TEST(FlatAddrMap, EraseKeepsProbeSequences)
+{
+    // enough entries to grow the table and form clusters, each removal
+    // shifts the slots after it back
+    const size_t entry_count = 500;
+    FlatAddrMap<size_t> addr_map;
+    for (size_t idx = 0; idx < entry_count; idx++)
+        addr_map[insnAddr(idx)] = idx;
+
+    for (size_t idx = 0; idx < entry_count; idx += 3)
+        addr_map.erase(insnAddr(idx));
+
+    size_t kept = 0;
+    for (size_t idx = 0; idx < entry_count; idx++)
+    {
+        size_t *value = addr_map.find(insnAddr(idx));
+        if (idx % 3 == 0)
+        {
+            EXPECT_EQ(value, nullptr) << "0x" << std::hex << insnAddr(idx);
+        }
+        else
+        {
+            ASSERT_NE(value, nullptr) << "0x" << std::hex << insnAddr(idx);
+            EXPECT_EQ(*value, idx);
+            kept++;
+        }
+    }
+    EXPECT_EQ(addr_map.size(), kept);
+}
+
+TEST(FlatAddrMap, MatchesStdMap)
+{
+    FlatAddrMap<uint32_t> addr_map;
+    std::map<uintptr_t, uint32_t> reference;
+
+    uint32_t seed = 12345;
+    for (int step = 0; step < 20000; step++)
+    {
+        seed = seed * 1103515245 + 12345;
+        // few distinct addresses, inserts and removals hit the same ones
+        uintptr_t addr = insnAddr((seed >> 8) % 300 + 1);
+        if ((seed >> 4) % 3 == 0)
+        {
+            addr_map.erase(addr);
+            reference.erase(addr);
+        }
+        else
+        {
+            addr_map[addr] = step;
+            reference[addr] = step;
+        }
+    }
+
+    ASSERT_EQ(addr_map.size(), reference.size());
+    for (auto &entry : reference)
+    {
+        uint32_t *value = addr_map.find(entry.first);
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(*value, entry.second);
+    }
+
+    // the dense list holds exactly the live entries
+    size_t iterated = 0;
+    for (auto &entry : addr_map)
+    {
+        auto ref_iter = reference.find(entry.first);
+        ASSERT_NE(ref_iter, reference.end());
+        EXPECT_EQ(entry.second, ref_iter->second);
+        iterated++;
+    }
+    EXPECT_EQ(iterated, reference.size());
+}
+
+TEST(FlatAddrMap, ClearThenReuse)
+{
+    FlatAddrMap<int> addr_map;
+    for (size_t idx = 0; idx < 100; idx++)
+        addr_map[insnAddr(idx)] = 1;
+
+    addr_map.clear();
+    EXPECT_TRUE(addr_map.empty());
+    EXPECT_EQ(addr_map.find(insnAddr(0)), nullptr);
+
+    addr_map[insnAddr(7)] = 7;
+    EXPECT_EQ(*addr_map.find(insnAddr(7)), 7);
+}
@@ -0,0 +1,20 @@
+/**
+ * @file main.cpp
+ * @brief Entry point of the unit tests
+ *
+ * The library logs to named loggers which the applications create, the
+ * tests create them with a null sink.
+ */
+#include <gtest/gtest.h>
+
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/null_sink.h"
+
+int main(int argc, char **argv)
+{
+    for (auto name : {"main", "bkpt", "syscall", "res_tracer", "debugger", "disasm", "tracee"})
+        spdlog::create<spdlog::sinks::null_sink_mt>(name);
+
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
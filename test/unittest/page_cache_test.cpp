@@ -0,0 +1,106 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "memory.hpp"
+#include "self_tracee.hpp"
+
+/// @brief one page of the test process read through the page cache, the
+/// test changes it behind the cache like a running Tracee would
+class PageCacheTest : public SelfTraceeTest {
+protected:
+    uint64_t *m_page = nullptr;
+
+    void SetUp()
+    {
+        SelfTraceeTest::SetUp();
+        m_page = reinterpret_cast<uint64_t *>(aligned_alloc(PAGE_CACHE_BLOCK_SIZE, PAGE_CACHE_BLOCK_SIZE));
+        memset(m_page, 0, PAGE_CACHE_BLOCK_SIZE);
+        m_page[0] = 0x1111;
+        memory().enablePageCache(PAGE_CACHE_DEFAULT_PAGES, false);
+    }
+
+    void TearDown()
+    {
+        free(m_page);
+        SelfTraceeTest::TearDown();
+    }
+
+    uintptr_t pageAddr() { return reinterpret_cast<uintptr_t>(m_page); }
+
+    uint64_t readValue()
+    {
+        uint64_t value = 0;
+        EXPECT_EQ(memory().readRemote(pageAddr(), &value, sizeof(value)), static_cast<ssize_t>(sizeof(value)));
+        return value;
+    }
+
+    const PageCacheStats &stats() { return *memory().pageCacheStats(); }
+};
+
+TEST_F(PageCacheTest, HitWithinStopEpoch)
+{
+    EXPECT_EQ(readValue(), 0x1111u);
+    EXPECT_EQ(stats().misses, 1u);
+
+    // the page is served from the cache until the Tracee runs again
+    m_page[0] = 0x2222;
+    EXPECT_EQ(readValue(), 0x1111u);
+    EXPECT_EQ(stats().hits, 1u);
+
+    memory().onResume();
+    memory().onStop();
+    EXPECT_EQ(readValue(), 0x2222u);
+    EXPECT_EQ(stats().misses, 2u);
+}
+
+TEST_F(PageCacheTest, WriteRemoteInvalidates)
+{
+    EXPECT_EQ(readValue(), 0x1111u);
+
+    uint64_t value = 0x3333;
+    EXPECT_EQ(memory().writeRemote(pageAddr(), &value, sizeof(value)), static_cast<ssize_t>(sizeof(value)));
+    EXPECT_EQ(stats().invalidations, 1u);
+    EXPECT_EQ(readValue(), 0x3333u);
+    EXPECT_EQ(stats().misses, 2u);
+}
+
+TEST_F(PageCacheTest, MappingChangeInvalidates)
+{
+    EXPECT_EQ(readValue(), 0x1111u);
+
+    m_page[0] = 0x4444;
+    memory().onMappingChange(pageAddr(), PAGE_CACHE_BLOCK_SIZE);
+    EXPECT_EQ(stats().invalidations, 1u);
+    EXPECT_EQ(readValue(), 0x4444u);
+}
+
+TEST_F(PageCacheTest, NotCachedWhileAnotherThreadRuns)
+{
+    // another thread of the same address space
+    RemoteMemory other_thread(getpid());
+    other_thread.shareAddressSpace(memory());
+    other_thread.onResume();
+
+    EXPECT_EQ(readValue(), 0x1111u);
+    m_page[0] = 0x5555;
+    EXPECT_EQ(readValue(), 0x5555u);
+    EXPECT_EQ(stats().hits, 0u);
+
+    // cached again once every thread is stopped
+    other_thread.onStop();
+    EXPECT_EQ(readValue(), 0x5555u);
+    m_page[0] = 0x6666;
+    EXPECT_EQ(readValue(), 0x5555u);
+    EXPECT_EQ(stats().hits, 1u);
+}
+
+TEST_F(PageCacheTest, ZeroLengthRead)
+{
+    uint64_t value = 0;
+    EXPECT_EQ(memory().readRemote(pageAddr(), &value, 0), 0);
+    EXPECT_EQ(memory().readRemote(0, &value, 0), 0);
+    EXPECT_EQ(stats().misses, 0u);
+}
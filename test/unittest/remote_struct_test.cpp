@@ -0,0 +1,107 @@
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <gtest/gtest.h>
+
+#include "remote_struct.hpp"
+#include "self_tracee.hpp"
+
+/// @brief the structures are built in local memory and read back through
+/// the RemoteMemory of the test process
+class RemoteFetchBatchTest : public SelfTraceeTest {
+protected:
+    static uintptr_t addrOf(const void *ptr) { return reinterpret_cast<uintptr_t>(ptr); }
+
+    std::string toString(const RemoteBuffer &buf)
+    {
+        AddrView view = buf.view();
+        return std::string(reinterpret_cast<const char *>(view.data()), view.size());
+    }
+};
+
+TEST_F(RemoteFetchBatchTest, FollowsMessageChain)
+{
+    char first[] = "first";
+    char second[] = "second buffer";
+    struct iovec iov[2] = {{first, 5}, {second, 13}};
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_flags = 0x40;
+
+    RemoteFetchBatch batch(memory());
+    RemoteStruct<remote_msghdr_t<>> remote_msg(addrOf(&msg));
+    EXPECT_EQ(batch.add(remote_msg).fetch(), 1);
+    ASSERT_TRUE(remote_msg.valid());
+    EXPECT_EQ(remote_msg->msg_iov, addrOf(iov));
+    EXPECT_EQ(remote_msg->msg_iovlen, 2u);
+    EXPECT_EQ(remote_msg->msg_flags, 0x40);
+
+    RemoteArray<remote_iovec_t<>> remote_iov(remote_msg->msg_iov, remote_msg->msg_iovlen);
+    EXPECT_EQ(batch.add(remote_iov).fetch(), 1);
+    ASSERT_EQ(remote_iov.size(), 2u);
+
+    std::vector<RemoteBuffer> data;
+    for (size_t i = 0; i < remote_iov.size(); i++)
+        data.push_back(RemoteBuffer(remote_iov[i].iov_base, remote_iov[i].iov_len));
+    for (auto &buf : data)
+        batch.add(buf);
+    EXPECT_EQ(batch.pending(), 2u);
+    EXPECT_EQ(batch.fetch(), 2);
+
+    EXPECT_EQ(toString(data[0]), "first");
+    EXPECT_EQ(toString(data[1]), "second buffer");
+}
+
+TEST_F(RemoteFetchBatchTest, FailureIsConfinedToItsObject)
+{
+    struct iovec value = {nullptr, 0x1122334455667788};
+    char text[] = "readable";
+
+    // a hole between two mapped pages, too small for the other mappings
+    uint8_t *pages = reinterpret_cast<uint8_t *>(
+        mmap(nullptr, 3 * 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    ASSERT_NE(pages, MAP_FAILED);
+    uint8_t *page = pages + 4096;
+    munmap(page, 4096);
+
+    RemoteFetchBatch batch(memory());
+    RemoteStruct<remote_iovec_t<>> good(addrOf(&value));
+    RemoteBuffer unmapped(addrOf(page), 64);
+    RemoteBuffer readable(addrOf(text), 8);
+    RemoteStruct<remote_iovec_t<>> null_ptr;
+
+    batch.add(good).add(unmapped).add(readable).add(null_ptr);
+    // the null pointer is never read
+    EXPECT_EQ(batch.pending(), 3u);
+    EXPECT_EQ(batch.fetch(), 2);
+
+    EXPECT_TRUE(good.valid());
+    EXPECT_EQ(good->iov_len, value.iov_len);
+    EXPECT_TRUE(unmapped.fetched());
+    EXPECT_TRUE(unmapped.view().empty());
+    EXPECT_EQ(toString(readable), "readable");
+    EXPECT_TRUE(null_ptr.fetched());
+    EXPECT_FALSE(null_ptr.valid());
+
+    munmap(pages, 4096);
+    munmap(pages + 2 * 4096, 4096);
+}
+
+TEST_F(RemoteFetchBatchTest, FetchedObjectsAreNotQueuedAgain)
+{
+    struct iovec value = {nullptr, 42};
+
+    RemoteStruct<remote_iovec_t<>> obj(addrOf(&value));
+    ASSERT_TRUE(obj.fetch(memory()));
+
+    value.iov_len = 43;
+    RemoteFetchBatch batch(memory());
+    batch.add(obj);
+    EXPECT_EQ(batch.pending(), 0u);
+    EXPECT_EQ(batch.fetch(), 0);
+    EXPECT_EQ(obj->iov_len, 42u);
+}
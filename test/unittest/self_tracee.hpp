@@ -0,0 +1,43 @@
+#ifndef H_TEST_SELF_TRACEE_H
+#define H_TEST_SELF_TRACEE_H
+
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "debugger.hpp"
+#include "tracee.hpp"
+
+/**
+ * @brief The test process is its own Tracee, nothing is traced, its
+ * RemoteMemory reads and writes the buffers of the test through
+ * process_vm_readv and /proc/<pid>/mem
+ */
+class SelfTraceeTest : public ::testing::Test {
+protected:
+    TargetDescription m_target_desc;
+    TraceeFactory m_tracee_factory;
+    TraceeProgram *m_tracee = nullptr;
+
+    /// @brief the architecture has to be enabled in config.hpp
+    explicit SelfTraceeTest(CPU_ARCH cpu_arch = TARGET_CPU_ARCH)
+    {
+        m_target_desc.m_cpu_arch = cpu_arch;
+    }
+
+    void SetUp()
+    {
+        m_tracee = m_tracee_factory.createTracee(getpid(), DebugType::DEFAULT, m_target_desc);
+        ASSERT_NE(m_tracee, nullptr);
+    }
+
+    void TearDown()
+    {
+        if (m_tracee != nullptr)
+            m_tracee_factory.destroyTracee(m_tracee);
+        m_tracee = nullptr;
+    }
+
+    RemoteMemory &memory() { return m_tracee->getDebugOpts().m_memory; }
+};
+
+#endif